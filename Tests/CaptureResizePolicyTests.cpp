@@ -0,0 +1,154 @@
+#include "pch.h"
+#include "CaptureResizePolicy.h"
+#include <random>
+
+// One frame of a recorded resize, the content size and when it arrived
+struct TraceFrame
+{
+    PixelSize Size;
+    Ticks Time;
+};
+
+int64_t const FrameTicks = 10'000'000 / 60;
+
+std::mt19937 Random(3);
+
+// A drag resize at 60fps: the window grows for a while in uneven steps,
+// rests, shrinks, rests again and then gets a few single pixel nudges
+std::vector<TraceFrame> MakeDragTrace()
+{
+    std::vector<TraceFrame> trace;
+    PixelSize size{ 800, 600 };
+    auto add = [&](int32_t frames, int32_t maxStepX, int32_t maxStepY)
+    {
+        for (int32_t i = 0; i < frames; i++)
+        {
+            if (maxStepX != 0 || maxStepY != 0)
+            {
+                size.Width += static_cast<int32_t>(Random() % (std::abs(maxStepX) + 1)) * (maxStepX < 0 ? -1 : 1);
+                size.Height += static_cast<int32_t>(Random() % (std::abs(maxStepY) + 1)) * (maxStepY < 0 ? -1 : 1);
+            }
+            trace.push_back({ size, Ticks(static_cast<int64_t>(trace.size()) * FrameTicks) });
+        }
+    };
+    add(150, 8, 5);
+    add(40, 0, 0);
+    add(80, -9, -6);
+    add(40, 0, 0);
+    for (int32_t i = 0; i < 10; i++)
+    {
+        add(1, 1, 0);
+        add(5, 0, 0);
+    }
+    return trace;
+}
+
+// Replays the trace through the policy, checking that the buffers always
+// hold the content and only settle to its exact size after the settle time
+bool ReplayTrace(std::vector<TraceFrame> const& trace, uint64_t& reallocations, uint64_t& sizeChanges)
+{
+    CaptureResizePolicy policy;
+    policy.Reset(trace.front().Size);
+    std::optional<Ticks> lastChange;
+    sizeChanges = 0;
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        auto& frame = trace[i];
+        if (i > 0 && (frame.Size.Width != trace[i - 1].Size.Width || frame.Size.Height != trace[i - 1].Size.Height))
+        {
+            sizeChanges++;
+            lastChange = frame.Time;
+        }
+        policy.Update(frame.Size, frame.Time);
+        auto buffer = policy.BufferSize();
+        if (buffer.Width < frame.Size.Width || buffer.Height < frame.Size.Height)
+        {
+            printf("FAILED: trace frame %zu doesn't fit its buffers\n", i);
+            return false;
+        }
+        auto fits = buffer.Width == frame.Size.Width && buffer.Height == frame.Size.Height;
+        auto settled = !lastChange.has_value() || frame.Time - lastChange.value() >= std::chrono::milliseconds(500);
+        if (settled && !fits)
+        {
+            printf("FAILED: trace frame %zu is settled but the buffers didn't shrink\n", i);
+            return false;
+        }
+    }
+    reallocations = policy.ReallocationCount();
+    return true;
+}
+
+bool TestDragTrace()
+{
+    uint64_t reallocations = 0;
+    uint64_t sizeChanges = 0;
+    if (!ReplayTrace(MakeDragTrace(), reallocations, sizeChanges))
+    {
+        return false;
+    }
+    printf("Drag trace: %llu reallocations instead of %llu\n",
+        static_cast<unsigned long long>(reallocations), static_cast<unsigned long long>(sizeChanges));
+    // Growing goes a bucket at a time and shrinking waits for the size to
+    // settle, so only a handful of the size changes cost a reallocation
+    if (reallocations * 10 > sizeChanges)
+    {
+        printf("FAILED: too many reallocations\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestShrinkDeadline()
+{
+    CaptureResizePolicy policy(256, std::chrono::milliseconds(500));
+    policy.Reset({ 800, 600 });
+    if (policy.ShrinkDeadline().has_value())
+    {
+        printf("FAILED: nothing to shrink after a reset\n");
+        return false;
+    }
+
+    // Grow into a bucket, and then nothing more arrives
+    auto grown = policy.Update({ 900, 650 }, Ticks(0));
+    if (!grown.has_value() || grown->Width != 1024 || grown->Height != 768)
+    {
+        printf("FAILED: growing should round up to the bucket\n");
+        return false;
+    }
+    auto deadline = policy.ShrinkDeadline();
+    if (!deadline.has_value() || deadline.value() != std::chrono::milliseconds(500))
+    {
+        printf("FAILED: the shrink deadline should be the settle time after the last change\n");
+        return false;
+    }
+    // What the capture's timer does when no frames arrive
+    if (policy.Update({ 900, 650 }, std::chrono::milliseconds(499)).has_value())
+    {
+        printf("FAILED: shrank before the deadline\n");
+        return false;
+    }
+    auto shrunk = policy.Update({ 900, 650 }, deadline.value());
+    if (!shrunk.has_value() || shrunk->Width != 900 || shrunk->Height != 650 || policy.ShrinkDeadline().has_value())
+    {
+        printf("FAILED: should shrink to fit at the deadline\n");
+        return false;
+    }
+
+    // Minimized windows report an empty size, the buffers can't be empty
+    policy.Reset({ 0, 0 });
+    if (policy.BufferSize().Width != 1 || policy.BufferSize().Height != 1)
+    {
+        printf("FAILED: empty sizes should become 1x1\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    auto passed = true;
+    passed = TestDragTrace() && passed;
+    passed = TestShrinkDeadline() && passed;
+    printf(passed ? "All resize policy tests passed\n" : "Some resize policy tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
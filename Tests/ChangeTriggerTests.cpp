@@ -0,0 +1,182 @@
+#include "pch.h"
+#include "ChangeTrigger.h"
+#include <random>
+
+uint32_t const Width = 1920;
+uint32_t const Height = 1080;
+uint32_t const Stride = Width * 4;
+// Frames and polls are simulated on a millisecond clock
+int32_t const StepMilliseconds = 1;
+
+std::mt19937 Random(1);
+
+class Screen
+{
+public:
+    Screen() : m_pixels(Stride * Height, 240) {}
+
+    uint8_t const* Pixels() const { return m_pixels.data(); }
+
+    void Fill(PixelRect const& rect, uint8_t value)
+    {
+        Paint(rect, [value]() { return value; });
+    }
+
+    // Random gray pixels, like text or video
+    void Scribble(PixelRect const& rect)
+    {
+        Paint(rect, []() { return static_cast<uint8_t>(Random()); });
+    }
+
+private:
+    template <typename Function>
+    void Paint(PixelRect const& rect, Function value)
+    {
+        for (auto y = rect.Top; y < rect.Bottom; y++)
+        {
+            for (auto x = rect.Left; x < rect.Right; x++)
+            {
+                auto pixel = &m_pixels[y * Stride + x * 4];
+                pixel[0] = pixel[1] = pixel[2] = value();
+            }
+        }
+    }
+
+private:
+    std::vector<uint8_t> m_pixels;
+};
+
+// Plays a scene and returns when the trigger fired, in milliseconds. The
+// first frame is the whole screen, after that the scene draws and returns
+// the dirty rect whenever it has a frame. Deadline and Poll are used in
+// between frames the same way the capture does.
+std::vector<int32_t> Play(
+    ChangeTriggerSettings const& settings,
+    int32_t durationMilliseconds,
+    std::function<std::optional<PixelRect>(Screen&, int32_t)> scene)
+{
+    Screen screen;
+    ChangeTrigger trigger(settings);
+    std::vector<int32_t> fired;
+    for (int32_t time = 0; time < durationMilliseconds; time += StepMilliseconds)
+    {
+        auto now = Ticks(std::chrono::milliseconds(time));
+        auto dirtyRect = time == 0 ? std::optional(PixelRect{ 0, 0, static_cast<int32_t>(Width), static_cast<int32_t>(Height) }) : scene(screen, time);
+        if (dirtyRect.has_value())
+        {
+            if (trigger.OnFrame(now, screen.Pixels(), Width, Height, Stride, std::vector<PixelRect>{ dirtyRect.value() }))
+            {
+                fired.push_back(time);
+            }
+        }
+        else
+        {
+            auto deadline = trigger.Deadline();
+            if (deadline.has_value() && now >= deadline.value() && trigger.Poll(now))
+            {
+                fired.push_back(time);
+            }
+        }
+    }
+    return fired;
+}
+
+bool Expect(char const* name, std::vector<int32_t> const& fired, std::vector<int32_t> const& expected)
+{
+    if (fired != expected)
+    {
+        printf("FAILED: %s, fired at", name);
+        for (auto&& time : fired)
+        {
+            printf(" %d", time);
+        }
+        printf(" instead of");
+        for (auto&& time : expected)
+        {
+            printf(" %d", time);
+        }
+        printf("\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    ChangeTriggerSettings settings;
+    auto debounce = static_cast<int32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(settings.Debounce).count());
+    auto maxDelay = static_cast<int32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(settings.MaxDelay).count());
+    auto passed = true;
+
+    // A blinking caret keeps the first frame from settling, so it fires at
+    // MaxDelay, and the caret is too small to count after that
+    passed = Expect("caret", Play(settings, 10000, [](Screen& screen, int32_t time) -> std::optional<PixelRect>
+    {
+        if (time % 500 != 0)
+        {
+            return std::nullopt;
+        }
+        PixelRect caret{ 100, 100, 102, 116 };
+        screen.Fill(caret, (time / 500) % 2 ? 0 : 240);
+        return caret;
+    }), { maxDelay }) && passed;
+
+    // Typing fires once it stops, even though each key alone is too small.
+    // It's still the same change as the first frame until then.
+    int32_t const typingEnd = 3000;
+    passed = Expect("typing", Play(settings, 10000, [](Screen& screen, int32_t time) -> std::optional<PixelRect>
+    {
+        if (time % 150 != 0 || time > typingEnd)
+        {
+            return std::nullopt;
+        }
+        auto left = 100 + (time / 150) * 8;
+        PixelRect glyph{ left, 200, left + 8, 216 };
+        screen.Scribble(glyph);
+        return glyph;
+    }), { typingEnd + debounce }) && passed;
+
+    // Video never settles, so it fires every MaxDelay instead
+    auto video = Play(settings, 12000, [](Screen& screen, int32_t time) -> std::optional<PixelRect>
+    {
+        if (time % 33 != 0)
+        {
+            return std::nullopt;
+        }
+        PixelRect frame{ 400, 300, 1040, 660 };
+        screen.Scribble(frame);
+        return frame;
+    });
+    // The cooldown is shorter, so only the frame after MaxDelay is late
+    if (video.size() != 2 || video[0] != maxDelay || video[1] - video[0] < maxDelay || video[1] - video[0] > maxDelay + 33)
+    {
+        passed = Expect("video", video, { maxDelay, 2 * maxDelay }) && passed;
+    }
+
+    // Only the watched region counts
+    auto watched = settings;
+    watched.Regions = { PixelRect{ 0, 0, 400, 200 } };
+    passed = Expect("outside the region", Play(watched, 5000, [](Screen& screen, int32_t time) -> std::optional<PixelRect>
+    {
+        if (time % 100 != 0)
+        {
+            return std::nullopt;
+        }
+        PixelRect outside{ 800, 600, 900, 700 };
+        screen.Scribble(outside);
+        return outside;
+    }), { debounce }) && passed;
+    passed = Expect("inside the region", Play(watched, 5000, [](Screen& screen, int32_t time) -> std::optional<PixelRect>
+    {
+        if (time != 2000)
+        {
+            return std::nullopt;
+        }
+        PixelRect inside{ 10, 10, 200, 100 };
+        screen.Scribble(inside);
+        return inside;
+    }), { debounce, 2000 + debounce }) && passed;
+
+    printf(passed ? "All change trigger tests passed\n" : "Some change trigger tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "DamageTracker.h"
+#include <random>
+
+// Frames of dirty rects on a 1080p screen, accumulated by a consumer that
+// only takes every tenth frame
+int32_t const ScreenWidth = 1920;
+int32_t const ScreenHeight = 1080;
+uint32_t const FrameCount = 600;
+uint32_t const FramesPerTake = 10;
+
+int main()
+{
+    std::mt19937 random(11);
+    std::uniform_int_distribution<LONG> x(0, ScreenWidth - 1);
+    std::uniform_int_distribution<LONG> y(0, ScreenHeight - 1);
+    std::uniform_int_distribution<LONG> size(1, 300);
+    for (uint32_t rectsPerFrame : { 4u, 32u, 256u })
+    {
+        // Mostly wide and short, like lines of text
+        std::vector<std::vector<RECT>> frames(FrameCount);
+        for (auto&& frame : frames)
+        {
+            for (uint32_t i = 0; i < rectsPerFrame; i++)
+            {
+                auto left = x(random);
+                auto top = y(random);
+                frame.push_back({ left, top, left + size(random), top + size(random) / 4 + 1 });
+            }
+        }
+
+        DamageTracker tracker;
+        auto consumer = tracker.AddConsumer();
+        tracker.Take(consumer);
+        size_t rectsTaken = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < FrameCount; i++)
+        {
+            tracker.AddFrame(frames[i]);
+            if (i % FramesPerTake == FramesPerTake - 1)
+            {
+                rectsTaken += tracker.Take(consumer)->size();
+            }
+        }
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+        printf("%3u rects per frame: %.3f ms per frame, %.0f rects taken for every %u added\n",
+            rectsPerFrame,
+            elapsed.count() / FrameCount,
+            static_cast<double>(rectsTaken) / (FrameCount / FramesPerTake),
+            rectsPerFrame * FramesPerTake);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "pch.h"
+#include "DamageRegion.h"
+#include "DamageTracker.h"
+#include <random>
+
+// Random rects are placed on a small grid so that they overlap and touch a
+// lot, and some hang over its edges or are empty
+int32_t const GridSize = 48;
+// Room around the grid in the oracle for the rects that hang over
+int32_t const Margin = 40;
+int32_t const BitmapSize = GridSize + 2 * Margin;
+uint32_t const FuzzIterations = 20000;
+uint32_t const MaxRectsPerRegion = 12;
+
+// The pixels a region should cover, painted one by one
+class Bitmap
+{
+public:
+    Bitmap() : m_pixels(BitmapSize * BitmapSize, 0) {}
+
+    void Paint(RECT const& rect)
+    {
+        for (auto y = rect.top; y < rect.bottom; y++)
+        {
+            for (auto x = rect.left; x < rect.right; x++)
+            {
+                Pixel(x, y) = 1;
+            }
+        }
+    }
+
+    // Fails if the rect covers a pixel that's already painted
+    bool PaintExclusive(RECT const& rect)
+    {
+        for (auto y = rect.top; y < rect.bottom; y++)
+        {
+            for (auto x = rect.left; x < rect.right; x++)
+            {
+                if (Pixel(x, y) != 0)
+                {
+                    return false;
+                }
+                Pixel(x, y) = 1;
+            }
+        }
+        return true;
+    }
+
+    int64_t Area() const { return std::count(m_pixels.begin(), m_pixels.end(), uint8_t(1)); }
+    bool operator==(Bitmap const& other) const { return m_pixels == other.m_pixels; }
+
+private:
+    uint8_t& Pixel(LONG x, LONG y) { return m_pixels[(y + Margin) * BitmapSize + x + Margin]; }
+
+private:
+    std::vector<uint8_t> m_pixels;
+};
+
+std::mt19937 Random(11);
+
+RECT RandomRect(int32_t maxSize)
+{
+    auto left = static_cast<LONG>(Random() % (GridSize + 8)) - 4;
+    auto top = static_cast<LONG>(Random() % (GridSize + 8)) - 4;
+    // Sizes of -1 and 0 make empty rects
+    auto width = static_cast<LONG>(Random() % maxSize) - 1;
+    auto height = static_cast<LONG>(Random() % maxSize) - 1;
+    return { left, top, left + width, top + height };
+}
+
+// Checks that the region covers exactly the oracle's pixels and that its
+// rects come out in the banded form the class promises
+bool MatchesOracle(DamageRegion const& region, Bitmap const& oracle, char const*& failure)
+{
+    auto rects = region.Rects();
+    Bitmap covered;
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        auto& rect = rects[i];
+        if (rect.left >= rect.right || rect.top >= rect.bottom)
+        {
+            failure = "empty rect";
+            return false;
+        }
+        if (!covered.PaintExclusive(rect))
+        {
+            failure = "overlapping rects";
+            return false;
+        }
+        if (i > 0)
+        {
+            auto& previous = rects[i - 1];
+            if (previous.top == rect.top)
+            {
+                // Spans in a band share its height, are in order and don't touch
+                if (previous.bottom != rect.bottom || previous.right >= rect.left)
+                {
+                    failure = "spans out of order";
+                    return false;
+                }
+            }
+            else if (rect.top < previous.bottom)
+            {
+                failure = "bands out of order";
+                return false;
+            }
+        }
+    }
+
+    // Bands that touch must have different spans, or they'd be one band
+    std::vector<std::pair<LONG, LONG>> bandRows;
+    std::vector<std::vector<std::pair<LONG, LONG>>> bandSpans;
+    for (auto&& rect : rects)
+    {
+        if (bandRows.empty() || bandRows.back().first != rect.top)
+        {
+            bandRows.push_back({ rect.top, rect.bottom });
+            bandSpans.push_back({});
+        }
+        bandSpans.back().push_back({ rect.left, rect.right });
+    }
+    for (size_t i = 1; i < bandRows.size(); i++)
+    {
+        if (bandRows[i].first == bandRows[i - 1].second && bandSpans[i] == bandSpans[i - 1])
+        {
+            failure = "bands not merged";
+            return false;
+        }
+    }
+
+    if (region.Area() != covered.Area())
+    {
+        failure = "wrong area";
+        return false;
+    }
+    if (!(covered == oracle))
+    {
+        failure = "different pixels than the oracle";
+        return false;
+    }
+    return true;
+}
+
+bool FuzzRegions()
+{
+    for (uint32_t iteration = 0; iteration < FuzzIterations; iteration++)
+    {
+        auto count = Random() % MaxRectsPerRegion;
+        // Alternate between small and large rects
+        auto maxSize = iteration % 2 ? 8 : 30;
+        std::vector<RECT> rects;
+        Bitmap oracle;
+        DamageRegion incremental;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto rect = RandomRect(maxSize);
+            rects.push_back(rect);
+            oracle.Paint(rect);
+            incremental.Union(rect);
+        }
+
+        DamageRegion batch(rects);
+        auto shuffledRects = rects;
+        std::shuffle(shuffledRects.begin(), shuffledRects.end(), Random);
+        DamageRegion shuffled(shuffledRects);
+        std::span<RECT const> allRects(rects);
+        DamageRegion halves(allRects.first(count / 2));
+        halves.Union(DamageRegion(allRects.subspan(count / 2)));
+        auto batchRects = batch.Rects();
+        DamageRegion rebuilt(batchRects);
+
+        char const* failure = nullptr;
+        if (!MatchesOracle(incremental, oracle, failure) || !MatchesOracle(batch, oracle, failure))
+        {
+            printf("FAILED: region on iteration %u, %s\n", iteration, failure);
+            return false;
+        }
+        // The banded form is canonical, so however the region was built
+        // it has to come out the same
+        if (!(incremental == batch) || !(shuffled == batch) || !(halves == batch) || !(rebuilt == batch))
+        {
+            printf("FAILED: region on iteration %u, differs by how it was built\n", iteration);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestBounds()
+{
+    DamageRegion region;
+    region.Union(RECT{ 10, 20, 30, 40 });
+    region.Union(RECT{ -5, 50, 0, 60 });
+    auto bounds = region.Bounds();
+    if (bounds.left != -5 || bounds.top != 20 || bounds.right != 30 || bounds.bottom != 60)
+    {
+        printf("FAILED: bounds\n");
+        return false;
+    }
+    region.Clear();
+    if (!region.IsEmpty() || region.Area() != 0 || !region.Rects().empty())
+    {
+        printf("FAILED: clear\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestTracker()
+{
+    DamageTracker tracker;
+    auto first = tracker.AddConsumer();
+    auto second = tracker.AddConsumer();
+    if (tracker.Take(first).has_value())
+    {
+        printf("FAILED: tracker, a new consumer should need the whole frame\n");
+        return false;
+    }
+
+    tracker.AddFrame(std::vector<RECT>{ { 0, 0, 10, 10 } });
+    tracker.AddFrame(std::vector<RECT>{ { 5, 5, 20, 20 } });
+    auto accumulated = tracker.Take(first);
+    if (!accumulated.has_value() || DamageRegion(std::span<RECT const>(accumulated.value())).Area() != 100 + 225 - 25)
+    {
+        printf("FAILED: tracker, frames should accumulate\n");
+        return false;
+    }
+    // Taking doesn't affect other consumers, which still need everything
+    if (tracker.Take(second).has_value())
+    {
+        printf("FAILED: tracker, consumers should be independent\n");
+        return false;
+    }
+    auto taken = tracker.Take(first);
+    if (!taken.has_value() || !taken->empty())
+    {
+        printf("FAILED: tracker, taking should clear the consumer\n");
+        return false;
+    }
+
+    tracker.AddFrame(std::nullopt);
+    tracker.AddFrame(std::vector<RECT>{ { 0, 0, 1, 1 } });
+    if (tracker.Take(first).has_value())
+    {
+        printf("FAILED: tracker, an unknown frame should mean everything\n");
+        return false;
+    }
+    tracker.AddFrame(std::vector<RECT>{ { 0, 0, 1, 1 } });
+    tracker.Invalidate(first);
+    if (tracker.Take(first).has_value())
+    {
+        printf("FAILED: tracker, invalidating should mean everything\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    auto passed = true;
+    passed = FuzzRegions() && passed;
+    passed = TestBounds() && passed;
+    passed = TestTracker() && passed;
+    printf(passed ? "All damage region tests passed\n" : "Some damage region tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "pch.h"
+#include "DeflateEncoder.h"
+#include "DeflateDecoder.h"
+#include "TestImages.h"
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Compresses, checks the zlib wrapping, and decompresses again with our own
+// decoder and, when it's around, with zlib itself
+bool CheckRoundTrip(char const* name, std::vector<uint8_t> const& input)
+{
+    auto compressed = DeflateEncoder::Compress(input);
+    if (compressed.size() < 6)
+    {
+        printf("FAILED: %s, the stream is only %zu bytes\n", name, compressed.size());
+        return false;
+    }
+    // Deflate with a 32K window, and a header check that zlib accepts
+    if ((compressed[0] & 0x0F) != 8 || (compressed[0] >> 4) > 7 || (compressed[0] * 256 + compressed[1]) % 31 != 0 || (compressed[1] & 0x20) != 0)
+    {
+        printf("FAILED: %s, the zlib header is %02X %02X\n", name, compressed[0], compressed[1]);
+        return false;
+    }
+    auto trailer = compressed.data() + compressed.size() - 4;
+    auto adler = (static_cast<uint32_t>(trailer[0]) << 24) | (static_cast<uint32_t>(trailer[1]) << 16) | (static_cast<uint32_t>(trailer[2]) << 8) | trailer[3];
+    if (adler != ComputeAdler32(input))
+    {
+        printf("FAILED: %s, the stream ends with the wrong checksum\n", name);
+        return false;
+    }
+
+    std::vector<uint8_t> output(input.size());
+    try
+    {
+        auto used = DeflateDecoder::Decompress(compressed, output);
+        if (used != compressed.size() || output != input)
+        {
+            printf("FAILED: %s didn't come back the same\n", name);
+            return false;
+        }
+    }
+    catch (winrt::hresult_error const&)
+    {
+        printf("FAILED: %s, the decoder rejected the stream\n", name);
+        return false;
+    }
+
+#ifdef HAVE_ZLIB
+    std::vector<uint8_t> zlibOutput(input.size() + 1);
+    auto zlibSize = static_cast<uLongf>(zlibOutput.size());
+    if (uncompress(zlibOutput.data(), &zlibSize, compressed.data(), static_cast<uLong>(compressed.size())) != Z_OK ||
+        zlibSize != input.size() || !std::equal(input.begin(), input.end(), zlibOutput.begin()))
+    {
+        printf("FAILED: %s, zlib didn't decompress the stream to the input\n", name);
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool TestRoundTrips()
+{
+    std::mt19937 random(1);
+    std::vector<std::pair<char const*, std::vector<uint8_t>>> inputs;
+    inputs.push_back({ "nothing", {} });
+    inputs.push_back({ "one byte", { 42 } });
+    inputs.push_back({ "zeros", std::vector<uint8_t>(1 << 20, 0) });
+
+    std::vector<uint8_t> noise(300'000);
+    for (auto&& value : noise)
+    {
+        value = static_cast<uint8_t>(random());
+    }
+    inputs.push_back({ "noise", noise });
+
+    // Repeats at every distance up to past the window, and matches longer
+    // than the longest one deflate can express
+    for (size_t period : { size_t(1), size_t(2), size_t(3), size_t(257), size_t(259), size_t(32767), size_t(32768), size_t(32769) })
+    {
+        std::vector<uint8_t> repeated(period);
+        for (auto&& value : repeated)
+        {
+            value = static_cast<uint8_t>(random());
+        }
+        while (repeated.size() < 3 * period + 1000)
+        {
+            repeated.push_back(repeated[repeated.size() - period]);
+        }
+        inputs.push_back({ "repeats", repeated });
+    }
+
+    // Few symbols, so the Huffman codes get very uneven
+    std::vector<uint8_t> skewed(200'000);
+    std::geometric_distribution<int> geometric(0.3);
+    for (auto&& value : skewed)
+    {
+        value = static_cast<uint8_t>(std::min(geometric(random), 255));
+    }
+    inputs.push_back({ "skewed", skewed });
+
+    std::string text;
+    char const* words[] = { "capture ", "frame ", "window ", "monitor ", "snapshot ", "pixel ", "\n" };
+    while (text.size() < 100'000)
+    {
+        text += words[random() % std::size(words)];
+    }
+    inputs.push_back({ "text", std::vector<uint8_t>(text.begin(), text.end()) });
+    inputs.push_back({ "UI image", MakeUiImage(800, 600, 2) });
+
+    for (auto&& [name, input] : inputs)
+    {
+        if (!CheckRoundTrip(name, input))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lots of short random inputs, where block and bit boundaries land
+// everywhere
+bool TestManySmallInputs()
+{
+    std::mt19937 random(5);
+    for (int i = 0; i < 2000; i++)
+    {
+        std::vector<uint8_t> input(random() % 600);
+        auto alphabet = 1 + random() % 8;
+        for (auto&& value : input)
+        {
+            value = static_cast<uint8_t>(random() % alphabet);
+        }
+        if (!CheckRoundTrip("small input", input))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestAdler32()
+{
+    std::string wikipedia = "Wikipedia";
+    if (ComputeAdler32({}) != 1 || ComputeAdler32(std::span(reinterpret_cast<uint8_t const*>(wikipedia.data()), wikipedia.size())) != 0x11E60398)
+    {
+        printf("FAILED: Adler-32 doesn't match the known values\n");
+        return false;
+    }
+    // Long runs of 0xFF are where the sums overflow first if they're
+    // reduced too late
+    for (size_t size : { size_t(5552), size_t(5553), size_t(1 << 20) })
+    {
+        std::vector<uint8_t> input(size, 0xFF);
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (auto&& value : input)
+        {
+            a = (a + value) % 65521;
+            b = (b + a) % 65521;
+        }
+        if (ComputeAdler32(input) != ((b << 16) | a))
+        {
+            printf("FAILED: Adler-32 of %zu bytes of 0xFF is wrong\n", size);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Broken streams are rejected rather than read past their end
+bool TestCorruptStreams()
+{
+    auto input = MakeUiImage(200, 100, 3);
+    auto compressed = DeflateEncoder::Compress(input);
+    std::vector<uint8_t> output(input.size());
+    auto rejects = [&](std::vector<uint8_t> const& stream, size_t outputSize)
+    {
+        std::vector<uint8_t> target(outputSize);
+        try
+        {
+            DeflateDecoder::Decompress(stream, target);
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            return error.code() == E_INVALIDARG;
+        }
+        return false;
+    };
+
+    auto flipBit = [&](size_t position)
+    {
+        auto stream = compressed;
+        stream.at(position) ^= 1;
+        return stream;
+    };
+    auto badChecksum = flipBit(compressed.size() - 1);
+    auto badHeader = flipBit(1);
+    auto truncated = std::vector<uint8_t>(compressed.begin(), compressed.begin() + compressed.size() / 2);
+    if (!rejects(badChecksum, input.size()) || !rejects(badHeader, input.size()) || !rejects(truncated, input.size()))
+    {
+        printf("FAILED: a corrupt stream was accepted\n");
+        return false;
+    }
+    if (!rejects(compressed, input.size() - 1) || !rejects(compressed, input.size() + 1))
+    {
+        printf("FAILED: a stream was accepted into the wrong size of output\n");
+        return false;
+    }
+
+    // Random damage anywhere must never crash, and either fails or happens
+    // to still decode to something of the right size
+    std::mt19937 random(9);
+    for (int i = 0; i < 500; i++)
+    {
+        auto damaged = compressed;
+        damaged[2 + random() % (damaged.size() - 2)] ^= static_cast<uint8_t>(1 + random() % 255);
+        try
+        {
+            DeflateDecoder::Decompress(damaged, output);
+        }
+        catch (winrt::hresult_error const&)
+        {
+        }
+    }
+    return true;
+}
+
+#ifdef HAVE_ZLIB
+// Our decoder reads what zlib writes at every level, which covers stored,
+// fixed and dynamic Huffman blocks
+bool TestDecodesZlib()
+{
+    auto input = MakeUiImage(640, 480, 4);
+    for (int level : { 0, 1, 6, 9 })
+    {
+        std::vector<uint8_t> compressed(compressBound(static_cast<uLong>(input.size())));
+        auto size = static_cast<uLongf>(compressed.size());
+        if (compress2(compressed.data(), &size, input.data(), static_cast<uLong>(input.size()), level) != Z_OK)
+        {
+            printf("FAILED: zlib couldn't compress at level %d\n", level);
+            return false;
+        }
+        compressed.resize(size);
+        std::vector<uint8_t> output(input.size());
+        try
+        {
+            DeflateDecoder::Decompress(compressed, output);
+        }
+        catch (winrt::hresult_error const&)
+        {
+            printf("FAILED: zlib's level %d stream was rejected\n", level);
+            return false;
+        }
+        if (output != input)
+        {
+            printf("FAILED: zlib's level %d stream didn't decode to the input\n", level);
+            return false;
+        }
+    }
+    // Short inputs get fixed Huffman blocks
+    std::string hello = "hello hello hello hello";
+    std::vector<uint8_t> compressed(compressBound(static_cast<uLong>(hello.size())));
+    auto size = static_cast<uLongf>(compressed.size());
+    compress2(compressed.data(), &size, reinterpret_cast<uint8_t const*>(hello.data()), static_cast<uLong>(hello.size()), 9);
+    compressed.resize(size);
+    std::vector<uint8_t> output(hello.size());
+    DeflateDecoder::Decompress(compressed, output);
+    if (!std::equal(output.begin(), output.end(), hello.begin()))
+    {
+        printf("FAILED: zlib's fixed Huffman stream didn't decode\n");
+        return false;
+    }
+
+    // And ours isn't far behind zlib's default level on screen content
+    auto ours = DeflateEncoder::Compress(input);
+    std::vector<uint8_t> theirs(compressBound(static_cast<uLong>(input.size())));
+    size = static_cast<uLongf>(theirs.size());
+    compress2(theirs.data(), &size, input.data(), static_cast<uLong>(input.size()), Z_DEFAULT_COMPRESSION);
+    printf("640x480 UI image: %zu bytes, zlib's default level %lu bytes\n", ours.size(), static_cast<unsigned long>(size));
+    if (ours.size() > size * 3 / 2)
+    {
+        printf("FAILED: the encoder is far behind zlib\n");
+        return false;
+    }
+    return true;
+}
+#endif
+
+int main()
+{
+    bool passed = true;
+    passed = TestRoundTrips() && passed;
+    passed = TestManySmallInputs() && passed;
+    passed = TestAdler32() && passed;
+    passed = TestCorruptStreams() && passed;
+#ifdef HAVE_ZLIB
+    passed = TestDecodesZlib() && passed;
+#else
+    printf("zlib wasn't found, only checked against our own decoder\n");
+#endif
+
+    if (passed)
+    {
+        printf("All DeflateEncoder tests passed\n");
+        return 0;
+    }
+    printf("Some DeflateEncoder tests failed\n");
+    return 1;
+}
\ No newline at end of file
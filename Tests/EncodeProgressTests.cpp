@@ -0,0 +1,200 @@
+#include "pch.h"
+#include "EncodeProgress.h"
+
+// What an encode reported, and a switch to cancel it part way
+struct ProgressLog
+{
+    std::vector<double> Reported;
+    bool Canceled = false;
+
+    EncodeProgress Make()
+    {
+        return EncodeProgress([this](double value) { Reported.push_back(value); }, [this]() { return Canceled; });
+    }
+};
+
+bool CheckIncreasing(char const* name, std::vector<double> const& reported)
+{
+    for (size_t i = 1; i < reported.size(); i++)
+    {
+        if (reported[i] <= reported[i - 1])
+        {
+            printf("FAILED: %s, progress went from %f to %f\n", name, reported[i - 1], reported[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs the steps of a WIC encode the way the encoder does
+bool Encode(EncodeProgress& progress, uint32_t height, uint32_t rowsPerChunk)
+{
+    if (!progress.Started() || !progress.ReadBack() || !progress.Prepared())
+    {
+        return false;
+    }
+    for (uint32_t row = 0; row < height; row += rowsPerChunk)
+    {
+        auto rows = std::min(rowsPerChunk, height - row);
+        if (!progress.WroteRows(row + rows, height))
+        {
+            return false;
+        }
+    }
+    return progress.Encoded() && progress.Saved();
+}
+
+bool TestFullEncode()
+{
+    ProgressLog log;
+    auto progress = log.Make();
+    if (!Encode(progress, 1080, 64))
+    {
+        printf("FAILED: an encode that wasn't canceled stopped\n");
+        return false;
+    }
+    if (!CheckIncreasing("full encode", log.Reported))
+    {
+        return false;
+    }
+    // Started, read back, prepared, 17 chunks and saved; the last chunk
+    // already reached the encoded mark
+    if (log.Reported.size() != 21 || log.Reported.front() != 0.0 || log.Reported.back() != 1.0)
+    {
+        printf("FAILED: full encode reported %zu values from %f to %f\n", log.Reported.size(), log.Reported.front(), log.Reported.back());
+        return false;
+    }
+    if (std::abs(log.Reported[log.Reported.size() - 2] - 0.9) > 1e-9)
+    {
+        printf("FAILED: writing every row reached %f, not 0.9\n", log.Reported[log.Reported.size() - 2]);
+        return false;
+    }
+    return true;
+}
+
+// Formats that don't go through WIC skip the rows and jump to encoded
+bool TestEncodeWithoutRows()
+{
+    ProgressLog log;
+    auto progress = log.Make();
+    if (!progress.Started() || !progress.ReadBack() || !progress.Encoded() || !progress.Saved())
+    {
+        printf("FAILED: an encode without rows stopped\n");
+        return false;
+    }
+    std::vector<double> expected = { 0.0, 0.2, 0.9, 1.0 };
+    if (log.Reported != expected)
+    {
+        printf("FAILED: an encode without rows reported the wrong steps\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestZeroHeight()
+{
+    ProgressLog log;
+    auto progress = log.Make();
+    if (!Encode(progress, 0, 64) || !progress.WroteRows(0, 0))
+    {
+        printf("FAILED: an empty image stopped the encode\n");
+        return false;
+    }
+    for (auto&& value : log.Reported)
+    {
+        if (!std::isfinite(value) || value < 0.0 || value > 1.0)
+        {
+            printf("FAILED: an empty image reported %f\n", value);
+            return false;
+        }
+    }
+    return CheckIncreasing("zero height", log.Reported);
+}
+
+// Rows written past the height, or reported again, don't move progress
+// past where writing ends or report it twice
+bool TestRowsAreClamped()
+{
+    ProgressLog log;
+    auto progress = log.Make();
+    progress.Prepared();
+    progress.WroteRows(50, 100);
+    progress.WroteRows(50, 100);
+    progress.WroteRows(10, 100);
+    progress.WroteRows(500, 100);
+    if (log.Reported.size() != 3 || std::abs(log.Reported.back() - 0.9) > 1e-9)
+    {
+        printf("FAILED: repeated and overlong rows reported %zu values ending at %f\n", log.Reported.size(), log.Reported.back());
+        return false;
+    }
+    return CheckIncreasing("clamped rows", log.Reported);
+}
+
+// Canceling at any step stops the encode there, and nothing after it is
+// reported even if the encode carried on asking
+bool TestCancelAtEveryStep()
+{
+    ProgressLog complete;
+    auto reference = complete.Make();
+    Encode(reference, 300, 64);
+    auto steps = complete.Reported.size();
+
+    for (size_t cancelAfter = 0; cancelAfter < steps; cancelAfter++)
+    {
+        ProgressLog log;
+        auto progress = EncodeProgress([&](double value)
+        {
+            log.Reported.push_back(value);
+            if (log.Reported.size() == cancelAfter + 1)
+            {
+                log.Canceled = true;
+            }
+        }, [&]() { return log.Canceled; });
+        auto finished = Encode(progress, 300, 64);
+        if (finished != (cancelAfter + 1 == steps))
+        {
+            printf("FAILED: canceling after step %zu %s the encode\n", cancelAfter, finished ? "didn't stop" : "stopped");
+            return false;
+        }
+        // Canceling can't be undone
+        log.Canceled = false;
+        if (progress.Saved() != finished || log.Reported.size() != cancelAfter + 1)
+        {
+            printf("FAILED: progress was reported after canceling at step %zu\n", cancelAfter);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestCanceledBeforeStart()
+{
+    ProgressLog log;
+    log.Canceled = true;
+    auto progress = log.Make();
+    if (progress.Started() || !log.Reported.empty())
+    {
+        printf("FAILED: an encode canceled before it started reported progress\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestFullEncode() && passed;
+    passed = TestEncodeWithoutRows() && passed;
+    passed = TestZeroHeight() && passed;
+    passed = TestRowsAreClamped() && passed;
+    passed = TestCancelAtEveryStep() && passed;
+    passed = TestCanceledBeforeStart() && passed;
+
+    if (passed)
+    {
+        printf("All EncodeProgress tests passed\n");
+        return 0;
+    }
+    printf("Some EncodeProgress tests failed\n");
+    return 1;
+}
\ No newline at end of file
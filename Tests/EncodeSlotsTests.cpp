@@ -0,0 +1,245 @@
+#include "pch.h"
+#include "EncodeSlots.h"
+#include <random>
+
+// Lets a simulated encode wait for its slot the way the encoder waits on
+// the event it hands to Acquire
+class SlotWaiter
+{
+public:
+    std::function<void()> Callback()
+    {
+        return [this]()
+        {
+            auto lock = std::scoped_lock(m_lock);
+            m_acquired = true;
+            m_acquiredOn = std::this_thread::get_id();
+            m_signal.notify_all();
+        };
+    }
+
+    bool Acquired()
+    {
+        auto lock = std::scoped_lock(m_lock);
+        return m_acquired;
+    }
+
+    std::thread::id Wait()
+    {
+        auto lock = std::unique_lock(m_lock);
+        m_signal.wait(lock, [this]() { return m_acquired; });
+        return m_acquiredOn;
+    }
+
+private:
+    std::mutex m_lock;
+    std::condition_variable m_signal;
+    bool m_acquired = false;
+    std::thread::id m_acquiredOn;
+};
+
+bool TestFreeSlotsAreImmediate()
+{
+    EncodeSlots slots(2);
+    SlotWaiter first;
+    SlotWaiter second;
+    SlotWaiter third;
+    slots.Acquire(first.Callback());
+    slots.Acquire(second.Callback());
+    slots.Acquire(third.Callback());
+    if (!first.Acquired() || !second.Acquired())
+    {
+        printf("FAILED: a free slot wasn't handed out right away\n");
+        return false;
+    }
+    if (third.Acquired())
+    {
+        printf("FAILED: more encodes than slots were let through\n");
+        return false;
+    }
+    slots.Release();
+    if (!third.Acquired())
+    {
+        printf("FAILED: a released slot didn't go to the waiting encode\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestZeroSlotsStillEncode()
+{
+    EncodeSlots slots(0);
+    SlotWaiter waiter;
+    slots.Acquire(waiter.Callback());
+    if (!waiter.Acquired())
+    {
+        printf("FAILED: zero slots never let an encode run\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestSlotsAreFirstComeFirstServed()
+{
+    EncodeSlots slots(1);
+    std::vector<int> order;
+    slots.Acquire([&]() { order.push_back(0); });
+    for (int i = 1; i <= 5; i++)
+    {
+        slots.Acquire([&order, i]() { order.push_back(i); });
+    }
+    // A slot freed while others wait goes to the queue, not to a newcomer
+    slots.Release();
+    slots.Acquire([&]() { order.push_back(6); });
+    for (int i = 0; i < 6; i++)
+    {
+        slots.Release();
+    }
+    std::vector<int> expected = { 0, 1, 2, 3, 4, 5, 6 };
+    if (order != expected)
+    {
+        printf("FAILED: slots weren't handed out in the order they were asked for\n");
+        return false;
+    }
+    // Everything was released, so the one slot is free again, and only one
+    bool acquired = false;
+    slots.Acquire([&]() { acquired = true; });
+    if (!acquired)
+    {
+        printf("FAILED: a released slot was lost\n");
+        return false;
+    }
+    acquired = false;
+    slots.Acquire([&]() { acquired = true; });
+    if (acquired)
+    {
+        printf("FAILED: releasing made more slots than there were\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestWaiterRunsOnReleasingThread()
+{
+    EncodeSlots slots(1);
+    slots.Acquire([]() {});
+    SlotWaiter waiter;
+    slots.Acquire(waiter.Callback());
+    std::thread::id releasedOn;
+    std::thread releaser([&]()
+    {
+        releasedOn = std::this_thread::get_id();
+        slots.Release();
+    });
+    auto acquiredOn = waiter.Wait();
+    releaser.join();
+    if (acquiredOn != releasedOn)
+    {
+        printf("FAILED: the waiting encode wasn't signaled by the release\n");
+        return false;
+    }
+    return true;
+}
+
+// Snapshots taken in a burst on their own threads, each holding a slot for
+// a while like an encode does. No more than the slot count may hold one at
+// once, and slots are handed out in the order the snapshots were taken.
+bool TestConcurrentEncodes(uint32_t slotCount, uint32_t encodeCount)
+{
+    EncodeSlots slots(slotCount);
+    std::mt19937 random(slotCount * 1000 + encodeCount);
+    std::vector<std::chrono::milliseconds> durations;
+    for (uint32_t i = 0; i < encodeCount; i++)
+    {
+        durations.push_back(std::chrono::milliseconds(1 + random() % 5));
+    }
+
+    std::mutex lock;
+    uint32_t holding = 0;
+    uint32_t mostHolding = 0;
+    std::vector<uint32_t> acquireOrder;
+    std::vector<std::chrono::steady_clock::duration> waits(encodeCount);
+    std::vector<std::thread> threads;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < encodeCount; i++)
+    {
+        auto waiter = std::make_shared<SlotWaiter>();
+        auto signal = waiter->Callback();
+        // Each one asks before the next is taken, so the order is known
+        slots.Acquire([&, i, signal]()
+        {
+            {
+                auto guard = std::scoped_lock(lock);
+                holding++;
+                mostHolding = std::max(mostHolding, holding);
+                acquireOrder.push_back(i);
+                waits[i] = std::chrono::steady_clock::now() - begin;
+            }
+            signal();
+        });
+        threads.emplace_back([&, i, waiter]()
+        {
+            waiter->Wait();
+            std::this_thread::sleep_for(durations[i]);
+            {
+                auto guard = std::scoped_lock(lock);
+                holding--;
+            }
+            slots.Release();
+        });
+    }
+    for (auto&& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (mostHolding > slotCount)
+    {
+        printf("FAILED: %u encodes held a slot at once with %u slots\n", mostHolding, slotCount);
+        return false;
+    }
+    if (mostHolding < std::min(slotCount, encodeCount))
+    {
+        printf("FAILED: only %u of %u slots were ever used\n", mostHolding, slotCount);
+        return false;
+    }
+    for (uint32_t i = 0; i < encodeCount; i++)
+    {
+        if (acquireOrder[i] != i)
+        {
+            printf("FAILED: encode %u got a slot in place of encode %u\n", acquireOrder[i], i);
+            return false;
+        }
+    }
+
+    auto total = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+    auto longestWait = std::chrono::duration_cast<std::chrono::milliseconds>(*std::max_element(waits.begin(), waits.end()));
+    std::chrono::milliseconds work(0);
+    for (auto&& duration : durations)
+    {
+        work += duration;
+    }
+    printf("%u encodes on %u slots: %lld ms of work took %lld ms, longest wait %lld ms\n",
+        encodeCount, slotCount, static_cast<long long>(work.count()), static_cast<long long>(total.count()), static_cast<long long>(longestWait.count()));
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestFreeSlotsAreImmediate() && passed;
+    passed = TestZeroSlotsStillEncode() && passed;
+    passed = TestSlotsAreFirstComeFirstServed() && passed;
+    passed = TestWaiterRunsOnReleasingThread() && passed;
+    passed = TestConcurrentEncodes(1, 20) && passed;
+    passed = TestConcurrentEncodes(2, 40) && passed;
+    passed = TestConcurrentEncodes(4, 60) && passed;
+
+    if (passed)
+    {
+        printf("All EncodeSlots tests passed\n");
+        return 0;
+    }
+    printf("Some EncodeSlots tests failed\n");
+    return 1;
+}
\ No newline at end of file
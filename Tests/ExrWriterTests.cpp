@@ -0,0 +1,344 @@
+#include "pch.h"
+#include "ExrWriter.h"
+#include "DeflateDecoder.h"
+#include <map>
+#include <random>
+
+// Reads back the files ExrWriter writes, following the OpenEXR layout
+// rather than the writer's code: the header's attributes, the offset
+// table, and every block decompressed, un-predicted and un-split
+class ExrReader
+{
+public:
+    ExrReader(std::vector<uint8_t> const& file) : m_file(file) {}
+
+    template <typename T>
+    T Read()
+    {
+        if (m_position + sizeof(T) > m_file.size())
+        {
+            throw std::runtime_error("read past the end");
+        }
+        T value;
+        memcpy(&value, m_file.data() + m_position, sizeof(T));
+        m_position += sizeof(T);
+        return value;
+    }
+
+    std::string ReadString()
+    {
+        std::string value;
+        while (auto c = Read<char>())
+        {
+            value += c;
+        }
+        return value;
+    }
+
+    std::vector<uint8_t> ReadBytes(size_t size)
+    {
+        if (m_position + size > m_file.size())
+        {
+            throw std::runtime_error("read past the end");
+        }
+        std::vector<uint8_t> value(m_file.begin() + m_position, m_file.begin() + m_position + size);
+        m_position += size;
+        return value;
+    }
+
+    size_t Position() const { return m_position; }
+    void Seek(size_t position) { m_position = position; }
+
+private:
+    std::vector<uint8_t> const& m_file;
+    size_t m_position = 0;
+};
+
+struct ExrImage
+{
+    std::map<std::string, std::pair<std::string, std::vector<uint8_t>>> Attributes;
+    std::vector<std::string> Channels;
+    int32_t Width = 0;
+    int32_t Height = 0;
+    // RGBA halves, tightly packed
+    std::vector<uint16_t> Pixels;
+    size_t StoredBlocks = 0;
+};
+
+ExrImage ReadExr(std::vector<uint8_t> const& file)
+{
+    ExrReader reader(file);
+    if (reader.Read<uint32_t>() != 20000630 || reader.Read<uint32_t>() != 2)
+    {
+        throw std::runtime_error("not a single part scanline EXR");
+    }
+    ExrImage image;
+    while (true)
+    {
+        auto name = reader.ReadString();
+        if (name.empty())
+        {
+            break;
+        }
+        auto type = reader.ReadString();
+        auto size = reader.Read<int32_t>();
+        image.Attributes[name] = { type, reader.ReadBytes(static_cast<size_t>(size)) };
+    }
+    for (auto required : { "channels", "compression", "dataWindow", "displayWindow", "lineOrder", "pixelAspectRatio", "screenWindowCenter", "screenWindowWidth" })
+    {
+        if (image.Attributes.count(required) == 0)
+        {
+            throw std::runtime_error("missing a required attribute");
+        }
+    }
+    if (image.Attributes["compression"].second != std::vector<uint8_t>{ 3 })
+    {
+        throw std::runtime_error("not ZIP compressed");
+    }
+
+    auto& channels = image.Attributes["channels"].second;
+    ExrReader channelReader(channels);
+    while (true)
+    {
+        auto name = channelReader.ReadString();
+        if (name.empty())
+        {
+            break;
+        }
+        if (channelReader.Read<int32_t>() != 1)
+        {
+            throw std::runtime_error("a channel isn't half float");
+        }
+        channelReader.Read<uint32_t>();
+        if (channelReader.Read<int32_t>() != 1 || channelReader.Read<int32_t>() != 1)
+        {
+            throw std::runtime_error("a channel is subsampled");
+        }
+        image.Channels.push_back(name);
+    }
+
+    auto& window = image.Attributes["dataWindow"].second;
+    ExrReader windowReader(window);
+    auto left = windowReader.Read<int32_t>();
+    auto top = windowReader.Read<int32_t>();
+    image.Width = windowReader.Read<int32_t>() - left + 1;
+    image.Height = windowReader.Read<int32_t>() - top + 1;
+
+    // ZIP compresses 16 rows to a block
+    auto blockCount = (image.Height + 15) / 16;
+    std::vector<uint64_t> offsets;
+    for (int32_t i = 0; i < blockCount; i++)
+    {
+        offsets.push_back(reader.Read<uint64_t>());
+    }
+
+    auto channelCount = image.Channels.size();
+    image.Pixels.resize(static_cast<size_t>(image.Width) * image.Height * 4);
+    for (int32_t blockIndex = 0; blockIndex < blockCount; blockIndex++)
+    {
+        reader.Seek(static_cast<size_t>(offsets[blockIndex]));
+        auto y = reader.Read<int32_t>();
+        auto size = reader.Read<int32_t>();
+        if (y != top + blockIndex * 16)
+        {
+            throw std::runtime_error("a block starts at the wrong row");
+        }
+        auto rows = std::min(16, image.Height - blockIndex * 16);
+        auto rawSize = static_cast<size_t>(image.Width) * rows * channelCount * 2;
+        auto data = reader.ReadBytes(static_cast<size_t>(size));
+        std::vector<uint8_t> raw;
+        if (data.size() == rawSize)
+        {
+            raw = data;
+            image.StoredBlocks++;
+        }
+        else
+        {
+            std::vector<uint8_t> split(rawSize);
+            if (DeflateDecoder::Decompress(data, split) != data.size())
+            {
+                throw std::runtime_error("a block has data after its stream");
+            }
+            for (size_t i = 1; i < split.size(); i++)
+            {
+                split[i] = static_cast<uint8_t>(split[i - 1] + split[i] - 128);
+            }
+            raw.resize(rawSize);
+            auto halfSize = (rawSize + 1) / 2;
+            for (size_t i = 0; i < rawSize; i++)
+            {
+                raw[i] = split[(i % 2) * halfSize + i / 2];
+            }
+        }
+
+        auto values = reinterpret_cast<uint16_t const*>(raw.data());
+        for (int32_t row = 0; row < rows; row++)
+        {
+            auto pixels = image.Pixels.data() + static_cast<size_t>(blockIndex * 16 + row) * image.Width * 4;
+            for (auto&& channel : image.Channels)
+            {
+                auto component = std::string("RGBA").find(channel);
+                for (int32_t x = 0; x < image.Width; x++)
+                {
+                    pixels[static_cast<size_t>(x) * 4 + component] = *values++;
+                }
+            }
+        }
+    }
+    return image;
+}
+
+// Half float pixels with smooth gradients, flat areas and a noisy patch
+std::vector<uint8_t> MakeHdrImage(uint32_t width, uint32_t height, uint32_t stride, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::vector<uint8_t> pixels(static_cast<size_t>(stride) * height, 0xCD);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        auto row = reinterpret_cast<uint16_t*>(pixels.data() + static_cast<size_t>(y) * stride);
+        for (uint32_t x = 0; x < width; x++)
+        {
+            auto noisy = x > width / 2 && y > height / 2;
+            row[x * 4 + 0] = static_cast<uint16_t>(0x3000 + (x * 7) % 0x0C00);
+            row[x * 4 + 1] = static_cast<uint16_t>(0x3400 + (y * 3) % 0x0800);
+            row[x * 4 + 2] = noisy ? static_cast<uint16_t>(random() & 0x7BFF) : 0x3800;
+            row[x * 4 + 3] = 0x3C00;
+        }
+    }
+    return pixels;
+}
+
+bool CheckRoundTrip(char const* name, std::vector<uint8_t> const& pixels, uint32_t width, uint32_t height, uint32_t stride, size_t* storedBlocks = nullptr)
+{
+    auto file = ExrWriter::Encode(pixels.data(), width, height, stride);
+    ExrImage image;
+    try
+    {
+        image = ReadExr(file);
+    }
+    catch (std::exception const& error)
+    {
+        printf("FAILED: %s, the file couldn't be read: %s\n", name, error.what());
+        return false;
+    }
+    if (image.Channels != std::vector<std::string>{ "A", "B", "G", "R" })
+    {
+        printf("FAILED: %s, the channels aren't A, B, G and R in that order\n", name);
+        return false;
+    }
+    if (image.Width != static_cast<int32_t>(width) || image.Height != static_cast<int32_t>(height))
+    {
+        printf("FAILED: %s, the data window is %dx%d\n", name, image.Width, image.Height);
+        return false;
+    }
+    for (uint32_t y = 0; y < height; y++)
+    {
+        auto source = pixels.data() + static_cast<size_t>(y) * stride;
+        if (memcmp(source, image.Pixels.data() + static_cast<size_t>(y) * width * 4, static_cast<size_t>(width) * 8) != 0)
+        {
+            printf("FAILED: %s, row %u didn't come back the same\n", name, y);
+            return false;
+        }
+    }
+    if (storedBlocks != nullptr)
+    {
+        *storedBlocks = image.StoredBlocks;
+    }
+    return true;
+}
+
+// Heights that fill the last block and ones that don't, a single column,
+// and rows with padding after them
+bool TestRoundTrips()
+{
+    uint32_t const sizes[][2] = { { 1, 1 }, { 1, 40 }, { 64, 16 }, { 100, 17 }, { 333, 250 }, { 1920, 33 } };
+    for (auto&& [width, height] : sizes)
+    {
+        auto stride = width * 8 + 40;
+        if (!CheckRoundTrip("round trip", MakeHdrImage(width, height, stride, width + height), width, height, stride))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Noise doesn't compress, so its blocks are stored as they are, and a
+// flat image compresses to a small fraction of its size
+bool TestStoredAndCompressedBlocks()
+{
+    uint32_t const width = 256;
+    uint32_t const height = 64;
+    std::mt19937 random(3);
+    std::vector<uint8_t> noise(static_cast<size_t>(width) * height * 8);
+    for (auto&& value : noise)
+    {
+        value = static_cast<uint8_t>(random());
+    }
+    size_t storedBlocks = 0;
+    if (!CheckRoundTrip("noise", noise, width, height, width * 8, &storedBlocks))
+    {
+        return false;
+    }
+    if (storedBlocks != height / ExrWriter::RowsPerBlock)
+    {
+        printf("FAILED: only %zu of the noise blocks were stored as is\n", storedBlocks);
+        return false;
+    }
+
+    std::vector<uint8_t> flat(static_cast<size_t>(width) * height * 8);
+    for (size_t i = 0; i < flat.size(); i += 2)
+    {
+        flat[i + 1] = 0x3C;
+    }
+    if (!CheckRoundTrip("flat", flat, width, height, width * 8, &storedBlocks) || storedBlocks != 0)
+    {
+        return false;
+    }
+    auto file = ExrWriter::Encode(flat.data(), width, height, width * 8);
+    if (file.size() > flat.size() / 20)
+    {
+        printf("FAILED: a flat image only compressed to %zu of %zu bytes\n", file.size(), flat.size());
+        return false;
+    }
+    return true;
+}
+
+bool TestInvalidSizes()
+{
+    std::vector<uint8_t> pixels(64);
+    for (auto&& [width, height] : { std::pair{ 0u, 1u }, std::pair{ 1u, 0u }, std::pair{ 0x80000000u, 1u } })
+    {
+        try
+        {
+            ExrWriter::Encode(pixels.data(), width, height, 8);
+            printf("FAILED: a %ux%u image was written\n", width, height);
+            return false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG)
+            {
+                printf("FAILED: a %ux%u image threw the wrong error\n", width, height);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestRoundTrips() && passed;
+    passed = TestStoredAndCompressedBlocks() && passed;
+    passed = TestInvalidSizes() && passed;
+
+    if (passed)
+    {
+        printf("All ExrWriter tests passed\n");
+        return 0;
+    }
+    printf("Some ExrWriter tests failed\n");
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include "WindowMetadataCache.h"
+
+// Windows that only exist in memory, and a count of how often each was
+// asked about
+class FakeWindowSystem
+{
+public:
+    struct Window
+    {
+        std::wstring Title;
+        std::wstring ClassName;
+        std::wstring ProcessName;
+    };
+
+    HWND Create(Window window)
+    {
+        auto handle = reinterpret_cast<HWND>(static_cast<uintptr_t>(++m_lastHandle));
+        m_windows[handle] = std::move(window);
+        return handle;
+    }
+
+    // Handles get reused once a window is gone
+    void Recreate(HWND handle, Window window) { m_windows[handle] = std::move(window); }
+    void Rename(HWND handle, std::wstring const& title) { m_windows.at(handle).Title = title; }
+
+    WindowQueries Queries()
+    {
+        return
+        {
+            [this](HWND handle) { TitleQueries++; return m_windows.at(handle).Title; },
+            [this](HWND handle) { ClassNameQueries++; return m_windows.at(handle).ClassName; },
+            [this](HWND handle) { ProcessNameQueries++; return m_windows.at(handle).ProcessName; },
+        };
+    }
+
+    size_t TitleQueries = 0;
+    size_t ClassNameQueries = 0;
+    size_t ProcessNameQueries = 0;
+
+private:
+    std::unordered_map<HWND, Window> m_windows;
+    uintptr_t m_lastHandle = 0;
+};
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "FrameBufferPool.h"
+#include "Hdr10Converter.h"
+#include "StridedCopy.h"
+
+// What a snapshot pays for the memory it reads a frame back into, and for
+// the memory an HDR10 conversion writes to. A fresh vector gets zeroed and
+// faulted in a page at a time as it's first touched, a fresh buffer from a
+// pool that keeps nothing is faulted in up front (on huge pages where it
+// can be), and a pooled one has been used before.
+int const Iterations = 10;
+
+template <typename Work>
+double BestMilliseconds(Work&& work)
+{
+    auto best = std::numeric_limits<double>::max();
+    for (int i = 0; i < Iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main()
+{
+    struct Size
+    {
+        char const* Name;
+        uint32_t Width;
+        uint32_t Height;
+    };
+    Size const sizes[] =
+    {
+        { "1080p", 1920, 1080 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    printf("%-16s %8s %10s %10s %10s\n", "", "MB", "vector ms", "fresh ms", "pooled ms");
+    for (auto&& size : sizes)
+    {
+        // Read back from a staging texture, rows padded to 256 bytes
+        auto rowBytes = size.Width * 4;
+        auto sourceStride = (rowBytes + 255) & ~255u;
+        std::vector<uint8_t> source(static_cast<size_t>(sourceStride) * size.Height, 0x5A);
+        auto bytes = static_cast<size_t>(rowBytes) * size.Height;
+
+        auto vector = BestMilliseconds([&]()
+        {
+            std::vector<uint8_t> pixels(bytes);
+            StridedCopy::Copy(source.data(), sourceStride, pixels.data(), rowBytes, rowBytes, size.Height);
+        });
+        FrameBufferPool freshPool(0);
+        auto fresh = BestMilliseconds([&]()
+        {
+            auto pixels = freshPool.Acquire(rowBytes, size.Height);
+            StridedCopy::Copy(source.data(), sourceStride, pixels.Data(), pixels.Stride(), rowBytes, size.Height);
+        });
+        FrameBufferPool pool(2);
+        auto pooled = BestMilliseconds([&]()
+        {
+            auto pixels = pool.Acquire(rowBytes, size.Height);
+            StridedCopy::Copy(source.data(), sourceStride, pixels.Data(), pixels.Stride(), rowBytes, size.Height);
+        });
+        printf("%-16s %8.1f %10.2f %10.2f %10.2f\n", (std::string(size.Name) + " read back").c_str(), bytes / 1e6, vector, fresh, pooled);
+    }
+
+    for (auto&& size : sizes)
+    {
+        // scRGB half floats in, packed 10-bit out
+        auto sourceStride = size.Width * 8;
+        std::vector<uint16_t> halves(static_cast<size_t>(size.Width) * size.Height * 4);
+        for (size_t i = 0; i < halves.size(); i++)
+        {
+            // 0.25 to about 2, and alpha of one
+            halves[i] = i % 4 == 3 ? 0x3C00 : static_cast<uint16_t>(0x3400 + (i * 37) % 0x0C00);
+        }
+        auto source = reinterpret_cast<uint8_t const*>(halves.data());
+        auto pixelCount = static_cast<size_t>(size.Width) * size.Height;
+
+        auto vector = BestMilliseconds([&]()
+        {
+            std::vector<uint32_t> packed(pixelCount);
+            Hdr10Converter::Convert(source, size.Width, size.Height, sourceStride, packed.data());
+        });
+        FrameBufferPool freshPool(0);
+        auto fresh = BestMilliseconds([&]()
+        {
+            auto packed = freshPool.Acquire(size.Width * 4, size.Height);
+            Hdr10Converter::Convert(source, size.Width, size.Height, sourceStride, reinterpret_cast<uint32_t*>(packed.Data()));
+        });
+        FrameBufferPool pool(2);
+        auto pooled = BestMilliseconds([&]()
+        {
+            auto packed = pool.Acquire(size.Width * 4, size.Height);
+            Hdr10Converter::Convert(source, size.Width, size.Height, sourceStride, reinterpret_cast<uint32_t*>(packed.Data()));
+        });
+        printf("%-16s %8.1f %10.2f %10.2f %10.2f\n", (std::string(size.Name) + " HDR10").c_str(), pixelCount * 4 / 1e6, vector, fresh, pooled);
+    }
+
+    FrameBufferPool pool(0);
+    auto buffer = pool.Acquire(7680 * 4, 4320);
+    printf("8K buffers %s on reserved huge pages, %s aligned to 2MB\n", buffer.IsLargePage() ? "are" : "aren't",
+        reinterpret_cast<uintptr_t>(buffer.Data()) % (2 * 1024 * 1024) == 0 ? "and" : "not");
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include "pch.h"
+#include "FrameBufferPool.h"
+#include <random>
+
+size_t const Megabyte = 1024 * 1024;
+
+void Fill(FrameBuffer const& buffer, uint8_t seed)
+{
+    auto data = buffer.Data();
+    for (size_t i = 0; i < buffer.Size(); i++)
+    {
+        data[i] = static_cast<uint8_t>(i * 31 + seed);
+    }
+}
+
+bool IsFilled(FrameBuffer const& buffer, uint8_t seed)
+{
+    auto data = buffer.Data();
+    for (size_t i = 0; i < buffer.Size(); i++)
+    {
+        if (data[i] != static_cast<uint8_t>(i * 31 + seed))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every byte of the buffer can be written and read back
+bool FillsWhole(FrameBuffer const& buffer, uint8_t seed)
+{
+    Fill(buffer, seed);
+    return IsFilled(buffer, seed);
+}
+
+bool TestLayout()
+{
+    std::pair<uint32_t, uint32_t> const strides[] = { { 1, 64 }, { 64, 64 }, { 65, 128 }, { 1920 * 4, 7680 }, { 1919 * 3, 5760 }, { 7680 * 8, 61440 } };
+    for (auto&& [rowBytes, expected] : strides)
+    {
+        if (FrameBufferPool::AlignStride(rowBytes) != expected)
+        {
+            printf("FAILED: %u bytes a row got a stride of %u, expected %u\n", rowBytes, FrameBufferPool::AlignStride(rowBytes), expected);
+            return false;
+        }
+    }
+
+    FrameBufferPool pool(4);
+    auto buffer = pool.Acquire(1919 * 3, 37);
+    if (!buffer || buffer.Stride() != 5760 || buffer.Height() != 37 || buffer.Size() != 5760u * 37)
+    {
+        printf("FAILED: a 1919x37 24bpp buffer came out %ux%u\n", buffer.Stride(), buffer.Height());
+        return false;
+    }
+    if (reinterpret_cast<uintptr_t>(buffer.Data()) % FrameBufferPool::RowAlignment != 0 || !FillsWhole(buffer, 1))
+    {
+        printf("FAILED: a buffer wasn't aligned or couldn't be written\n");
+        return false;
+    }
+
+    // Buffers held at the same time don't share any memory
+    std::vector<FrameBuffer> held;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        held.push_back(pool.Acquire(4096 * (i % 3 + 1) + 100, 100 + i * 37));
+        Fill(held.back(), static_cast<uint8_t>(i));
+    }
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        if (!IsFilled(held[i], static_cast<uint8_t>(i)))
+        {
+            printf("FAILED: buffers held at the same time overlap\n");
+            return false;
+        }
+    }
+
+    // Nothing to write, but still something to point at
+    auto empty = pool.Acquire(256, 0);
+    if (!empty || empty.Size() != 0)
+    {
+        printf("FAILED: a buffer without rows wasn't handed out\n");
+        return false;
+    }
+    return true;
+}
+
+// A released buffer comes back to the next frame that fits in it, as it
+// was left
+bool TestReuse()
+{
+    FrameBufferPool pool(4);
+    auto first = pool.Acquire(1920 * 4, 1080);
+    auto data = first.Data();
+    FillsWhole(first, 7);
+    first.Release();
+    if (first || pool.SpareBufferCount() != 1)
+    {
+        printf("FAILED: a released buffer didn't go back to the pool\n");
+        return false;
+    }
+    auto second = pool.Acquire(1920 * 4, 1080);
+    if (second.Data() != data || pool.SpareBufferCount() != 0)
+    {
+        printf("FAILED: the same size didn't reuse the released buffer\n");
+        return false;
+    }
+    if (second.Data()[12345] != static_cast<uint8_t>(12345 * 31 + 7))
+    {
+        printf("FAILED: a reused buffer didn't keep what was in it\n");
+        return false;
+    }
+    // A smaller frame fits in it too, with its own stride
+    second.Release();
+    auto smaller = pool.Acquire(1280 * 4, 720);
+    if (smaller.Data() != data || smaller.Stride() != 5120 || smaller.Height() != 720)
+    {
+        printf("FAILED: a smaller frame didn't reuse the released buffer\n");
+        return false;
+    }
+    return true;
+}
+
+// Of the spares that fit, the smallest one is handed out
+bool TestBestFit()
+{
+    FrameBufferPool pool(8);
+    auto three = pool.Acquire(Megabyte, 3);
+    auto one = pool.Acquire(Megabyte, 1);
+    auto two = pool.Acquire(Megabyte, 2);
+    auto threeData = three.Data();
+    auto oneData = one.Data();
+    auto twoData = two.Data();
+    three.Release();
+    one.Release();
+    two.Release();
+
+    auto middle = pool.Acquire(Megabyte, 2);
+    auto small = pool.Acquire(static_cast<uint32_t>(Megabyte / 2), 1);
+    if (middle.Data() != twoData || small.Data() != oneData)
+    {
+        printf("FAILED: spares weren't handed out smallest that fits first\n");
+        return false;
+    }
+    auto big = pool.Acquire(Megabyte, 4);
+    if (big.Data() == threeData || pool.SpareBufferCount() != 1)
+    {
+        printf("FAILED: a frame that didn't fit any spare was given one\n");
+        return false;
+    }
+    if (!FillsWhole(big, 3))
+    {
+        printf("FAILED: a new buffer couldn't be written\n");
+        return false;
+    }
+    return true;
+}
+
+// Past maxSpareBuffers the oldest spare goes
+bool TestEviction()
+{
+    FrameBufferPool pool(2);
+    std::vector<FrameBuffer> buffers;
+    std::vector<uint8_t*> data;
+    for (auto i = 0; i < 3; i++)
+    {
+        buffers.push_back(pool.Acquire(4096, 64));
+        data.push_back(buffers.back().Data());
+    }
+    for (auto&& buffer : buffers)
+    {
+        buffer.Release();
+    }
+    if (pool.SpareBufferCount() != 2)
+    {
+        printf("FAILED: kept %zu spares, expected 2\n", pool.SpareBufferCount());
+        return false;
+    }
+    auto first = pool.Acquire(4096, 64);
+    auto second = pool.Acquire(4096, 64);
+    if (first.Data() != data[1] || second.Data() != data[2])
+    {
+        printf("FAILED: the oldest spare wasn't the one dropped\n");
+        return false;
+    }
+
+    // A pool that keeps nothing frees everything right away
+    FrameBufferPool none(0);
+    none.Acquire(4096, 64).Release();
+    if (none.SpareBufferCount() != 0)
+    {
+        printf("FAILED: a pool without spares kept one\n");
+        return false;
+    }
+    return true;
+}
+
+// Moving hands the memory over, assigning over a buffer gives the old one
+// back, and buffers can outlive their pool
+bool TestOwnership()
+{
+    FrameBuffer outlives;
+    {
+        FrameBufferPool pool(4);
+        auto buffer = pool.Acquire(4096, 16);
+        auto data = buffer.Data();
+        FrameBuffer moved(std::move(buffer));
+        if (buffer || moved.Data() != data || moved.Stride() != 4096 || buffer.Size() != 0)
+        {
+            printf("FAILED: moving a buffer didn't hand it over\n");
+            return false;
+        }
+        moved = pool.Acquire(8192, 16);
+        if (pool.SpareBufferCount() != 1)
+        {
+            printf("FAILED: assigning over a buffer didn't give it back\n");
+            return false;
+        }
+        outlives = std::move(moved);
+    }
+    if (!FillsWhole(outlives, 9))
+    {
+        printf("FAILED: a buffer that outlived its pool couldn't be written\n");
+        return false;
+    }
+    outlives.Release();
+    return true;
+}
+
+#ifndef _WIN32
+// Buffers of a huge page or more are lined up with huge pages, whether they
+// got reserved ones or transparent ones, and the rest of the mapping was
+// given back
+bool TestHugePageAlignment()
+{
+    size_t const hugePage = 2 * Megabyte;
+    FrameBufferPool pool(0);
+    for (auto&& [rowBytes, height] : { std::pair{ 7680u * 4, 4320u }, std::pair{ 3840u * 4, 2160u }, std::pair{ 1024u, 2048u } })
+    {
+        auto buffer = pool.Acquire(rowBytes, height);
+        if (reinterpret_cast<uintptr_t>(buffer.Data()) % hugePage != 0)
+        {
+            printf("FAILED: a %zuMB buffer isn't aligned to huge pages\n", buffer.Size() / Megabyte);
+            return false;
+        }
+        if (!FillsWhole(buffer, 5))
+        {
+            printf("FAILED: a %zuMB buffer couldn't be written\n", buffer.Size() / Megabyte);
+            return false;
+        }
+    }
+    auto small = pool.Acquire(4096, 4);
+    if (reinterpret_cast<uintptr_t>(small.Data()) % 4096 != 0 || !FillsWhole(small, 6))
+    {
+        printf("FAILED: a small buffer isn't page aligned\n");
+        return false;
+    }
+    return true;
+}
+#endif
+
+// Threads taking and giving back buffers never get one someone else has
+bool TestConcurrentUse()
+{
+    FrameBufferPool pool(3);
+    std::atomic<bool> failed = false;
+    std::vector<std::thread> threads;
+    for (uint32_t thread = 0; thread < 4; thread++)
+    {
+        threads.emplace_back([&, thread]()
+        {
+            std::mt19937 random(thread);
+            for (auto i = 0; i < 300; i++)
+            {
+                auto buffer = pool.Acquire(4096 * (1 + random() % 4), 16);
+                auto value = static_cast<uint8_t>(thread * 50 + i);
+                memset(buffer.Data(), value, buffer.Size());
+                std::this_thread::yield();
+                for (size_t offset = 0; offset < buffer.Size(); offset += 997)
+                {
+                    if (buffer.Data()[offset] != value)
+                    {
+                        failed.store(true);
+                    }
+                }
+            }
+        });
+    }
+    for (auto&& thread : threads)
+    {
+        thread.join();
+    }
+    if (failed.load() || pool.SpareBufferCount() > 3)
+    {
+        printf("FAILED: threads shared a buffer or the pool kept too many\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestLayout() && passed;
+    passed = TestReuse() && passed;
+    passed = TestBestFit() && passed;
+    passed = TestEviction() && passed;
+    passed = TestOwnership() && passed;
+#ifndef _WIN32
+    passed = TestHugePageAlignment() && passed;
+#endif
+    passed = TestConcurrentUse() && passed;
+
+    if (passed)
+    {
+        printf("All FrameBufferPool tests passed\n");
+        return 0;
+    }
+    printf("Some FrameBufferPool tests failed\n");
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "FramePacer.h"
+#include <random>
+#include <set>
+
+int64_t const TicksPerSecond = 10'000'000;
+
+std::mt19937_64 Random(1);
+
+// Captured frames around a nominal rate, with normally distributed jitter
+// that never reorders them
+std::vector<Ticks> MakeTrace(double rate, double jitterMilliseconds, double seconds)
+{
+    auto interval = TicksPerSecond / rate;
+    std::normal_distribution<double> jitter(0.0, jitterMilliseconds * 10'000.0);
+    std::vector<Ticks> timestamps;
+    auto count = static_cast<int64_t>(seconds * rate);
+    for (int64_t i = 0; i < count; i++)
+    {
+        auto offset = std::clamp(jitter(Random), -interval * 0.45, interval * 0.45);
+        auto timestamp = Ticks(static_cast<int64_t>(TicksPerSecond + i * interval + offset));
+        if (!timestamps.empty() && timestamp <= timestamps.back())
+        {
+            timestamp = timestamps.back() + Ticks(1);
+        }
+        timestamps.push_back(timestamp);
+    }
+    return timestamps;
+}
+
+// Every output frame is accounted for, in order and on the output grid, and
+// the statistics agree with what came out
+bool CheckPacing(char const* name, std::vector<Ticks> const& timestamps, uint32_t numerator, uint32_t denominator)
+{
+    FramePacerSettings settings;
+    settings.FrameRateNumerator = numerator;
+    settings.FrameRateDenominator = denominator;
+    FramePacer pacer(settings);
+    std::vector<PacedFrame> output;
+    for (auto&& timestamp : timestamps)
+    {
+        auto frames = pacer.Push(timestamp);
+        output.insert(output.end(), frames.begin(), frames.end());
+    }
+    auto frames = pacer.Flush();
+    output.insert(output.end(), frames.begin(), frames.end());
+
+    std::set<uint64_t> shown;
+    uint64_t repeats = 0;
+    for (size_t i = 0; i < output.size(); i++)
+    {
+        auto& frame = output[i];
+        if (frame.Index != i || frame.Time != pacer.OutputTime(static_cast<int64_t>(i)))
+        {
+            printf("FAILED: %s, output frame %zu is out of place\n", name, i);
+            return false;
+        }
+        if (i > 0 && frame.Source < output[i - 1].Source)
+        {
+            printf("FAILED: %s, output frame %zu goes backwards\n", name, i);
+            return false;
+        }
+        if (frame.IsRepeat != (i > 0 && frame.Source == output[i - 1].Source))
+        {
+            printf("FAILED: %s, output frame %zu is marked wrong\n", name, i);
+            return false;
+        }
+        repeats += frame.IsRepeat ? 1 : 0;
+        shown.insert(frame.Source);
+    }
+
+    auto statistics = pacer.Statistics();
+    if (statistics.InputFrames != timestamps.size() ||
+        statistics.OutputFrames != output.size() ||
+        statistics.RepeatedFrames != repeats ||
+        statistics.DroppedFrames != timestamps.size() - shown.size())
+    {
+        printf("FAILED: %s, statistics don't match the output\n", name);
+        return false;
+    }
+    // The phase follows the input, so jitter well under half a frame
+    // shouldn't cost more than the odd repeat or drop
+    auto interval = static_cast<double>(TicksPerSecond) * denominator / numerator;
+    if (statistics.Phase.count() > interval * 5 / 8 || statistics.MaxError.count() > interval)
+    {
+        printf("FAILED: %s, output strays too far from the input\n", name);
+        return false;
+    }
+    return true;
+}
+
+bool TestMatchingRate()
+{
+    // Same rate as the output, the only repeats and drops should come from
+    // the jitter wrapping the phase, which tracking it keeps rare
+    auto timestamps = MakeTrace(60.0, 1.5, 60.0);
+    if (!CheckPacing("60Hz into 60fps", timestamps, 60, 1))
+    {
+        return false;
+    }
+    FramePacer pacer;
+    for (auto&& timestamp : timestamps)
+    {
+        pacer.Push(timestamp);
+    }
+    pacer.Flush();
+    auto statistics = pacer.Statistics();
+    if (statistics.RepeatedFrames + statistics.DroppedFrames > timestamps.size() / 100)
+    {
+        printf("FAILED: 60Hz into 60fps, %llu repeats and %llu drops\n",
+            static_cast<unsigned long long>(statistics.RepeatedFrames),
+            static_cast<unsigned long long>(statistics.DroppedFrames));
+        return false;
+    }
+    return true;
+}
+
+bool TestAdvance()
+{
+    // Nothing comes in for a second, the output keeps going with repeats
+    // that are only held back by the latency
+    FramePacer pacer;
+    auto first = pacer.Push(Ticks(0));
+    auto idle = pacer.Advance(std::chrono::seconds(1));
+    auto expected = 60 - static_cast<int64_t>(FramePacerSettings{}.Latency.count() * 60 / TicksPerSecond);
+    auto produced = static_cast<int64_t>(first.size() + idle.size());
+    if (produced < expected - 1 || produced > expected + 1)
+    {
+        printf("FAILED: advance, %lld frames after a second of nothing\n", static_cast<long long>(produced));
+        return false;
+    }
+    for (auto&& frame : idle)
+    {
+        if (frame.Source != 0)
+        {
+            printf("FAILED: advance, frames without input should repeat\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestZeroRate()
+{
+    FramePacerSettings settings;
+    settings.FrameRateNumerator = 0;
+    try
+    {
+        FramePacer pacer(settings);
+    }
+    catch (winrt::hresult_error const&)
+    {
+        return true;
+    }
+    printf("FAILED: a zero frame rate should throw\n");
+    return false;
+}
+
+int main()
+{
+    auto passed = true;
+    passed = CheckPacing("60Hz into 60fps with 4ms jitter", MakeTrace(60.0, 4.0, 60.0), 60, 1) && passed;
+    passed = CheckPacing("59.94Hz into 60fps", MakeTrace(59.94, 2.0, 120.0), 60, 1) && passed;
+    passed = CheckPacing("60.1Hz into 60fps", MakeTrace(60.1, 2.0, 120.0), 60, 1) && passed;
+    passed = CheckPacing("60Hz into 29.97fps", MakeTrace(60.0, 2.0, 120.0), 30000, 1001) && passed;
+    passed = CheckPacing("144Hz into 60fps", MakeTrace(144.0, 0.5, 60.0), 60, 1) && passed;
+    passed = CheckPacing("24Hz into 60fps", MakeTrace(24.0, 2.0, 60.0), 60, 1) && passed;
+    passed = TestMatchingRate() && passed;
+    passed = TestAdvance() && passed;
+    passed = TestZeroRate() && passed;
+    printf(passed ? "All frame pacer tests passed\n" : "Some frame pacer tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "pch.h"
+#include "FramePoolTuner.h"
+#include <random>
+
+using namespace std::chrono_literals;
+
+Ticks const RefreshInterval = Ticks(166'667);
+
+// Plays a frame pool against a 60Hz display. A frame is captured at every
+// refresh while a buffer is free. While they're all in use refreshes are
+// missed, and as soon as one frees up the next frame comes in. The app
+// handles frames one at a time for as long as consumeTime says, and the
+// tuner hears about each frame when it's closed, which is when its
+// suggestions take effect.
+struct PoolSimulation
+{
+    uint32_t BufferCount = 0;
+    uint64_t CapturedFrames = 0;
+    uint64_t MissedRefreshes = 0;
+    std::vector<std::pair<Ticks, uint32_t>> Changes;
+
+    PoolSimulation(FramePoolTuner& tuner) : BufferCount(tuner.BufferCount()), m_tuner(tuner) {}
+
+    // Missed refreshes from here on, to see how the pool does once tuned
+    void ResetCounts()
+    {
+        CapturedFrames = 0;
+        MissedRefreshes = 0;
+    }
+
+    template <typename ConsumeTime>
+    void Run(Ticks duration, ConsumeTime&& consumeTime)
+    {
+        auto end = m_now + duration;
+        while (m_now < end)
+        {
+            auto refresh = m_now;
+            ReportReleasedBy(refresh);
+            auto captured = refresh;
+            if (m_held.size() >= BufferCount)
+            {
+                // Every refresh until the oldest frame is closed is missed
+                auto freed = m_held.front().second;
+                MissedRefreshes += static_cast<uint64_t>((freed - refresh) / RefreshInterval) + 1;
+                ReportReleasedBy(freed);
+                captured = freed;
+            }
+            auto handled = m_held.empty() ? captured : std::max(captured, m_lastRelease);
+            auto released = handled + consumeTime(CapturedFrames);
+            m_held.emplace_back(captured, released);
+            m_lastRelease = released;
+            CapturedFrames++;
+            // The next refresh after this frame
+            m_now = (captured / RefreshInterval + 1) * RefreshInterval;
+        }
+    }
+
+private:
+    void ReportReleasedBy(Ticks time)
+    {
+        while (!m_held.empty() && m_held.front().second <= time)
+        {
+            auto [captured, released] = m_held.front();
+            m_held.pop_front();
+            if (auto count = m_tuner.OnFrame(captured, released))
+            {
+                BufferCount = count.value();
+                Changes.emplace_back(released, count.value());
+            }
+        }
+    }
+
+private:
+    FramePoolTuner& m_tuner;
+    Ticks m_now = Ticks(0);
+    Ticks m_lastRelease = {};
+    // Captured and released times of the frames holding a buffer
+    std::deque<std::pair<Ticks, Ticks>> m_held;
+};
+
+// Frames usually take 6ms, but every 20th one takes 70ms, e.g. to encode
+// a key frame. The average keeps up, so extra buffers absorb the bursts.
+Ticks BurstyConsumer(uint64_t frame)
+{
+    return frame % 20 == 19 ? Ticks(70ms) : Ticks(6ms);
+}
+
+bool TestGrowsForBursts()
+{
+    FramePoolTuner fixed(2, 8 * 1024 * 1024, { 2, 2 });
+    PoolSimulation untuned(fixed);
+    untuned.Run(60s, BurstyConsumer);
+
+    FramePoolTuner tuner(2, 8 * 1024 * 1024);
+    PoolSimulation tuned(tuner);
+    tuned.Run(30s, BurstyConsumer);
+    tuned.ResetCounts();
+    tuned.Run(30s, BurstyConsumer);
+
+    printf("Bursty consumer: %llu refreshes missed a minute with 2 buffers, %llu once tuned to %u buffers\n",
+        static_cast<unsigned long long>(untuned.MissedRefreshes),
+        static_cast<unsigned long long>(tuned.MissedRefreshes * 2),
+        tuned.BufferCount);
+    if (tuned.BufferCount <= 2 || tuned.BufferCount > FramePoolTunerSettings().MaxBufferCount)
+    {
+        printf("FAILED: the pool ended up with %u buffers\n", tuned.BufferCount);
+        return false;
+    }
+    if (tuned.MissedRefreshes * 10 > untuned.MissedRefreshes / 2)
+    {
+        printf("FAILED: tuning didn't stop the missed refreshes\n");
+        return false;
+    }
+    // Each growth has to wait for the last one to show its effect, and
+    // once the bursts are absorbed the pool settles
+    std::optional<Ticks> lastGrowth;
+    uint32_t count = 2;
+    for (auto&& [time, newCount] : tuned.Changes)
+    {
+        if (newCount > count)
+        {
+            if (lastGrowth.has_value() && time - lastGrowth.value() < FramePoolTunerSettings().GrowCooldown)
+            {
+                printf("FAILED: the pool grew twice within the cooldown\n");
+                return false;
+            }
+            lastGrowth = time;
+        }
+        count = newCount;
+    }
+    if (tuned.Changes.size() > 6)
+    {
+        printf("FAILED: the pool changed size %zu times\n", tuned.Changes.size());
+        return false;
+    }
+
+    // The estimate is what the app shows, it should be in the right ballpark
+    auto estimated = fixed.Statistics().EstimatedDroppedFrames;
+    if (estimated < untuned.MissedRefreshes / 2 || estimated > untuned.MissedRefreshes * 2)
+    {
+        printf("FAILED: %llu dropped frames were estimated for %llu missed refreshes\n",
+            static_cast<unsigned long long>(estimated),
+            static_cast<unsigned long long>(untuned.MissedRefreshes));
+        return false;
+    }
+    return true;
+}
+
+// Every frame takes longer than a refresh, so more buffers would only
+// queue up more stale frames
+bool TestSlowConsumerDoesntGrow()
+{
+    FramePoolTuner tuner(2, 8 * 1024 * 1024);
+    PoolSimulation simulation(tuner);
+    simulation.Run(30s, [](uint64_t) { return Ticks(25ms); });
+    if (simulation.MissedRefreshes == 0)
+    {
+        printf("FAILED: a slow consumer didn't miss any refreshes\n");
+        return false;
+    }
+    for (auto&& [time, count] : simulation.Changes)
+    {
+        if (count > 2)
+        {
+            printf("FAILED: the pool grew to %u buffers for a consumer that can't keep up\n", count);
+            return false;
+        }
+    }
+    auto statistics = tuner.Statistics();
+    if (std::abs((statistics.MeanHoldTime - Ticks(25ms)).count()) > Ticks(1ms).count())
+    {
+        printf("FAILED: a 25ms hold time was measured as %lld ticks\n", static_cast<long long>(statistics.MeanHoldTime.count()));
+        return false;
+    }
+    return true;
+}
+
+// A quick consumer never needs more than one buffer, so a big pool gives
+// one back every ShrinkAfter until it's down to the minimum
+bool TestShrinksWhenIdle()
+{
+    FramePoolTuner tuner(5, 8 * 1024 * 1024);
+    PoolSimulation simulation(tuner);
+    simulation.Run(65s, [](uint64_t) { return Ticks(2ms); });
+    if (simulation.BufferCount != FramePoolTunerSettings().MinBufferCount || simulation.MissedRefreshes != 0)
+    {
+        printf("FAILED: a quick consumer left %u buffers and missed %llu refreshes\n",
+            simulation.BufferCount,
+            static_cast<unsigned long long>(simulation.MissedRefreshes));
+        return false;
+    }
+    for (size_t i = 0; i < simulation.Changes.size(); i++)
+    {
+        auto previous = i == 0 ? Ticks(0) : simulation.Changes[i - 1].first;
+        if (simulation.Changes[i].second != 4 - i || simulation.Changes[i].first - previous < FramePoolTunerSettings().ShrinkAfter)
+        {
+            printf("FAILED: the pool shrank too quickly or by more than one buffer\n");
+            return false;
+        }
+    }
+    auto statistics = tuner.Statistics();
+    if (std::abs((statistics.FrameInterval - RefreshInterval).count()) > 10)
+    {
+        printf("FAILED: the frame interval was measured as %lld ticks\n", static_cast<long long>(statistics.FrameInterval.count()));
+        return false;
+    }
+    return true;
+}
+
+// A pool that holds steady shouldn't be touched
+bool TestSteadyPoolIsLeftAlone()
+{
+    FramePoolTuner tuner(2, 8 * 1024 * 1024);
+    PoolSimulation simulation(tuner);
+    std::mt19937 random(5);
+    // Somewhat uneven, but always done well within two refreshes
+    simulation.Run(60s, [&](uint64_t) { return Ticks(8ms) + Ticks(random() % 60'000); });
+    if (!simulation.Changes.empty() && simulation.Changes.back().second > 2)
+    {
+        printf("FAILED: a pool that kept up grew to %u buffers\n", simulation.Changes.back().second);
+        return false;
+    }
+    if (simulation.MissedRefreshes != 0)
+    {
+        printf("FAILED: a pool that should keep up missed %llu refreshes\n", static_cast<unsigned long long>(simulation.MissedRefreshes));
+        return false;
+    }
+    return true;
+}
+
+// Big buffers are capped by MaxBytes, even against the bursts
+bool TestMemoryCap()
+{
+    uint64_t const bytesPerBuffer = 200 * 1024 * 1024;
+    FramePoolTuner tuner(4, bytesPerBuffer);
+    PoolSimulation simulation(tuner);
+    simulation.Run(30s, BurstyConsumer);
+    if (simulation.Changes.empty() || simulation.Changes.front().second != 2)
+    {
+        printf("FAILED: a pool over MaxBytes wasn't cut down to 2 buffers right away\n");
+        return false;
+    }
+    for (auto&& [time, count] : simulation.Changes)
+    {
+        if (count * bytesPerBuffer > FramePoolTunerSettings().MaxBytes)
+        {
+            printf("FAILED: the pool grew past MaxBytes\n");
+            return false;
+        }
+    }
+    if (tuner.Statistics().PoolBytes != simulation.BufferCount * bytesPerBuffer)
+    {
+        printf("FAILED: the statistics have the wrong pool size\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestInvalidSettings()
+{
+    for (auto&& [minimum, maximum] : { std::pair{ 0u, 4u }, std::pair{ 5u, 4u } })
+    {
+        try
+        {
+            FramePoolTuner tuner(2, 1024, { minimum, maximum });
+            printf("FAILED: a buffer count range of %u to %u was accepted\n", minimum, maximum);
+            return false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG)
+            {
+                printf("FAILED: an invalid range threw the wrong error\n");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestGrowsForBursts() && passed;
+    passed = TestSlowConsumerDoesntGrow() && passed;
+    passed = TestShrinksWhenIdle() && passed;
+    passed = TestSteadyPoolIsLeftAlone() && passed;
+    passed = TestMemoryCap() && passed;
+    passed = TestInvalidSettings() && passed;
+
+    if (passed)
+    {
+        printf("All FramePoolTuner tests passed\n");
+        return 0;
+    }
+    printf("Some FramePoolTuner tests failed\n");
+    return 1;
+}
\ No newline at end of file
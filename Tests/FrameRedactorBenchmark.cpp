@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "FrameRedactor.h"
+#include "TestImages.h"
+
+// Time to redact a 4K frame, Prepare, Update and Apply together, against
+// the 16.7ms a frame has at 60Hz. The regions are a couple of password
+// fields, a chat pixelated out and a document blurred out, and each
+// workload changes a different part of the frame.
+uint32_t const Width = 3840;
+uint32_t const Height = 2160;
+uint32_t const Stride = Width * 4;
+int const Iterations = 30;
+double const FrameBudget = 1000.0 / 60.0;
+
+int main()
+{
+    std::vector<RedactionRegion> const regions =
+    {
+        { { 400, 300, 700, 340 }, RedactionStyle::Blur, 16 },
+        { { 400, 380, 700, 420 }, RedactionStyle::Blur, 16 },
+        { { 2900, 200, 3700, 1400 }, RedactionStyle::Pixelate, 16 },
+        { { 800, 600, 2400, 1500 }, RedactionStyle::Blur, 24 },
+        { { 100, 1900, 600, 2000 }, RedactionStyle::Fill, 0 },
+    };
+    struct Workload
+    {
+        char const* Name;
+        std::optional<std::vector<RECT>> DirtyRects;
+    };
+    Workload const workloads[] =
+    {
+        { "everything", std::nullopt },
+        { "nothing redacted", std::vector<RECT>{ { 0, 1600, 3840, 1800 } } },
+        { "typing password", std::vector<RECT>{ { 520, 305, 540, 335 } } },
+        { "scrolling chat", std::vector<RECT>{ { 2900, 200, 3700, 1400 } } },
+        { "video in document", std::vector<RECT>{ { 1280, 700, 1920, 1060 } } },
+        { "whole document", std::vector<RECT>{ { 800, 600, 2400, 1500 } } },
+    };
+
+    auto frame = MakeUiImage(Width, Height, 1);
+    auto output = frame;
+    FrameRedactor redactor;
+    redactor.Regions(regions);
+    printf("%-18s %10s %10s %10s %10s\n", "4K", "read kpx", "best ms", "median ms", "of budget");
+    for (auto&& workload : workloads)
+    {
+        std::vector<double> times;
+        double readPixels = 0.0;
+        for (int i = 0; i < Iterations; i++)
+        {
+            // Start from an up to date cache, like the frame before had
+            redactor.Prepare(Width, Height, std::nullopt);
+            redactor.Update(frame.data(), Stride);
+
+            auto start = std::chrono::steady_clock::now();
+            if (redactor.Prepare(Width, Height, workload.DirtyRects))
+            {
+                redactor.Update(frame.data(), Stride);
+            }
+            redactor.Apply(output.data(), Width, Height, Stride);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            auto source = redactor.SourceBounds();
+            readPixels = source.right > source.left ? static_cast<double>(source.right - source.left) * (source.bottom - source.top) / 1e3 : 0.0;
+        }
+        std::sort(times.begin(), times.end());
+        auto median = times[times.size() / 2];
+        printf("%-18s %10.1f %10.2f %10.2f %9.0f%%\n", workload.Name, readPixels, times.front(), median, median / FrameBudget * 100.0);
+    }
+    printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    return 0;
+}
\ No newline at end of file
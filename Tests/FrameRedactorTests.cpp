@@ -0,0 +1,436 @@
+#include "pch.h"
+#include "FrameRedactor.h"
+#include "TestImages.h"
+
+uint32_t const Width = 320;
+uint32_t const Height = 200;
+uint32_t const Stride = Width * 4;
+
+bool IsInside(RECT const& rect, LONG x, LONG y)
+{
+    return x >= rect.left && x < rect.right && y >= rect.top && y < rect.bottom;
+}
+
+bool IsSameRect(RECT const& first, RECT const& second)
+{
+    return first.left == second.left && first.top == second.top && first.right == second.right && first.bottom == second.bottom;
+}
+
+RECT Clip(RECT const& rect)
+{
+    return { std::max(rect.left, 0L), std::max(rect.top, 0L), std::min(rect.right, static_cast<LONG>(Width)), std::min(rect.bottom, static_cast<LONG>(Height)) };
+}
+
+// The straightforward way, every pixel of every region from scratch. Blurs
+// are rounded exactly here, so they can be one off.
+std::vector<uint8_t> Reference(std::vector<uint8_t> const& frame, std::vector<RedactionRegion> const& regions)
+{
+    auto output = frame;
+    for (auto&& region : regions)
+    {
+        auto bounds = Clip(region.Bounds);
+        auto strength = static_cast<LONG>(region.Strength);
+        for (auto y = bounds.top; y < bounds.bottom; y++)
+        {
+            for (auto x = bounds.left; x < bounds.right; x++)
+            {
+                RECT window = {};
+                switch (region.Style)
+                {
+                case RedactionStyle::Blur:
+                    window = { x - strength, y - strength, x + strength + 1, y + strength + 1 };
+                    break;
+                case RedactionStyle::Pixelate:
+                {
+                    auto left = bounds.left + (x - bounds.left) / strength * strength;
+                    auto top = bounds.top + (y - bounds.top) / strength * strength;
+                    window = { left, top, left + strength, top + strength };
+                    break;
+                }
+                case RedactionStyle::Fill:
+                    memcpy(output.data() + static_cast<size_t>(y) * Stride + x * 4, &region.FillColor, 4);
+                    continue;
+                }
+                window = { std::max(window.left, bounds.left), std::max(window.top, bounds.top), std::min(window.right, bounds.right), std::min(window.bottom, bounds.bottom) };
+                uint32_t sums[4] = {};
+                for (auto windowY = window.top; windowY < window.bottom; windowY++)
+                {
+                    for (auto windowX = window.left; windowX < window.right; windowX++)
+                    {
+                        for (size_t channel = 0; channel < 4; channel++)
+                        {
+                            sums[channel] += frame[static_cast<size_t>(windowY) * Stride + windowX * 4 + channel];
+                        }
+                    }
+                }
+                auto count = static_cast<uint32_t>((window.right - window.left) * (window.bottom - window.top));
+                for (size_t channel = 0; channel < 4; channel++)
+                {
+                    output[static_cast<size_t>(y) * Stride + x * 4 + channel] = static_cast<uint8_t>((sums[channel] + count / 2) / count);
+                }
+            }
+        }
+    }
+    return output;
+}
+
+// Runs a frame through the redactor the way the capture does
+std::vector<uint8_t> Redact(FrameRedactor& redactor, std::vector<uint8_t> const& frame, std::optional<std::vector<RECT>> const& dirtyRects)
+{
+    if (redactor.Prepare(Width, Height, dirtyRects))
+    {
+        redactor.Update(frame.data(), Stride);
+    }
+    auto output = frame;
+    redactor.Apply(output.data(), Width, Height, Stride);
+    return output;
+}
+
+std::vector<RedactionRegion> MakeRegions()
+{
+    return
+    {
+        { { 20, 20, 120, 80 }, RedactionStyle::Blur, 5 },
+        { { 150, 30, 250, 110 }, RedactionStyle::Pixelate, 8 },
+        { { 40, 120, 100, 160 }, RedactionStyle::Fill, 0, 0xFF102030 },
+        // Partly off the frame
+        { { 200, 90, 340, 230 }, RedactionStyle::Blur, 12 },
+        // Over parts of the first two
+        { { 100, 60, 170, 100 }, RedactionStyle::Pixelate, 6 },
+    };
+}
+
+bool CheckAgainstReference(std::vector<uint8_t> const& output, std::vector<uint8_t> const& expected, char const* what)
+{
+    for (size_t i = 0; i < output.size(); i++)
+    {
+        if (std::abs(output[i] - expected[i]) > 1)
+        {
+            auto pixel = i / 4;
+            printf("FAILED: %s, pixel %zu,%zu is %d, expected %d\n", what, pixel % Width, pixel / Width, output[i], expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestMatchesReference()
+{
+    auto regions = MakeRegions();
+    auto frame = MakeUiImage(Width, Height, 3);
+    FrameRedactor redactor;
+    redactor.Regions(regions);
+    auto output = Redact(redactor, frame, std::nullopt);
+    if (!CheckAgainstReference(output, Reference(frame, regions), "redacting a whole frame"))
+    {
+        return false;
+    }
+    // Every pixel is different, which is where rounding would show
+    frame = MakeNoiseImage(Width, Height, 4);
+    redactor.Invalidate();
+    output = Redact(redactor, frame, std::vector<RECT>{});
+    return CheckAgainstReference(output, Reference(frame, regions), "redacting noise");
+}
+
+// A stream of frames with text typed, patches repainted and content
+// scrolled, with regions that move every so often like password fields do.
+// Only recomputing what the dirty rects reach has to come out the same as
+// recomputing everything, and the output can only change beyond the dirty
+// rects where Damage says.
+bool TestIncrementalMatchesFull()
+{
+    std::mt19937 random(11);
+    auto frame = MakeUiImage(Width, Height, 5);
+    auto regions = MakeRegions();
+    FrameRedactor incremental;
+    FrameRedactor full;
+    incremental.Regions(regions);
+    full.Regions(regions);
+    auto previous = Redact(incremental, frame, std::nullopt);
+    Redact(full, frame, std::nullopt);
+
+    auto randomRect = [&](LONG maxSize)
+    {
+        auto width = 1 + static_cast<LONG>(random() % maxSize);
+        auto height = 1 + static_cast<LONG>(random() % maxSize);
+        auto left = static_cast<LONG>(random() % (Width - width + 1));
+        auto top = static_cast<LONG>(random() % (Height - height + 1));
+        return RECT{ left, top, left + width, top + height };
+    };
+    for (auto frameNumber = 1; frameNumber <= 300; frameNumber++)
+    {
+        std::vector<RECT> dirtyRects;
+        auto edits = random() % 4;
+        for (uint32_t edit = 0; edit < edits; edit++)
+        {
+            auto kind = random() % 3;
+            if (kind == 0)
+            {
+                // A character or a button changing color
+                auto rect = randomRect(12);
+                FillRect(frame, Stride, rect.left, rect.top, rect.right, rect.bottom, Bgra(random() & 255, random() & 255, random() & 255));
+                dirtyRects.push_back(rect);
+            }
+            else if (kind == 1)
+            {
+                // A patch of video
+                auto rect = randomRect(60);
+                for (auto y = rect.top; y < rect.bottom; y++)
+                {
+                    for (auto x = rect.left; x < rect.right; x++)
+                    {
+                        auto value = static_cast<uint32_t>(random());
+                        memcpy(frame.data() + static_cast<size_t>(y) * Stride + x * 4, &value, 4);
+                    }
+                }
+                dirtyRects.push_back(rect);
+            }
+            else
+            {
+                // Scrolling a view moves its content, which is reported as
+                // dirty
+                auto rect = randomRect(150);
+                auto distance = 1 + static_cast<LONG>(random() % 20);
+                if (rect.bottom - rect.top > distance)
+                {
+                    for (auto y = rect.top; y < rect.bottom - distance; y++)
+                    {
+                        memmove(frame.data() + static_cast<size_t>(y) * Stride + rect.left * 4,
+                            frame.data() + static_cast<size_t>(y + distance) * Stride + rect.left * 4, static_cast<size_t>(rect.right - rect.left) * 4);
+                    }
+                    dirtyRects.push_back(rect);
+                }
+            }
+        }
+        if (frameNumber % 25 == 0)
+        {
+            // The password field moved
+            auto&& moved = regions[frameNumber % 2 == 0 ? 0 : 1];
+            auto dx = static_cast<LONG>(random() % 41) - 20;
+            auto dy = static_cast<LONG>(random() % 41) - 20;
+            moved.Bounds = { moved.Bounds.left + dx, moved.Bounds.top + dy, moved.Bounds.right + dx, moved.Bounds.bottom + dy };
+            incremental.Regions(regions);
+            full.Regions(regions);
+        }
+
+        auto output = Redact(incremental, frame, dirtyRects);
+        full.Invalidate();
+        auto expected = Redact(full, frame, std::vector<RECT>{});
+        if (output != expected)
+        {
+            printf("FAILED: frame %d came out different from redacting all of it\n", frameNumber);
+            return false;
+        }
+        if (frameNumber % 50 == 0 && !CheckAgainstReference(output, Reference(frame, regions), "redacting a stream of frames"))
+        {
+            return false;
+        }
+
+        auto const& damage = incremental.Damage();
+        for (LONG y = 0; y < static_cast<LONG>(Height); y++)
+        {
+            for (LONG x = 0; x < static_cast<LONG>(Width); x++)
+            {
+                auto offset = static_cast<size_t>(y) * Stride + x * 4;
+                if (memcmp(output.data() + offset, previous.data() + offset, 4) == 0)
+                {
+                    continue;
+                }
+                auto covered = [&](std::vector<RECT> const& rects)
+                {
+                    return std::any_of(rects.begin(), rects.end(), [&](auto&& rect) { return IsInside(rect, x, y); });
+                };
+                if (!covered(dirtyRects) && !covered(damage))
+                {
+                    printf("FAILED: frame %d changed pixel %ld,%ld without it being dirty or damaged\n", frameNumber, x, y);
+                    return false;
+                }
+            }
+        }
+        previous = std::move(output);
+    }
+    return true;
+}
+
+// Dirty rects that can't reach a region don't recompute anything, and ones
+// that can only recompute what they reach
+bool TestOnlyRecomputesWhatsReached()
+{
+    auto frame = MakeUiImage(Width, Height, 6);
+    FrameRedactor redactor;
+    redactor.Regions(MakeRegions());
+    Redact(redactor, frame, std::nullopt);
+
+    // Further from the first blur than its radius, and away from the others
+    if (redactor.Prepare(Width, Height, std::vector<RECT>{ { 0, 0, 14, 14 }, { 0, 170, 30, 200 } }))
+    {
+        printf("FAILED: dirty rects away from every region needed an update\n");
+        return false;
+    }
+    if (!redactor.Damage().empty() || redactor.SourceBounds().right > redactor.SourceBounds().left)
+    {
+        printf("FAILED: dirty rects away from every region left damage or something to read\n");
+        return false;
+    }
+    // A fill doesn't depend on the frame
+    if (redactor.Prepare(Width, Height, std::vector<RECT>{ { 50, 130, 60, 140 } }))
+    {
+        printf("FAILED: a dirty rect inside a fill needed an update\n");
+        return false;
+    }
+
+    struct Case
+    {
+        RECT Dirty;
+        RECT Updated;
+        RECT Source;
+    };
+    Case const cases[] =
+    {
+        // Just outside the first blur but within its radius
+        { { 0, 40, 16, 50 }, { 20, 35, 21, 55 }, { 20, 30, 26, 60 } },
+        // Inside the first pixelate, rounded out to its 8px blocks
+        { { 161, 45, 170, 47 }, { 158, 38, 174, 54 }, { 158, 38, 174, 54 } },
+        // A block cut short by the edge of the region
+        { { 248, 32, 249, 33 }, { 246, 30, 250, 38 }, { 246, 30, 250, 38 } },
+    };
+    for (auto&& test : cases)
+    {
+        if (!redactor.Prepare(Width, Height, std::vector<RECT>{ test.Dirty }))
+        {
+            printf("FAILED: a dirty rect at %ld,%ld didn't need an update\n", test.Dirty.left, test.Dirty.top);
+            return false;
+        }
+        if (!IsSameRect(redactor.SourceBounds(), test.Source))
+        {
+            auto source = redactor.SourceBounds();
+            printf("FAILED: a dirty rect at %ld,%ld reads %ld,%ld,%ld,%ld\n", test.Dirty.left, test.Dirty.top, source.left, source.top, source.right, source.bottom);
+            return false;
+        }
+        // Only what SourceBounds says gets read
+        std::vector<uint8_t> poisoned(frame.size(), 0xFF);
+        for (auto y = test.Source.top; y < test.Source.bottom; y++)
+        {
+            auto offset = static_cast<size_t>(y) * Stride + test.Source.left * 4;
+            memcpy(poisoned.data() + offset, frame.data() + offset, static_cast<size_t>(test.Source.right - test.Source.left) * 4);
+        }
+        redactor.Update(poisoned.data(), Stride);
+        auto const& updated = redactor.Updated();
+        if (updated.size() != 1 || !IsSameRect(updated[0].Bounds, test.Updated) || redactor.Damage().size() != 1 || !IsSameRect(redactor.Damage()[0], test.Updated))
+        {
+            printf("FAILED: a dirty rect at %ld,%ld updated the wrong pixels\n", test.Dirty.left, test.Dirty.top);
+            return false;
+        }
+        auto output = frame;
+        redactor.Apply(output.data(), Width, Height, Stride);
+        if (!CheckAgainstReference(output, Reference(frame, MakeRegions()), "reading only the source bounds"))
+        {
+            return false;
+        }
+    }
+
+    // Setting the same regions again keeps what's cached
+    redactor.Regions(MakeRegions());
+    if (redactor.Prepare(Width, Height, std::vector<RECT>{}))
+    {
+        printf("FAILED: setting the same regions again recomputed them\n");
+        return false;
+    }
+    return true;
+}
+
+// Regions that go away leave damage so that the frame gets repainted, and a
+// smaller frame only gets what fits
+bool TestRemovedRegionsAndSmallerFrames()
+{
+    auto frame = MakeUiImage(Width, Height, 7);
+    FrameRedactor redactor;
+    auto regions = MakeRegions();
+    redactor.Regions(regions);
+    Redact(redactor, frame, std::nullopt);
+
+    auto redacted = redactor.RedactedBounds();
+    if (redacted.size() != regions.size() || !IsSameRect(redacted[3], { 200, 90, 320, 200 }))
+    {
+        printf("FAILED: the redacted bounds weren't clipped to the frame\n");
+        return false;
+    }
+
+    auto output = frame;
+    std::vector<uint8_t> small(static_cast<size_t>(Stride) * 100, 0);
+    memcpy(small.data(), frame.data(), small.size());
+    redactor.Apply(small.data(), 150, 100, Stride);
+    auto expected = Reference(frame, regions);
+    for (uint32_t y = 0; y < 100; y++)
+    {
+        if (memcmp(small.data() + static_cast<size_t>(y) * Stride, expected.data() + static_cast<size_t>(y) * Stride, 150 * 4) != 0 ||
+            memcmp(small.data() + static_cast<size_t>(y) * Stride + 150 * 4, frame.data() + static_cast<size_t>(y) * Stride + 150 * 4, (Width - 150) * 4) != 0)
+        {
+            printf("FAILED: applying to a smaller frame wrote outside of it\n");
+            return false;
+        }
+    }
+
+    redactor.Regions({});
+    if (redactor.Prepare(Width, Height, std::vector<RECT>{}) || redactor.HasRegions())
+    {
+        printf("FAILED: removing the regions needed an update\n");
+        return false;
+    }
+    auto const& damage = redactor.Damage();
+    if (damage.size() != redacted.size() || !std::equal(damage.begin(), damage.end(), redacted.begin(), IsSameRect))
+    {
+        printf("FAILED: removing the regions didn't damage where they were\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestInvalidRegions()
+{
+    std::vector<RedactionRegion> const invalid[] =
+    {
+        { { { 0, 0, 10, 10 }, RedactionStyle::Blur, 0 } },
+        { { { 0, 0, 10, 10 }, RedactionStyle::Pixelate, 0 } },
+        { { { 0, 0, 10, 10 }, RedactionStyle::Blur, FrameRedactor::MaxBlurRadius + 1 } },
+    };
+    for (auto&& regions : invalid)
+    {
+        try
+        {
+            FrameRedactor redactor;
+            redactor.Regions(regions);
+            printf("FAILED: a region with a strength of %u didn't throw\n", regions[0].Strength);
+            return false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG)
+            {
+                printf("FAILED: an invalid region threw the wrong error\n");
+                return false;
+            }
+        }
+    }
+    // Fills don't have a strength, and the largest blur is fine
+    FrameRedactor::CheckRegions({ { { 0, 0, 10, 10 }, RedactionStyle::Fill, 0 }, { { 0, 0, 10, 10 }, RedactionStyle::Blur, FrameRedactor::MaxBlurRadius } });
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestMatchesReference() && passed;
+    passed = TestIncrementalMatchesFull() && passed;
+    passed = TestOnlyRecomputesWhatsReached() && passed;
+    passed = TestRemovedRegionsAndSmallerFrames() && passed;
+    passed = TestInvalidRegions() && passed;
+
+    if (passed)
+    {
+        printf("All FrameRedactor tests passed\n");
+        return 0;
+    }
+    printf("Some FrameRedactor tests failed\n");
+    return 1;
+}
\ No newline at end of file
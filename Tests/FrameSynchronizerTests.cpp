@@ -0,0 +1,405 @@
+#include "pch.h"
+#include "FrameSynchronizer.h"
+#include <random>
+
+using namespace std::chrono_literals;
+
+Ticks const FrameInterval = Ticks(166'667);
+
+// Frames carry their number so the tests can tell which one ended up where
+std::shared_ptr<void const> Content(int number)
+{
+    return std::make_shared<int>(number);
+}
+
+int Number(SynchronizedFrame const& frame)
+{
+    return *static_cast<int const*>(frame.Content.get());
+}
+
+void Append(std::vector<FrameSet>& sets, std::vector<FrameSet>&& more)
+{
+    sets.insert(sets.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+}
+
+// Two 60Hz captures whose clocks are seconds apart, with a couple of
+// milliseconds of jitter and frames arriving in either order, line up frame
+// for frame on the shared clock
+bool TestMatchesAcrossClocks()
+{
+    FrameSynchronizer synchronizer;
+    synchronizer.AddSource();
+    synchronizer.AddSource(5s);
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int64_t> jitter(-20'000, 20'000);
+    std::vector<FrameSet> sets;
+    for (auto i = 0; i < 600; i++)
+    {
+        auto time = FrameInterval * i;
+        auto first = time + Ticks(jitter(random));
+        auto second = time + Ticks(jitter(random)) + 5s;
+        if (random() % 2)
+        {
+            Append(sets, synchronizer.AddFrame(0, first, Content(i)));
+            Append(sets, synchronizer.AddFrame(1, second, Content(i)));
+        }
+        else
+        {
+            Append(sets, synchronizer.AddFrame(1, second, Content(i)));
+            Append(sets, synchronizer.AddFrame(0, first, Content(i)));
+        }
+    }
+    // A set goes out as soon as every source has a frame for it
+    if (sets.size() != 600)
+    {
+        printf("FAILED: 600 frame pairs made %zu sets\n", sets.size());
+        return false;
+    }
+    for (size_t i = 0; i < sets.size(); i++)
+    {
+        auto&& set = sets[i];
+        if (set.Frames.size() != 2 || Number(set.Frames[0]) != static_cast<int>(i) || Number(set.Frames[1]) != static_cast<int>(i))
+        {
+            printf("FAILED: set %zu didn't pair up frame %zu\n", i, i);
+            return false;
+        }
+        if (set.Frames[0].IsHeld || set.Frames[1].IsHeld)
+        {
+            printf("FAILED: set %zu held a frame\n", i);
+            return false;
+        }
+        auto spread = set.Frames[1].Time - set.Frames[0].Time;
+        if (spread > 4ms || spread < -4ms || set.Time != std::min(set.Frames[0].Time, set.Frames[1].Time))
+        {
+            printf("FAILED: set %zu wasn't moved onto the shared clock\n", i);
+            return false;
+        }
+    }
+    auto statistics = synchronizer.Statistics();
+    if (statistics.Sets != sets.size() || statistics.SkippedSets != 0 || statistics.HeldFrames != 0 || statistics.MaxSpread > 4ms)
+    {
+        printf("FAILED: the statistics don't match the sets\n");
+        return false;
+    }
+    return true;
+}
+
+// A 30Hz source next to a 60Hz one has its frame held for every other set
+bool TestHoldsSlowerSource()
+{
+    FrameSynchronizer synchronizer;
+    synchronizer.AddSource();
+    synchronizer.AddSource();
+    std::vector<FrameSet> sets;
+    for (auto i = 0; i < 120; i++)
+    {
+        Append(sets, synchronizer.AddFrame(0, FrameInterval * i, Content(i)));
+        if (i % 2 == 0)
+        {
+            Append(sets, synchronizer.AddFrame(1, FrameInterval * i, Content(i)));
+        }
+    }
+    // The other source went quiet after its last frame
+    Append(sets, synchronizer.Poll(FrameInterval * 119 + 100ms));
+    if (sets.size() != 120)
+    {
+        printf("FAILED: 120 frames at 60Hz made %zu sets\n", sets.size());
+        return false;
+    }
+    for (size_t i = 0; i < sets.size(); i++)
+    {
+        auto&& frames = sets[i].Frames;
+        auto expected = static_cast<int>(i - i % 2);
+        if (Number(frames[0]) != static_cast<int>(i) || frames[0].IsHeld || Number(frames[1]) != expected || frames[1].IsHeld != (i % 2 == 1))
+        {
+            printf("FAILED: set %zu has frames %d and %d\n", i, Number(frames[0]), Number(frames[1]));
+            return false;
+        }
+    }
+    if (synchronizer.Statistics().HeldFrames != 60)
+    {
+        printf("FAILED: counted %llu held frames, expected 60\n", static_cast<unsigned long long>(synchronizer.Statistics().HeldFrames));
+        return false;
+    }
+    return true;
+}
+
+// The frame just inside the tolerance is matched, the one just outside
+// isn't, and of two inside it the first is
+bool TestTolerance()
+{
+    FrameSynchronizer synchronizer({ 8ms, 100ms, MissingFramePolicy::HoldLast });
+    synchronizer.AddSource();
+    synchronizer.AddSource();
+    std::vector<FrameSet> sets;
+    Append(sets, synchronizer.AddFrame(0, 0ms, Content(0)));
+    Append(sets, synchronizer.AddFrame(1, 8ms, Content(0)));
+    Append(sets, synchronizer.AddFrame(0, 100ms, Content(1)));
+    Append(sets, synchronizer.AddFrame(1, 108ms + Ticks(1), Content(1)));
+    Append(sets, synchronizer.AddFrame(0, 200ms, Content(2)));
+    Append(sets, synchronizer.AddFrame(1, 203ms, Content(2)));
+    Append(sets, synchronizer.AddFrame(1, 206ms, Content(3)));
+    Append(sets, synchronizer.AddFrame(0, 300ms, Content(4)));
+    if (sets.size() < 4)
+    {
+        printf("FAILED: made %zu sets, expected at least 4\n", sets.size());
+        return false;
+    }
+    if (sets[0].Time != 0ms || sets[0].Frames[0].IsHeld || Number(sets[0].Frames[1]) != 0 || sets[0].Frames[1].IsHeld)
+    {
+        printf("FAILED: a frame right at the tolerance wasn't matched\n");
+        return false;
+    }
+    // The second source's 108ms frame is a set of its own
+    if (Number(sets[1].Frames[0]) != 1 || Number(sets[1].Frames[1]) != 0 || !sets[1].Frames[1].IsHeld ||
+        Number(sets[2].Frames[0]) != 1 || !sets[2].Frames[0].IsHeld || Number(sets[2].Frames[1]) != 1)
+    {
+        printf("FAILED: a frame just past the tolerance was matched\n");
+        return false;
+    }
+    if (Number(sets[3].Frames[1]) != 2)
+    {
+        printf("FAILED: the later of two frames in the window was matched\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestSkipPolicy()
+{
+    FrameSynchronizer synchronizer({ 8ms, 100ms, MissingFramePolicy::Skip });
+    synchronizer.AddSource();
+    synchronizer.AddSource();
+    std::vector<FrameSet> sets;
+    for (auto i = 0; i < 120; i++)
+    {
+        Append(sets, synchronizer.AddFrame(0, FrameInterval * i, Content(i)));
+        if (i % 2 == 0)
+        {
+            Append(sets, synchronizer.AddFrame(1, FrameInterval * i, Content(i)));
+        }
+    }
+    // The other source went quiet after its last frame
+    Append(sets, synchronizer.Poll(FrameInterval * 119 + 100ms));
+    auto statistics = synchronizer.Statistics();
+    if (sets.size() != 60 || statistics.SkippedSets != 60 || statistics.HeldFrames != 0)
+    {
+        printf("FAILED: skipping made %zu sets and skipped %llu\n", sets.size(), static_cast<unsigned long long>(statistics.SkippedSets));
+        return false;
+    }
+    for (auto&& set : sets)
+    {
+        if (Number(set.Frames[0]) != Number(set.Frames[1]) || Number(set.Frames[0]) % 2 != 0)
+        {
+            printf("FAILED: skipping made a set of frames %d and %d\n", Number(set.Frames[0]), Number(set.Frames[1]));
+            return false;
+        }
+    }
+    return true;
+}
+
+// A source that goes quiet holds everything up until MaxLatency has passed,
+// which only Poll can notice
+bool TestTimeout()
+{
+    FrameSynchronizer synchronizer({ 8ms, 100ms, MissingFramePolicy::HoldLast });
+    synchronizer.AddSource();
+    synchronizer.AddSource();
+    if (synchronizer.Deadline().has_value())
+    {
+        printf("FAILED: there's a deadline with nothing waiting\n");
+        return false;
+    }
+    auto sets = synchronizer.AddFrame(0, 0ms, Content(0));
+    Append(sets, synchronizer.AddFrame(1, 0ms, Content(0)));
+    Append(sets, synchronizer.AddFrame(0, 50ms, Content(1)));
+    if (sets.size() != 1 || synchronizer.Deadline() != 150ms)
+    {
+        printf("FAILED: a frame is waiting with %zu sets made\n", sets.size());
+        return false;
+    }
+    if (!synchronizer.Poll(150ms - Ticks(1)).empty())
+    {
+        printf("FAILED: a set was made before the deadline\n");
+        return false;
+    }
+    sets = synchronizer.Poll(150ms);
+    if (sets.size() != 1 || Number(sets[0].Frames[0]) != 1 || !sets[0].Frames[1].IsHeld || Number(sets[0].Frames[1]) != 0)
+    {
+        printf("FAILED: the deadline didn't make a set with the quiet source's last frame\n");
+        return false;
+    }
+    if (synchronizer.Deadline().has_value())
+    {
+        printf("FAILED: there's still a deadline after everything was sent\n");
+        return false;
+    }
+
+    // A source that never sent anything has nothing to hold, so the set is
+    // skipped rather than sent without it
+    FrameSynchronizer fresh;
+    fresh.AddSource();
+    fresh.AddSource();
+    fresh.AddFrame(0, 0ms, Content(0));
+    sets = fresh.Poll(1s);
+    if (!sets.empty() || fresh.Statistics().SkippedSets != 1 || fresh.Deadline().has_value())
+    {
+        printf("FAILED: a source with no frames yet didn't skip the set\n");
+        return false;
+    }
+    return true;
+}
+
+// Late frames after the queue moved on are dropped and counted
+bool TestOutOfOrderFrames()
+{
+    FrameSynchronizer synchronizer;
+    synchronizer.AddSource();
+    auto sets = synchronizer.AddFrame(0, 20ms, Content(0));
+    Append(sets, synchronizer.AddFrame(0, 10ms, Content(1)));
+    Append(sets, synchronizer.AddFrame(0, 20ms, Content(2)));
+    Append(sets, synchronizer.AddFrame(0, 30ms, Content(3)));
+    if (synchronizer.Statistics().OutOfOrderFrames != 2 || sets.size() != 2 || Number(sets[0].Frames[0]) != 0 || Number(sets[1].Frames[0]) != 3)
+    {
+        printf("FAILED: out of order frames weren't dropped\n");
+        return false;
+    }
+    return true;
+}
+
+// Many sources at once, each a little behind the one before
+bool TestManySources()
+{
+    FrameSynchronizer synchronizer;
+    size_t const sourceCount = 16;
+    for (size_t source = 0; source < sourceCount; source++)
+    {
+        synchronizer.AddSource(Ticks(static_cast<int64_t>(source) * 1'000'000));
+    }
+    std::vector<FrameSet> sets;
+    for (auto i = 0; i < 60; i++)
+    {
+        for (size_t source = sourceCount; source-- > 0;)
+        {
+            auto timestamp = FrameInterval * i + Ticks(static_cast<int64_t>(source) * 1'000'000 + static_cast<int64_t>(source) * 2'000);
+            Append(sets, synchronizer.AddFrame(source, timestamp, Content(i)));
+        }
+    }
+    if (sets.size() != 60)
+    {
+        printf("FAILED: 16 sources made %zu sets\n", sets.size());
+        return false;
+    }
+    for (auto&& set : sets)
+    {
+        for (auto&& frame : set.Frames)
+        {
+            if (Number(frame) != Number(set.Frames[0]) || frame.IsHeld)
+            {
+                printf("FAILED: a set of 16 sources mixed up frames\n");
+                return false;
+            }
+        }
+    }
+    if (synchronizer.Statistics().MaxSpread != Ticks(2'000 * (sourceCount - 1)))
+    {
+        printf("FAILED: the spread across 16 sources was %lld\n", static_cast<long long>(synchronizer.Statistics().MaxSpread.count()));
+        return false;
+    }
+    return true;
+}
+
+bool TestReset()
+{
+    FrameSynchronizer synchronizer;
+    synchronizer.AddSource();
+    synchronizer.AddSource();
+    synchronizer.AddFrame(0, 0ms, Content(0));
+    synchronizer.AddFrame(1, 0ms, Content(0));
+    synchronizer.AddFrame(0, 100ms, Content(1));
+    synchronizer.Reset();
+    if (synchronizer.SourceCount() != 2 || synchronizer.Deadline().has_value() || synchronizer.Statistics().Sets != 0)
+    {
+        printf("FAILED: Reset left frames or statistics behind\n");
+        return false;
+    }
+    // Nothing to hold any more, and earlier times are fine again
+    auto sets = synchronizer.AddFrame(0, 0ms, Content(2));
+    if (!sets.empty() || synchronizer.Deadline() != 100ms || synchronizer.Statistics().SkippedSets != 0)
+    {
+        printf("FAILED: after Reset a set didn't wait for the other source\n");
+        return false;
+    }
+    sets = synchronizer.Poll(1s);
+    if (!sets.empty() || synchronizer.Statistics().OutOfOrderFrames != 0)
+    {
+        printf("FAILED: frames from before Reset were used\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestInvalidArguments()
+{
+    FrameSynchronizerSettings const invalid[] =
+    {
+        { Ticks(-1), 100ms, MissingFramePolicy::HoldLast },
+        { 8ms, Ticks(-1), MissingFramePolicy::Skip },
+    };
+    for (auto&& settings : invalid)
+    {
+        try
+        {
+            FrameSynchronizer synchronizer(settings);
+            printf("FAILED: negative settings didn't throw\n");
+            return false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG)
+            {
+                printf("FAILED: negative settings threw the wrong error\n");
+                return false;
+            }
+        }
+    }
+    try
+    {
+        FrameSynchronizer synchronizer;
+        synchronizer.AddSource();
+        synchronizer.AddFrame(1, 0ms, Content(0));
+        printf("FAILED: an unknown source didn't throw\n");
+        return false;
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        if (error.code() != E_INVALIDARG)
+        {
+            printf("FAILED: an unknown source threw the wrong error\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestMatchesAcrossClocks() && passed;
+    passed = TestHoldsSlowerSource() && passed;
+    passed = TestTolerance() && passed;
+    passed = TestSkipPolicy() && passed;
+    passed = TestTimeout() && passed;
+    passed = TestOutOfOrderFrames() && passed;
+    passed = TestManySources() && passed;
+    passed = TestReset() && passed;
+    passed = TestInvalidArguments() && passed;
+
+    if (passed)
+    {
+        printf("All FrameSynchronizer tests passed\n");
+        return 0;
+    }
+    printf("Some FrameSynchronizer tests failed\n");
+    return 1;
+}
\ No newline at end of file
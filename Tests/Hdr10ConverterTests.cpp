@@ -0,0 +1,239 @@
+#include "pch.h"
+#include "Hdr10Converter.h"
+#include <random>
+
+// BT.709 to BT.2020, the same matrix the converter uses
+double const Rec709ToRec2020[3][3] =
+{
+    { 0.6274040, 0.3292820, 0.0433136 },
+    { 0.0690970, 0.9195400, 0.0113612 },
+    { 0.0163916, 0.0880132, 0.8955950 },
+};
+
+// Rounds to the nearest half, the way the GPU writes them
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    auto exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+    auto mantissa = bits & 0x7fffff;
+    if (exponent >= 31)
+    {
+        return sign | 0x7c00;
+    }
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        auto shift = static_cast<uint32_t>(14 - exponent);
+        auto half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+        {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+    auto half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+    {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+// Every finite half, including denormals and negative zero
+bool TestHalfToFloat()
+{
+    for (uint32_t half = 0; half < 0x10000; half++)
+    {
+        if ((half & 0x7c00) == 0x7c00)
+        {
+            continue;
+        }
+        auto exponent = static_cast<int>((half >> 10) & 0x1f);
+        auto mantissa = static_cast<double>(half & 0x3ff);
+        auto expected = exponent == 0 ? std::ldexp(mantissa, -24) : std::ldexp(1024.0 + mantissa, exponent - 25);
+        if (half & 0x8000)
+        {
+            expected = -expected;
+        }
+        auto value = Hdr10Converter::HalfToFloat(static_cast<uint16_t>(half));
+        if (value != expected || std::signbit(value) != ((half & 0x8000) != 0))
+        {
+            printf("FAILED: half %04X became %g instead of %g\n", half, value, expected);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The table has to stay within 0.004 of a 10-bit code value of the double
+// precision curve everywhere, from black (and below the table's first
+// octave) to 10000 nits
+bool TestEncodePQAccuracy()
+{
+    double worst = 0.0;
+    float worstValue = 0.0f;
+    auto check = [&](float value)
+    {
+        auto error = std::abs(Hdr10Converter::EncodePQ(value) - PQReference(value)) * 1023.0;
+        if (error > worst)
+        {
+            worst = error;
+            worstValue = value;
+        }
+    };
+    int const Steps = 2'000'000;
+    for (int i = 0; i <= Steps; i++)
+    {
+        check(static_cast<float>(std::pow(10.0, -14.0 + 14.0 * i / Steps)));
+    }
+    // Every sample in the table and the points halfway between them
+    for (int exponent = -40; exponent < 0; exponent++)
+    {
+        for (int sample = 0; sample < 128; sample++)
+        {
+            check(std::ldexp(1.0f + sample / 128.0f, exponent));
+        }
+    }
+    check(0.0f);
+    check(1.0f);
+    check(std::numeric_limits<float>::denorm_min());
+    if (worst > 0.004)
+    {
+        printf("FAILED: EncodePQ(%g) is %.4f of a code value from the reference\n", worstValue, worst);
+        return false;
+    }
+    printf("EncodePQ is within %.5f of a code value of the reference\n", worst);
+    return true;
+}
+
+// Out of range values are clamped, and NaN is black
+bool TestEncodePQClamps()
+{
+    auto nan = std::numeric_limits<float>::quiet_NaN();
+    auto infinity = std::numeric_limits<float>::infinity();
+    if (Hdr10Converter::EncodePQ(-1.0f) != Hdr10Converter::EncodePQ(0.0f) ||
+        Hdr10Converter::EncodePQ(nan) != Hdr10Converter::EncodePQ(0.0f) ||
+        Hdr10Converter::EncodePQ(-infinity) != Hdr10Converter::EncodePQ(0.0f))
+    {
+        printf("FAILED: negative values or NaN weren't black\n");
+        return false;
+    }
+    if (Hdr10Converter::EncodePQ(2.0f) != Hdr10Converter::EncodePQ(1.0f) || Hdr10Converter::EncodePQ(infinity) != Hdr10Converter::EncodePQ(1.0f))
+    {
+        printf("FAILED: values past 10000 nits weren't clamped\n");
+        return false;
+    }
+    return true;
+}
+
+// Whole pixels against the conversion done in double precision. The
+// rounded code values can only differ where the exact value is within the
+// table's error of halfway between two codes.
+bool TestConvertPixelAccuracy()
+{
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> channel(-0.5f, 20.0f);
+    uint32_t mismatches = 0;
+    for (int i = 0; i < 300'000; i++)
+    {
+        float color[3] = { channel(random), channel(random), channel(random) };
+        // Plenty of dark colors too, that's where PQ is steepest
+        if (i % 3 == 0)
+        {
+            color[i % 2] = std::ldexp(color[i % 2], -(i % 20));
+        }
+        uint16_t half[4] = { FloatToHalf(color[0]), FloatToHalf(color[1]), FloatToHalf(color[2]), FloatToHalf(1.0f) };
+        auto pixel = Hdr10Converter::ConvertPixel(half);
+        if ((pixel >> 30) != 3)
+        {
+            printf("FAILED: opaque alpha came out as %u\n", pixel >> 30);
+            return false;
+        }
+        for (uint32_t component = 0; component < 3; component++)
+        {
+            double linear = 0.0;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                linear += Rec709ToRec2020[component][k] * Hdr10Converter::HalfToFloat(half[k]);
+            }
+            linear = std::clamp(linear * Hdr10Converter::ScRgbWhiteNits / Hdr10Converter::MaxNits, 0.0, 1.0);
+            auto exact = PQReference(linear) * 1023.0;
+            auto code = static_cast<double>((pixel >> (component * 10)) & 0x3ff);
+            if (std::abs(code - exact) > 0.5 + 0.004 + 1e-4)
+            {
+                printf("FAILED: a channel became code %g where the exact value is %.4f\n", code, exact);
+                return false;
+            }
+            if (code != std::floor(exact + 0.5))
+            {
+                mismatches++;
+            }
+        }
+    }
+    printf("%u of 900000 channels rounded to the neighboring code\n", mismatches);
+    return true;
+}
+
+// The SSE2 path converts four pixels at a time and has to agree exactly
+// with the scalar one, for every kind of half there is. Widths that aren't
+// a multiple of four mix both paths in one row.
+bool TestConvertMatchesConvertPixel()
+{
+    std::mt19937 random(7);
+    uint16_t const special[] = { 0x0000, 0x8000, 0x0001, 0x03ff, 0x3c00, 0xbc00, 0x7bff, 0x7c00, 0xfc00, 0x7e00, 0xfe00, 0x5a40 };
+    for (uint32_t width : { 4u, 5u, 7u, 64u, 333u })
+    {
+        uint32_t const height = 97;
+        auto stride = width * 8 + 24;
+        std::vector<uint8_t> source(static_cast<size_t>(stride) * height);
+        for (uint32_t y = 0; y < height; y++)
+        {
+            auto row = reinterpret_cast<uint16_t*>(source.data() + static_cast<size_t>(y) * stride);
+            for (uint32_t i = 0; i < width * 4; i++)
+            {
+                row[i] = random() % 4 == 0 ? special[random() % std::size(special)] : static_cast<uint16_t>(random());
+            }
+        }
+        std::vector<uint32_t> converted(static_cast<size_t>(width) * height);
+        Hdr10Converter::Convert(source.data(), width, height, stride, converted.data());
+        for (uint32_t y = 0; y < height; y++)
+        {
+            auto row = reinterpret_cast<uint16_t const*>(source.data() + static_cast<size_t>(y) * stride);
+            for (uint32_t x = 0; x < width; x++)
+            {
+                auto expected = Hdr10Converter::ConvertPixel(row + x * 4);
+                if (converted[static_cast<size_t>(y) * width + x] != expected)
+                {
+                    printf("FAILED: pixel %u,%u of a %u wide image is %08X, the scalar version gives %08X\n",
+                        x, y, width, converted[static_cast<size_t>(y) * width + x], expected);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestHalfToFloat() && passed;
+    passed = TestEncodePQAccuracy() && passed;
+    passed = TestEncodePQClamps() && passed;
+    passed = TestConvertPixelAccuracy() && passed;
+    passed = TestConvertMatchesConvertPixel() && passed;
+
+    if (passed)
+    {
+        printf("All Hdr10Converter tests passed\n");
+        return 0;
+    }
+    printf("Some Hdr10Converter tests failed\n");
+    return 1;
+}
\ No newline at end of file
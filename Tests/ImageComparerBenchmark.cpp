@@ -0,0 +1,100 @@
+#include "pch.h"
+#include "ImageComparer.h"
+#include "TestImages.h"
+
+// Comparing captures of a 4K and an 8K screen, against a loop over every
+// channel of every pixel. Most comparisons in a UI test match or nearly
+// match, so that's what matters most, but a completely different image
+// shows what stopping early saves.
+int const Iterations = 5;
+
+// Counts the pixels with a channel off by more than the tolerance
+uint64_t CountDifferent(std::vector<uint8_t> const& expected, std::vector<uint8_t> const& actual, uint8_t tolerance)
+{
+    uint64_t count = 0;
+    for (size_t i = 0; i < expected.size(); i += 4)
+    {
+        for (size_t channel = 0; channel < 3; channel++)
+        {
+            if (std::abs(expected[i + channel] - actual[i + channel]) > tolerance)
+            {
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+template <typename Work>
+double BestMilliseconds(Work&& work)
+{
+    auto best = std::numeric_limits<double>::max();
+    for (int i = 0; i < Iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main()
+{
+    struct Size
+    {
+        char const* Name;
+        uint32_t Width;
+        uint32_t Height;
+    };
+    Size const sizes[] =
+    {
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    printf("%-4s %-12s %10s %10s %10s %10s %10s\n", "", "", "loop ms", "diff ms", "no img ms", "stop ms", "different");
+    for (auto&& size : sizes)
+    {
+        auto stride = size.Width * 4;
+        auto expected = MakeUiImage(size.Width, size.Height, 1);
+
+        // Text that came out a little differently in a few places
+        auto nearly = expected;
+        std::mt19937 random(2);
+        for (int i = 0; i < 40; i++)
+        {
+            auto left = static_cast<int32_t>(random() % (size.Width - 40));
+            auto top = static_cast<int32_t>(random() % (size.Height - 12));
+            FillRect(nearly, stride, left, top, left + 40, top + 12, Bgra(20, 20, 20));
+        }
+        struct Case
+        {
+            char const* Name;
+            std::vector<uint8_t> Actual;
+        };
+        Case const cases[] =
+        {
+            { "identical", expected },
+            { "40 words", nearly },
+            { "different", MakeUiImage(size.Width, size.Height, 3) },
+        };
+        for (auto&& test : cases)
+        {
+            uint64_t different = 0;
+            auto loop = BestMilliseconds([&]() { different = CountDifferent(expected, test.Actual, 0); });
+            ImageComparer withImage;
+            auto diff = BestMilliseconds([&]() { withImage.Compare(expected.data(), stride, test.Actual.data(), stride, size.Width, size.Height); });
+            ImageCompareSettings settings;
+            settings.CreateDiffImage = false;
+            ImageComparer withoutImage(settings);
+            auto noImage = BestMilliseconds([&]() { withoutImage.Compare(expected.data(), stride, test.Actual.data(), stride, size.Width, size.Height); });
+            settings.StopOnFailure = true;
+            ImageComparer stopping(settings);
+            auto stop = BestMilliseconds([&]() { stopping.Compare(expected.data(), stride, test.Actual.data(), stride, size.Width, size.Height); });
+            printf("%-4s %-12s %10.1f %10.1f %10.1f %10.1f %10llu\n", size.Name, test.Name, loop, diff, noImage, stop, static_cast<unsigned long long>(different));
+        }
+    }
+    printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,518 @@
+#include "pch.h"
+#include "ImageComparer.h"
+#include "TestImages.h"
+
+uint32_t const White = Bgra(255, 255, 255);
+uint32_t const Black = Bgra(0, 0, 0);
+uint32_t const Red = 0xFFFF0000;
+uint32_t const Yellow = 0xFFFFFF00;
+
+uint32_t PixelAt(std::vector<uint8_t> const& pixels, uint32_t stride, uint32_t x, uint32_t y)
+{
+    uint32_t pixel = 0;
+    memcpy(&pixel, pixels.data() + static_cast<size_t>(y) * stride + x * 4, 4);
+    return pixel;
+}
+
+void SetPixel(std::vector<uint8_t>& pixels, uint32_t stride, uint32_t x, uint32_t y, uint32_t color)
+{
+    memcpy(pixels.data() + static_cast<size_t>(y) * stride + x * 4, &color, 4);
+}
+
+ImageCompareResult Compare(ImageCompareSettings const& settings, std::vector<uint8_t> const& expected, std::vector<uint8_t> const& actual, uint32_t width, uint32_t height)
+{
+    ImageComparer comparer(settings);
+    return comparer.Compare(expected.data(), width * 4, actual.data(), width * 4, width, height);
+}
+
+// Pixels with a channel further apart than the tolerance outside of the
+// ignored regions, one at a time
+uint64_t CountDifferent(ImageCompareSettings const& settings, std::vector<uint8_t> const& expected, std::vector<uint8_t> const& actual, uint32_t width, uint32_t height)
+{
+    uint64_t count = 0;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            auto ignored = std::any_of(settings.IgnoreRegions.begin(), settings.IgnoreRegions.end(), [&](auto&& region)
+            {
+                return static_cast<LONG>(x) >= region.left && static_cast<LONG>(x) < region.right && static_cast<LONG>(y) >= region.top && static_cast<LONG>(y) < region.bottom;
+            });
+            if (ignored)
+            {
+                continue;
+            }
+            auto channels = settings.CompareAlpha ? 4u : 3u;
+            auto offset = (static_cast<size_t>(y) * width + x) * 4;
+            for (uint32_t channel = 0; channel < channels; channel++)
+            {
+                if (std::abs(expected[offset + channel] - actual[offset + channel]) > settings.Tolerance)
+                {
+                    count++;
+                    break;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+// The diff rects don't overlap, hold every different pixel and are as small
+// as they can be
+bool CheckDiffRects(ImageCompareResult const& result, uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> covered(static_cast<size_t>(width) * height, 0);
+    for (auto&& rect : result.DiffRects)
+    {
+        bool touchesLeft = false;
+        bool touchesTop = false;
+        bool touchesRight = false;
+        bool touchesBottom = false;
+        for (auto y = rect.top; y < rect.bottom; y++)
+        {
+            for (auto x = rect.left; x < rect.right; x++)
+            {
+                auto index = static_cast<size_t>(y) * width + x;
+                if (covered[index]++)
+                {
+                    printf("FAILED: diff rects overlap at %ld,%ld\n", x, y);
+                    return false;
+                }
+                if (PixelAt(result.DiffImage, width * 4, x, y) == Red)
+                {
+                    touchesLeft |= x == rect.left;
+                    touchesTop |= y == rect.top;
+                    touchesRight |= x == rect.right - 1;
+                    touchesBottom |= y == rect.bottom - 1;
+                }
+            }
+        }
+        if (!touchesLeft || !touchesTop || !touchesRight || !touchesBottom)
+        {
+            printf("FAILED: the diff rect %ld,%ld,%ld,%ld is bigger than what's in it\n", rect.left, rect.top, rect.right, rect.bottom);
+            return false;
+        }
+    }
+    uint64_t red = 0;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            if (PixelAt(result.DiffImage, width * 4, x, y) == Red)
+            {
+                red++;
+                if (!covered[static_cast<size_t>(y) * width + x])
+                {
+                    printf("FAILED: the different pixel at %u,%u isn't in a diff rect\n", x, y);
+                    return false;
+                }
+            }
+        }
+    }
+    if (red != result.DifferentPixels)
+    {
+        printf("FAILED: the diff image has %llu red pixels for %llu different ones\n", static_cast<unsigned long long>(red), static_cast<unsigned long long>(result.DifferentPixels));
+        return false;
+    }
+    return true;
+}
+
+bool TestIdenticalImages()
+{
+    // Not a multiple of 16 wide, so both the wide and the one at a time
+    // paths are used
+    auto image = MakeUiImage(203, 77, 1);
+    auto result = Compare({}, image, image, 203, 77);
+    if (!result.Matches || !result.Complete || result.DifferentPixels != 0 || result.AntiAliasedPixels != 0 || !result.DiffRects.empty())
+    {
+        printf("FAILED: an image didn't match itself\n");
+        return false;
+    }
+    // The diff image is the expected one faded out to greys
+    for (size_t i = 0; i < result.DiffImage.size(); i += 4)
+    {
+        auto pixel = &result.DiffImage[i];
+        if (pixel[0] != pixel[1] || pixel[1] != pixel[2] || pixel[3] != 255 || pixel[0] < 229)
+        {
+            printf("FAILED: the diff image of identical images isn't faded out\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every channel off by up to 40 in noise, against the tolerance on either
+// side of it
+bool TestTolerance()
+{
+    uint32_t const width = 203;
+    uint32_t const height = 61;
+    std::mt19937 random(2);
+    auto expected = MakeNoiseImage(width, height, 3, false);
+    auto actual = expected;
+    for (auto&& value : actual)
+    {
+        auto offset = static_cast<int>(random() % 81) - 40;
+        value = static_cast<uint8_t>(std::clamp(value + offset, 0, 255));
+    }
+    for (auto compareAlpha : { false, true })
+    {
+        for (uint8_t tolerance : { 0, 1, 16, 39, 40, 255 })
+        {
+            ImageCompareSettings settings;
+            settings.Tolerance = tolerance;
+            settings.CompareAlpha = compareAlpha;
+            settings.IgnoreAntiAliasing = false;
+            auto result = Compare(settings, expected, actual, width, height);
+            auto expectedCount = CountDifferent(settings, expected, actual, width, height);
+            if (result.DifferentPixels != expectedCount || result.Matches != (expectedCount == 0))
+            {
+                printf("FAILED: a tolerance of %u found %llu different pixels, expected %llu\n", tolerance,
+                    static_cast<unsigned long long>(result.DifferentPixels), static_cast<unsigned long long>(expectedCount));
+                return false;
+            }
+            if (!CheckDiffRects(result, width, height))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Right at the tolerance in one channel matches, one past doesn't
+    auto flat = std::vector<uint8_t>(static_cast<size_t>(width) * height * 4, 100);
+    for (uint32_t channel = 0; channel < 3; channel++)
+    {
+        for (auto offset : { -10, 10, -11, 11 })
+        {
+            auto changed = flat;
+            changed[(static_cast<size_t>(30) * width + 150) * 4 + channel] = static_cast<uint8_t>(100 + offset);
+            ImageCompareSettings settings;
+            settings.Tolerance = 10;
+            auto result = Compare(settings, flat, changed, width, height);
+            if (result.DifferentPixels != (std::abs(offset) > 10 ? 1u : 0u))
+            {
+                printf("FAILED: channel %u off by %d with a tolerance of 10 found %llu different pixels\n", channel, offset,
+                    static_cast<unsigned long long>(result.DifferentPixels));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TestAlpha()
+{
+    auto expected = MakeUiImage(64, 64, 4);
+    auto actual = expected;
+    for (size_t i = 3; i < actual.size(); i += 4)
+    {
+        actual[i] = 0;
+    }
+    if (!Compare({}, expected, actual, 64, 64).Matches)
+    {
+        printf("FAILED: alpha was compared without asking for it\n");
+        return false;
+    }
+    ImageCompareSettings settings;
+    settings.CompareAlpha = true;
+    settings.IgnoreAntiAliasing = false;
+    if (Compare(settings, expected, actual, 64, 64).DifferentPixels != 64 * 64)
+    {
+        printf("FAILED: alpha wasn't compared when asked for\n");
+        return false;
+    }
+    return true;
+}
+
+// A black box on white drawn half a pixel further right, so that its right
+// edge is a column of grey, and a small red box that wasn't there before
+bool TestAntiAliasing()
+{
+    uint32_t const width = 64;
+    uint32_t const height = 48;
+    std::vector<uint8_t> expected(static_cast<size_t>(width) * height * 4);
+    FillRect(expected, width * 4, 0, 0, width, height, White);
+    FillRect(expected, width * 4, 10, 10, 30, 30, Black);
+    auto actual = expected;
+    FillRect(actual, width * 4, 30, 10, 31, 30, Bgra(128, 128, 128));
+    FillRect(actual, width * 4, 45, 20, 50, 25, Bgra(255, 0, 0));
+
+    auto result = Compare({}, expected, actual, width, height);
+    if (result.AntiAliasedPixels != 20 || result.DifferentPixels != 25 || result.Matches)
+    {
+        printf("FAILED: found %llu anti-aliased and %llu different pixels, expected 20 and 25\n",
+            static_cast<unsigned long long>(result.AntiAliasedPixels), static_cast<unsigned long long>(result.DifferentPixels));
+        return false;
+    }
+    if (result.DiffRects.size() != 1 || result.DiffRects[0].left != 45 || result.DiffRects[0].top != 20 ||
+        result.DiffRects[0].right != 50 || result.DiffRects[0].bottom != 25)
+    {
+        printf("FAILED: the anti-aliased edge ended up in the diff rects\n");
+        return false;
+    }
+    if (PixelAt(result.DiffImage, width * 4, 30, 15) != Yellow || PixelAt(result.DiffImage, width * 4, 47, 22) != Red)
+    {
+        printf("FAILED: the diff image doesn't show anti-aliased pixels yellow and different ones red\n");
+        return false;
+    }
+
+    // The same in the other direction
+    result = Compare({}, actual, expected, width, height);
+    if (result.AntiAliasedPixels != 20 || result.DifferentPixels != 25)
+    {
+        printf("FAILED: swapping the images found %llu anti-aliased pixels\n", static_cast<unsigned long long>(result.AntiAliasedPixels));
+        return false;
+    }
+
+    // A whole new column of black isn't a blend of anything
+    auto moved = expected;
+    FillRect(moved, width * 4, 30, 10, 31, 30, Black);
+    result = Compare({}, expected, moved, width, height);
+    if (result.AntiAliasedPixels != 0 || result.DifferentPixels != 20)
+    {
+        printf("FAILED: a box that grew by a pixel was taken for anti-aliasing\n");
+        return false;
+    }
+
+    // Nor is an edge between two flat areas that used to be busy
+    auto busy = expected;
+    auto noise = MakeNoiseImage(30, 20, 9);
+    for (uint32_t y = 0; y < 20; y++)
+    {
+        memcpy(busy.data() + static_cast<size_t>(y + 10) * width * 4 + 10 * 4, noise.data() + static_cast<size_t>(y) * 30 * 4, 30 * 4);
+    }
+    result = Compare({}, busy, actual, width, height);
+    for (uint32_t y = 11; y < 29; y++)
+    {
+        if (PixelAt(result.DiffImage, width * 4, 30, y) != Red)
+        {
+            printf("FAILED: an edge over what used to be noise was taken for anti-aliasing\n");
+            return false;
+        }
+    }
+
+    ImageCompareSettings settings;
+    settings.IgnoreAntiAliasing = false;
+    result = Compare(settings, expected, actual, width, height);
+    if (result.AntiAliasedPixels != 0 || result.DifferentPixels != 45)
+    {
+        printf("FAILED: anti-aliasing was ignored without asking for it\n");
+        return false;
+    }
+    return true;
+}
+
+// Regions that overlap, run off the image and start and end in the middle
+// of 16 pixel runs
+bool TestIgnoreRegions()
+{
+    uint32_t const width = 150;
+    uint32_t const height = 90;
+    auto expected = MakeNoiseImage(width, height, 5);
+    auto actual = MakeNoiseImage(width, height, 6);
+    ImageCompareSettings settings;
+    settings.IgnoreAntiAliasing = false;
+    settings.IgnoreRegions =
+    {
+        { 5, 5, 40, 30 },
+        { 30, 20, 77, 50 },
+        { -20, 60, 19, 200 },
+        { 140, -5, 400, 88 },
+        { 60, 60, 60, 80 },
+        { 35, 22, 38, 28 },
+    };
+    auto result = Compare(settings, expected, actual, width, height);
+    auto expectedCount = CountDifferent(settings, expected, actual, width, height);
+    if (result.DifferentPixels != expectedCount)
+    {
+        printf("FAILED: with ignored regions found %llu different pixels, expected %llu\n",
+            static_cast<unsigned long long>(result.DifferentPixels), static_cast<unsigned long long>(expectedCount));
+        return false;
+    }
+    if (!CheckDiffRects(result, width, height))
+    {
+        return false;
+    }
+
+    // Differences only inside of the regions don't count at all
+    auto clock = expected;
+    FillRect(clock, width * 4, 10, 10, 35, 25, Black);
+    FillRect(clock, width * 4, 141, 0, 150, 88, Black);
+    result = Compare(settings, expected, clock, width, height);
+    if (!result.Matches || result.DifferentPixels != 0 || !result.DiffRects.empty())
+    {
+        printf("FAILED: changes inside of ignored regions were counted\n");
+        return false;
+    }
+    return true;
+}
+
+// Images that are wildly different everywhere stop after the first rows
+// over the limit, ones within it are still looked at in full
+bool TestStopOnFailure()
+{
+    uint32_t const width = 200;
+    uint32_t const height = 200;
+    auto expected = MakeNoiseImage(width, height, 7);
+    auto actual = MakeNoiseImage(width, height, 8);
+    ImageCompareSettings settings;
+    settings.IgnoreAntiAliasing = false;
+    settings.MaxDifferentPixels = 500;
+    settings.StopOnFailure = true;
+    auto result = Compare(settings, expected, actual, width, height);
+    if (result.Matches || result.Complete)
+    {
+        printf("FAILED: completely different images weren't stopped early\n");
+        return false;
+    }
+    // Whole rows are finished, and bands of other threads may get further
+    if (result.DifferentPixels <= 500 || result.DifferentPixels > 500 + width * std::max(1u, std::thread::hardware_concurrency()))
+    {
+        printf("FAILED: stopping early still found %llu different pixels\n", static_cast<unsigned long long>(result.DifferentPixels));
+        return false;
+    }
+    for (auto&& rect : result.DiffRects)
+    {
+        if (static_cast<uint64_t>(rect.bottom) * width > result.DifferentPixels + width * 16)
+        {
+            printf("FAILED: stopping early has a diff rect past the rows that were looked at\n");
+            return false;
+        }
+    }
+
+    settings.StopOnFailure = false;
+    result = Compare(settings, expected, actual, width, height);
+    if (result.Matches || !result.Complete || result.DifferentPixels != CountDifferent(settings, expected, actual, width, height))
+    {
+        printf("FAILED: without stopping early not every pixel was looked at\n");
+        return false;
+    }
+
+    // Up to the limit still matches, and is looked at in full
+    auto close = expected;
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        SetPixel(close, width * 4, (i * 37) % width, i * height / 500, Black);
+    }
+    settings.StopOnFailure = true;
+    result = Compare(settings, expected, close, width, height);
+    if (!result.Matches || !result.Complete || result.DifferentPixels != 500)
+    {
+        printf("FAILED: 500 different pixels didn't match with a limit of 500\n");
+        return false;
+    }
+    SetPixel(close, width * 4, width - 1, height - 1, Black);
+    result = Compare(settings, expected, close, width, height);
+    if (result.Matches || result.DifferentPixels != 501)
+    {
+        printf("FAILED: 501 different pixels matched with a limit of 500\n");
+        return false;
+    }
+    return true;
+}
+
+// Blobs of differences turn into one rect each, even across blocks
+bool TestDiffRects()
+{
+    uint32_t const width = 100;
+    uint32_t const height = 80;
+    std::vector<uint8_t> expected(static_cast<size_t>(width) * height * 4);
+    FillRect(expected, width * 4, 0, 0, width, height, White);
+    auto actual = expected;
+    FillRect(actual, width * 4, 3, 5, 40, 44, Black);
+    FillRect(actual, width * 4, 70, 2, 71, 3, Black);
+    FillRect(actual, width * 4, 60, 50, 99, 79, Black);
+    auto result = Compare({}, expected, actual, width, height);
+    if (result.DiffRects.size() != 3)
+    {
+        printf("FAILED: three boxes made %zu diff rects\n", result.DiffRects.size());
+        return false;
+    }
+    RECT const expectedRects[] = { { 70, 2, 71, 3 }, { 3, 5, 40, 44 }, { 60, 50, 99, 79 } };
+    for (size_t i = 0; i < 3; i++)
+    {
+        auto&& rect = result.DiffRects[i];
+        auto&& expectedRect = expectedRects[i];
+        if (rect.left != expectedRect.left || rect.top != expectedRect.top || rect.right != expectedRect.right || rect.bottom != expectedRect.bottom)
+        {
+            printf("FAILED: diff rect %zu is %ld,%ld,%ld,%ld\n", i, rect.left, rect.top, rect.right, rect.bottom);
+            return false;
+        }
+    }
+
+    // An L doesn't fit one rect without taking in what didn't change
+    auto shape = expected;
+    FillRect(shape, width * 4, 5, 5, 20, 70, Black);
+    FillRect(shape, width * 4, 20, 55, 90, 70, Black);
+    result = Compare({}, expected, shape, width, height);
+    if (result.DifferentPixels != 15 * 65 + 70 * 15 || result.DiffRects.size() < 2 || !CheckDiffRects(result, width, height))
+    {
+        printf("FAILED: an L shape made %zu diff rects\n", result.DiffRects.size());
+        return false;
+    }
+    return true;
+}
+
+// Rows padded past the width, with the padding different, only compare
+// what's inside
+bool TestPaddedRows()
+{
+    uint32_t const width = 37;
+    uint32_t const height = 20;
+    uint32_t const stride = 64 * 4;
+    std::vector<uint8_t> expected(static_cast<size_t>(stride) * height, 0x11);
+    std::vector<uint8_t> actual(static_cast<size_t>(stride) * height, 0xEE);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        memset(expected.data() + static_cast<size_t>(y) * stride, 0x40, width * 4);
+        memset(actual.data() + static_cast<size_t>(y) * stride, 0x40, width * 4);
+    }
+    SetPixel(actual, stride, 36, 19, Black);
+    ImageComparer comparer;
+    auto result = comparer.Compare(expected.data(), stride, actual.data(), stride, width, height);
+    if (result.DifferentPixels != 1 || result.DiffImage.size() != static_cast<size_t>(width) * height * 4)
+    {
+        printf("FAILED: padded rows found %llu different pixels\n", static_cast<unsigned long long>(result.DifferentPixels));
+        return false;
+    }
+
+    for (auto&& [badWidth, badHeight, badStride] : { std::tuple{ 0u, 20u, stride }, std::tuple{ 37u, 0u, stride }, std::tuple{ 65u, 20u, stride } })
+    {
+        try
+        {
+            comparer.Compare(expected.data(), badStride, actual.data(), badStride, badWidth, badHeight);
+            printf("FAILED: a %ux%u image with a stride of %u didn't throw\n", badWidth, badHeight, badStride);
+            return false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG)
+            {
+                printf("FAILED: an invalid size threw the wrong error\n");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestIdenticalImages() && passed;
+    passed = TestTolerance() && passed;
+    passed = TestAlpha() && passed;
+    passed = TestAntiAliasing() && passed;
+    passed = TestIgnoreRegions() && passed;
+    passed = TestStopOnFailure() && passed;
+    passed = TestDiffRects() && passed;
+    passed = TestPaddedRows() && passed;
+
+    if (passed)
+    {
+        printf("All ImageComparer tests passed\n");
+        return 0;
+    }
+    printf("Some ImageComparer tests failed\n");
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "pch.h"
+#include "LatencyMeter.h"
+#include "TestImages.h"
+
+using namespace std::chrono_literals;
+
+Ticks const RefreshInterval = Ticks(166'667);
+
+bool TestMeasuresOneFlash()
+{
+    LatencyMeter meter;
+    auto phase = meter.OnInput(100ms);
+    if (phase != MarkerPhase::Light)
+    {
+        printf("FAILED: the first flash wasn't away from the initial phase\n");
+        return false;
+    }
+    // Still the old phase, and then the new one composed before the input
+    // but delivered after it
+    meter.OnFrame(105ms, 108ms, MarkerPhase::Dark);
+    meter.OnFrame(99ms, 110ms, MarkerPhase::Light);
+    if (meter.Report().Samples != 0)
+    {
+        printf("FAILED: a frame composed before the input counted\n");
+        return false;
+    }
+    // Input while the flash is on its way is ignored
+    if (meter.OnInput(112ms).has_value())
+    {
+        printf("FAILED: input while a flash was on its way wasn't ignored\n");
+        return false;
+    }
+    meter.OnFrame(121ms, 130ms, MarkerPhase::Light);
+    auto report = meter.Report();
+    if (report.Samples != 1 || report.Missed != 0 || report.ToFrame.Median != 21ms || report.ToArrival.Median != 30ms)
+    {
+        printf("FAILED: measured %lld and %lld ticks, expected 21ms to the frame and 30ms to arrival\n",
+            static_cast<long long>(report.ToFrame.Median.count()), static_cast<long long>(report.ToArrival.Median.count()));
+        return false;
+    }
+    // Next time back the other way, even after a frame where the marker
+    // couldn't be seen
+    meter.OnFrame(150ms, 155ms, MarkerPhase::None);
+    if (meter.OnInput(200ms) != MarkerPhase::Dark)
+    {
+        printf("FAILED: the second flash wasn't back to dark\n");
+        return false;
+    }
+    return true;
+}
+
+// A flash that never shows up is missed once the timeout has passed, on the
+// next input or frame, and the next one still flashes away from what the
+// frames show
+bool TestMissedFlashes()
+{
+    LatencyMeter meter(500ms);
+    meter.OnInput(0ms);
+    meter.OnFrame(400ms, 500ms, MarkerPhase::Dark);
+    if (meter.Report().Missed != 0)
+    {
+        printf("FAILED: a flash was missed right at the timeout\n");
+        return false;
+    }
+    // A covered marker doesn't tell us anything
+    meter.OnFrame(450ms, 501ms, MarkerPhase::None);
+    if (meter.Report().Missed != 1)
+    {
+        printf("FAILED: a flash wasn't missed after the timeout\n");
+        return false;
+    }
+    if (meter.OnInput(600ms) != MarkerPhase::Light)
+    {
+        printf("FAILED: after a missed flash the marker didn't flash away from what was shown\n");
+        return false;
+    }
+    if (meter.OnInput(1101ms) != MarkerPhase::Light || meter.Report().Missed != 2)
+    {
+        printf("FAILED: input after the timeout didn't miss the flash before\n");
+        return false;
+    }
+    meter.OnFrame(1110ms, 1115ms, MarkerPhase::Light);
+    auto report = meter.Report();
+    if (report.Samples != 1 || report.ToFrame.Max != 9ms)
+    {
+        printf("FAILED: a flash after two missed ones wasn't measured\n");
+        return false;
+    }
+
+    meter.Reset();
+    report = meter.Report();
+    if (report.Samples != 0 || report.Missed != 0 || report.ToFrame.Max != Ticks(0))
+    {
+        printf("FAILED: Reset left samples behind\n");
+        return false;
+    }
+    // The marker still shows what it did
+    if (meter.OnInput(2s) != MarkerPhase::Dark)
+    {
+        printf("FAILED: Reset forgot what the marker shows\n");
+        return false;
+    }
+    return true;
+}
+
+// Nearest rank percentiles over 1 to 100ms, shuffled, and only the latest
+// MaxSamples are kept
+bool TestPercentiles()
+{
+    // Ranks round up
+    LatencyMeter few;
+    for (auto latency = 1; latency <= 7; latency++)
+    {
+        auto input = std::chrono::seconds(latency);
+        auto phase = few.OnInput(input);
+        few.OnFrame(input + std::chrono::milliseconds(latency), input + std::chrono::milliseconds(latency), phase.value());
+    }
+    auto fewReport = few.Report();
+    if (fewReport.ToFrame.Median != 4ms || fewReport.ToFrame.P90 != 7ms || fewReport.ToFrame.Min != 1ms)
+    {
+        printf("FAILED: the median and 90th percentile of 1 to 7ms were %lld and %lld\n",
+            static_cast<long long>(fewReport.ToFrame.Median.count()), static_cast<long long>(fewReport.ToFrame.P90.count()));
+        return false;
+    }
+
+    LatencyMeter meter;
+    std::vector<int> latencies(100);
+    std::iota(latencies.begin(), latencies.end(), 1);
+    std::shuffle(latencies.begin(), latencies.end(), std::mt19937(6));
+    auto now = Ticks(0);
+    auto flash = [&](Ticks latency)
+    {
+        auto phase = meter.OnInput(now);
+        meter.OnFrame(now + latency, now + latency + 2ms, phase.value());
+        now += 1s;
+    };
+    for (auto latency : latencies)
+    {
+        flash(std::chrono::milliseconds(latency));
+    }
+    auto report = meter.Report();
+    auto&& frame = report.ToFrame;
+    if (report.Samples != 100 || frame.Min != 1ms || frame.Median != 50ms || frame.P90 != 90ms || frame.P95 != 95ms || frame.P99 != 99ms || frame.Max != 100ms)
+    {
+        printf("FAILED: the percentiles of 1 to 100ms were %lld %lld %lld %lld %lld %lld\n", static_cast<long long>(frame.Min.count()),
+            static_cast<long long>(frame.Median.count()), static_cast<long long>(frame.P90.count()), static_cast<long long>(frame.P95.count()),
+            static_cast<long long>(frame.P99.count()), static_cast<long long>(frame.Max.count()));
+        return false;
+    }
+    if (report.ToArrival.Min != 3ms || report.ToArrival.Max != 102ms)
+    {
+        printf("FAILED: the latencies to arrival weren't 2ms more\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < LatencyMeter::MaxSamples; i++)
+    {
+        flash(200ms);
+    }
+    report = meter.Report();
+    if (report.Samples != LatencyMeter::MaxSamples || report.ToFrame.Min != 200ms)
+    {
+        printf("FAILED: the oldest samples weren't dropped\n");
+        return false;
+    }
+    return true;
+}
+
+// The whole loop on synthetic frames: input comes in at random times, the
+// app flashes the marker on its next frame, and the compositor shows that
+// on the refresh after. The capture sees the marker through a window that
+// sometimes covers it, and frames arrive a few milliseconds after they're
+// composed.
+bool TestSimulatedCapture()
+{
+    uint32_t const width = 160;
+    uint32_t const height = 90;
+    uint32_t const stride = width * 4;
+    RECT const bounds = { 120, 50, 150, 80 };
+    MarkerDetector detector(bounds);
+    LatencyMeter meter;
+    auto frame = MakeUiImage(width, height, 7);
+
+    auto drawMarker = [&](MarkerPhase phase)
+    {
+        auto light = Bgra(255, 255, 255);
+        auto dark = Bgra(0, 0, 0);
+        auto first = phase == MarkerPhase::Light ? light : dark;
+        auto second = phase == MarkerPhase::Light ? dark : light;
+        FillRect(frame, stride, 120, 50, 135, 65, first);
+        FillRect(frame, stride, 135, 50, 150, 65, second);
+        FillRect(frame, stride, 120, 65, 135, 80, second);
+        FillRect(frame, stride, 135, 65, 150, 80, first);
+    };
+    drawMarker(LatencyMeter::InitialPhase);
+
+    std::mt19937 random(8);
+    std::vector<Ticks> expected;
+    auto nextInput = Ticks(5ms);
+    std::optional<std::pair<Ticks, MarkerPhase>> pendingPhase;
+    uint32_t covered = 0;
+    for (auto refresh = 1; refresh <= 60 * 120; refresh++)
+    {
+        auto refreshTime = RefreshInterval * refresh;
+        while (nextInput < refreshTime)
+        {
+            auto phase = meter.OnInput(nextInput);
+            if (phase.has_value())
+            {
+                // Drawn by the app on the next refresh, composed on the one after
+                auto shown = RefreshInterval * ((nextInput / RefreshInterval) + 2);
+                pendingPhase = { shown, phase.value() };
+                expected.push_back(shown - nextInput);
+            }
+            nextInput += Ticks(static_cast<int64_t>(random() % 4'000'000) + 100'000);
+        }
+        if (pendingPhase.has_value() && pendingPhase->first <= refreshTime)
+        {
+            drawMarker(pendingPhase->second);
+            pendingPhase.reset();
+        }
+        // A window goes over the marker now and then, but not for long
+        auto captured = frame;
+        if (random() % 50 == 0)
+        {
+            FillRect(captured, stride, 100, 40, 140, 70, Bgra(230, 230, 230));
+            covered++;
+        }
+        auto arrival = refreshTime + Ticks(static_cast<int64_t>(random() % 40'000) + 10'000);
+        meter.OnFrame(refreshTime, arrival, detector.Detect(captured.data(), stride, width, height));
+    }
+
+    auto report = meter.Report();
+    if (covered == 0 || report.Missed != 0 || report.Samples + 1 < expected.size() || report.Samples > expected.size())
+    {
+        printf("FAILED: %zu flashes measured and %zu missed out of %zu\n", report.Samples, report.Missed, expected.size());
+        return false;
+    }
+    // Covered frames only delay a flash by a refresh, so everything is
+    // within a refresh of what was drawn
+    expected.resize(report.Samples);
+    std::sort(expected.begin(), expected.end());
+    auto&& toFrame = report.ToFrame;
+    if (toFrame.Min < expected.front() || toFrame.Max > expected.back() + RefreshInterval ||
+        toFrame.Median < expected[expected.size() / 2] - RefreshInterval || toFrame.Median > expected[expected.size() / 2] + RefreshInterval)
+    {
+        printf("FAILED: measured %lld to %lld ticks with a median of %lld, expected %lld to %lld\n", static_cast<long long>(toFrame.Min.count()),
+            static_cast<long long>(toFrame.Max.count()), static_cast<long long>(toFrame.Median.count()),
+            static_cast<long long>(expected.front().count()), static_cast<long long>(expected.back().count()));
+        return false;
+    }
+    if (report.ToArrival.Min < toFrame.Min + Ticks(10'000) || report.ToArrival.Max > toFrame.Max + Ticks(50'000))
+    {
+        printf("FAILED: the latencies to arrival don't follow the arrival times\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestInvalidTimeout()
+{
+    for (auto timeout : { Ticks(0), Ticks(-1) })
+    {
+        try
+        {
+            LatencyMeter meter(timeout);
+            printf("FAILED: a timeout of %lld didn't throw\n", static_cast<long long>(timeout.count()));
+            return false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG)
+            {
+                printf("FAILED: an invalid timeout threw the wrong error\n");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestMeasuresOneFlash() && passed;
+    passed = TestMissedFlashes() && passed;
+    passed = TestPercentiles() && passed;
+    passed = TestSimulatedCapture() && passed;
+    passed = TestInvalidTimeout() && passed;
+
+    if (passed)
+    {
+        printf("All LatencyMeter tests passed\n");
+        return 0;
+    }
+    printf("Some LatencyMeter tests failed\n");
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "LatestFrameCache.h"
+
+// A 60fps capture publishing 1080p frames while other threads keep asking
+// for the latest one, the way the change trigger polls and snapshots get
+// taken, with the cache and with the obvious version that takes a lock.
+// What matters is that the frame pool's thread never waits on someone
+// else's copy, and that asking for a frame that's already been copied is
+// cheap.
+uint32_t const Width = 1920;
+uint32_t const Height = 1080;
+auto const FrameInterval = std::chrono::microseconds(16667);
+auto const ReadInterval = std::chrono::milliseconds(1);
+auto const RunTime = std::chrono::seconds(2);
+int const HitCount = 1000000;
+
+using Frame = std::vector<uint32_t>;
+
+std::shared_ptr<Frame const> CopyFrame(Frame const& frame)
+{
+    return std::make_shared<Frame const>(frame);
+}
+
+// The same thing behind a mutex, which the copy is made under
+class LockedLatestFrame
+{
+public:
+    void Publish(std::shared_ptr<Frame> frame)
+    {
+        auto lock = std::scoped_lock(m_lock);
+        m_frame = std::move(frame);
+        m_version++;
+    }
+
+    std::shared_ptr<Frame const> GetCopy()
+    {
+        auto lock = std::scoped_lock(m_lock);
+        if (m_copy == nullptr || m_copyVersion != m_version)
+        {
+            m_copy = CopyFrame(*m_frame);
+            m_copyVersion = m_version;
+            m_copies++;
+        }
+        return m_copy;
+    }
+
+    int Copies()
+    {
+        auto lock = std::scoped_lock(m_lock);
+        return m_copies;
+    }
+
+private:
+    std::mutex m_lock;
+    std::shared_ptr<Frame> m_frame;
+    uint64_t m_version = 0;
+    std::shared_ptr<Frame const> m_copy;
+    uint64_t m_copyVersion = 0;
+    int m_copies = 0;
+};
+
+struct Result
+{
+    int Reads = 0;
+    double MeanReadMicroseconds = 0;
+    double WorstReadMicroseconds = 0;
+    int Frames = 0;
+    double WorstPublishMicroseconds = 0;
+};
+
+double MicrosecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Publish, typename GetCopy>
+Result Run(int readerCount, Publish&& publish, GetCopy&& getCopy)
+{
+    std::atomic<bool> done = false;
+    std::mutex resultLock;
+    Result result;
+    double totalReadMicroseconds = 0;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < readerCount; i++)
+    {
+        readers.emplace_back([&]()
+        {
+            int reads = 0;
+            double total = 0;
+            double worst = 0;
+            while (!done.load())
+            {
+                auto readStart = std::chrono::steady_clock::now();
+                getCopy();
+                auto readTime = MicrosecondsSince(readStart);
+                reads++;
+                total += readTime;
+                worst = std::max(worst, readTime);
+                std::this_thread::sleep_for(ReadInterval);
+            }
+            auto lock = std::scoped_lock(resultLock);
+            result.Reads += reads;
+            totalReadMicroseconds += total;
+            result.WorstReadMicroseconds = std::max(result.WorstReadMicroseconds, worst);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    while (next - start < RunTime)
+    {
+        // The new frame is made before the clock starts, only handing it
+        // over is timed
+        auto frame = std::make_shared<Frame>(static_cast<size_t>(Width) * Height, static_cast<uint32_t>(result.Frames));
+        auto publishStart = std::chrono::steady_clock::now();
+        publish(std::move(frame));
+        result.WorstPublishMicroseconds = std::max(result.WorstPublishMicroseconds, MicrosecondsSince(publishStart));
+        result.Frames++;
+        next += FrameInterval;
+        std::this_thread::sleep_until(next);
+    }
+    done.store(true);
+    for (auto&& reader : readers)
+    {
+        reader.join();
+    }
+    result.MeanReadMicroseconds = totalReadMicroseconds / std::max(result.Reads, 1);
+    return result;
+}
+
+void Print(char const* name, int readerCount, Result const& result, int copies)
+{
+    printf("%-8s %7d %7d %12.1f %13.1f %7d %8d %18.1f\n", name, readerCount, result.Reads, result.MeanReadMicroseconds,
+        result.WorstReadMicroseconds, copies, result.Frames, result.WorstPublishMicroseconds);
+}
+
+int main()
+{
+    // Asking again for a frame that's already been copied, on one thread
+    {
+        LatestFrameCache<Frame, Frame> cache;
+        cache.Publish(std::make_shared<Frame>(static_cast<size_t>(Width) * Height));
+        cache.GetCopy(CopyFrame);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < HitCount; i++)
+        {
+            cache.GetCopy(CopyFrame);
+        }
+        auto cacheHit = MicrosecondsSince(start) * 1000 / HitCount;
+
+        LockedLatestFrame locked;
+        locked.Publish(std::make_shared<Frame>(static_cast<size_t>(Width) * Height));
+        locked.GetCopy();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < HitCount; i++)
+        {
+            locked.GetCopy();
+        }
+        auto lockedHit = MicrosecondsSince(start) * 1000 / HitCount;
+        printf("Copy already made: cache %.1f ns, mutex %.1f ns\n\n", cacheHit, lockedHit);
+    }
+
+    printf("%-8s %7s %7s %12s %13s %7s %8s %18s\n", "", "readers", "reads", "mean read us", "worst read us", "copies", "frames", "worst publish us");
+    for (auto readerCount : { 1, 4, 16 })
+    {
+        {
+            LatestFrameCache<Frame, Frame> cache;
+            std::atomic<int> copies = 0;
+            auto result = Run(readerCount,
+                [&](std::shared_ptr<Frame> frame) { cache.Publish(std::move(frame)); },
+                [&]()
+                {
+                    return cache.GetCopy([&](Frame const& frame)
+                    {
+                        copies.fetch_add(1);
+                        return CopyFrame(frame);
+                    });
+                });
+            Print("cache", readerCount, result, copies.load());
+        }
+        {
+            LockedLatestFrame locked;
+            locked.Publish(std::make_shared<Frame>(static_cast<size_t>(Width) * Height));
+            auto result = Run(readerCount,
+                [&](std::shared_ptr<Frame> frame) { locked.Publish(std::move(frame)); },
+                [&]() { return locked.GetCopy(); });
+            Print("mutex", readerCount, result, locked.Copies());
+        }
+    }
+    return 0;
+}
\ No newline at end of file
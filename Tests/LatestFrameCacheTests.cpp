@@ -0,0 +1,290 @@
+#include "pch.h"
+#include "LatestFrameCache.h"
+
+// Every pixel of a frame holds its number, so a copy that caught two
+// frames at once doesn't pass for either
+struct TestFrame
+{
+    uint64_t Number = 0;
+    std::vector<uint64_t> Pixels;
+};
+
+std::shared_ptr<TestFrame> MakeFrame(uint64_t number, size_t pixelCount = 64)
+{
+    auto frame = std::make_shared<TestFrame>();
+    frame->Number = number;
+    frame->Pixels.assign(pixelCount, number);
+    return frame;
+}
+
+bool IsWhole(TestFrame const& frame)
+{
+    return std::all_of(frame.Pixels.begin(), frame.Pixels.end(), [&](uint64_t pixel) { return pixel == frame.Number; });
+}
+
+using TestCache = LatestFrameCache<TestFrame, TestFrame>;
+
+// Copies the frame and counts how many times it was asked to
+struct Copier
+{
+    int Count = 0;
+
+    std::shared_ptr<TestFrame const> operator()(TestFrame const& frame)
+    {
+        Count++;
+        return std::make_shared<TestFrame const>(frame);
+    }
+};
+
+bool TestEmpty()
+{
+    TestCache cache;
+    Copier copier;
+    if (cache.GetCopy(std::ref(copier)) != nullptr || cache.Load() != nullptr || copier.Count != 0)
+    {
+        printf("FAILED: an empty cache handed out a frame\n");
+        return false;
+    }
+    return true;
+}
+
+// Nothing gets copied until someone asks, and then only once per frame
+bool TestCopiesLazilyOncePerFrame()
+{
+    TestCache cache;
+    Copier copier;
+    cache.Publish(MakeFrame(1));
+    cache.Publish(MakeFrame(2));
+    if (copier.Count != 0)
+    {
+        printf("FAILED: publishing made a copy\n");
+        return false;
+    }
+
+    auto first = cache.GetCopy(std::ref(copier));
+    auto second = cache.GetCopy(std::ref(copier));
+    if (first == nullptr || first->Number != 2 || first != second || copier.Count != 1)
+    {
+        printf("FAILED: asking twice for the same frame made %d copies\n", copier.Count);
+        return false;
+    }
+
+    cache.Publish(MakeFrame(3));
+    auto third = cache.GetCopy(std::ref(copier));
+    if (third == nullptr || third->Number != 3 || copier.Count != 2)
+    {
+        printf("FAILED: a new frame didn't get a new copy\n");
+        return false;
+    }
+    // Whoever still holds the old copy keeps it as it was
+    if (first->Number != 2 || !IsWhole(*first))
+    {
+        printf("FAILED: an old copy changed\n");
+        return false;
+    }
+    return true;
+}
+
+// SimpleCapture copies each frame into the same texture and publishes it
+// again
+bool TestPublishSameFrameAgain()
+{
+    TestCache cache;
+    Copier copier;
+    auto frame = MakeFrame(1);
+    cache.Publish(frame);
+    auto before = cache.GetCopy(std::ref(copier));
+
+    frame->Number = 2;
+    frame->Pixels.assign(frame->Pixels.size(), 2);
+    cache.Publish(frame);
+    auto after = cache.GetCopy(std::ref(copier));
+    if (after == nullptr || after->Number != 2 || before->Number != 1 || copier.Count != 2)
+    {
+        printf("FAILED: publishing a changed frame again kept the old copy\n");
+        return false;
+    }
+    return true;
+}
+
+// A frame that can't be copied (SimpleCapture asked for another pixel
+// format) gives nullptr, and the next caller gets to try again
+bool TestCopyRefused()
+{
+    TestCache cache;
+    cache.Publish(MakeFrame(1));
+    int refusals = 0;
+    auto refuse = [&](TestFrame const&) -> std::shared_ptr<TestFrame const>
+    {
+        refusals++;
+        return nullptr;
+    };
+    if (cache.GetCopy(refuse) != nullptr || cache.GetCopy(refuse) != nullptr || refusals != 2)
+    {
+        printf("FAILED: a refused copy was remembered\n");
+        return false;
+    }
+    Copier copier;
+    auto copy = cache.GetCopy(std::ref(copier));
+    if (copy == nullptr || copy->Number != 1 || copier.Count != 1)
+    {
+        printf("FAILED: a refused copy kept the frame from being copied\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestClear()
+{
+    TestCache cache;
+    Copier copier;
+    cache.Publish(MakeFrame(1));
+    auto copy = cache.GetCopy(std::ref(copier));
+    auto version = cache.Version();
+    cache.Clear();
+    if (cache.Load() != nullptr || cache.GetCopy(std::ref(copier)) != nullptr || cache.Version() == version)
+    {
+        printf("FAILED: a cleared cache still handed out a frame\n");
+        return false;
+    }
+    if (copy == nullptr || !IsWhole(*copy))
+    {
+        printf("FAILED: clearing changed a copy someone held\n");
+        return false;
+    }
+    // SimpleCapture clears it when it closes, the copy is a texture
+    std::weak_ptr<TestFrame const> held = copy;
+    copy = nullptr;
+    if (!held.expired())
+    {
+        printf("FAILED: a cleared cache held on to its copy\n");
+        return false;
+    }
+    return true;
+}
+
+// Threads that all ask for a frame nobody has copied yet get one copy
+// between them, not one each
+bool TestConcurrentMissesCopyOnce()
+{
+    int const ReaderCount = 4;
+    TestCache cache;
+    cache.Publish(MakeFrame(1, 1 << 20));
+    std::atomic<int> copies = 0;
+    std::atomic<int> started = 0;
+    std::vector<std::shared_ptr<TestFrame const>> results(ReaderCount);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < ReaderCount; i++)
+    {
+        readers.emplace_back([&, i]()
+        {
+            started.fetch_add(1);
+            while (started.load() < ReaderCount)
+            {
+                std::this_thread::yield();
+            }
+            results[i] = cache.GetCopy([&](TestFrame const& frame)
+            {
+                copies.fetch_add(1);
+                // Slow enough that the others ask while it's being made
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                return std::make_shared<TestFrame const>(frame);
+            });
+        });
+    }
+    for (auto&& reader : readers)
+    {
+        reader.join();
+    }
+    if (copies.load() != 1 || std::any_of(results.begin(), results.end(), [&](auto&& result) { return result != results[0]; }))
+    {
+        printf("FAILED: %d threads asking for the same frame made %d copies\n", ReaderCount, copies.load());
+        return false;
+    }
+    return true;
+}
+
+// A thread publishing new frames while others copy them. Nobody gets a
+// copy that's torn or older than one they already had.
+bool TestConcurrentReaders()
+{
+    uint64_t const FrameCount = 20000;
+    int const ReaderCount = 3;
+    TestCache cache;
+    cache.Publish(MakeFrame(0));
+    std::atomic<bool> done = false;
+    std::atomic<int> copies = 0;
+    std::atomic<bool> passed = true;
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < ReaderCount; i++)
+    {
+        readers.emplace_back([&]()
+        {
+            uint64_t last = 0;
+            while (!done.load())
+            {
+                auto copy = cache.GetCopy([&](TestFrame const& frame)
+                {
+                    copies.fetch_add(1);
+                    return std::make_shared<TestFrame const>(frame);
+                });
+                if (copy == nullptr || !IsWhole(*copy) || copy->Number < last)
+                {
+                    passed.store(false);
+                    return;
+                }
+                last = copy->Number;
+            }
+        });
+    }
+    for (uint64_t number = 1; number <= FrameCount; number++)
+    {
+        cache.Publish(MakeFrame(number));
+    }
+    done.store(true);
+    for (auto&& reader : readers)
+    {
+        reader.join();
+    }
+
+    if (!passed.load())
+    {
+        printf("FAILED: a reader got a torn copy or went back in time\n");
+        return false;
+    }
+    Copier copier;
+    auto last = cache.GetCopy(std::ref(copier));
+    if (last == nullptr || last->Number != FrameCount)
+    {
+        printf("FAILED: the last frame wasn't the one handed out\n");
+        return false;
+    }
+    // Each frame is copied once at most
+    if (copies.load() > static_cast<int>(FrameCount + 1))
+    {
+        printf("FAILED: %d copies of %llu frames\n", copies.load(), static_cast<unsigned long long>(FrameCount));
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestEmpty() && passed;
+    passed = TestCopiesLazilyOncePerFrame() && passed;
+    passed = TestPublishSameFrameAgain() && passed;
+    passed = TestCopyRefused() && passed;
+    passed = TestClear() && passed;
+    passed = TestConcurrentMissesCopyOnce() && passed;
+    passed = TestConcurrentReaders() && passed;
+
+    if (passed)
+    {
+        printf("All LatestFrameCache tests passed\n");
+        return 0;
+    }
+    printf("Some LatestFrameCache tests failed\n");
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "pch.h"
+#include "MarkerDetector.h"
+#include "TestImages.h"
+
+uint32_t const Width = 200;
+uint32_t const Height = 120;
+uint32_t const Stride = Width * 4;
+
+// The 2x2 checkerboard the way LatencyMarkerWindow draws it, into a frame
+void DrawMarker(std::vector<uint8_t>& frame, uint32_t stride, RECT const& bounds, MarkerPhase phase, uint32_t light = Bgra(255, 255, 255), uint32_t dark = Bgra(0, 0, 0))
+{
+    auto middleX = (bounds.left + bounds.right) / 2;
+    auto middleY = (bounds.top + bounds.bottom) / 2;
+    auto first = phase == MarkerPhase::Light ? light : dark;
+    auto second = phase == MarkerPhase::Light ? dark : light;
+    FillRect(frame, stride, bounds.left, bounds.top, middleX, middleY, first);
+    FillRect(frame, stride, middleX, bounds.top, bounds.right, middleY, second);
+    FillRect(frame, stride, bounds.left, middleY, middleX, bounds.bottom, second);
+    FillRect(frame, stride, middleX, middleY, bounds.right, bounds.bottom, first);
+}
+
+char const* PhaseName(MarkerPhase phase)
+{
+    switch (phase)
+    {
+    case MarkerPhase::Light: return "light";
+    case MarkerPhase::Dark: return "dark";
+    default: return "none";
+    }
+}
+
+// Markers of odd sizes at odd places, so that the squares aren't the same
+// size and the rows aren't a multiple of four pixels
+bool TestFindsBothPhases()
+{
+    RECT const markers[] =
+    {
+        { 0, 0, 2, 2 },
+        { 13, 7, 30, 20 },
+        { 41, 3, 104, 68 },
+        { 150, 90, 200, 120 },
+        { 7, 100, 14, 103 },
+    };
+    for (auto&& bounds : markers)
+    {
+        MarkerDetector detector(bounds);
+        for (auto phase : { MarkerPhase::Light, MarkerPhase::Dark })
+        {
+            auto frame = MakeUiImage(Width, Height, 1);
+            DrawMarker(frame, Stride, bounds, phase);
+            auto detected = detector.Detect(frame.data(), Stride, Width, Height);
+            if (detected != phase)
+            {
+                printf("FAILED: a %s marker at %ld,%ld,%ld,%ld was seen as %s\n", PhaseName(phase), bounds.left, bounds.top, bounds.right, bounds.bottom, PhaseName(detected));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Averages just past the thresholds count, ones right at them don't. Noise
+// and color with the same average are the same as grey.
+bool TestThresholds()
+{
+    RECT const bounds = { 20, 20, 60, 50 };
+    MarkerDetector detector(bounds);
+    auto grey = [](uint8_t value) { return Bgra(value, value, value); };
+    struct Case
+    {
+        uint32_t Light;
+        uint32_t Dark;
+        MarkerPhase Expected;
+    };
+    Case const cases[] =
+    {
+        { grey(MarkerDetector::LightThreshold + 1), grey(MarkerDetector::DarkThreshold - 1), MarkerPhase::Light },
+        { grey(MarkerDetector::LightThreshold), grey(0), MarkerPhase::None },
+        { grey(255), grey(MarkerDetector::DarkThreshold), MarkerPhase::None },
+        { grey(128), grey(0), MarkerPhase::None },
+        // Averages 170 and 94
+        { Bgra(255, 255, 0), Bgra(0, 0, 255) | 0x00001B1B, MarkerPhase::Light },
+        // Alpha doesn't matter
+        { grey(255) & 0x00FFFFFF, grey(0), MarkerPhase::Light },
+    };
+    for (auto&& test : cases)
+    {
+        auto frame = MakeUiImage(Width, Height, 2);
+        DrawMarker(frame, Stride, bounds, MarkerPhase::Light, test.Light, test.Dark);
+        auto detected = detector.Detect(frame.data(), Stride, Width, Height);
+        if (detected != test.Expected)
+        {
+            printf("FAILED: light %08X and dark %08X were seen as %s\n", test.Light, test.Dark, PhaseName(detected));
+            return false;
+        }
+    }
+
+    // A scaled marker has blended pixels along its edges, and noise on top
+    auto frame = MakeUiImage(Width, Height, 3);
+    DrawMarker(frame, Stride, bounds, MarkerPhase::Dark);
+    FillRect(frame, Stride, 39, 20, 41, 50, grey(128));
+    FillRect(frame, Stride, 20, 34, 60, 36, grey(128));
+    std::mt19937 random(4);
+    for (auto y = bounds.top; y < bounds.bottom; y++)
+    {
+        for (auto x = bounds.left; x < bounds.right; x++)
+        {
+            auto pixel = frame.data() + static_cast<size_t>(y) * Stride + x * 4;
+            for (size_t channel = 0; channel < 3; channel++)
+            {
+                pixel[channel] = static_cast<uint8_t>(std::clamp(pixel[channel] + static_cast<int>(random() % 61) - 30, 0, 255));
+            }
+        }
+    }
+    if (detector.Detect(frame.data(), Stride, Width, Height) != MarkerPhase::Dark)
+    {
+        printf("FAILED: a blurry, noisy marker wasn't found\n");
+        return false;
+    }
+    return true;
+}
+
+// A window dragged over part of the marker, or a frame that doesn't reach
+// it, isn't a marker
+bool TestCoveredOrMissing()
+{
+    RECT const bounds = { 100, 40, 140, 80 };
+    MarkerDetector detector(bounds);
+    auto frame = MakeUiImage(Width, Height, 5);
+    DrawMarker(frame, Stride, bounds, MarkerPhase::Light);
+    auto covered = frame;
+    FillRect(covered, Stride, 125, 30, 180, 90, Bgra(240, 240, 240));
+    if (detector.Detect(covered.data(), Stride, Width, Height) != MarkerPhase::None)
+    {
+        printf("FAILED: a covered marker was found\n");
+        return false;
+    }
+    auto swapped = frame;
+    FillRect(swapped, Stride, 100, 40, 140, 60, Bgra(0, 0, 0));
+    if (detector.Detect(swapped.data(), Stride, Width, Height) != MarkerPhase::None)
+    {
+        printf("FAILED: a marker with two dark squares side by side was found\n");
+        return false;
+    }
+    if (detector.Detect(frame.data(), Stride, 139, Height) != MarkerPhase::None || detector.Detect(frame.data(), Stride, Width, 79) != MarkerPhase::None)
+    {
+        printf("FAILED: a marker was found past the edge of the frame\n");
+        return false;
+    }
+    if (detector.Detect(frame.data(), Stride, 140, 80) != MarkerPhase::Light)
+    {
+        printf("FAILED: a marker right at the edge of the frame wasn't found\n");
+        return false;
+    }
+    return true;
+}
+
+// Everything outside of the bounds can be anything, including the padding
+// at the end of the rows
+bool TestOnlyLooksInsideBounds()
+{
+    RECT const bounds = { 61, 11, 95, 37 };
+    MarkerDetector detector(bounds);
+    uint32_t const stride = (Width + 24) * 4;
+    std::vector<uint8_t> frame(static_cast<size_t>(stride) * Height, 0x80);
+    DrawMarker(frame, stride, bounds, MarkerPhase::Dark);
+    if (detector.Detect(frame.data(), stride, Width, Height) != MarkerPhase::Dark)
+    {
+        printf("FAILED: a marker on grey wasn't found\n");
+        return false;
+    }
+    for (auto&& outside : { RECT{ 0, 0, 224, 11 }, RECT{ 0, 37, 224, 120 }, RECT{ 0, 11, 61, 37 }, RECT{ 95, 11, 224, 37 } })
+    {
+        FillRect(frame, stride, outside.left, outside.top, outside.right, outside.bottom, Bgra(255, 255, 255));
+    }
+    if (detector.Detect(frame.data(), stride, Width, Height) != MarkerPhase::Dark)
+    {
+        printf("FAILED: pixels outside of the bounds changed what was found\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestInvalidBounds()
+{
+    for (auto&& bounds : { RECT{ 0, 0, 1, 2 }, RECT{ 0, 0, 2, 1 }, RECT{ -1, 0, 4, 4 }, RECT{ 0, -1, 4, 4 }, RECT{ 5, 5, 3, 8 } })
+    {
+        try
+        {
+            MarkerDetector detector(bounds);
+            printf("FAILED: the bounds %ld,%ld,%ld,%ld didn't throw\n", bounds.left, bounds.top, bounds.right, bounds.bottom);
+            return false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG)
+            {
+                printf("FAILED: invalid bounds threw the wrong error\n");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestFindsBothPhases() && passed;
+    passed = TestThresholds() && passed;
+    passed = TestCoveredOrMissing() && passed;
+    passed = TestOnlyLooksInsideBounds() && passed;
+    passed = TestInvalidBounds() && passed;
+
+    if (passed)
+    {
+        printf("All MarkerDetector tests passed\n");
+        return 0;
+    }
+    printf("Some MarkerDetector tests failed\n");
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "pch.h"
+#include "MonitorDiff.h"
+#include <random>
+
+uint32_t const FuzzIterations = 5000;
+uint32_t const MaxMonitors = 6;
+
+MonitorSnapshot Monitor(std::wstring const& name, uintptr_t handle, int32_t left, int32_t top, int32_t width, int32_t height, uint32_t dpi = 96)
+{
+    return { name, handle, { left, top, left + width, top + height }, dpi };
+}
+
+std::wstring Describe(MonitorChange const& change)
+{
+    std::wstring result;
+    switch (change.Kind)
+    {
+    case MonitorChangeKind::Added: result = L"added "; break;
+    case MonitorChangeKind::Removed: result = L"removed "; break;
+    case MonitorChangeKind::Modified: result = L"modified "; break;
+    }
+    result += change.DisplayName;
+    if (change.HandleChanged) { result += L" handle"; }
+    if (change.PositionChanged) { result += L" position"; }
+    if (change.ResolutionChanged) { result += L" resolution"; }
+    if (change.DpiChanged) { result += L" dpi"; }
+    return result;
+}
+
+bool ExpectChanges(std::vector<MonitorSnapshot> const& oldMonitors, std::vector<MonitorSnapshot> const& newMonitors, std::vector<std::wstring> const& expected, char const* name)
+{
+    std::vector<std::wstring> changes;
+    for (auto&& change : DiffMonitors(oldMonitors, newMonitors))
+    {
+        changes.push_back(Describe(change));
+    }
+    if (changes != expected)
+    {
+        printf("FAILED: %s gave:\n", name);
+        for (auto&& change : changes)
+        {
+            printf("  %ls\n", change.c_str());
+        }
+        return false;
+    }
+    return true;
+}
+
+bool TestTopologies()
+{
+    auto laptop = Monitor(L"\\\\.\\DISPLAY1", 1, 0, 0, 1920, 1080, 144);
+    auto left = Monitor(L"\\\\.\\DISPLAY2", 2, -2560, 0, 2560, 1440);
+    auto right = Monitor(L"\\\\.\\DISPLAY3", 3, 1920, 0, 3840, 2160, 192);
+    std::vector<MonitorSnapshot> const docked = { laptop, left, right };
+    auto passed = true;
+
+    passed = ExpectChanges(docked, docked, {}, "no change") && passed;
+    // Enumeration order isn't stable, only names matter
+    passed = ExpectChanges(docked, { right, laptop, left }, {}, "a reorder") && passed;
+
+    passed = ExpectChanges({ laptop }, docked, { L"added \\\\.\\DISPLAY2", L"added \\\\.\\DISPLAY3" }, "docking") && passed;
+    passed = ExpectChanges({ laptop }, { right, left, laptop }, { L"added \\\\.\\DISPLAY3", L"added \\\\.\\DISPLAY2" }, "docking in another order") && passed;
+
+    // Undocking usually hands out new HMONITORs to whatever is left
+    auto undockedLaptop = laptop;
+    undockedLaptop.Handle = 7;
+    passed = ExpectChanges(docked, { undockedLaptop }, { L"removed \\\\.\\DISPLAY2", L"removed \\\\.\\DISPLAY3", L"modified \\\\.\\DISPLAY1 handle" }, "undocking") && passed;
+
+    // Changing the resolution of the laptop pushes the monitor on its right
+    auto smallerLaptop = Monitor(L"\\\\.\\DISPLAY1", 1, 0, 0, 1280, 720, 144);
+    auto pushedRight = right;
+    pushedRight.Bounds = { 1280, 0, 1280 + 3840, 2160 };
+    passed = ExpectChanges(docked, { smallerLaptop, left, pushedRight }, { L"modified \\\\.\\DISPLAY1 resolution", L"modified \\\\.\\DISPLAY3 position" }, "a resolution change") && passed;
+
+    // Rotating swaps width and height
+    auto rotated = Monitor(L"\\\\.\\DISPLAY2", 2, -1440, 0, 1440, 2560);
+    passed = ExpectChanges(docked, { laptop, rotated, right }, { L"modified \\\\.\\DISPLAY2 position resolution" }, "a rotation") && passed;
+
+    auto scaled = right;
+    scaled.Dpi = 144;
+    passed = ExpectChanges(docked, { laptop, left, scaled }, { L"modified \\\\.\\DISPLAY3 dpi" }, "a scale change") && passed;
+
+    // Removals in the old order, then modifications, then additions in the
+    // new order
+    auto projector = Monitor(L"\\\\.\\DISPLAY4", 4, 5760, 0, 1024, 768);
+    passed = ExpectChanges(docked, { projector, scaled, undockedLaptop }, { L"removed \\\\.\\DISPLAY2", L"modified \\\\.\\DISPLAY1 handle", L"modified \\\\.\\DISPLAY3 dpi", L"added \\\\.\\DISPLAY4" }, "everything at once") && passed;
+    passed = ExpectChanges({}, {}, {}, "no monitors") && passed;
+    return passed;
+}
+
+bool Same(MonitorSnapshot const& left, MonitorSnapshot const& right)
+{
+    return left.DisplayName == right.DisplayName && left.Handle == right.Handle && left.Dpi == right.Dpi &&
+        left.Bounds.Left == right.Bounds.Left && left.Bounds.Top == right.Bounds.Top &&
+        left.Bounds.Right == right.Bounds.Right && left.Bounds.Bottom == right.Bounds.Bottom;
+}
+
+// Applying the changes to the old list the way MonitorList does has to
+// give the new list. The order can differ, MonitorList appends additions.
+bool FuzzTopologies()
+{
+    std::mt19937 random(13);
+    auto randomTopology = [&]()
+    {
+        std::vector<MonitorSnapshot> monitors;
+        for (uint32_t i = 1; i <= MaxMonitors; i++)
+        {
+            if (random() % 2 == 0)
+            {
+                monitors.push_back(Monitor(L"DISPLAY" + std::to_wstring(i), random() % 3, static_cast<int32_t>(random() % 2) * 1920, 0, 1920 + static_cast<int32_t>(random() % 2) * 640, 1080, 96 + (random() % 2) * 48));
+            }
+        }
+        std::shuffle(monitors.begin(), monitors.end(), random);
+        return monitors;
+    };
+
+    for (uint32_t iteration = 0; iteration < FuzzIterations; iteration++)
+    {
+        auto oldMonitors = randomTopology();
+        auto newMonitors = randomTopology();
+        auto find = [](std::vector<MonitorSnapshot>& list, std::wstring const& name)
+        {
+            return std::find_if(list.begin(), list.end(), [&](auto&& monitor) { return monitor.DisplayName == name; });
+        };
+
+        auto monitors = oldMonitors;
+        for (auto&& change : DiffMonitors(oldMonitors, newMonitors))
+        {
+            switch (change.Kind)
+            {
+            case MonitorChangeKind::Removed:
+                monitors.erase(find(monitors, change.DisplayName));
+                break;
+            case MonitorChangeKind::Modified:
+                *find(monitors, change.DisplayName) = *find(newMonitors, change.DisplayName);
+                break;
+            case MonitorChangeKind::Added:
+                if (find(monitors, change.DisplayName) != monitors.end())
+                {
+                    printf("FAILED: %ls was added twice\n", change.DisplayName.c_str());
+                    return false;
+                }
+                monitors.push_back(*find(newMonitors, change.DisplayName));
+                break;
+            }
+        }
+
+        auto matches = monitors.size() == newMonitors.size() && std::all_of(monitors.begin(), monitors.end(), [&](auto&& monitor)
+        {
+            auto search = find(newMonitors, monitor.DisplayName);
+            return search != newMonitors.end() && Same(monitor, *search);
+        });
+        if (!matches)
+        {
+            printf("FAILED: applying the changes didn't give the new monitors on iteration %u\n", iteration);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    auto passed = true;
+    passed = TestTopologies() && passed;
+    passed = FuzzTopologies() && passed;
+    printf(passed ? "All monitor diff tests passed\n" : "Some monitor diff tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "PaletteIndexer.h"
+#include "DeflateEncoder.h"
+#include "TestImages.h"
+
+// What a snapshot costs as an 8bpp indexed PNG compared to the 32bpp one it
+// would otherwise be. PNG is deflated rows with a filter byte in front, so
+// the deflate size of those rows stands in for the file size. Photos that
+// don't fit only pay for noticing.
+uint32_t const Width = 2560;
+uint32_t const Height = 1440;
+int const Iterations = 5;
+
+template <typename Function>
+double Time(Function&& function)
+{
+    auto best = std::numeric_limits<double>::max();
+    for (int i = 0; i < Iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+std::vector<uint8_t> FilteredRows(uint8_t const* data, uint32_t rowBytes, uint32_t height)
+{
+    std::vector<uint8_t> rows;
+    rows.reserve((static_cast<size_t>(rowBytes) + 1) * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        rows.push_back(0);
+        rows.insert(rows.end(), data + static_cast<size_t>(y) * rowBytes, data + static_cast<size_t>(y + 1) * rowBytes);
+    }
+    return rows;
+}
+
+int main()
+{
+    auto image = MakeUiImage(Width, Height, 5);
+    auto colors = reinterpret_cast<uint32_t const*>(image.data());
+    auto pixelCount = static_cast<size_t>(Width) * Height;
+
+    // A UI screenshot: the photo in it makes for too many colors, so flatten
+    // it the way a screenshot of a plain app would look
+    auto flat = image;
+    FillRect(flat, Width * 4, Width * 2 / 3, Height * 2 / 3, Width, Height, Bgra(250, 250, 250));
+    auto flatColors = reinterpret_cast<uint32_t const*>(flat.data());
+
+    std::vector<uint8_t> indices(pixelCount);
+    std::vector<uint32_t> palette;
+    auto indexTime = Time([&]()
+    {
+        PaletteIndexer indexer;
+        indexer.TryAddRange(flatColors, pixelCount);
+        indexer.TryIndexRange(flatColors, pixelCount, indices.data());
+        palette = indexer.Colors();
+    });
+    std::vector<uint8_t> indexed;
+    auto indexedDeflateTime = Time([&]() { indexed = DeflateEncoder::Compress(FilteredRows(indices.data(), Width, Height)); });
+    std::vector<uint8_t> full;
+    auto fullDeflateTime = Time([&]() { full = DeflateEncoder::Compress(FilteredRows(flat.data(), Width * 4, Height)); });
+
+    printf("%ux%u UI screenshot, %zu colors\n", Width, Height, palette.size());
+    printf("  32bpp:  %8zu bytes, %6.1f ms to deflate\n", full.size(), fullDeflateTime);
+    printf("  8bpp:   %8zu bytes, %6.1f ms to index and %.1f ms to deflate (%.1fx smaller, %.1fx quicker)\n",
+        indexed.size() + palette.size() * 3,
+        indexTime,
+        indexedDeflateTime,
+        static_cast<double>(full.size()) / (indexed.size() + palette.size() * 3),
+        fullDeflateTime / (indexTime + indexedDeflateTime));
+
+    // The same screen with the photo in it doesn't fit, and neither does noise
+    for (auto&& [name, pixels] : { std::pair{ "UI with a photo", colors }, std::pair{ "noise", static_cast<uint32_t const*>(nullptr) } })
+    {
+        std::vector<uint8_t> noise;
+        auto source = pixels;
+        if (source == nullptr)
+        {
+            noise = MakeNoiseImage(Width, Height, 7);
+            source = reinterpret_cast<uint32_t const*>(noise.data());
+        }
+        bool fits = true;
+        auto rejectTime = Time([&]()
+        {
+            PaletteIndexer indexer;
+            fits = indexer.TryAddRange(source, pixelCount);
+        });
+        auto deflateTime = Time([&]() { DeflateEncoder::Compress(FilteredRows(reinterpret_cast<uint8_t const*>(source), Width * 4, Height)); });
+        printf("%s: %s after %.3f ms, %.2f%% of the %.1f ms the 32bpp deflate takes\n",
+            name,
+            fits ? "fits" : "gave up",
+            rejectTime,
+            100.0 * rejectTime / deflateTime,
+            deflateTime);
+    }
+    return 0;
+}
\ No newline at end of file
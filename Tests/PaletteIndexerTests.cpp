@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "PaletteIndexer.h"
+#include "TestImages.h"
+
+// The indices have to point back at the exact colors they came from
+bool CheckIndices(char const* name, PaletteIndexer const& palette, std::vector<uint32_t> const& colors, std::vector<uint8_t> const& indices)
+{
+    for (size_t i = 0; i < colors.size(); i++)
+    {
+        if (indices[i] >= palette.Colors().size() || palette.Colors()[indices[i]] != colors[i])
+        {
+            printf("FAILED: %s, color %zu came back as %08X\n", name, i, indices[i] < palette.Colors().size() ? palette.Colors()[indices[i]] : 0);
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<uint32_t> ToColors(std::vector<uint8_t> const& pixels)
+{
+    std::vector<uint32_t> colors(pixels.size() / 4);
+    memcpy(colors.data(), pixels.data(), colors.size() * 4);
+    return colors;
+}
+
+// A UI without the photo in it, the kind of screenshot a palette is for
+bool TestUiImageFits()
+{
+    auto pixels = MakeUiImage(640, 480, 1);
+    FillRect(pixels, 640 * 4, 640 * 2 / 3, 480 * 2 / 3, 640, 480, Bgra(250, 250, 250));
+    auto colors = ToColors(pixels);
+    PaletteIndexer counter;
+    if (!counter.TryAddRange(colors.data(), colors.size()))
+    {
+        printf("FAILED: a UI image didn't fit in a palette\n");
+        return false;
+    }
+    PaletteIndexer palette;
+    std::vector<uint8_t> indices(colors.size());
+    if (!palette.TryIndexRange(colors.data(), colors.size(), indices.data()) || palette.Colors() != counter.Colors())
+    {
+        printf("FAILED: indexing a UI image didn't give the palette counting did\n");
+        return false;
+    }
+    return CheckIndices("UI image", palette, colors, indices);
+}
+
+// Exactly 256 colors fit and the 257th is turned away, wherever it is
+bool TestPaletteLimit()
+{
+    std::vector<uint32_t> colors;
+    for (uint32_t i = 0; i < PaletteIndexer::MaxColors; i++)
+    {
+        colors.push_back(Bgra(static_cast<uint8_t>(i), static_cast<uint8_t>(i * 7), 0));
+        colors.push_back(colors.back());
+    }
+    PaletteIndexer palette;
+    std::vector<uint8_t> indices(colors.size());
+    if (!palette.TryIndexRange(colors.data(), colors.size(), indices.data()) || palette.Colors().size() != PaletteIndexer::MaxColors)
+    {
+        printf("FAILED: 256 colors didn't fit in a palette\n");
+        return false;
+    }
+    if (!CheckIndices("256 colors", palette, colors, indices))
+    {
+        return false;
+    }
+
+    for (size_t position : { size_t(0), size_t(1), size_t(255), colors.size() })
+    {
+        auto extra = colors;
+        extra.insert(extra.begin() + position, Bgra(1, 2, 3, 4));
+        PaletteIndexer counter;
+        if (counter.TryAddRange(extra.data(), extra.size()))
+        {
+            printf("FAILED: 257 colors fit in a palette\n");
+            return false;
+        }
+        // Whatever was seen before giving up is still there, nothing more
+        if (counter.Colors().size() != PaletteIndexer::MaxColors)
+        {
+            printf("FAILED: giving up left %zu colors in the palette\n", counter.Colors().size());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Noise gives up at the 257th color, long before the end of the image,
+// and gives up just as early the second time around
+bool TestEarlyExit()
+{
+    auto colors = ToColors(MakeNoiseImage(3840, 2160, 1));
+    PaletteIndexer palette;
+    auto start = std::chrono::steady_clock::now();
+    auto fits = palette.TryAddRange(colors.data(), colors.size());
+    auto rejected = std::chrono::steady_clock::now() - start;
+    if (fits)
+    {
+        printf("FAILED: noise fit in a palette\n");
+        return false;
+    }
+    // The first 257 pixels hold 257 colors, so that's all that was read
+    std::vector<uint32_t> seen(palette.Colors());
+    std::vector<uint32_t> first(colors.begin(), colors.begin() + 256);
+    std::sort(seen.begin(), seen.end());
+    std::sort(first.begin(), first.end());
+    if (seen != first)
+    {
+        printf("FAILED: the palette doesn't hold the first 256 colors it saw\n");
+        return false;
+    }
+
+    // A pass over every pixel, which giving up has to be far quicker than
+    uint32_t sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto&& color : colors)
+    {
+        sum += color;
+    }
+    auto fullPass = std::chrono::steady_clock::now() - start;
+    if (rejected * 10 > fullPass)
+    {
+        printf("FAILED: giving up on 4K noise took %lld us, a full pass takes %lld us (%u)\n",
+            static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(rejected).count()),
+            static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(fullPass).count()),
+            sum);
+        return false;
+    }
+    return true;
+}
+
+// Runs of every length, starting anywhere relative to the four colors the
+// run check compares at once, and ending at the end of the range
+bool TestRuns()
+{
+    std::mt19937 random(3);
+    uint32_t const palette[] = { Bgra(255, 255, 255), Bgra(0, 0, 0), Bgra(255, 0, 0), Bgra(0, 0, 255) };
+    for (size_t offset = 0; offset < 4; offset++)
+    {
+        for (size_t runLength = 1; runLength < 24; runLength++)
+        {
+            std::vector<uint32_t> colors;
+            for (size_t i = 0; i < offset; i++)
+            {
+                colors.push_back(palette[random() % 4]);
+            }
+            while (colors.size() < 200)
+            {
+                auto color = palette[random() % 4];
+                auto length = random() % 2 == 0 ? runLength : 1 + random() % runLength;
+                colors.insert(colors.end(), length, color);
+            }
+
+            PaletteIndexer indexer;
+            std::vector<uint8_t> indices(colors.size(), 0xEE);
+            if (!indexer.TryIndexRange(colors.data() + offset, colors.size() - offset, indices.data() + offset))
+            {
+                printf("FAILED: four colors didn't fit in a palette\n");
+                return false;
+            }
+            std::vector<uint32_t> tail(colors.begin() + offset, colors.end());
+            std::vector<uint8_t> tailIndices(indices.begin() + offset, indices.end());
+            if (!CheckIndices("runs", indexer, tail, tailIndices))
+            {
+                return false;
+            }
+            if (std::any_of(indices.begin(), indices.begin() + offset, [](uint8_t index) { return index != 0xEE; }))
+            {
+                printf("FAILED: indexing wrote before the start of the range\n");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TestReset()
+{
+    PaletteIndexer palette;
+    std::vector<uint32_t> colors(300);
+    for (uint32_t i = 0; i < colors.size(); i++)
+    {
+        colors[i] = i;
+    }
+    palette.TryAddRange(colors.data(), colors.size());
+    palette.Reset();
+    uint8_t index = 0;
+    if (!palette.Colors().empty() || !palette.TryAdd(299, index) || index != 0)
+    {
+        printf("FAILED: a reset palette still held colors\n");
+        return false;
+    }
+    // The last color seen doesn't outlive a reset either
+    palette.Reset();
+    if (!palette.TryAdd(299, index) || palette.Colors().size() != 1)
+    {
+        printf("FAILED: a reset palette remembered the last color\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestUiImageFits() && passed;
+    passed = TestPaletteLimit() && passed;
+    passed = TestEarlyExit() && passed;
+    passed = TestRuns() && passed;
+    passed = TestReset() && passed;
+
+    if (passed)
+    {
+        printf("All PaletteIndexer tests passed\n");
+        return 0;
+    }
+    printf("Some PaletteIndexer tests failed\n");
+    return 1;
+}
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "pch.h"
+#include "PipelineWorker.h"
+
+// Holds work on the worker's thread until the test lets it go
+class Gate
+{
+public:
+    std::function<void()> Work()
+    {
+        return [this]()
+        {
+            auto lock = std::unique_lock(m_lock);
+            m_entered = true;
+            m_changed.notify_all();
+            m_changed.wait(lock, [this]() { return m_open; });
+        };
+    }
+
+    void WaitUntilEntered()
+    {
+        auto lock = std::unique_lock(m_lock);
+        m_changed.wait(lock, [this]() { return m_entered; });
+    }
+
+    void Open()
+    {
+        {
+            auto lock = std::scoped_lock(m_lock);
+            m_open = true;
+        }
+        m_changed.notify_all();
+    }
+
+private:
+    std::mutex m_lock;
+    std::condition_variable m_changed;
+    bool m_entered = false;
+    bool m_open = false;
+};
+
+bool TestZeroCapacityThrows()
+{
+    try
+    {
+        PipelineWorker worker(0);
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        if (error.code() != E_INVALIDARG)
+        {
+            printf("FAILED: zero capacity threw the wrong error\n");
+            return false;
+        }
+        return true;
+    }
+    printf("FAILED: a worker with zero capacity was created\n");
+    return false;
+}
+
+// Work from several threads runs one piece at a time, and each thread's
+// work runs in the order it was submitted
+bool TestOrdering()
+{
+    PipelineWorker worker(1000);
+    std::vector<std::pair<int, int>> ran;
+    std::atomic<int> running = 0;
+    bool overlapped = false;
+    std::vector<std::thread> submitters;
+    for (int thread = 0; thread < 4; thread++)
+    {
+        submitters.emplace_back([&, thread]()
+        {
+            for (int i = 0; i < 200; i++)
+            {
+                while (!worker.TrySubmit([&, thread, i]()
+                {
+                    if (running++ != 0)
+                    {
+                        overlapped = true;
+                    }
+                    ran.emplace_back(thread, i);
+                    running--;
+                }))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto&& submitter : submitters)
+    {
+        submitter.join();
+    }
+    worker.Drain();
+
+    if (overlapped)
+    {
+        printf("FAILED: two pieces of work ran at once\n");
+        return false;
+    }
+    if (ran.size() != 800)
+    {
+        printf("FAILED: %zu of 800 pieces of work ran\n", ran.size());
+        return false;
+    }
+    std::vector<int> next(4, 0);
+    for (auto&& [thread, i] : ran)
+    {
+        if (next[thread] != i)
+        {
+            printf("FAILED: thread %d's work %d ran when %d was next\n", thread, i, next[thread]);
+            return false;
+        }
+        next[thread]++;
+    }
+    return true;
+}
+
+// While one piece runs, capacity more can wait and the next is turned away
+bool TestRejectedWhenFull()
+{
+    uint32_t const capacity = 3;
+    PipelineWorker worker(capacity);
+    Gate gate;
+    std::vector<int> ran;
+    if (!worker.TrySubmit(gate.Work()))
+    {
+        printf("FAILED: an idle worker turned work away\n");
+        return false;
+    }
+    gate.WaitUntilEntered();
+    std::vector<bool> taken;
+    for (int i = 0; i <= static_cast<int>(capacity); i++)
+    {
+        auto canSubmit = worker.CanSubmit();
+        taken.push_back(worker.TrySubmit([&ran, i]() { ran.push_back(i); }) && canSubmit);
+    }
+    // Let the worker go before checking, so a failure can't leave it stuck
+    gate.Open();
+    worker.Drain();
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        if (!taken[i])
+        {
+            printf("FAILED: work %u was turned away with room in the queue\n", i);
+            return false;
+        }
+    }
+    if (taken[capacity])
+    {
+        printf("FAILED: a full worker took more work\n");
+        return false;
+    }
+
+    if (ran != std::vector<int>{ 0, 1, 2 })
+    {
+        printf("FAILED: the queued work didn't all run in order\n");
+        return false;
+    }
+    if (!worker.CanSubmit() || !worker.TrySubmit([&ran]() { ran.push_back(3); }))
+    {
+        printf("FAILED: a drained worker turned work away\n");
+        return false;
+    }
+    worker.Drain();
+    if (ran.size() != 4)
+    {
+        printf("FAILED: work submitted after draining didn't run\n");
+        return false;
+    }
+    return true;
+}
+
+// Closing lets the running piece finish, drops and lets go of what's
+// queued, and turns away anything after it
+bool TestCloseWhileRunning()
+{
+    PipelineWorker worker(4);
+    Gate gate;
+    std::atomic<bool> finished = false;
+    worker.TrySubmit([&]()
+    {
+        gate.Work()();
+        finished = true;
+    });
+    gate.WaitUntilEntered();
+
+    auto frame = std::make_shared<int>(0);
+    std::atomic<int> queuedRan = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        worker.TrySubmit([&queuedRan, frame]() { queuedRan++; });
+    }
+    std::weak_ptr<int> held = frame;
+    frame = nullptr;
+    auto heldWhileQueued = !held.expired();
+
+    std::atomic<bool> closed = false;
+    std::thread closer([&]()
+    {
+        worker.Close();
+        closed = true;
+    });
+    // Close waits for the running piece
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    if (closed)
+    {
+        printf("FAILED: close didn't wait for the running work\n");
+        gate.Open();
+        closer.join();
+        return false;
+    }
+    gate.Open();
+    closer.join();
+
+    if (!heldWhileQueued)
+    {
+        printf("FAILED: queued work let go of its frame before running\n");
+        return false;
+    }
+    if (!finished)
+    {
+        printf("FAILED: the running work didn't finish\n");
+        return false;
+    }
+    if (queuedRan != 0)
+    {
+        printf("FAILED: %d pieces of queued work ran after closing\n", queuedRan.load());
+        return false;
+    }
+    if (!held.expired())
+    {
+        printf("FAILED: dropped work held on to its frame\n");
+        return false;
+    }
+    if (worker.CanSubmit() || worker.TrySubmit([]() {}))
+    {
+        printf("FAILED: a closed worker took work\n");
+        return false;
+    }
+    // Neither of these may hang once closed
+    worker.Drain();
+    worker.Close();
+    return true;
+}
+
+// Work that throws is dropped, and the worker carries on
+bool TestThrowingWork()
+{
+    PipelineWorker worker(4);
+    int ran = 0;
+    worker.TrySubmit([]() { throw winrt::hresult_error(E_INVALIDARG, L"Bad frame."); });
+    worker.TrySubmit([]() { throw std::runtime_error("bad frame"); });
+    worker.TrySubmit([&ran]() { ran++; });
+    worker.Drain();
+    if (ran != 1)
+    {
+        printf("FAILED: work after throwing work didn't run\n");
+        return false;
+    }
+    return true;
+}
+
+// What work holds on to is let go of before Drain returns
+bool TestDrainReleasesWork()
+{
+    PipelineWorker worker(1);
+    auto frame = std::make_shared<int>(0);
+    std::weak_ptr<int> held = frame;
+    worker.TrySubmit([frame]() {});
+    frame = nullptr;
+    worker.Drain();
+    if (!held.expired())
+    {
+        printf("FAILED: finished work still held its frame after draining\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestZeroCapacityThrows() && passed;
+    passed = TestOrdering() && passed;
+    passed = TestRejectedWhenFull() && passed;
+    passed = TestCloseWhileRunning() && passed;
+    passed = TestThrowingWork() && passed;
+    passed = TestDrainReleasesWork() && passed;
+
+    if (passed)
+    {
+        printf("All PipelineWorker tests passed\n");
+        return 0;
+    }
+    printf("Some PipelineWorker tests failed\n");
+    return 1;
+}
\ No newline at end of file
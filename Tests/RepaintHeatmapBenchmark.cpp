@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "RepaintHeatmap.h"
+#include <random>
+
+// Time to add a frame's dirty rects to the heatmap, compared against the
+// straightforward accumulator that decays every cell on every frame, and
+// time to find the hotspots once the heatmap is busy.
+int const Frames = 600;
+Ticks const FrameInterval = Ticks(166'667);
+
+// Decays the whole grid and then adds to the touched cells
+class NaiveHeatmap
+{
+public:
+    NaiveHeatmap(uint32_t width, uint32_t height, uint32_t cellSize, Ticks halfLife) :
+        m_width(width), m_height(height), m_cellSize(cellSize),
+        m_columns((width + cellSize - 1) / cellSize), m_rows((height + cellSize - 1) / cellSize),
+        m_decayRate(std::log(2.0) / static_cast<double>(halfLife.count())),
+        m_activity(static_cast<size_t>(m_columns) * m_rows, 0.0f), m_touched(m_activity.size(), 0) {}
+
+    void AddFrame(Ticks timestamp, std::vector<RECT> const& rects)
+    {
+        auto decay = static_cast<float>(std::exp(-m_decayRate * static_cast<double>((timestamp - m_lastTimestamp).count())));
+        m_lastTimestamp = timestamp;
+        for (auto&& activity : m_activity)
+        {
+            activity *= decay;
+        }
+        std::fill(m_touched.begin(), m_touched.end(), 0);
+        for (auto&& rect : rects)
+        {
+            auto left = std::clamp<LONG>(rect.left, 0, m_width) / m_cellSize;
+            auto top = std::clamp<LONG>(rect.top, 0, m_height) / m_cellSize;
+            auto right = (std::clamp<LONG>(rect.right, 0, m_width) + m_cellSize - 1) / m_cellSize;
+            auto bottom = (std::clamp<LONG>(rect.bottom, 0, m_height) + m_cellSize - 1) / m_cellSize;
+            for (auto row = top; row < bottom; row++)
+            {
+                for (auto column = left; column < right; column++)
+                {
+                    auto index = static_cast<size_t>(row) * m_columns + column;
+                    if (!m_touched[index])
+                    {
+                        m_touched[index] = 1;
+                        m_activity[index] += 1.0f;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    LONG m_width;
+    LONG m_height;
+    LONG m_cellSize;
+    LONG m_columns;
+    LONG m_rows;
+    double m_decayRate;
+    std::vector<float> m_activity;
+    std::vector<uint8_t> m_touched;
+    Ticks m_lastTimestamp = {};
+};
+
+// Frames of dirty rects that look like some common workloads
+std::vector<std::vector<RECT>> MakeFrames(char const* workload, uint32_t width, uint32_t height)
+{
+    std::mt19937 random(7);
+    auto w = static_cast<LONG>(width);
+    auto h = static_cast<LONG>(height);
+    std::vector<std::vector<RECT>> frames(Frames);
+    for (auto i = 0; i < Frames; i++)
+    {
+        auto&& rects = frames[i];
+        if (strcmp(workload, "caret") == 0)
+        {
+            rects.push_back({ 200 + i % 80 * 8, 300, 210 + i % 80 * 8, 320 });
+        }
+        else if (strcmp(workload, "video") == 0)
+        {
+            rects.push_back({ w / 4, h / 4, w * 3 / 4, h * 3 / 4 });
+            rects.push_back({ 0, h - 40, w, h });
+        }
+        else if (strcmp(workload, "scattered") == 0)
+        {
+            for (auto j = 0; j < 200; j++)
+            {
+                auto x = static_cast<LONG>(random() % width);
+                auto y = static_cast<LONG>(random() % height);
+                rects.push_back({ x, y, x + 8 + static_cast<LONG>(random() % 120), y + 8 + static_cast<LONG>(random() % 40) });
+            }
+        }
+        else
+        {
+            rects.push_back({ 0, 0, w, h });
+        }
+    }
+    return frames;
+}
+
+template <typename Work>
+double BestMicroseconds(int iterations, Work&& work)
+{
+    auto best = std::numeric_limits<double>::max();
+    for (int i = 0; i < iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int main()
+{
+    struct Size
+    {
+        char const* Name;
+        uint32_t Width;
+        uint32_t Height;
+    };
+    Size const sizes[] =
+    {
+        { "1080p", 1920, 1080 },
+        { "4K", 3840, 2160 },
+    };
+    char const* const workloads[] = { "caret", "video", "scattered", "full" };
+
+    printf("%-6s %-10s %14s %14s %14s\n", "", "", "naive us", "heatmap us", "hotspots us");
+    for (auto&& size : sizes)
+    {
+        for (auto workload : workloads)
+        {
+            auto frames = MakeFrames(workload, size.Width, size.Height);
+            auto naive = BestMicroseconds(5, [&]()
+            {
+                NaiveHeatmap heatmap(size.Width, size.Height, 16, std::chrono::seconds(2));
+                auto timestamp = Ticks(0);
+                for (auto&& rects : frames)
+                {
+                    heatmap.AddFrame(timestamp, rects);
+                    timestamp += FrameInterval;
+                }
+            }) / Frames;
+            RepaintHeatmap heatmap;
+            auto accumulate = BestMicroseconds(5, [&]()
+            {
+                heatmap.Reset();
+                auto timestamp = Ticks(0);
+                for (auto&& rects : frames)
+                {
+                    heatmap.AddFrame(timestamp, size.Width, size.Height, rects);
+                    timestamp += FrameInterval;
+                }
+            }) / Frames;
+            size_t found = 0;
+            auto hotspots = BestMicroseconds(20, [&]()
+            {
+                found = heatmap.Hotspots().size();
+            });
+            printf("%-6s %-10s %14.2f %14.2f %14.1f (%zu found)\n", size.Name, workload, naive, accumulate, hotspots, found);
+        }
+    }
+    return 0;
+}
\ No newline at end of file
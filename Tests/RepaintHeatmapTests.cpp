@@ -0,0 +1,444 @@
+#include "pch.h"
+#include "RepaintHeatmap.h"
+
+using namespace std::chrono_literals;
+
+Ticks const FrameInterval = Ticks(166'667);
+
+float CellRate(RepaintHeatmap const& heatmap, uint32_t column, uint32_t row)
+{
+    std::vector<float> rates;
+    heatmap.Rates(rates);
+    return rates.at(static_cast<size_t>(row) * heatmap.Columns() + column);
+}
+
+bool Near(double value, double expected, double tolerance)
+{
+    return std::abs(value - expected) <= tolerance * std::abs(expected);
+}
+
+// One repaint of a cell is worth the decay rate, and counts half as much
+// every half-life after that
+bool TestDecayHalvesEveryHalfLife()
+{
+    RepaintHeatmap heatmap;
+    heatmap.AddFrame(Ticks(0), 64, 64, std::vector<RECT>{ { 0, 0, 16, 16 } });
+    auto initial = CellRate(heatmap, 0, 0);
+    auto expected = std::log(2.0) / 2.0;
+    if (!Near(initial, expected, 1e-4))
+    {
+        printf("FAILED: one repaint is worth %f a second, expected %f\n", initial, expected);
+        return false;
+    }
+    for (auto halfLives = 1; halfLives <= 4; halfLives++)
+    {
+        heatmap.AddFrame(std::chrono::seconds(2 * halfLives), 64, 64, std::vector<RECT>{});
+        auto rate = CellRate(heatmap, 0, 0);
+        if (!Near(rate, initial / (1 << halfLives), 1e-4))
+        {
+            printf("FAILED: after %d half-lives the rate is %f, expected %f\n", halfLives, rate, initial / (1 << halfLives));
+            return false;
+        }
+    }
+    if (CellRate(heatmap, 1, 0) != 0.0f || CellRate(heatmap, 0, 1) != 0.0f)
+    {
+        printf("FAILED: cells that were never repainted have a rate\n");
+        return false;
+    }
+    return true;
+}
+
+// A cell repainted steadily settles on its repaint rate, give or take the
+// half a repaint it's ahead by right after one
+bool TestSteadyRateConverges()
+{
+    RepaintHeatmap heatmap({ 16, std::chrono::seconds(1) });
+    auto timestamp = Ticks(0);
+    for (auto frame = 0; frame < 60 * 20; frame++)
+    {
+        // The left cell every frame, the right one every sixth
+        std::vector<RECT> rects = { { 0, 0, 16, 16 } };
+        if (frame % 6 == 0)
+        {
+            rects.push_back({ 48, 0, 64, 16 });
+        }
+        heatmap.AddFrame(timestamp, 64, 16, rects);
+        timestamp += FrameInterval;
+    }
+    auto fast = CellRate(heatmap, 0, 0);
+    auto slow = CellRate(heatmap, 3, 0);
+    if (!Near(fast, 60.0, 0.02))
+    {
+        printf("FAILED: a cell repainted at 60Hz has a rate of %f\n", fast);
+        return false;
+    }
+    if (!Near(slow, 10.0, 0.05))
+    {
+        printf("FAILED: a cell repainted at 10Hz has a rate of %f\n", slow);
+        return false;
+    }
+    if (CellRate(heatmap, 1, 0) != 0.0f)
+    {
+        printf("FAILED: a cell between the repainted ones has a rate\n");
+        return false;
+    }
+    return true;
+}
+
+// Overlapping rects in a frame repaint their shared cells once, rects are
+// rounded out to whole cells and clipped to the frame
+bool TestRectsCountOncePerFrame()
+{
+    RepaintHeatmap heatmap;
+    heatmap.AddFrame(Ticks(0), 40, 40, std::vector<RECT>
+    {
+        { 0, 0, 20, 20 },
+        { 10, 10, 30, 30 },
+        { 15, 15, 17, 17 },
+        { -100, 35, 1, 100 },
+        { 100, 100, 200, 200 },
+        { 20, 0, 20, 40 },
+    });
+    auto once = std::log(2.0) / 2.0;
+    // Cells are 16 pixels, so the 40x40 frame is 3x3 with the last ones cut short
+    float const expected[3][3] =
+    {
+        { 1, 1, 0 },
+        { 1, 1, 0 },
+        { 1, 0, 0 },
+    };
+    if (heatmap.Columns() != 3 || heatmap.Rows() != 3)
+    {
+        printf("FAILED: a 40x40 frame is %ux%u cells\n", heatmap.Columns(), heatmap.Rows());
+        return false;
+    }
+    for (uint32_t row = 0; row < 3; row++)
+    {
+        for (uint32_t column = 0; column < 3; column++)
+        {
+            auto rate = CellRate(heatmap, column, row);
+            if (!Near(rate, expected[row][column] * once, 1e-4))
+            {
+                printf("FAILED: cell %u,%u has a rate of %f, expected %f\n", column, row, rate, expected[row][column] * once);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TestUnknownChangesRepaintEverything()
+{
+    RepaintHeatmap heatmap;
+    heatmap.AddFrame(Ticks(0), 100, 50, std::nullopt);
+    std::vector<float> rates;
+    heatmap.Rates(rates);
+    if (rates.size() != 7 * 4)
+    {
+        printf("FAILED: a 100x50 frame has %zu cells\n", rates.size());
+        return false;
+    }
+    auto once = static_cast<float>(std::log(2.0) / 2.0);
+    for (auto rate : rates)
+    {
+        if (!Near(rate, once, 1e-4))
+        {
+            printf("FAILED: a frame without dirty rects left a cell at %f\n", rate);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TestResizeStartsOver()
+{
+    RepaintHeatmap heatmap;
+    for (auto frame = 0; frame < 10; frame++)
+    {
+        heatmap.AddFrame(FrameInterval * frame, 64, 64, std::nullopt);
+    }
+    if (heatmap.FrameCount() != 10)
+    {
+        printf("FAILED: counted %llu frames, expected 10\n", static_cast<unsigned long long>(heatmap.FrameCount()));
+        return false;
+    }
+    heatmap.AddFrame(FrameInterval * 10, 128, 64, std::vector<RECT>{ { 0, 0, 16, 16 } });
+    if (heatmap.FrameCount() != 1 || heatmap.Width() != 128 || heatmap.Columns() != 8)
+    {
+        printf("FAILED: a new size didn't start over\n");
+        return false;
+    }
+    auto once = std::log(2.0) / 2.0;
+    if (!Near(CellRate(heatmap, 0, 0), once, 1e-4) || CellRate(heatmap, 1, 0) != 0.0f)
+    {
+        printf("FAILED: activity from before the resize was kept\n");
+        return false;
+    }
+
+    heatmap.Reset();
+    if (heatmap.FrameCount() != 0 || heatmap.Columns() != 0 || !heatmap.Hotspots(0.0f).empty())
+    {
+        printf("FAILED: Reset left something behind\n");
+        return false;
+    }
+    return true;
+}
+
+// Long enough that the shared scale is renormalized many times over. The
+// rates mustn't drift, and cells that went quiet mustn't come back.
+bool TestLongRunsStayAccurate()
+{
+    RepaintHeatmap heatmap({ 16, std::chrono::milliseconds(500) });
+    auto timestamp = Ticks(0);
+    for (auto frame = 0; frame < 60 * 60 * 10; frame++)
+    {
+        std::vector<RECT> rects = { { 0, 0, 16, 16 } };
+        // The middle cell only for the first second
+        if (frame < 60)
+        {
+            rects.push_back({ 16, 0, 32, 16 });
+        }
+        if (frame % 2 == 0)
+        {
+            rects.push_back({ 32, 0, 48, 16 });
+        }
+        heatmap.AddFrame(timestamp, 48, 16, rects);
+        timestamp += FrameInterval;
+    }
+    std::vector<float> rates;
+    heatmap.Rates(rates);
+    for (auto rate : rates)
+    {
+        if (!std::isfinite(rate))
+        {
+            printf("FAILED: a rate became %f after a long run\n", rate);
+            return false;
+        }
+    }
+    if (!Near(rates[0], 60.0, 0.02) || !Near(rates[2], 30.0, 0.05))
+    {
+        printf("FAILED: after ten minutes the rates are %f and %f, expected 60 and 30\n", rates[0], rates[2]);
+        return false;
+    }
+    if (rates[1] > 1e-6f)
+    {
+        printf("FAILED: a cell quiet for ten minutes has a rate of %f\n", rates[1]);
+        return false;
+    }
+    return true;
+}
+
+// Frames that arrive out of order still count but don't turn back the clock
+bool TestLateFramesDontUndecay()
+{
+    RepaintHeatmap heatmap;
+    heatmap.AddFrame(Ticks(0), 16, 16, std::nullopt);
+    heatmap.AddFrame(std::chrono::seconds(2), 16, 16, std::vector<RECT>{});
+    heatmap.AddFrame(std::chrono::seconds(1), 16, 16, std::nullopt);
+    heatmap.AddFrame(std::chrono::seconds(2), 16, 16, std::vector<RECT>{});
+    auto once = std::log(2.0) / 2.0;
+    auto rate = CellRate(heatmap, 0, 0);
+    if (!Near(rate, once * 1.5, 1e-4))
+    {
+        printf("FAILED: a late frame left a rate of %f, expected %f\n", rate, once * 1.5);
+        return false;
+    }
+    return true;
+}
+
+// Areas painted at their own rates: a spinner, a progress bar, a video and
+// a clock that's too slow to count
+struct HotspotScene
+{
+    RepaintHeatmap Heatmap;
+
+    HotspotScene()
+    {
+        auto timestamp = Ticks(0);
+        for (auto frame = 0; frame < 60 * 20; frame++)
+        {
+            std::vector<RECT> rects;
+            // Spinner, one cell at 60Hz
+            rects.push_back({ 4, 4, 12, 12 });
+            // Progress bar, 3x1 cells at 30Hz
+            if (frame % 2 == 0)
+            {
+                rects.push_back({ 64, 0, 112, 16 });
+            }
+            // Video, 6x4 cells at 20Hz, the last column cut short by the frame
+            if (frame % 3 == 0)
+            {
+                rects.push_back({ 112, 64, 200, 128 });
+            }
+            // Clock, two cells once every two seconds
+            if (frame % 120 == 0)
+            {
+                rects.push_back({ 0, 112, 32, 128 });
+            }
+            Heatmap.AddFrame(timestamp, 200, 128, rects);
+            timestamp += FrameInterval;
+        }
+    }
+};
+
+bool TestHotspotsAreRankedByPixels()
+{
+    HotspotScene scene;
+    auto hotspots = scene.Heatmap.Hotspots(1.0f);
+    if (hotspots.size() != 3)
+    {
+        printf("FAILED: found %zu hotspots, expected 3\n", hotspots.size());
+        return false;
+    }
+    struct Expected
+    {
+        RECT Bounds;
+        uint32_t Cells;
+        float Rate;
+    };
+    Expected const expected[] =
+    {
+        { { 112, 64, 200, 128 }, 24, 20.0f },
+        { { 64, 0, 112, 16 }, 3, 30.0f },
+        { { 0, 0, 16, 16 }, 1, 60.0f },
+    };
+    for (size_t i = 0; i < 3; i++)
+    {
+        auto&& hotspot = hotspots[i];
+        auto&& bounds = hotspot.Bounds;
+        if (bounds.left != expected[i].Bounds.left || bounds.top != expected[i].Bounds.top ||
+            bounds.right != expected[i].Bounds.right || bounds.bottom != expected[i].Bounds.bottom)
+        {
+            printf("FAILED: hotspot %zu is at %ld,%ld,%ld,%ld\n", i, bounds.left, bounds.top, bounds.right, bounds.bottom);
+            return false;
+        }
+        if (hotspot.Cells != expected[i].Cells)
+        {
+            printf("FAILED: hotspot %zu has %u cells, expected %u\n", i, hotspot.Cells, expected[i].Cells);
+            return false;
+        }
+        if (!Near(hotspot.PeakRate, expected[i].Rate, 0.05) || !Near(hotspot.MeanRate, expected[i].Rate, 0.05))
+        {
+            printf("FAILED: hotspot %zu has a peak of %f and mean of %f, expected %f\n", i, hotspot.PeakRate, hotspot.MeanRate, expected[i].Rate);
+            return false;
+        }
+        // Clipped cells only count the pixels they have
+        auto area = static_cast<double>(bounds.right - bounds.left) * (bounds.bottom - bounds.top);
+        if (!Near(hotspot.PixelsPerSecond, area * expected[i].Rate, 0.05))
+        {
+            printf("FAILED: hotspot %zu repaints %f pixels a second, expected %f\n", i, hotspot.PixelsPerSecond, area * expected[i].Rate);
+            return false;
+        }
+    }
+
+    // The clock shows up when the bar is low enough, last
+    auto all = scene.Heatmap.Hotspots(0.1f);
+    if (all.size() != 4 || all.back().Cells != 2 || all.back().Bounds.top != 112)
+    {
+        printf("FAILED: lowering the rate found %zu hotspots without the clock last\n", all.size());
+        return false;
+    }
+    auto top = scene.Heatmap.Hotspots(1.0f, 2);
+    if (top.size() != 2 || top[0].Cells != 24 || top[1].Cells != 3)
+    {
+        printf("FAILED: asking for two hotspots didn't give the two busiest\n");
+        return false;
+    }
+    return true;
+}
+
+// Cells that touch are one hotspot, even when the rates differ, but corners
+// touching aren't enough
+bool TestHotspotsJoinNeighbours()
+{
+    RepaintHeatmap heatmap;
+    auto timestamp = Ticks(0);
+    for (auto frame = 0; frame < 60 * 30; frame++)
+    {
+        std::vector<RECT> rects =
+        {
+            { 0, 0, 16, 48 },
+            { 16, 48, 32, 64 },
+        };
+        if (frame % 4 == 0)
+        {
+            rects.push_back({ 16, 0, 32, 16 });
+        }
+        heatmap.AddFrame(timestamp, 64, 64, rects);
+        timestamp += FrameInterval;
+    }
+    auto hotspots = heatmap.Hotspots(1.0f);
+    if (hotspots.size() != 2)
+    {
+        printf("FAILED: found %zu hotspots, expected 2\n", hotspots.size());
+        return false;
+    }
+    auto&& joined = hotspots[0];
+    if (joined.Cells != 4 || joined.Bounds.right != 32 || joined.Bounds.bottom != 48)
+    {
+        printf("FAILED: the neighbouring cells made a hotspot of %u cells\n", joined.Cells);
+        return false;
+    }
+    if (!Near(joined.PeakRate, 60.0, 0.02) || !Near(joined.MeanRate, (3 * 60.0 + 15.0) / 4, 0.05))
+    {
+        printf("FAILED: the joined hotspot has a peak of %f and a mean of %f\n", joined.PeakRate, joined.MeanRate);
+        return false;
+    }
+    if (hotspots[1].Cells != 1 || hotspots[1].Bounds.left != 16)
+    {
+        printf("FAILED: a cell touching at the corner was joined\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestInvalidSettings()
+{
+    RepaintHeatmapSettings const invalid[] =
+    {
+        { 0, std::chrono::seconds(2) },
+        { 16, Ticks(0) },
+        { 16, Ticks(-1) },
+    };
+    for (auto&& settings : invalid)
+    {
+        try
+        {
+            RepaintHeatmap heatmap(settings);
+            printf("FAILED: a cell size of %u and half-life of %lld didn't throw\n", settings.CellSize, static_cast<long long>(settings.HalfLife.count()));
+            return false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG)
+            {
+                printf("FAILED: invalid settings threw the wrong error\n");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestDecayHalvesEveryHalfLife() && passed;
+    passed = TestSteadyRateConverges() && passed;
+    passed = TestRectsCountOncePerFrame() && passed;
+    passed = TestUnknownChangesRepaintEverything() && passed;
+    passed = TestResizeStartsOver() && passed;
+    passed = TestLongRunsStayAccurate() && passed;
+    passed = TestLateFramesDontUndecay() && passed;
+    passed = TestHotspotsAreRankedByPixels() && passed;
+    passed = TestHotspotsJoinNeighbours() && passed;
+    passed = TestInvalidSettings() && passed;
+
+    if (passed)
+    {
+        printf("All RepaintHeatmap tests passed\n");
+        return 0;
+    }
+    printf("Some RepaintHeatmap tests failed\n");
+    return 1;
+}
\ No newline at end of file
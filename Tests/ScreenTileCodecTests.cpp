@@ -0,0 +1,208 @@
+#include "pch.h"
+#include "ScreenTileCodec.h"
+#include "TestImages.h"
+
+// Not a multiple of the tile size, so the last row and column of tiles are
+// partial
+uint32_t const ImageWidth = 1000;
+uint32_t const ImageHeight = 700;
+uint32_t const ThroughputWidth = 1920;
+uint32_t const ThroughputHeight = 1080;
+uint32_t const ThroughputRuns = 5;
+// Screen content should compress far better than this. A regression in
+// picking the tile mode shows up here first.
+double const MinUiRatio = 4.0;
+
+bool RoundTrips(std::vector<uint8_t> const& pixels, uint32_t width, uint32_t height, bool deflateRawTiles, char const* name)
+{
+    auto encoded = ScreenTileCodec::Encode(pixels.data(), width, height, width * 4, deflateRawTiles);
+    auto image = ScreenTileCodec::Decode(encoded);
+    if (image.Width != width || image.Height != height || image.Pixels != pixels)
+    {
+        printf("FAILED: %s%s doesn't round trip\n", name, deflateRawTiles ? " (deflated)" : "");
+        return false;
+    }
+    return true;
+}
+
+bool TestRoundTrip()
+{
+    auto passed = true;
+    for (auto deflate : { false, true })
+    {
+        passed = RoundTrips(MakeUiImage(ImageWidth, ImageHeight), ImageWidth, ImageHeight, deflate, "ui") && passed;
+        passed = RoundTrips(MakeNoiseImage(ImageWidth, ImageHeight), ImageWidth, ImageHeight, deflate, "opaque noise") && passed;
+        passed = RoundTrips(MakeNoiseImage(ImageWidth, ImageHeight, 2, false), ImageWidth, ImageHeight, deflate, "translucent noise") && passed;
+        passed = RoundTrips(MakeUiImage(1, 1), 1, 1, deflate, "1x1") && passed;
+        passed = RoundTrips(MakeNoiseImage(ScreenTileCodec::TileSize + 1, 3), ScreenTileCodec::TileSize + 1, 3, deflate, "sliver") && passed;
+    }
+
+    // A tile with exactly 256 colors is the largest palette, 257 is raw
+    for (uint32_t colors : { 256u, 257u })
+    {
+        auto size = ScreenTileCodec::TileSize;
+        std::vector<uint8_t> pixels(size * size * 4);
+        auto row = reinterpret_cast<uint32_t*>(pixels.data());
+        for (uint32_t i = 0; i < size * size; i++)
+        {
+            row[i] = Bgra(static_cast<uint8_t>(i % colors), static_cast<uint8_t>((i % colors) >> 8), 0);
+        }
+        passed = RoundTrips(pixels, size, size, false, colors == 256 ? "256 colors" : "257 colors") && passed;
+    }
+
+    // The stride can be wider than the image
+    auto width = 100u;
+    auto height = 80u;
+    auto stride = width * 4 + 64;
+    auto tight = MakeUiImage(width, height);
+    std::vector<uint8_t> padded(stride * height, 0xCD);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        std::copy_n(tight.data() + y * width * 4, width * 4, padded.data() + y * stride);
+    }
+    auto image = ScreenTileCodec::Decode(ScreenTileCodec::Encode(padded.data(), width, height, stride));
+    if (image.Pixels != tight)
+    {
+        printf("FAILED: a padded stride doesn't round trip\n");
+        passed = false;
+    }
+    return passed;
+}
+
+bool TestRatioAndThroughput()
+{
+    auto pixels = MakeUiImage(ThroughputWidth, ThroughputHeight);
+    auto rawSize = static_cast<double>(pixels.size());
+    auto passed = true;
+    size_t plainSize = 0;
+    for (auto deflate : { false, true })
+    {
+        std::vector<uint8_t> encoded;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < ThroughputRuns; i++)
+        {
+            encoded = ScreenTileCodec::Encode(pixels.data(), ThroughputWidth, ThroughputHeight, ThroughputWidth * 4, deflate);
+        }
+        auto encodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / ThroughputRuns;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < ThroughputRuns; i++)
+        {
+            ScreenTileCodec::Decode(encoded);
+        }
+        auto decodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / ThroughputRuns;
+
+        auto ratio = rawSize / encoded.size();
+        printf("%s: %.1fx smaller, encode %.0f MB/s, decode %.0f MB/s\n",
+            deflate ? "deflated" : "plain   ",
+            ratio,
+            rawSize / encodeTime / 1e6,
+            rawSize / decodeTime / 1e6);
+        if (ratio < MinUiRatio)
+        {
+            printf("FAILED: ui content only compressed %.1fx\n", ratio);
+            passed = false;
+        }
+        if (!deflate)
+        {
+            plainSize = encoded.size();
+        }
+        else if (encoded.size() > plainSize)
+        {
+            printf("FAILED: deflating made the image bigger (%zu vs %zu bytes)\n", encoded.size(), plainSize);
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+std::vector<uint8_t> MakeHeader(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t tileCount)
+{
+    std::vector<uint8_t> data = { 'S', 'T', 'C', '2' };
+    for (auto value : { width, height, tileSize, tileCount })
+    {
+        for (auto i = 0; i < 4; i++)
+        {
+            data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+    return data;
+}
+
+bool Rejects(std::vector<uint8_t> const& data, char const* name)
+{
+    try
+    {
+        ScreenTileCodec::Decode(data);
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        if (error.code() == E_INVALIDARG)
+        {
+            return true;
+        }
+    }
+    catch (...)
+    {
+    }
+    printf("FAILED: %s wasn't rejected as invalid\n", name);
+    return false;
+}
+
+bool TestMalformed()
+{
+    auto passed = true;
+
+    // A 65536x65536 image in one tile would be 16 GiB. It has to fail before
+    // anything is allocated, so this would run out of memory otherwise.
+    auto bomb = MakeHeader(65536, 65536, 65536, 1);
+    bomb.resize(bomb.size() + 8, 0);
+    bomb.push_back(0x80);
+    passed = Rejects(bomb, "a single huge tile") && passed;
+
+    // Valid tile size, but a million tiles and no offset table
+    passed = Rejects(MakeHeader(65536, 65536, ScreenTileCodec::TileSize, 1024 * 1024), "a missing offset table") && passed;
+
+    // A full offset table, but every tile points at the same few bytes
+    auto tiles = 64u * 64u;
+    auto shared = MakeHeader(64 * ScreenTileCodec::TileSize, 64 * ScreenTileCodec::TileSize, ScreenTileCodec::TileSize, tiles);
+    shared.resize(shared.size() + tiles * 8, 0);
+    shared.insert(shared.end(), { 0x80, 1, 2, 3 });
+    passed = Rejects(shared, "tiles sharing their data") && passed;
+
+    passed = Rejects(MakeHeader(0, 10, ScreenTileCodec::TileSize, 0), "an empty image") && passed;
+    passed = Rejects({ 'P', 'N', 'G', 0 }, "another format") && passed;
+
+    // Every truncation of a valid image
+    auto pixels = MakeUiImage(150, 70);
+    auto valid = ScreenTileCodec::Encode(pixels.data(), 150, 70, 150 * 4, true);
+    for (size_t size = 0; size < valid.size(); size++)
+    {
+        if (!Rejects({ valid.begin(), valid.begin() + size }, "a truncated image"))
+        {
+            printf("  at %zu of %zu bytes\n", size, valid.size());
+            passed = false;
+            break;
+        }
+    }
+
+    // Offsets past the end and out of order
+    auto tableStart = 20;
+    auto pastEnd = valid;
+    pastEnd[tableStart + 8 + 6] = 0x7F;
+    passed = Rejects(pastEnd, "an offset past the end") && passed;
+    auto backwards = valid;
+    std::copy_n(valid.begin() + tableStart + 16, 8, backwards.begin() + tableStart + 8);
+    std::copy_n(valid.begin() + tableStart + 8, 8, backwards.begin() + tableStart + 16);
+    passed = Rejects(backwards, "offsets out of order") && passed;
+    return passed;
+}
+
+int main()
+{
+    auto passed = true;
+    passed = TestRoundTrip() && passed;
+    passed = TestRatioAndThroughput() && passed;
+    passed = TestMalformed() && passed;
+    printf(passed ? "All screen tile codec tests passed\n" : "Some screen tile codec tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
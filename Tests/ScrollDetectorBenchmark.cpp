@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "ScrollDetector.h"
+#include "TestImages.h"
+
+// A 1080p browser-like window scrolling through a long page: wheel clicks
+// of three lines, flings that speed up and slow down, pauses with a
+// blinking caret, and a jump that shows unrelated content
+uint32_t const Width = 1920;
+uint32_t const Height = 1080;
+uint32_t const Stride = Width * 4;
+int32_t const ToolbarHeight = 80;
+uint32_t const PageHeight = 20000;
+
+int main()
+{
+    auto page = MakeUiImage(Width, PageHeight, 17);
+    auto frameAt = [&](uint32_t position)
+    {
+        std::vector<uint8_t> frame(static_cast<size_t>(Stride) * Height);
+        FillRect(frame, Stride, 0, 0, Width, ToolbarHeight, Bgra(222, 225, 230));
+        memcpy(frame.data() + static_cast<size_t>(ToolbarHeight) * Stride, page.data() + static_cast<size_t>(position) * Stride, static_cast<size_t>(Height - ToolbarHeight) * Stride);
+        return frame;
+    };
+
+    std::vector<int32_t> deltas;
+    for (int i = 0; i < 40; i++)
+    {
+        deltas.push_back(66);
+    }
+    for (int32_t speed : { 10, 40, 90, 160, 240, 300, 240, 160, 90, 40, 10, 3, 1 })
+    {
+        deltas.push_back(speed);
+        deltas.push_back(speed);
+    }
+    for (int i = 0; i < 20; i++)
+    {
+        deltas.push_back(0);
+    }
+    for (int i = 0; i < 40; i++)
+    {
+        deltas.push_back(-66);
+    }
+    deltas.push_back(9000);
+    for (int i = 0; i < 20; i++)
+    {
+        deltas.push_back(-22);
+    }
+
+    std::vector<std::vector<uint8_t>> frames;
+    uint32_t position = 2000;
+    frames.push_back(frameAt(position));
+    for (size_t i = 0; i < deltas.size(); i++)
+    {
+        position += deltas[i];
+        auto frame = frameAt(position);
+        if (deltas[i] == 0 && i % 2 == 0)
+        {
+            FillRect(frame, Stride, 900, 400, 902, 416, Bgra(0, 0, 0));
+        }
+        frames.push_back(std::move(frame));
+    }
+
+    RECT view = { 0, ToolbarHeight, static_cast<LONG>(Width), static_cast<LONG>(Height) };
+    auto viewArea = static_cast<double>(view.right - view.left) * (view.bottom - view.top);
+    ScrollDetector detector;
+    size_t moves = 0;
+    double residualArea = 0;
+    double changedArea = 0;
+    // Warm up the detector's buffers the way a capture session would
+    detector.Detect(frames[0].data(), frames[1].data(), Stride, 4, view);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 1; i < frames.size(); i++)
+    {
+        auto motion = detector.Detect(frames[i - 1].data(), frames[i].data(), Stride, 4, view);
+        moves += motion.Moves.size();
+        for (auto&& residual : motion.Residual)
+        {
+            residualArea += static_cast<double>(residual.right - residual.left) * (residual.bottom - residual.top);
+        }
+        if (frames[i] != frames[i - 1])
+        {
+            changedArea += viewArea;
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    auto frameCount = frames.size() - 1;
+
+    printf("%zu frames of %ux%u, %zu scrolled\n", frameCount, Width, Height - ToolbarHeight, moves);
+    printf("Detect: %.3f ms per frame (%.0f MB/s of frame pairs)\n",
+        elapsed.count() / frameCount,
+        2.0 * viewArea * 4 * frameCount / (elapsed.count() / 1000) / 1e6);
+    printf("Pixels to encode: %.1f%% of the changed views, %.0f per frame instead of %.0f\n",
+        100.0 * residualArea / changedArea,
+        residualArea / frameCount,
+        changedArea / frameCount);
+    return 0;
+}
\ No newline at end of file
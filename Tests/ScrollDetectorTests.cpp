@@ -0,0 +1,326 @@
+#include "pch.h"
+#include "ScrollDetector.h"
+#include "TestImages.h"
+
+// A scrolling view inside a frame: the frame has a fixed title bar above
+// the view and some padding at the end of each row, and the view shows the
+// part of a tall page the scroll position points at
+struct ScrollingView
+{
+    uint32_t FrameWidth = 0;
+    uint32_t FrameHeight = 0;
+    uint32_t Stride = 0;
+    RECT View = {};
+    uint32_t PageWidth = 0;
+    uint32_t PageHeight = 0;
+    std::vector<uint8_t> Page;
+
+    ScrollingView(uint32_t frameWidth, uint32_t frameHeight, RECT view, uint32_t pageWidth, uint32_t pageHeight, uint32_t seed) :
+        FrameWidth(frameWidth),
+        FrameHeight(frameHeight),
+        Stride(frameWidth * 4 + 64),
+        View(view),
+        PageWidth(pageWidth),
+        PageHeight(pageHeight),
+        Page(MakeUiImage(pageWidth, pageHeight, seed))
+    {
+    }
+
+    std::vector<uint8_t> Frame(uint32_t scrollX, uint32_t scrollY) const
+    {
+        std::vector<uint8_t> frame(static_cast<size_t>(Stride) * FrameHeight, 0x5A);
+        FillRect(frame, Stride, 0, 0, FrameWidth, View.top, Bgra(32, 96, 176));
+        auto viewWidth = static_cast<size_t>(View.right - View.left);
+        for (auto y = View.top; y < View.bottom; y++)
+        {
+            auto source = Page.data() + (static_cast<size_t>(scrollY + y - View.top) * PageWidth + scrollX) * 4;
+            memcpy(frame.data() + static_cast<size_t>(y) * Stride + static_cast<size_t>(View.left) * 4, source, viewWidth * 4);
+        }
+        return frame;
+    }
+};
+
+LONG Area(RECT const& rect)
+{
+    return (rect.right - rect.left) * (rect.bottom - rect.top);
+}
+
+bool Contains(RECT const& outer, RECT const& inner)
+{
+    return inner.left >= outer.left && inner.top >= outer.top && inner.right <= outer.right && inner.bottom <= outer.bottom;
+}
+
+// Copying the moves out of the previous frame and the residual out of the
+// current one has to rebuild the current frame inside the region, and
+// nothing may be reported outside of it
+bool CheckMotion(
+    char const* name,
+    FrameMotion const& motion,
+    std::vector<uint8_t> const& previous,
+    std::vector<uint8_t> const& current,
+    uint32_t stride,
+    uint32_t bytesPerPixel,
+    RECT const& region)
+{
+    auto rebuilt = previous;
+    auto copy = [&](std::vector<uint8_t> const& from, RECT const& destination, LONG sourceX, LONG sourceY)
+    {
+        auto rowSize = static_cast<size_t>(destination.right - destination.left) * bytesPerPixel;
+        for (auto y = destination.top; y < destination.bottom; y++)
+        {
+            auto source = from.data() + static_cast<size_t>(sourceY + y - destination.top) * stride + static_cast<size_t>(sourceX) * bytesPerPixel;
+            memcpy(rebuilt.data() + static_cast<size_t>(y) * stride + static_cast<size_t>(destination.left) * bytesPerPixel, source, rowSize);
+        }
+    };
+    for (auto&& move : motion.Moves)
+    {
+        RECT source = { move.Source.x, move.Source.y, move.Source.x + move.Destination.right - move.Destination.left, move.Source.y + move.Destination.bottom - move.Destination.top };
+        if (!Contains(region, move.Destination) || !Contains(region, source))
+        {
+            printf("FAILED: %s, a move reaches outside the region\n", name);
+            return false;
+        }
+        copy(previous, move.Destination, move.Source.x, move.Source.y);
+    }
+    for (auto&& residual : motion.Residual)
+    {
+        if (!Contains(region, residual) || Area(residual) <= 0)
+        {
+            printf("FAILED: %s, a residual rect is empty or outside the region\n", name);
+            return false;
+        }
+        copy(current, residual, residual.left, residual.top);
+    }
+    auto rowSize = static_cast<size_t>(region.right - region.left) * bytesPerPixel;
+    for (auto y = region.top; y < region.bottom; y++)
+    {
+        auto offset = static_cast<size_t>(y) * stride + static_cast<size_t>(region.left) * bytesPerPixel;
+        if (memcmp(rebuilt.data() + offset, current.data() + offset, rowSize) != 0)
+        {
+            printf("FAILED: %s, row %ld doesn't match after applying the motion\n", name, static_cast<long>(y));
+            return false;
+        }
+    }
+    return true;
+}
+
+LONG ResidualArea(FrameMotion const& motion)
+{
+    LONG area = 0;
+    for (auto&& residual : motion.Residual)
+    {
+        area += Area(residual);
+    }
+    return area;
+}
+
+// Scrolling down and back up by amounts from a pixel to half the view is
+// found at the exact offset, and only the newly shown lines are residual.
+// Past that too few lines are left to outvote the ones that changed.
+bool TestVerticalScrolling()
+{
+    ScrollingView view(800, 600, { 40, 32, 760, 600 }, 720, 4000, 3);
+    auto viewHeight = view.View.bottom - view.View.top;
+    ScrollDetector detector;
+    std::mt19937 random(5);
+    uint32_t position = 1000;
+    auto previous = view.Frame(0, position);
+    for (int i = 0; i < 60; i++)
+    {
+        auto delta = static_cast<int32_t>(random() % (viewHeight / 2)) + 1;
+        if (random() % 2 == 0 || position + delta + viewHeight > view.PageHeight)
+        {
+            delta = -delta;
+        }
+        if (static_cast<int32_t>(position) + delta < 0)
+        {
+            delta = -delta;
+        }
+        position += delta;
+        auto current = view.Frame(0, position);
+        auto motion = detector.Detect(previous.data(), current.data(), view.Stride, 4, view.View);
+        if (!CheckMotion("vertical scrolling", motion, previous, current, view.Stride, 4, view.View))
+        {
+            return false;
+        }
+        if (motion.Moves.size() != 1 || motion.Moves[0].Destination.top - motion.Moves[0].Source.y != -delta)
+        {
+            printf("FAILED: scrolling by %d wasn't found\n", delta);
+            return false;
+        }
+        // The new lines, and a few more where repeated blank lines at the
+        // edge of the move can't be told apart
+        auto newArea = std::abs(delta) * (view.View.right - view.View.left);
+        if (ResidualArea(motion) > newArea + 32 * (view.View.right - view.View.left))
+        {
+            printf("FAILED: scrolling by %d left %ld pixels to encode for %ld new ones\n", delta, static_cast<long>(ResidualArea(motion)), static_cast<long>(newArea));
+            return false;
+        }
+        previous = std::move(current);
+    }
+    return true;
+}
+
+bool TestHorizontalScrolling()
+{
+    ScrollingView view(640, 400, { 0, 32, 640, 400 }, 3000, 368, 7);
+    ScrollDetector detector;
+    auto previous = view.Frame(1000, 0);
+    for (int32_t delta : { 1, 17, -40, 250, -3, 320 })
+    {
+        auto current = view.Frame(static_cast<uint32_t>(1000 + delta), 0);
+        auto motion = detector.Detect(previous.data(), current.data(), view.Stride, 4, view.View);
+        if (!CheckMotion("horizontal scrolling", motion, previous, current, view.Stride, 4, view.View))
+        {
+            return false;
+        }
+        if (motion.Moves.size() != 1 || motion.Moves[0].Destination.left - motion.Moves[0].Source.x != -delta ||
+            motion.Moves[0].Destination.top != view.View.top || motion.Moves[0].Destination.bottom != view.View.bottom)
+        {
+            printf("FAILED: scrolling sideways by %d wasn't found\n", delta);
+            return false;
+        }
+    }
+    return true;
+}
+
+// 8 byte pixels, like 16 bit float frames, scroll the same way
+bool TestWidePixels()
+{
+    ScrollingView view(600, 300, { 0, 0, 600, 300 }, 600, 2000, 9);
+    ScrollDetector detector;
+    // Two 4 byte pixels read as one 8 byte pixel
+    RECT region = { 0, 0, 300, 300 };
+    auto previous = view.Frame(0, 100);
+    auto current = view.Frame(0, 137);
+    auto motion = detector.Detect(previous.data(), current.data(), view.Stride, 8, region);
+    if (!CheckMotion("wide pixels", motion, previous, current, view.Stride, 8, region))
+    {
+        return false;
+    }
+    if (motion.Moves.size() != 1 || motion.Moves[0].Source.y - motion.Moves[0].Destination.top != 37)
+    {
+        printf("FAILED: scrolling 8 byte pixels wasn't found\n");
+        return false;
+    }
+    return true;
+}
+
+// Nothing moved: unchanged frames report nothing and scattered changes are
+// reported as just the rows they touch
+bool TestNoScrolling()
+{
+    ScrollingView view(800, 600, { 0, 32, 800, 600 }, 800, 568, 11);
+    ScrollDetector detector;
+    auto previous = view.Frame(0, 0);
+    auto same = detector.Detect(previous.data(), previous.data(), view.Stride, 4, view.View);
+    if (!same.Moves.empty() || !same.Residual.empty())
+    {
+        printf("FAILED: identical frames reported motion\n");
+        return false;
+    }
+
+    auto current = previous;
+    // A caret and a progress bar
+    FillRect(current, view.Stride, 300, 100, 302, 116, Bgra(0, 0, 0));
+    FillRect(current, view.Stride, 100, 500, 400, 510, Bgra(0, 160, 0));
+    auto motion = detector.Detect(previous.data(), current.data(), view.Stride, 4, view.View);
+    if (!CheckMotion("no scrolling", motion, previous, current, view.Stride, 4, view.View))
+    {
+        return false;
+    }
+    if (!motion.Moves.empty() || motion.Residual.size() != 2 || ResidualArea(motion) != 26 * 800)
+    {
+        printf("FAILED: small changes reported %zu moves and %zu residual rects\n", motion.Moves.size(), motion.Residual.size());
+        return false;
+    }
+    return true;
+}
+
+// Content replaced by something unrelated isn't mistaken for a scroll
+bool TestUnrelatedContent()
+{
+    ScrollDetector detector;
+    uint32_t const width = 500;
+    uint32_t const height = 400;
+    auto previous = MakeUiImage(width, height, 1);
+    auto current = MakeNoiseImage(width, height, 2);
+    RECT region = { 0, 0, width, height };
+    auto motion = detector.Detect(previous.data(), current.data(), width * 4, 4, region);
+    if (!CheckMotion("unrelated content", motion, previous, current, width * 4, 4, region))
+    {
+        return false;
+    }
+    if (!motion.Moves.empty())
+    {
+        printf("FAILED: unrelated content was reported as a move\n");
+        return false;
+    }
+    return true;
+}
+
+// A scroll with a sticky header and a changed line in the middle of the
+// move still finds the scroll, and the rebuilt frame is exact
+bool TestScrollWithChanges()
+{
+    ScrollingView view(700, 500, { 0, 32, 700, 500 }, 700, 3000, 13);
+    ScrollDetector detector;
+    auto previous = view.Frame(0, 500);
+    auto current = view.Frame(0, 560);
+    FillRect(previous, view.Stride, 0, 32, 700, 60, Bgra(250, 250, 250));
+    FillRect(current, view.Stride, 0, 32, 700, 60, Bgra(250, 250, 250));
+    FillRect(current, view.Stride, 200, 250, 600, 262, Bgra(200, 0, 0));
+    auto motion = detector.Detect(previous.data(), current.data(), view.Stride, 4, view.View);
+    if (!CheckMotion("scroll with changes", motion, previous, current, view.Stride, 4, view.View))
+    {
+        return false;
+    }
+    if (motion.Moves.size() != 1 || motion.Moves[0].Source.y - motion.Moves[0].Destination.top != 60)
+    {
+        printf("FAILED: a scroll with changes in it wasn't found\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestDegenerateRegions()
+{
+    ScrollDetector detector;
+    std::vector<uint8_t> pixels(64 * 64 * 4, 0);
+    for (auto&& region : { RECT{ 10, 10, 10, 20 }, RECT{ 10, 20, 20, 10 }, RECT{ 0, 0, 64, 4 } })
+    {
+        auto motion = detector.Detect(pixels.data(), pixels.data(), 64 * 4, 4, region);
+        if (!motion.Moves.empty() || !motion.Residual.empty())
+        {
+            printf("FAILED: a degenerate region reported motion\n");
+            return false;
+        }
+    }
+    auto motion = detector.Detect(pixels.data(), pixels.data(), 64 * 4, 16, RECT{ 0, 0, 4, 4 });
+    if (!motion.Moves.empty() || !motion.Residual.empty())
+    {
+        printf("FAILED: oversized pixels reported motion\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestVerticalScrolling() && passed;
+    passed = TestHorizontalScrolling() && passed;
+    passed = TestWidePixels() && passed;
+    passed = TestNoScrolling() && passed;
+    passed = TestUnrelatedContent() && passed;
+    passed = TestScrollWithChanges() && passed;
+    passed = TestDegenerateRegions() && passed;
+
+    if (passed)
+    {
+        printf("All ScrollDetector tests passed\n");
+        return 0;
+    }
+    printf("Some ScrollDetector tests failed\n");
+    return 1;
+}
\ No newline at end of file
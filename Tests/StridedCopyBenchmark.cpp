@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "StridedCopy.h"
+
+// Reading frames back out of a mapped staging texture, whose rows are
+// padded to 256 bytes, into tightly packed pixels. Compared against the
+// plain row loop it replaced, into a reused destination and into a fresh
+// one that has to be faulted in.
+int const Iterations = 20;
+
+void RowLoop(uint8_t const* source, size_t sourceStride, uint8_t* destination, size_t destinationStride, size_t rowBytes, uint32_t rows)
+{
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        memcpy(destination + y * destinationStride, source + y * sourceStride, rowBytes);
+    }
+}
+
+template <typename Copy>
+double BestGigabytesPerSecond(size_t bytes, Copy&& copy)
+{
+    auto best = std::numeric_limits<double>::max();
+    for (int i = 0; i < Iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        copy();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return bytes / best / 1e9;
+}
+
+int main()
+{
+    struct Frame
+    {
+        char const* Name;
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t BytesPerPixel;
+    };
+    Frame const frames[] =
+    {
+        { "1080p BGRA8", 1920, 1080, 4 },
+        { "1440p BGRA8", 2560, 1440, 4 },
+        { "4K BGRA8", 3840, 2160, 4 },
+        { "4K FP16", 3840, 2160, 8 },
+        { "8K FP16", 7680, 4320, 8 },
+    };
+    printf("%-12s %8s %12s %12s %12s %12s\n", "", "MB", "loop GB/s", "copy GB/s", "fresh loop", "fresh copy");
+    for (auto&& frame : frames)
+    {
+        auto rowBytes = static_cast<size_t>(frame.Width) * frame.BytesPerPixel;
+        auto sourceStride = (rowBytes + 255) & ~size_t(255);
+        std::vector<uint8_t> source(sourceStride * frame.Height, 1);
+        std::vector<uint8_t> destination(rowBytes * frame.Height, 0);
+        auto bytes = rowBytes * frame.Height;
+
+        auto loop = BestGigabytesPerSecond(bytes, [&]() { RowLoop(source.data(), sourceStride, destination.data(), rowBytes, rowBytes, frame.Height); });
+        auto copy = BestGigabytesPerSecond(bytes, [&]() { StridedCopy::Copy(source.data(), sourceStride, destination.data(), rowBytes, rowBytes, frame.Height); });
+        auto freshLoop = BestGigabytesPerSecond(bytes, [&]()
+        {
+            std::unique_ptr<uint8_t[]> fresh(new uint8_t[bytes]);
+            RowLoop(source.data(), sourceStride, fresh.get(), rowBytes, rowBytes, frame.Height);
+        });
+        auto freshCopy = BestGigabytesPerSecond(bytes, [&]()
+        {
+            std::unique_ptr<uint8_t[]> fresh(new uint8_t[bytes]);
+            StridedCopy::Copy(source.data(), sourceStride, fresh.get(), rowBytes, rowBytes, frame.Height);
+        });
+        printf("%-12s %8.1f %12.2f %12.2f %12.2f %12.2f\n", frame.Name, bytes / 1e6, loop, copy, freshLoop, freshCopy);
+    }
+    printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "pch.h"
+#include "StridedCopy.h"
+
+uint8_t const Guard = 0xA5;
+
+// Copies rows of rowBytes into a destination that starts offset bytes
+// into its buffer, and checks that every row arrived and that nothing
+// before, between or after the rows was touched
+bool CheckCopy(char const* name, size_t rowBytes, uint32_t rows, size_t sourcePadding, size_t destinationPadding, size_t offset)
+{
+    auto sourceStride = rowBytes + sourcePadding;
+    auto destinationStride = rowBytes + destinationPadding;
+    std::vector<uint8_t> source(sourceStride * rows);
+    // Rows differ from each other so a row copied to the wrong place shows
+    uint32_t state = static_cast<uint32_t>(rowBytes * 31 + rows);
+    for (auto&& value : source)
+    {
+        state = state * 1664525u + 1013904223u;
+        value = static_cast<uint8_t>(state >> 24);
+    }
+    std::vector<uint8_t> buffer(offset + destinationStride * rows + 64, Guard);
+    auto destination = buffer.data() + offset;
+
+    StridedCopy::Copy(source.data(), sourceStride, destination, destinationStride, rowBytes, rows);
+
+    for (size_t i = 0; i < offset; i++)
+    {
+        if (buffer[i] != Guard)
+        {
+            printf("FAILED: %s, wrote before the destination\n", name);
+            return false;
+        }
+    }
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        auto row = destination + y * destinationStride;
+        if (memcmp(row, source.data() + y * sourceStride, rowBytes) != 0)
+        {
+            printf("FAILED: %s, row %u of %zu bytes didn't arrive\n", name, y, rowBytes);
+            return false;
+        }
+        // The padding after each row, and everything after the last one
+        auto end = y + 1 == rows ? buffer.data() + buffer.size() : row + destinationStride;
+        if (std::any_of(row + rowBytes, end, [](uint8_t value) { return value != Guard; }))
+        {
+            printf("FAILED: %s, wrote into the padding after row %u\n", name, y);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Below the parallel threshold, one thread copies every row
+bool TestSmallCopies()
+{
+    for (size_t rowBytes : { size_t(1), size_t(3), size_t(15), size_t(16), size_t(63), size_t(64), size_t(65), size_t(4097) })
+    {
+        for (size_t offset = 0; offset < 16; offset += 5)
+        {
+            if (!CheckCopy("small strided", rowBytes, 37, 13, 7, offset) ||
+                !CheckCopy("small packed", rowBytes, 37, 0, 0, offset) ||
+                !CheckCopy("small into packed", rowBytes, 37, 32, 0, offset))
+            {
+                return false;
+            }
+        }
+    }
+    return CheckCopy("nothing", 0, 10, 4, 4, 0) && CheckCopy("no rows", 100, 0, 4, 4, 0);
+}
+
+// Between the parallel and streaming thresholds, bands of rows are copied
+// on the thread pool. Row counts that don't divide into bands leave a short
+// last band, and rows bigger than a band get one band each.
+bool TestBandedCopies()
+{
+    if (!CheckCopy("banded frame", 7680, 1080, 256, 0, 0) ||
+        !CheckCopy("banded odd rows", 4099, 1531, 61, 3, 9) ||
+        !CheckCopy("banded packed", 4096, 1500, 0, 0, 1) ||
+        !CheckCopy("banded huge rows", 3 * 1024 * 1024 + 5, 3, 11, 0, 3))
+    {
+        return false;
+    }
+    return true;
+}
+
+// Past the streaming threshold the stores bypass the cache on x64, and
+// have to start on 16 byte boundaries whatever the destination's alignment
+bool TestStreamingCopies()
+{
+    if (!CheckCopy("streaming frame", 15360, 2200, 256, 0, 0) ||
+        !CheckCopy("streaming unaligned", 15361, 2200, 7, 5, 3) ||
+        !CheckCopy("streaming packed", 16000, 2100, 0, 0, 13))
+    {
+        return false;
+    }
+    // Just over the threshold, and a single enormous row
+    auto rows = static_cast<uint32_t>(StridedCopy::StreamingThreshold / 8191 + 1);
+    return CheckCopy("streaming threshold", 8191, rows, 1, 1, 1) &&
+        CheckCopy("streaming one row", StridedCopy::StreamingThreshold + 77, 1, 0, 0, 7);
+}
+
+int main()
+{
+    bool passed = true;
+    passed = TestSmallCopies() && passed;
+    passed = TestBandedCopies() && passed;
+    passed = TestStreamingCopies() && passed;
+
+    if (passed)
+    {
+        printf("All StridedCopy tests passed\n");
+        return 0;
+    }
+    printf("Some StridedCopy tests failed\n");
+    return 1;
+}
\ No newline at end of file
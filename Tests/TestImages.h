@@ -0,0 +1,86 @@
+#pragma once
+#include <random>
+
+// Synthetic 32bpp BGRA images that look like what gets captured. They're
+// made the same way every time for a given seed.
+
+inline uint32_t Bgra(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha = 255)
+{
+    return static_cast<uint32_t>(blue) | (static_cast<uint32_t>(green) << 8) | (static_cast<uint32_t>(red) << 16) | (static_cast<uint32_t>(alpha) << 24);
+}
+
+inline void FillRect(std::vector<uint8_t>& pixels, uint32_t stride, int32_t left, int32_t top, int32_t right, int32_t bottom, uint32_t color)
+{
+    for (auto y = top; y < bottom; y++)
+    {
+        auto row = reinterpret_cast<uint32_t*>(pixels.data() + static_cast<size_t>(y) * stride);
+        std::fill(row + left, row + right, color);
+    }
+}
+
+// A window with a title bar, panels, lines of anti-aliased looking text and
+// a photo-like gradient with noise in it. Text and the photo make up most of
+// the colors, the rest is flat.
+inline std::vector<uint8_t> MakeUiImage(uint32_t width, uint32_t height, uint32_t seed = 1)
+{
+    std::mt19937 random(seed);
+    auto stride = width * 4;
+    std::vector<uint8_t> pixels(static_cast<size_t>(stride) * height);
+    auto w = static_cast<int32_t>(width);
+    auto h = static_cast<int32_t>(height);
+    FillRect(pixels, stride, 0, 0, w, h, Bgra(243, 243, 243));
+    FillRect(pixels, stride, 0, 0, w, std::min(h, 32), Bgra(32, 96, 176));
+    FillRect(pixels, stride, 0, std::min(h, 32), std::min(w, 200), h, Bgra(230, 230, 235));
+
+    // Text: short runs of dark glyph pixels with a few gray edge shades
+    uint32_t const shades[] = { Bgra(20, 20, 20), Bgra(90, 90, 90), Bgra(160, 160, 160), Bgra(210, 210, 210) };
+    for (auto line = 48; line + 14 < h; line += 22)
+    {
+        auto lineEnd = std::min(w - 8, 220 + static_cast<int32_t>(random() % std::max(1, w / 2)));
+        for (auto x = 216; x < lineEnd; x += 7)
+        {
+            if (random() % 6 == 0)
+            {
+                continue;
+            }
+            for (auto y = line; y < line + 14; y++)
+            {
+                auto row = reinterpret_cast<uint32_t*>(pixels.data() + static_cast<size_t>(y) * stride);
+                for (auto glyphX = x; glyphX < std::min(x + 6, w); glyphX++)
+                {
+                    if (random() % 3 == 0)
+                    {
+                        row[glyphX] = shades[random() % 4];
+                    }
+                }
+            }
+        }
+    }
+
+    // A photo in the bottom right
+    auto photoLeft = w * 2 / 3;
+    auto photoTop = h * 2 / 3;
+    for (auto y = photoTop; y < h; y++)
+    {
+        auto row = reinterpret_cast<uint32_t*>(pixels.data() + static_cast<size_t>(y) * stride);
+        for (auto x = photoLeft; x < w; x++)
+        {
+            auto noise = static_cast<int32_t>(random() % 16);
+            row[x] = Bgra(static_cast<uint8_t>((x * 3 + noise) & 0xFF), static_cast<uint8_t>((y * 2 + noise) & 0xFF), static_cast<uint8_t>((x + y) & 0xFF));
+        }
+    }
+    return pixels;
+}
+
+// Every pixel different, the worst case for anything that looks for
+// repeats
+inline std::vector<uint8_t> MakeNoiseImage(uint32_t width, uint32_t height, uint32_t seed = 1, bool opaque = true)
+{
+    std::mt19937 random(seed);
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        pixels[i] = (opaque && i % 4 == 3) ? 255 : static_cast<uint8_t>(random());
+    }
+    return pixels;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "WindowFilterRules.h"
+#include <random>
+
+// Large generated rule sets, the kind a policy file for a fleet of machines
+// ends up with, evaluated against a desktop's worth of windows many times
+uint32_t const WindowCount = 2000;
+uint32_t const Passes = 20;
+
+std::wstring RandomWord(std::mt19937& random, uint32_t length)
+{
+    std::wstring word;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        word += static_cast<wchar_t>(L'a' + random() % 26);
+    }
+    return word;
+}
+
+int main()
+{
+    for (uint32_t ruleCount : { 100u, 1000u, 10000u })
+    {
+        std::mt19937 random(3);
+        // Mostly exact titles and classes, then prefixes and globs. Only a
+        // few globs start with a wildcard, those and the style rules are
+        // checked against every window.
+        std::wstring text;
+        std::vector<std::wstring> titles;
+        for (uint32_t i = 0; i < ruleCount; i++)
+        {
+            auto word = RandomWord(random, 8);
+            auto kind = random() % 100;
+            if (kind < 40)
+            {
+                titles.push_back(word);
+                text += L"block title=\"" + word + L"\"\n";
+            }
+            else if (kind < 60)
+            {
+                text += L"block class=\"" + word + L"\" exstyle=WS_EX_LAYERED\n";
+            }
+            else if (kind < 80)
+            {
+                text += L"block process=\"" + word.substr(0, 4) + L"*\"\n";
+            }
+            else if (kind < 97)
+            {
+                text += L"block title=\"" + word.substr(0, 5) + L" ?*.txt\"\n";
+            }
+            else if (kind < 99)
+            {
+                text += L"block title=\"*" + word.substr(0, 5) + L"*\"\n";
+            }
+            else
+            {
+                text += L"block style=WS_POPUP|0x" + std::to_wstring(1 + random() % 9) + L"\n";
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        WindowFilterRules rules;
+        rules.AddRules(text);
+        auto compileTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+        // A quarter of the windows have a blocked title
+        std::vector<std::wstring> strings;
+        for (uint32_t i = 0; i < WindowCount; i++)
+        {
+            strings.push_back(i % 4 == 0 ? titles[random() % titles.size()] : RandomWord(random, 12));
+            strings.push_back(RandomWord(random, 10));
+            strings.push_back(RandomWord(random, 8) + L".exe");
+        }
+        std::vector<WindowFilterInput> windows;
+        for (uint32_t i = 0; i < WindowCount; i++)
+        {
+            windows.push_back({ strings[i * 3], strings[i * 3 + 1], strings[i * 3 + 2], static_cast<uint32_t>(WS_VISIBLE | WS_CAPTION) });
+        }
+
+        size_t blocked = 0;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t pass = 0; pass < Passes; pass++)
+        {
+            for (auto&& window : windows)
+            {
+                blocked += rules.IsBlocked(window) ? 1 : 0;
+            }
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+
+        printf("%5u rules: compiled in %.2f ms, %.0f ns per window, %zu of %u blocked\n",
+            ruleCount,
+            compileTime.count(),
+            elapsed.count() / (Passes * WindowCount),
+            blocked / Passes,
+            WindowCount);
+    }
+    return 0;
+}
\ No newline at end of file
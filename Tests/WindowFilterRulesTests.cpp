@@ -0,0 +1,257 @@
+#include "pch.h"
+#include "WindowFilterRules.h"
+#include <random>
+
+uint32_t const FuzzIterations = 2000;
+uint32_t const MaxRulesPerSet = 24;
+uint32_t const WindowsPerSet = 64;
+
+bool ExpectBlocked(WindowFilterRules const& rules, WindowFilterInput const& window, bool expected, char const* name)
+{
+    if (rules.IsBlocked(window) != expected)
+    {
+        printf("FAILED: %s should%s be blocked\n", name, expected ? "" : "n't");
+        return false;
+    }
+    return true;
+}
+
+bool TestDefaultRules()
+{
+    WindowFilterRules rules;
+    rules.AddRules(WindowFilterRules::DefaultRules);
+    auto passed = true;
+    passed = ExpectBlocked(rules, { L"Task View", L"Windows.UI.Core.CoreWindow", {} }, true, "task view") && passed;
+    passed = ExpectBlocked(rules, { L"Task View", L"Notepad", {} }, false, "a window titled task view") && passed;
+    passed = ExpectBlocked(rules, { L"PopupHost", L"Xaml_WindowedPopupClass", {} }, true, "a xaml popup") && passed;
+    passed = ExpectBlocked(rules, { L"Untitled", L"Notepad", {}, static_cast<uint32_t>(WS_VISIBLE | WS_DISABLED) }, true, "a disabled window") && passed;
+    passed = ExpectBlocked(rules, { L"Tip", L"tooltips_class32", {}, 0, static_cast<uint32_t>(WS_EX_TOPMOST | WS_EX_TOOLWINDOW) }, true, "a tool window") && passed;
+    passed = ExpectBlocked(rules, { L"Untitled", L"Notepad", {}, static_cast<uint32_t>(WS_VISIBLE | WS_CAPTION) }, false, "notepad") && passed;
+    if (rules.UsesProcessName())
+    {
+        printf("FAILED: the default rules shouldn't need process names\n");
+        passed = false;
+    }
+    return passed;
+}
+
+bool TestMatching()
+{
+    WindowFilterRules rules;
+    rules.AddRules(LR"(
+        block process="notepad*.exe"
+        block title="Secret*"
+        block class=Chrome_* title="*Incognito*"
+        block title="Report ?.txt"
+        block style=WS_POPUP|0x00C00000 exstyle=WS_EX_LAYERED
+    )");
+    auto passed = true;
+    if (rules.RuleCount() != 5 || !rules.UsesProcessName())
+    {
+        printf("FAILED: expected 5 rules that use process names\n");
+        passed = false;
+    }
+    passed = ExpectBlocked(rules, { L"a", L"b", L"NOTEPAD2.EXE" }, true, "a process matched case-insensitively") && passed;
+    passed = ExpectBlocked(rules, { L"a", L"b", L"notepad.txt" }, false, "a process with the wrong extension") && passed;
+    passed = ExpectBlocked(rules, { L"Secret plans", L"b", {} }, true, "a title prefix") && passed;
+    passed = ExpectBlocked(rules, { L"secret plans", L"b", {} }, false, "a title in the wrong case") && passed;
+    passed = ExpectBlocked(rules, { L"New Tab - Incognito", L"Chrome_WidgetWin_1", {} }, true, "a class prefix and a title glob") && passed;
+    passed = ExpectBlocked(rules, { L"New Tab - Incognito", L"MozillaWindowClass", {} }, false, "a title glob with the wrong class") && passed;
+    passed = ExpectBlocked(rules, { L"Report 7.txt", L"b", {} }, true, "a single character wildcard") && passed;
+    passed = ExpectBlocked(rules, { L"Report 17.txt", L"b", {} }, false, "two characters for one wildcard") && passed;
+    passed = ExpectBlocked(rules, { L"a", L"b", {}, static_cast<uint32_t>(WS_POPUP | WS_CAPTION | WS_VISIBLE), static_cast<uint32_t>(WS_EX_LAYERED) }, true, "all of the style flags") && passed;
+    passed = ExpectBlocked(rules, { L"a", L"b", {}, static_cast<uint32_t>(WS_POPUP), static_cast<uint32_t>(WS_EX_LAYERED) }, false, "some of the style flags") && passed;
+    return passed;
+}
+
+bool TestParseErrors()
+{
+    std::wstring_view const invalidRules[] =
+    {
+        L"allow title=a",
+        L"blocktitle=a",
+        L"block",
+        L"block title",
+        L"block title=\"a",
+        L"block color=red",
+        L"block style=WS_EX_TOOLWINDOW",
+        L"block exstyle=WS_POPUP",
+        L"block style=0x",
+        L"block style=0x0x1",
+        L"block style=0x-1",
+        L"block style=0x 1",
+        L"block style=0x123456789",
+        L"block style=0x12g",
+        L"block style=WS_POPUP|",
+    };
+
+    auto passed = true;
+    WindowFilterRules rules;
+    rules.AddRules(L"block title=kept");
+    for (auto&& text : invalidRules)
+    {
+        try
+        {
+            // The good line before the bad one has to be thrown away too
+            rules.AddRules(std::wstring(L"block title=dropped\n") + std::wstring(text));
+            printf("FAILED: '%ls' was accepted\n", std::wstring(text).c_str());
+            passed = false;
+        }
+        catch (winrt::hresult_error const& error)
+        {
+            if (error.code() != E_INVALIDARG || error.message().find(L"line 2") == std::wstring::npos)
+            {
+                printf("FAILED: '%ls' gave the wrong error: %ls\n", std::wstring(text).c_str(), error.message().c_str());
+                passed = false;
+            }
+        }
+    }
+    if (rules.RuleCount() != 1 || !rules.IsBlocked({ L"kept", L"b", {} }) || rules.IsBlocked({ L"dropped", L"b", {} }))
+    {
+        printf("FAILED: a bad line changed the rules that were already there\n");
+        passed = false;
+    }
+
+    rules.AddRules(L"block style=0xF exstyle=0x00000080");
+    passed = ExpectBlocked(rules, { L"a", L"b", {}, 0xFF, static_cast<uint32_t>(WS_EX_TOOLWINDOW) }, true, "hex styles") && passed;
+    return passed;
+}
+
+// A slow, simple definition of what a pattern matches, to check the
+// indexed lookups against
+bool ReferenceGlob(std::wstring_view pattern, std::wstring_view value)
+{
+    if (pattern.empty())
+    {
+        return value.empty();
+    }
+    if (pattern.front() == L'*')
+    {
+        for (size_t skip = 0; skip <= value.size(); skip++)
+        {
+            if (ReferenceGlob(pattern.substr(1), value.substr(skip)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    return !value.empty() && (pattern.front() == L'?' || pattern.front() == value.front()) && ReferenceGlob(pattern.substr(1), value.substr(1));
+}
+
+struct ReferenceRule
+{
+    std::optional<std::wstring> Title;
+    std::optional<std::wstring> ClassName;
+    std::optional<std::wstring> ProcessName;
+    uint32_t Style = 0;
+    uint32_t ExStyle = 0;
+
+    bool Matches(WindowFilterInput const& window) const
+    {
+        auto lower = [](std::wstring_view value)
+        {
+            std::wstring result(value);
+            std::transform(result.begin(), result.end(), result.begin(), [](wchar_t character) { return static_cast<wchar_t>(towlower(character)); });
+            return result;
+        };
+        return (window.Style & Style) == Style &&
+            (window.ExStyle & ExStyle) == ExStyle &&
+            (!Title || ReferenceGlob(*Title, window.Title)) &&
+            (!ClassName || ReferenceGlob(*ClassName, window.ClassName)) &&
+            (!ProcessName || ReferenceGlob(lower(*ProcessName), lower(window.ProcessName)));
+    }
+};
+
+// Patterns and values come from a tiny alphabet so that rules and windows
+// collide often, and every kind of pattern shows up
+bool FuzzRules()
+{
+    std::mt19937 random(7);
+    auto randomString = [&](std::wstring_view alphabet, uint32_t maxLength)
+    {
+        std::wstring result;
+        auto length = random() % (maxLength + 1);
+        for (uint32_t i = 0; i < length; i++)
+        {
+            result += alphabet[random() % alphabet.size()];
+        }
+        return result;
+    };
+    uint32_t const styleBits[] = { 0x1, 0x2, 0x4 };
+
+    for (uint32_t iteration = 0; iteration < FuzzIterations; iteration++)
+    {
+        std::vector<ReferenceRule> referenceRules;
+        std::wstring text;
+        auto ruleCount = 1 + random() % MaxRulesPerSet;
+        for (uint32_t i = 0; i < ruleCount; i++)
+        {
+            ReferenceRule rule;
+            std::wstring line = L"block";
+            while (line == L"block")
+            {
+                if (random() % 2 == 0)
+                {
+                    rule.Title = randomString(L"ab*?", 3);
+                    line += L" title=\"" + *rule.Title + L"\"";
+                }
+                if (random() % 3 == 0)
+                {
+                    rule.ClassName = randomString(L"ab*", 3);
+                    line += L" class=\"" + *rule.ClassName + L"\"";
+                }
+                if (random() % 3 == 0)
+                {
+                    rule.ProcessName = randomString(L"aAb*", 3);
+                    line += L" process=\"" + *rule.ProcessName + L"\"";
+                }
+                if (random() % 4 == 0)
+                {
+                    rule.Style = styleBits[random() % 3] | styleBits[random() % 3];
+                    wchar_t style[16] = {};
+                    swprintf(style, 16, L" style=0x%x", rule.Style);
+                    line += style;
+                }
+            }
+            referenceRules.push_back(rule);
+            text += line + L"\n";
+        }
+
+        // Some sets are added in more than one go
+        WindowFilterRules rules;
+        auto split = text.find(L'\n', random() % text.size());
+        rules.AddRules(std::wstring_view(text).substr(0, split));
+        if (split != std::wstring::npos)
+        {
+            rules.AddRules(std::wstring_view(text).substr(split + 1));
+        }
+
+        for (uint32_t i = 0; i < WindowsPerSet; i++)
+        {
+            auto title = randomString(L"ab", 4);
+            auto className = randomString(L"ab", 3);
+            auto processName = randomString(L"aAb", 3);
+            WindowFilterInput window{ title, className, processName, static_cast<uint32_t>(random() % 8) };
+            auto expected = std::any_of(referenceRules.begin(), referenceRules.end(), [&](auto&& rule) { return rule.Matches(window); });
+            if (rules.IsBlocked(window) != expected)
+            {
+                printf("FAILED: title '%ls' class '%ls' process '%ls' style %u should%s be blocked by:\n%ls",
+                    title.c_str(), className.c_str(), processName.c_str(), window.Style, expected ? "" : "n't", text.c_str());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    auto passed = true;
+    passed = TestDefaultRules() && passed;
+    passed = TestMatching() && passed;
+    passed = TestParseErrors() && passed;
+    passed = FuzzRules() && passed;
+    printf(passed ? "All window filter rules tests passed\n" : "Some window filter rules tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
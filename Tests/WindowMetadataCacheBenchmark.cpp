@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "WindowMetadataCache.h"
+#include "FakeWindowSystem.h"
+#include <random>
+
+// A burst of window hook events like the ones WindowList handles, with and
+// without the cache. Each query to the fake spins for a while, as a stand-in
+// for a call into the window manager.
+uint32_t const WindowCount = 500;
+uint32_t const EventCount = 50000;
+auto const QueryCost = std::chrono::microseconds(2);
+
+enum class Event
+{
+    Show,
+    NameChange,
+    Destroy,
+};
+
+void Spin()
+{
+    auto end = std::chrono::steady_clock::now() + QueryCost;
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+}
+
+int main()
+{
+    FakeWindowSystem system;
+    std::vector<HWND> windows;
+    for (uint32_t i = 0; i < WindowCount; i++)
+    {
+        windows.push_back(system.Create({ L"Window " + std::to_wstring(i), L"Class" + std::to_wstring(i % 20), L"app" + std::to_wstring(i % 50) + L".exe" }));
+    }
+    auto fakeQueries = system.Queries();
+    WindowQueries queries =
+    {
+        [&](HWND handle) { Spin(); return fakeQueries.Title(handle); },
+        [&](HWND handle) { Spin(); return fakeQueries.ClassName(handle); },
+        [&](HWND handle) { Spin(); return fakeQueries.ProcessName(handle); },
+    };
+
+    // Mostly shows and uncloaks, which come in several at a time for the
+    // same window, some renames and a few windows closing
+    std::mt19937 random(23);
+    std::vector<std::pair<Event, HWND>> events;
+    for (uint32_t i = 0; i < EventCount; i++)
+    {
+        auto kind = random() % 100;
+        auto event = kind < 80 ? Event::Show : (kind < 98 ? Event::NameChange : Event::Destroy);
+        events.push_back({ event, windows[random() % WindowCount] });
+    }
+
+    auto run = [&](auto&& handleEvent)
+    {
+        system.TitleQueries = 0;
+        system.ClassNameQueries = 0;
+        system.ProcessNameQueries = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto&& [event, handle] : events)
+        {
+            handleEvent(event, handle);
+        }
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+        printf("%.2f us per event, %.2f queries per event\n",
+            elapsed.count() / EventCount,
+            static_cast<double>(system.TitleQueries + system.ClassNameQueries + system.ProcessNameQueries) / EventCount);
+    };
+
+    // Every event queries the window again, with rules that need the
+    // process name
+    printf("Uncached: ");
+    run([&](Event event, HWND handle)
+    {
+        if (event != Event::Destroy)
+        {
+            queries.Title(handle);
+            queries.ClassName(handle);
+            queries.ProcessName(handle);
+        }
+    });
+
+    WindowMetadataCache cache(queries);
+    printf("Cached:   ");
+    run([&](Event event, HWND handle)
+    {
+        switch (event)
+        {
+        case Event::Show:
+            cache.Get(handle);
+            cache.GetProcessName(handle);
+            break;
+        case Event::NameChange:
+            cache.RefreshTitle(handle);
+            cache.Get(handle);
+            break;
+        case Event::Destroy:
+            cache.Remove(handle);
+            break;
+        }
+    });
+    return 0;
+}
\ No newline at end of file
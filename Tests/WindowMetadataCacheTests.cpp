@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "WindowMetadataCache.h"
+#include "FakeWindowSystem.h"
+
+// Enough classes to make the interned set rehash a few times
+uint32_t const ManyClassNames = 5000;
+
+bool TestQueriesOnce()
+{
+    FakeWindowSystem system;
+    WindowMetadataCache cache(system.Queries());
+    auto notepad = system.Create({ L"Untitled - Notepad", L"Notepad", L"notepad.exe" });
+
+    // Show, uncloak and focus events for the same window
+    for (auto i = 0; i < 3; i++)
+    {
+        auto& metadata = cache.Get(notepad);
+        if (metadata.Title != L"Untitled - Notepad" || *metadata.ClassName != L"Notepad")
+        {
+            printf("FAILED: wrong metadata for a window\n");
+            return false;
+        }
+    }
+    if (system.TitleQueries != 1 || system.ClassNameQueries != 1 || system.ProcessNameQueries != 0)
+    {
+        printf("FAILED: expected one title and class name query and no process query, got %zu, %zu and %zu\n",
+            system.TitleQueries, system.ClassNameQueries, system.ProcessNameQueries);
+        return false;
+    }
+
+    // The process name is only looked up when a rule needs it, and then once
+    if (cache.GetProcessName(notepad) != L"notepad.exe" || cache.GetProcessName(notepad) != L"notepad.exe" || system.ProcessNameQueries != 1)
+    {
+        printf("FAILED: the process name should be queried once, got %zu\n", system.ProcessNameQueries);
+        return false;
+    }
+    return true;
+}
+
+bool TestNameChange()
+{
+    FakeWindowSystem system;
+    WindowMetadataCache cache(system.Queries());
+    auto editor = system.Create({ L"a.txt", L"Editor", L"editor.exe" });
+    cache.GetProcessName(editor);
+
+    system.Rename(editor, L"b.txt");
+    if (cache.Get(editor).Title != L"a.txt")
+    {
+        printf("FAILED: the title shouldn't change until the name change event\n");
+        return false;
+    }
+    cache.RefreshTitle(editor);
+    if (cache.Get(editor).Title != L"b.txt")
+    {
+        printf("FAILED: refreshing should pick up the new title\n");
+        return false;
+    }
+    // A rename doesn't change the class or the process
+    if (system.TitleQueries != 2 || system.ClassNameQueries != 1 || system.ProcessNameQueries != 1)
+    {
+        printf("FAILED: refreshing should only query the title\n");
+        return false;
+    }
+
+    // Name changes come in for windows we never looked at, those are
+    // queried when they're first needed instead
+    auto other = system.Create({ L"c.txt", L"Editor", L"editor.exe" });
+    cache.RefreshTitle(other);
+    if (system.TitleQueries != 2)
+    {
+        printf("FAILED: refreshing a window that isn't cached shouldn't query it\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestRemove()
+{
+    FakeWindowSystem system;
+    WindowMetadataCache cache(system.Queries());
+    auto window = system.Create({ L"Old", L"OldClass", L"old.exe" });
+    cache.GetProcessName(window);
+
+    // The handle is reused by a new window after the old one is destroyed
+    cache.Remove(window);
+    system.Recreate(window, { L"New", L"NewClass", L"new.exe" });
+    auto& metadata = cache.Get(window);
+    if (metadata.Title != L"New" || *metadata.ClassName != L"NewClass" || cache.GetProcessName(window) != L"new.exe")
+    {
+        printf("FAILED: a reused handle kept the destroyed window's metadata\n");
+        return false;
+    }
+    cache.Remove(window);
+    cache.Remove(window);
+    return true;
+}
+
+bool TestInterning()
+{
+    FakeWindowSystem system;
+    WindowMetadataCache cache(system.Queries());
+    auto first = system.Create({ L"One", L"Chrome_WidgetWin_1", L"a.exe" });
+    auto second = system.Create({ L"Two", L"Chrome_WidgetWin_1", L"b.exe" });
+    auto coreWindow = cache.InternClassName(L"Chrome_WidgetWin_1");
+    if (cache.Get(first).ClassName != coreWindow || cache.Get(second).ClassName != coreWindow)
+    {
+        printf("FAILED: windows of the same class should share the interned name\n");
+        return false;
+    }
+
+    // Pointers have to survive the set growing
+    for (uint32_t i = 0; i < ManyClassNames; i++)
+    {
+        cache.InternClassName(L"Class" + std::to_wstring(i));
+    }
+    if (cache.InternClassName(L"Chrome_WidgetWin_1") != coreWindow || *coreWindow != L"Chrome_WidgetWin_1")
+    {
+        printf("FAILED: an interned name moved\n");
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    auto passed = true;
+    passed = TestQueriesOnce() && passed;
+    passed = TestNameChange() && passed;
+    passed = TestRemove() && passed;
+    passed = TestInterning() && passed;
+    printf(passed ? "All window metadata cache tests passed\n" : "Some window metadata cache tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
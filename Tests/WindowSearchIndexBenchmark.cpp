@@ -0,0 +1,64 @@
+#include "pch.h"
+#include "WindowSearchIndex.h"
+#include <random>
+
+// Typing queries one character at a time over a large number of windows,
+// each keystroke being a search like the window list does
+uint32_t const WindowCount = 10000;
+uint32_t const Repeats = 20;
+std::wstring_view const Words[] =
+{
+    L"Visual", L"Studio", L"Code", L"Notepad", L"Untitled", L"Document", L"Mail", L"Inbox", L"Calendar",
+    L"Terminal", L"PowerShell", L"Settings", L"Explorer", L"Downloads", L"Report", L"Budget", L"Meeting",
+    L"Chat", L"Photos", L"Player", L"Browser", L"New", L"Tab", L"Project", L"Solution", L"Debug",
+};
+std::wstring_view const ClassNames[] =
+{
+    L"Chrome_WidgetWin_1", L"Notepad", L"CabinetWClass", L"ApplicationFrameWindow", L"ConsoleWindowClass",
+    L"MozillaWindowClass", L"HwndWrapper[DefaultDomain;;]", L"Windows.UI.Core.CoreWindow",
+};
+
+int main()
+{
+    std::mt19937 random(17);
+    WindowSearchIndex index;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < WindowCount; i++)
+    {
+        std::wstring title;
+        auto wordCount = 2 + random() % 4;
+        for (uint32_t word = 0; word < wordCount; word++)
+        {
+            title += std::wstring(Words[random() % std::size(Words)]) + (word == 0 ? L" - " : L" ");
+        }
+        title += std::to_wstring(i);
+        index.Add(reinterpret_cast<HWND>(static_cast<uintptr_t>(i + 1)), title, ClassNames[random() % std::size(ClassNames)]);
+    }
+    auto addTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    printf("Added %u windows in %.2f ms\n", WindowCount, addTime.count());
+
+    for (std::wstring_view query : { L"vscode", L"budget report", L"zzz", L"chrome" })
+    {
+        std::vector<double> keystrokeTimes(query.size(), 0.0);
+        size_t matches = 0;
+        for (uint32_t repeat = 0; repeat < Repeats; repeat++)
+        {
+            // Start over each time so the first keystroke searches everything
+            index.Search(L"");
+            for (size_t length = 1; length <= query.size(); length++)
+            {
+                auto keystrokeStart = std::chrono::steady_clock::now();
+                matches = index.Search(query.substr(0, length)).size();
+                keystrokeTimes[length - 1] += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - keystrokeStart).count();
+            }
+        }
+
+        printf("'%ls': %zu matches, us per keystroke:", std::wstring(query).c_str(), matches);
+        for (auto&& time : keystrokeTimes)
+        {
+            printf(" %.0f", time / Repeats);
+        }
+        printf("\n");
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "pch.h"
+#include "WindowSearchIndex.h"
+#include <random>
+
+uint32_t const FuzzOperations = 20000;
+uint32_t const FuzzWindows = 40;
+
+HWND MakeHandle(uintptr_t value)
+{
+    return reinterpret_cast<HWND>(value);
+}
+
+bool ExpectResults(WindowSearchIndex& index, std::wstring_view query, std::vector<uintptr_t> const& expected)
+{
+    auto results = index.Search(query);
+    std::vector<uintptr_t> values;
+    for (auto&& result : results)
+    {
+        values.push_back(reinterpret_cast<uintptr_t>(result));
+    }
+    if (values != expected)
+    {
+        printf("FAILED: '%ls' gave", std::wstring(query).c_str());
+        for (auto&& value : values)
+        {
+            printf(" %zu", static_cast<size_t>(value));
+        }
+        printf(", expected");
+        for (auto&& value : expected)
+        {
+            printf(" %zu", static_cast<size_t>(value));
+        }
+        printf("\n");
+        return false;
+    }
+    return true;
+}
+
+bool TestMatching()
+{
+    WindowSearchIndex index;
+    index.Add(MakeHandle(1), L"Visual Studio Code", L"Chrome_WidgetWin_1");
+    index.Add(MakeHandle(2), L"Untitled - Notepad", L"Notepad");
+    index.Add(MakeHandle(3), L"Calculator", L"ApplicationFrameWindow");
+    index.Add(MakeHandle(4), L"", L"Shell_TrayWnd");
+
+    auto passed = true;
+    passed = ExpectResults(index, L"", { 1, 2, 3, 4 }) && passed;
+    passed = ExpectResults(index, L"vsc", { 1 }) && passed;
+    passed = ExpectResults(index, L"NOTEPAD", { 2 }) && passed;
+    passed = ExpectResults(index, L"tray", { 4 }) && passed;
+    passed = ExpectResults(index, L"xyz", {}) && passed;
+    // In order only
+    passed = ExpectResults(index, L"csv", {}) && passed;
+    if (!index.Matches(MakeHandle(3), L"calc") || index.Matches(MakeHandle(3), L"note") || index.Matches(MakeHandle(5), L""))
+    {
+        printf("FAILED: Matches disagrees with Search\n");
+        passed = false;
+    }
+    return passed;
+}
+
+bool TestRanking()
+{
+    WindowSearchIndex index;
+    // Scattered letters, then word starts, then a substring, then a prefix
+    index.Add(MakeHandle(1), L"Summary of Plans", L"a");
+    index.Add(MakeHandle(2), L"Most Annoying Popup", L"a");
+    index.Add(MakeHandle(3), L"Bitmap", L"a");
+    index.Add(MakeHandle(4), L"Maps", L"a");
+    auto passed = ExpectResults(index, L"map", { 4, 3, 2, 1 });
+
+    // The same text in the title beats it in the class name, and ties keep
+    // the order the windows were added in
+    WindowSearchIndex ties;
+    ties.Add(MakeHandle(1), L"Other", L"Terminal");
+    ties.Add(MakeHandle(2), L"Terminal", L"Other");
+    ties.Add(MakeHandle(3), L"Terminal", L"Other");
+    passed = ExpectResults(ties, L"term", { 2, 3, 1 }) && passed;
+    return passed;
+}
+
+bool TestChanges()
+{
+    WindowSearchIndex index;
+    index.Add(MakeHandle(1), L"Inbox - Mail", L"a");
+    index.Add(MakeHandle(2), L"Calendar", L"a");
+    auto passed = ExpectResults(index, L"in", { 1 });
+
+    // Typing more only searches the last matches, so changes in between
+    // have to be seen
+    index.Update(MakeHandle(2), L"Invitation", L"a");
+    passed = ExpectResults(index, L"inv", { 2 }) && passed;
+    index.Remove(MakeHandle(2));
+    passed = ExpectResults(index, L"invi", {}) && passed;
+    index.Add(MakeHandle(3), L"Invoice.pdf", L"a");
+    passed = ExpectResults(index, L"invo", { 3 }) && passed;
+
+    // Adding a window twice updates it and keeps its place
+    index.Add(MakeHandle(1), L"Sent - Mail", L"a");
+    passed = ExpectResults(index, L"", { 1, 3 }) && passed;
+    passed = ExpectResults(index, L"sent", { 1 }) && passed;
+    index.Remove(MakeHandle(42));
+    index.Update(MakeHandle(42), L"Nothing", L"a");
+    passed = ExpectResults(index, L"", { 1, 3 }) && passed;
+    return passed;
+}
+
+// Random edits and searches, mostly typing and deleting characters, checked
+// against an index that's rebuilt from scratch for every search and so
+// never reuses a previous search
+bool FuzzSearches()
+{
+    std::mt19937 random(5);
+    std::wstring_view const alphabet = L"abcAB -";
+    auto randomString = [&](uint32_t maxLength)
+    {
+        std::wstring result;
+        auto length = random() % (maxLength + 1);
+        for (uint32_t i = 0; i < length; i++)
+        {
+            result += alphabet[random() % alphabet.size()];
+        }
+        return result;
+    };
+
+    struct Window
+    {
+        uintptr_t Handle;
+        std::wstring Title;
+        std::wstring ClassName;
+    };
+    // In the order they were added
+    std::vector<Window> windows;
+    WindowSearchIndex index;
+    std::wstring query;
+    for (uint32_t operation = 0; operation < FuzzOperations; operation++)
+    {
+        auto handle = 1 + random() % FuzzWindows;
+        auto existing = std::find_if(windows.begin(), windows.end(), [&](auto&& window) { return window.Handle == handle; });
+        auto kind = random() % 8;
+        switch (kind)
+        {
+        case 0:
+        {
+            auto title = randomString(8);
+            auto className = randomString(4);
+            index.Add(MakeHandle(handle), title, className);
+            if (existing == windows.end())
+            {
+                windows.push_back({ handle, title, className });
+            }
+            else
+            {
+                *existing = { handle, title, className };
+            }
+            break;
+        }
+        case 1:
+            index.Remove(MakeHandle(handle));
+            if (existing != windows.end())
+            {
+                windows.erase(existing);
+            }
+            break;
+        case 2:
+        {
+            auto title = randomString(8);
+            index.Update(MakeHandle(handle), title, L"b");
+            if (existing != windows.end())
+            {
+                *existing = { handle, title, L"b" };
+            }
+            break;
+        }
+        case 3:
+            query.clear();
+            break;
+        case 4:
+            if (!query.empty())
+            {
+                query.pop_back();
+            }
+            break;
+        default:
+            query += alphabet[random() % alphabet.size()];
+            break;
+        }
+
+        // Edits aren't followed by a search, so the next one can reuse the
+        // matches from before them
+        if (kind < 3)
+        {
+            continue;
+        }
+        WindowSearchIndex reference;
+        for (auto&& window : windows)
+        {
+            reference.Add(MakeHandle(window.Handle), window.Title, window.ClassName);
+        }
+        if (index.Search(query) != reference.Search(query))
+        {
+            printf("FAILED: searching for '%ls' after %u operations didn't match a fresh index\n", query.c_str(), operation);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    auto passed = true;
+    passed = TestMatching() && passed;
+    passed = TestRanking() && passed;
+    passed = TestChanges() && passed;
+    passed = FuzzSearches() && passed;
+    printf(passed ? "All window search index tests passed\n" : "Some window search index tests failed\n");
+    return passed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+// Stands in for the app's precompiled header when building the portable
+// classes on their own
+
+// STL
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <optional>
+#include <future>
+#include <mutex>
+#include <filesystem>
+#include <fstream>
+#include <execution>
+#include <span>
+#include <bit>
+#include <array>
+#include <numeric>
+#include <deque>
+#include <queue>
+#include <map>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <cwctype>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <winrt/base.h>
+#else
+typedef long LONG;
+// Only ever used as a key
+struct HWND__;
+typedef HWND__* HWND;
+struct RECT
+{
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+};
+struct POINT
+{
+    LONG x;
+    LONG y;
+};
+
+// Window styles, with the values from WinUser.h
+#define WS_POPUP 0x80000000L
+#define WS_CHILD 0x40000000L
+#define WS_MINIMIZE 0x20000000L
+#define WS_VISIBLE 0x10000000L
+#define WS_DISABLED 0x08000000L
+#define WS_MAXIMIZE 0x01000000L
+#define WS_CAPTION 0x00C00000L
+#define WS_EX_TOPMOST 0x00000008L
+#define WS_EX_TRANSPARENT 0x00000020L
+#define WS_EX_TOOLWINDOW 0x00000080L
+#define WS_EX_APPWINDOW 0x00040000L
+#define WS_EX_LAYERED 0x00080000L
+#define WS_EX_NOREDIRECTIONBITMAP 0x00200000L
+#define WS_EX_NOACTIVATE 0x08000000L
+
+// The portable classes report bad arguments the same way as the rest of
+// the app and some name their formats with a guid, this is just enough of
+// C++/WinRT for that
+typedef int32_t HRESULT;
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+namespace winrt
+{
+    // Only used to name formats, never compared or passed to the system
+    struct guid
+    {
+        uint32_t Data1;
+        uint16_t Data2;
+        uint16_t Data3;
+        uint8_t Data4[8];
+    };
+
+    struct hresult_error : std::runtime_error
+    {
+        hresult_error(HRESULT code, std::wstring const& message) : std::runtime_error("hresult_error"), m_code(code), m_message(message) {}
+        HRESULT code() const { return m_code; }
+        std::wstring message() const { return m_message; }
+
+    private:
+        HRESULT m_code;
+        std::wstring m_message;
+    };
+}
+#endif
\ No newline at end of file
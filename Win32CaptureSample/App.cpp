@@ -1,6 +1,13 @@
 #include "pch.h"
 #include "App.h"
 #include "CaptureSnapshot.h"
+#include "ScreenTileCodec.h"
+#include "ExrWriter.h"
+#include "SyncedCapture.h"
+#include "ImageComparer.h"
+#include "CpuFrameReader.h"
+#include "MonitorList.h"
+#include "WindowList.h"
 
 namespace winrt
 {
@@ -23,6 +30,17 @@ namespace util
     using namespace robmikh::common::uwp;
 }
 
+// The capture API can't give us HDR10 frames, so we capture in FP16 and
+// convert when saving.
+winrt::DirectXPixelFormat GetCapturePixelFormat(winrt::DirectXPixelFormat pixelFormat)
+{
+    if (pixelFormat == winrt::DirectXPixelFormat::R10G10B10A2UIntNormalized)
+    {
+        return winrt::DirectXPixelFormat::R16G16B16A16Float;
+    }
+    return pixelFormat;
+}
+
 App::App(winrt::ContainerVisual root)
 {
     m_mainThread = winrt::DispatcherQueue::GetForCurrentThread();
@@ -50,8 +68,14 @@ App::App(winrt::ContainerVisual root)
     m_root.Children().InsertAtTop(m_content);
 
     auto d3dDevice = util::CreateD3D11Device();
+    // Snapshots read the capture's latest frame from the UI thread while
+    // the frame pool's thread is still using the immediate context.
+    winrt::com_ptr<ID3D11DeviceContext> d3dContext;
+    d3dDevice->GetImmediateContext(d3dContext.put());
+    d3dContext.as<ID3D11Multithread>()->SetMultithreadProtected(TRUE);
     auto dxgiDevice = d3dDevice.as<IDXGIDevice>();
     m_device = CreateDirect3DDevice(dxgiDevice.get());
+    m_snapshotEncoder = std::make_shared<SnapshotEncoder>();
 
     // Don't bother with a D2D device if we can't use dirty regions
     if (winrt::ApiInformation::IsPropertyPresent(winrt::name_of<winrt::GraphicsCaptureSession>(), L"DirtyRegionMode"))
@@ -84,7 +108,9 @@ winrt::GraphicsCaptureItem App::TryStartCaptureFromMonitorHandle(HMONITOR hmon)
     try
     {
         item = util::CreateCaptureItemForMonitor(hmon);
+        auto displayName = MonitorInfo(hmon).DisplayName;
         StartCaptureFromItem(item);
+        m_capturedDisplayName = displayName;
     }
     catch (winrt::hresult_error const& error)
     {
@@ -111,13 +137,18 @@ winrt::IAsyncOperation<winrt::GraphicsCaptureItem> App::StartCaptureWithPickerAs
         // requirement. See the README if you're unsure of which version of 'Create' to use.
         co_await wil::resume_foreground(m_mainThread);
         StartCaptureFromItem(item);
+        m_capturedItemFromPicker = true;
     }
 
     co_return item;
 }
 
-winrt::IAsyncOperation<winrt::StorageFile> App::TakeSnapshotAsync()
+winrt::IAsyncOperationWithProgress<winrt::StorageFile, double> App::TakeSnapshotAsync()
 {
+    auto cancellation = co_await winrt::get_cancellation_token();
+    cancellation.enable_propagation();
+    auto progress = co_await winrt::get_progress_token();
+
     // Use what we're currently capturing
     if (m_capture == nullptr)
     {
@@ -135,6 +166,8 @@ winrt::IAsyncOperation<winrt::StorageFile> App::TakeSnapshotAsync()
     savePicker.FileTypeChoices().Insert(L"PNG image", winrt::single_threaded_vector<winrt::hstring>({ L".png" }));
     savePicker.FileTypeChoices().Insert(L"JPG image", winrt::single_threaded_vector<winrt::hstring>({ L".jpg" }));
     savePicker.FileTypeChoices().Insert(L"JXR image", winrt::single_threaded_vector<winrt::hstring>({ L".jxr" }));
+    savePicker.FileTypeChoices().Insert(L"OpenEXR image", winrt::single_threaded_vector<winrt::hstring>({ L".exr" }));
+    savePicker.FileTypeChoices().Insert(L"Screen tile image", winrt::single_threaded_vector<winrt::hstring>({ L".stc" }));
     auto file = co_await savePicker.PickSaveFileAsync();
     if (file == nullptr)
     {
@@ -146,7 +179,14 @@ winrt::IAsyncOperation<winrt::StorageFile> App::TakeSnapshotAsync()
     winrt::guid fileFormatGuid = {};
     winrt::guid bitmapPixelFormat = {};
     winrt::DirectXPixelFormat pixelFormat;
-    if (fileExtension == L".png")
+    if (fileExtension == L".png" && m_pixelFormat == winrt::DirectXPixelFormat::R10G10B10A2UIntNormalized)
+    {
+        // SnapshotEncoder takes this to mean a PQ tagged PNG
+        fileFormatGuid = GUID_ContainerFormatPng;
+        bitmapPixelFormat = GUID_WICPixelFormat32bppRGBA1010102;
+        pixelFormat = winrt::DirectXPixelFormat::R16G16B16A16Float;
+    }
+    else if (fileExtension == L".png")
     {
         fileFormatGuid = GUID_ContainerFormatPng;
         bitmapPixelFormat = GUID_WICPixelFormat32bppBGRA;
@@ -164,6 +204,18 @@ winrt::IAsyncOperation<winrt::StorageFile> App::TakeSnapshotAsync()
         bitmapPixelFormat = GUID_WICPixelFormat64bppRGBAHalf;
         pixelFormat = winrt::DirectXPixelFormat::R16G16B16A16Float;
     }
+    else if (fileExtension == L".exr")
+    {
+        fileFormatGuid = ExrWriter::ContainerFormat;
+        bitmapPixelFormat = GUID_WICPixelFormat64bppRGBAHalf;
+        pixelFormat = winrt::DirectXPixelFormat::R16G16B16A16Float;
+    }
+    else if (fileExtension == L".stc")
+    {
+        fileFormatGuid = ScreenTileCodec::ContainerFormat;
+        bitmapPixelFormat = GUID_WICPixelFormat32bppBGRA;
+        pixelFormat = winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized;
+    }
     else
     {
         // Unsupported
@@ -175,79 +227,425 @@ winrt::IAsyncOperation<winrt::StorageFile> App::TakeSnapshotAsync()
         co_return nullptr;
     }
 
-    // Ensure WIC
-    if (!m_wicFactory)
+    // Take the snapshot. If we're still capturing the same item and already
+    // have a frame in the right format, there's no need to start another
+    // capture session and wait for it to produce a frame.
+    winrt::com_ptr<ID3D11Texture2D> texture;
+    if (m_capture != nullptr && m_capture->CaptureItem() == item)
     {
-        m_wicFactory = util::CreateWICFactory();
+        texture = m_capture->TryGetLatestFrame(pixelFormat);
+    }
+    if (texture == nullptr)
+    {
+        texture = co_await CaptureSnapshot::TakeAsync(m_device, item, pixelFormat);
     }
 
-    // Take the snapshot
-    auto texture = co_await CaptureSnapshot::TakeAsync(m_device, item, pixelFormat);
+    // Encoding happens on the thread pool, we only come back here once it's done
+    auto encode = m_snapshotEncoder->EncodeAsync(texture, file, fileFormatGuid, bitmapPixelFormat);
+    encode.Progress([&progress](auto&&, double value)
+    {
+        progress(value);
+    });
+    co_await encode;
 
+    co_return file;
+}
+
+winrt::IAsyncOperation<winrt::StorageFile> App::CompareToGoldenAsync()
+{
+    if (m_capture == nullptr)
+    {
+        co_return nullptr;
+    }
+    auto item = m_capture->CaptureItem();
+
+    // Grab the frame now, this is the moment the user cares about
+    winrt::com_ptr<ID3D11Texture2D> texture = m_capture->TryGetLatestFrame(winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized);
+    if (texture == nullptr)
+    {
+        texture = co_await CaptureSnapshot::TakeAsync(m_device, item, winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized);
+    }
+
+    // Goldens have to be lossless
+    auto openPicker = winrt::FileOpenPicker();
+    InitializeObjectWithWindowHandle(openPicker);
+    openPicker.SuggestedStartLocation(winrt::PickerLocationId::PicturesLibrary);
+    openPicker.FileTypeFilter().Append(L".png");
+    openPicker.FileTypeFilter().Append(L".bmp");
+    auto goldenFile = co_await openPicker.PickSingleFileAsync();
+    if (goldenFile == nullptr)
+    {
+        co_return nullptr;
+    }
+
+    co_await winrt::resume_background();
+    auto stream = co_await goldenFile.OpenReadAsync();
+    auto decoder = co_await winrt::BitmapDecoder::CreateAsync(stream);
+    auto goldenPixelData = co_await decoder.GetPixelDataAsync(
+        winrt::BitmapPixelFormat::Bgra8,
+        winrt::BitmapAlphaMode::Straight,
+        winrt::BitmapTransform(),
+        winrt::ExifOrientationMode::IgnoreExifOrientation,
+        winrt::ColorManagementMode::DoNotColorManage);
+    auto goldenPixels = goldenPixelData.DetachPixelData();
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    texture->GetDesc(&desc);
+    if (decoder.PixelWidth() != desc.Width || decoder.PixelHeight() != desc.Height)
+    {
+        co_await wil::resume_foreground(m_mainThread);
+        MessageBoxW(m_mainWindow,
+            L"The capture isn't the same size as the golden image!",
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+        co_return nullptr;
+    }
+
+    winrt::com_ptr<ID3D11Device> d3dDevice;
+    texture->GetDevice(d3dDevice.put());
+    std::vector<uint8_t> pixels;
+    CpuFrameReader(d3dDevice).Read(texture, desc.Width, desc.Height, pixels);
+    auto stride = desc.Width * 4;
+    ImageComparer comparer;
+    auto result = comparer.Compare(goldenPixels.data(), stride, pixels.data(), stride, desc.Width, desc.Height);
+
+    co_await wil::resume_foreground(m_mainThread);
+    if (result.Matches)
+    {
+        MessageBoxW(m_mainWindow,
+            L"The capture matches the golden image.",
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONINFORMATION);
+        co_return nullptr;
+    }
+
+    auto bounds = result.DiffRects.front();
+    for (auto&& rect : result.DiffRects)
+    {
+        UnionRect(&bounds, &bounds, &rect);
+    }
+    wchar_t message[512] = {};
+    swprintf_s(message, L"%llu pixels differ from the golden image, in %zu areas between (%ld, %ld) and (%ld, %ld). Another %llu only differ in anti-aliasing.\n\nSave an image of the differences?",
+        result.DifferentPixels, result.DiffRects.size(), bounds.left, bounds.top, bounds.right, bounds.bottom, result.AntiAliasedPixels);
+    if (MessageBoxW(m_mainWindow, message, L"Win32CaptureSample", MB_YESNO | MB_ICONWARNING) != IDYES)
+    {
+        co_return nullptr;
+    }
+
+    auto savePicker = winrt::FileSavePicker();
+    InitializeObjectWithWindowHandle(savePicker);
+    savePicker.SuggestedStartLocation(winrt::PickerLocationId::PicturesLibrary);
+    savePicker.SuggestedFileName(L"diff");
+    savePicker.DefaultFileExtension(L".png");
+    savePicker.FileTypeChoices().Clear();
+    savePicker.FileTypeChoices().Insert(L"PNG image", winrt::single_threaded_vector<winrt::hstring>({ L".png" }));
+    auto file = co_await savePicker.PickSaveFileAsync();
+    if (file == nullptr)
+    {
+        co_return nullptr;
+    }
+
+    // The encoder reads staging textures as they are
+    auto diffDesc = desc;
+    diffDesc.MipLevels = 1;
+    diffDesc.ArraySize = 1;
+    diffDesc.SampleDesc.Count = 1;
+    diffDesc.SampleDesc.Quality = 0;
+    diffDesc.Usage = D3D11_USAGE_STAGING;
+    diffDesc.BindFlags = 0;
+    diffDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    diffDesc.MiscFlags = 0;
+    D3D11_SUBRESOURCE_DATA diffData = {};
+    diffData.pSysMem = result.DiffImage.data();
+    diffData.SysMemPitch = stride;
+    winrt::com_ptr<ID3D11Texture2D> diffTexture;
+    winrt::check_hresult(d3dDevice->CreateTexture2D(&diffDesc, &diffData, diffTexture.put()));
+    co_await m_snapshotEncoder->EncodeAsync(diffTexture, file, GUID_ContainerFormatPng, GUID_WICPixelFormat32bppBGRA);
+
+    co_return file;
+}
+
+winrt::IAsyncOperation<winrt::StorageFile> App::SaveReplayAsync()
+{
+    if (m_capture == nullptr)
+    {
+        co_return nullptr;
+    }
+
+    // Grab the frames now, this is the moment the user cares about. The
+    // capture keeps going while we wait on the picker.
+    auto frames = m_capture->ReplayFrames();
+    if (frames.empty())
+    {
+        MessageBoxW(m_mainWindow,
+            L"The replay buffer is empty! Only BGRA8 captures are kept.",
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+        co_return nullptr;
+    }
+
+    auto savePicker = winrt::FileSavePicker();
+    InitializeObjectWithWindowHandle(savePicker);
+    savePicker.SuggestedStartLocation(winrt::PickerLocationId::PicturesLibrary);
+    savePicker.SuggestedFileName(L"replay");
+    savePicker.DefaultFileExtension(L".stcr");
+    savePicker.FileTypeChoices().Clear();
+    savePicker.FileTypeChoices().Insert(L"Screen tile replay", winrt::single_threaded_vector<winrt::hstring>({ L".stcr" }));
+    auto file = co_await savePicker.PickSaveFileAsync();
+    if (file == nullptr)
+    {
+        co_return nullptr;
+    }
+
+    co_await winrt::resume_background();
+    // Frames are only captured when something changes, and not always on
+    // time. Tools that play this back expect a constant frame rate, so it's
+    // written out at the default 60fps.
+    auto bytes = ReplayBuffer::SerializePaced(frames, FramePacerSettings{});
     {
-        // Get the file stream
         auto randomAccessStream = co_await file.OpenAsync(winrt::FileAccessMode::ReadWrite);
+        randomAccessStream.Size(0);
         auto streamUnknown = randomAccessStream.as<IUnknown>();
         winrt::com_ptr<IStream> stream;
         winrt::check_hresult(CreateStreamOverRandomAccessStream(streamUnknown.get(), winrt::guid_of<IStream>(), stream.put_void()));
+        winrt::check_hresult(stream->Write(bytes.data(), static_cast<ULONG>(bytes.size()), nullptr));
+    }
+
+    co_return file;
+}
+
+winrt::IAsyncOperation<winrt::StorageFile> App::SaveRepaintReportAsync()
+{
+    if (m_capture == nullptr)
+    {
+        co_return nullptr;
+    }
+
+    auto hotspots = m_capture->RepaintHotspots();
+    if (hotspots.empty())
+    {
+        MessageBoxW(m_mainWindow,
+            L"Nothing has been repainting at least once a second!",
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONINFORMATION);
+        co_return nullptr;
+    }
+
+    auto savePicker = winrt::FileSavePicker();
+    InitializeObjectWithWindowHandle(savePicker);
+    savePicker.SuggestedStartLocation(winrt::PickerLocationId::DocumentsLibrary);
+    savePicker.SuggestedFileName(L"repaints");
+    savePicker.DefaultFileExtension(L".csv");
+    savePicker.FileTypeChoices().Clear();
+    savePicker.FileTypeChoices().Insert(L"CSV", winrt::single_threaded_vector<winrt::hstring>({ L".csv" }));
+    auto file = co_await savePicker.PickSaveFileAsync();
+    if (file == nullptr)
+    {
+        co_return nullptr;
+    }
+
+    // Busiest first, rates are repaints per second
+    std::wstring report = L"left,top,right,bottom,cells,peak_rate,mean_rate,pixels_per_second\r\n";
+    for (auto&& hotspot : hotspots)
+    {
+        wchar_t line[256] = {};
+        swprintf_s(line, L"%ld,%ld,%ld,%ld,%u,%.2f,%.2f,%.0f\r\n",
+            hotspot.Bounds.left, hotspot.Bounds.top, hotspot.Bounds.right, hotspot.Bounds.bottom,
+            hotspot.Cells, hotspot.PeakRate, hotspot.MeanRate, hotspot.PixelsPerSecond);
+        report += line;
+    }
+    co_await winrt::FileIO::WriteTextAsync(file, report);
+
+    co_return file;
+}
+
+winrt::IAsyncOperation<winrt::StorageFolder> App::SaveWindowSetAsync(std::vector<HWND> windows)
+{
+    std::vector<winrt::GraphicsCaptureItem> items;
+    try
+    {
+        for (auto&& window : windows)
+        {
+            items.push_back(util::CreateCaptureItemForWindow(window));
+        }
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        MessageBoxW(m_mainWindow,
+            error.message().c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+        co_return nullptr;
+    }
+    if (items.empty())
+    {
+        co_return nullptr;
+    }
+
+    auto folderPicker = winrt::FolderPicker();
+    InitializeObjectWithWindowHandle(folderPicker);
+    folderPicker.SuggestedStartLocation(winrt::PickerLocationId::PicturesLibrary);
+    folderPicker.FileTypeFilter().Append(L"*");
+    auto folder = co_await folderPicker.PickSingleFolderAsync();
+    if (folder == nullptr)
+    {
+        co_return nullptr;
+    }
 
-        // Initialize the encoder
-        winrt::com_ptr<IWICBitmapEncoder> encoder;
-        winrt::check_hresult(m_wicFactory->CreateEncoder(fileFormatGuid, nullptr, encoder.put()));
-        winrt::check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
-        winrt::com_ptr<IWICBitmapFrameEncode> frame;
-        winrt::com_ptr<IPropertyBag2> props;
-        winrt::check_hresult(encoder->CreateNewFrame(frame.put(), props.put()));
-
-        // Encode the image
-        D3D11_TEXTURE2D_DESC desc = {};
-        texture->GetDesc(&desc);
-        auto bytes = util::CopyBytesFromTexture(texture);
-        auto bytesPerPixel = util::GetBytesPerPixel(desc.Format);
-        auto stride = static_cast<uint32_t>(bytesPerPixel) * desc.Width;
-        auto bufferSize = stride * desc.Height;
-
-        winrt::check_hresult(frame->Initialize(props.get()));
-        winrt::check_hresult(frame->SetSize(desc.Width, desc.Height));
-        winrt::guid targetFormat = bitmapPixelFormat;
-        winrt::check_hresult(frame->SetPixelFormat(reinterpret_cast<WICPixelFormatGUID*>(&targetFormat)));
-        if (targetFormat != bitmapPixelFormat)
+    // Windows that don't change only send their first frame, so the first
+    // set is the one we want
+    struct FirstSet
+    {
+        std::mutex Lock;
+        std::vector<winrt::com_ptr<ID3D11Texture2D>> Textures;
+    };
+    auto firstSet = std::make_shared<FirstSet>();
+    wil::shared_event setEvent(wil::EventOptions::ManualReset);
+    auto capture = std::make_unique<SyncedCapture>(m_device, items, [firstSet, setEvent](auto&& textures, auto&&)
+    {
+        auto lock = std::scoped_lock(firstSet->Lock);
+        if (firstSet->Textures.empty())
         {
-            // We must convert the image, but we should only really be converting to a single format.
-            if (targetFormat != winrt::guid(GUID_WICPixelFormat24bppBGR))
+            // The capture reuses its textures, so keep copies
+            for (auto&& texture : textures)
             {
-                throw winrt::hresult_error(E_FAIL, L"Unsupported pixel format!");
+                D3D11_TEXTURE2D_DESC desc = {};
+                texture->GetDesc(&desc);
+                winrt::com_ptr<ID3D11Device> d3dDevice;
+                texture->GetDevice(d3dDevice.put());
+                winrt::com_ptr<ID3D11DeviceContext> d3dContext;
+                d3dDevice->GetImmediateContext(d3dContext.put());
+                winrt::com_ptr<ID3D11Texture2D> copy;
+                winrt::check_hresult(d3dDevice->CreateTexture2D(&desc, nullptr, copy.put()));
+                d3dContext->CopyResource(copy.get(), texture.get());
+                firstSet->Textures.push_back(copy);
             }
-            uint32_t convertedBytesPerPixel = 3;
-            uint32_t convertedStride = convertedBytesPerPixel * desc.Width;
-            uint32_t convertedBufferSize = convertedStride * desc.Height;
-
-            winrt::com_ptr<IWICFormatConverter> converter;
-            winrt::check_hresult(m_wicFactory->CreateFormatConverter(converter.put()));
-            winrt::com_ptr<IWICBitmap> bitmap;
-            winrt::check_hresult(m_wicFactory->CreateBitmapFromMemory(desc.Width, desc.Height, bitmapPixelFormat, stride, bufferSize, bytes.data(), bitmap.put()));
-
-            winrt::check_hresult(converter->Initialize(bitmap.get(), targetFormat, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeMedianCut));
-
-            bytes = std::vector<byte>(convertedBufferSize, 0);
-            winrt::check_hresult(converter->CopyPixels(nullptr, convertedStride, convertedBufferSize, bytes.data()));
-            bytesPerPixel = convertedBytesPerPixel;
-            stride = convertedStride;
-            bufferSize = convertedBufferSize;
+            setEvent.SetEvent();
         }
-        // TODO: Metadata
+    });
+    capture->StartCapture();
+    auto signaled = co_await winrt::resume_on_signal(setEvent.get(), std::chrono::seconds(5));
+    auto silentSources = capture->SourcesWithoutFrames();
+    capture->Close();
+    if (!signaled)
+    {
+        co_await wil::resume_foreground(m_mainThread);
+        // Every window sent something if the sets just never lined up
+        std::wstring message = L"The windows didn't send frames close enough together!";
+        if (!silentSources.empty())
+        {
+            message = L"These windows didn't send a frame in time:";
+            for (auto&& source : silentSources)
+            {
+                std::wstring title = WindowInfo(windows[source]).Title.c_str();
+                if (title.empty())
+                {
+                    wchar_t handle[32] = {};
+                    swprintf_s(handle, L"0x%p", windows[source]);
+                    title = handle;
+                }
+                message += L"\n" + title;
+            }
+        }
+        MessageBoxW(m_mainWindow,
+            message.c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+        co_return nullptr;
+    }
 
-        winrt::check_hresult(frame->WritePixels(desc.Height, stride, bufferSize, bytes.data()));
-        winrt::check_hresult(frame->Commit());
-        winrt::check_hresult(encoder->Commit());
+    std::vector<winrt::com_ptr<ID3D11Texture2D>> textures;
+    {
+        auto lock = std::scoped_lock(firstSet->Lock);
+        textures = firstSet->Textures;
+    }
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        auto file = co_await folder.CreateFileAsync(L"window-" + std::to_wstring(i + 1) + L".png", winrt::CreationCollisionOption::GenerateUniqueName);
+        co_await m_snapshotEncoder->EncodeAsync(textures[i], file, GUID_ContainerFormatPng, GUID_WICPixelFormat32bppBGRA);
     }
 
+    co_return folder;
+}
+
+winrt::IAsyncOperation<bool> App::StartSnapshotOnChangeAsync(
+    std::function<void(winrt::IAsyncOperationWithProgress<winrt::StorageFile, double>)> onSnapshot)
+{
+    if (m_capture == nullptr)
+    {
+        co_return false;
+    }
+
+    auto folderPicker = winrt::FolderPicker();
+    InitializeObjectWithWindowHandle(folderPicker);
+    folderPicker.SuggestedStartLocation(winrt::PickerLocationId::PicturesLibrary);
+    folderPicker.FileTypeFilter().Append(L"*");
+    auto folder = co_await folderPicker.PickSingleFolderAsync();
+    if (folder == nullptr)
+    {
+        co_return false;
+    }
+
+    // The capture could have stopped while the picker was up
+    co_await wil::resume_foreground(m_mainThread);
+    if (m_capture == nullptr)
+    {
+        co_return false;
+    }
+    // Called on the capture's threads, the saving starts right away
+    auto mainThread = m_mainThread;
+    m_capture->SnapshotOnChange([this, folder, mainThread, onSnapshot](auto&& texture)
+    {
+        auto operation = SaveChangeSnapshotAsync(texture, folder);
+        mainThread.TryEnqueue([onSnapshot, operation]()
+        {
+            onSnapshot(operation);
+        });
+    });
+    co_return true;
+}
+
+void App::StopSnapshotOnChange()
+{
+    if (m_capture != nullptr)
+    {
+        m_capture->SnapshotOnChange(nullptr);
+    }
+}
+
+winrt::IAsyncOperationWithProgress<winrt::StorageFile, double> App::SaveChangeSnapshotAsync(
+    winrt::com_ptr<ID3D11Texture2D> texture,
+    winrt::StorageFolder folder)
+{
+    // We don't touch the app after this, it can be gone by the time we finish
+    auto encoder = m_snapshotEncoder;
+    auto cancellation = co_await winrt::get_cancellation_token();
+    cancellation.enable_propagation();
+    auto progress = co_await winrt::get_progress_token();
+
+    // Timestamped names keep the folder in order
+    SYSTEMTIME time = {};
+    GetLocalTime(&time);
+    wchar_t fileName[64] = {};
+    swprintf_s(fileName, L"%04u%02u%02u-%02u%02u%02u-%03u.png",
+        time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond, time.wMilliseconds);
+
+    auto file = co_await folder.CreateFileAsync(fileName, winrt::CreationCollisionOption::GenerateUniqueName);
+    auto encode = encoder->EncodeAsync(texture, file, GUID_ContainerFormatPng, GUID_WICPixelFormat32bppBGRA);
+    encode.Progress([&progress](auto&&, double value)
+    {
+        progress(value);
+    });
+    co_await encode;
+
     co_return file;
 }
 
 void App::StartCaptureFromItem(winrt::GraphicsCaptureItem item)
 {
-    m_capture = std::make_unique<SimpleCapture>(m_device, m_dirtyRegionVisualizer, item, m_pixelFormat);
+    m_capturedDisplayName = std::nullopt;
+    m_capturedItemFromPicker = false;
+    m_capture = std::make_unique<SimpleCapture>(m_device, m_dirtyRegionVisualizer, item, GetCapturePixelFormat(m_pixelFormat));
 
     auto surface = m_capture->CreateSurface(m_compositor);
     m_brush.Surface(surface);
@@ -275,6 +673,26 @@ void App::StopCapture()
         m_capture = nullptr;
         m_brush.Surface(nullptr);
     }
+    m_capturedDisplayName = std::nullopt;
+    m_capturedItemFromPicker = false;
+}
+
+void App::OnDisplaysChanged(std::vector<MonitorChange> const& changes)
+{
+    // Windows resize themselves. We can't tell what the picker gave us, so
+    // those follow any display that changed resolution.
+    if (m_capture != nullptr && (m_capturedDisplayName.has_value() || m_capturedItemFromPicker))
+    {
+        auto resolutionChanged = std::any_of(changes.begin(), changes.end(), [&](auto&& change)
+            {
+                return change.Kind == MonitorChangeKind::Modified && change.ResolutionChanged &&
+                    (m_capturedItemFromPicker || change.DisplayName == *m_capturedDisplayName);
+            });
+        if (resolutionChanged)
+        {
+            m_capture->ResizeToItemSize();
+        }
+    }
 }
 
 void App::InitializeWithWindow(HWND window)
@@ -304,7 +722,7 @@ void App::PixelFormat(winrt::DirectXPixelFormat pixelFormat)
     m_pixelFormat = pixelFormat;
     if (m_capture)
     {
-        m_capture->SetPixelFormat(pixelFormat);
+        m_capture->SetPixelFormat(GetCapturePixelFormat(pixelFormat));
     }
 }
 
@@ -364,6 +782,106 @@ void App::VisualizeDirtyRegions(bool value)
     }
 }
 
+bool App::DetectScrolling()
+{
+    if (m_capture != nullptr)
+    {
+        return m_capture->DetectScrolling();
+    }
+    return false;
+}
+
+void App::DetectScrolling(bool value)
+{
+    if (m_capture != nullptr)
+    {
+        m_capture->DetectScrolling(value);
+    }
+}
+
+void App::ShowRepaintHeatmap(bool value)
+{
+    if (m_capture != nullptr)
+    {
+        m_capture->ShowRepaintHeatmap(value);
+    }
+}
+
+bool App::KeepReplay()
+{
+    if (m_capture != nullptr)
+    {
+        return m_capture->KeepReplay();
+    }
+    return false;
+}
+
+void App::KeepReplay(bool value)
+{
+    if (m_capture != nullptr)
+    {
+        m_capture->KeepReplay(value);
+    }
+}
+
+void App::RedactPasswordFields(HWND window)
+{
+    if (m_capture != nullptr)
+    {
+        m_capture->RedactPasswordFields(window);
+    }
+}
+
+void App::StartMeasuringLatency(RECT const& markerBounds)
+{
+    if (m_capture != nullptr)
+    {
+        m_capture->MeasureLatency(markerBounds);
+    }
+}
+
+void App::StopMeasuringLatency()
+{
+    if (m_capture == nullptr)
+    {
+        return;
+    }
+    auto report = m_capture->MeasuredLatency();
+    m_capture->MeasureLatency(std::nullopt);
+    if (report.Samples == 0)
+    {
+        MessageBoxW(m_mainWindow,
+            L"Nothing was measured! Press keys or click while the marker is in the capture. Only BGRA8 captures are measured.",
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    auto toMilliseconds = [](winrt::TimeSpan const& duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+    auto& toFrame = report.ToFrame;
+    auto& toArrival = report.ToArrival;
+    wchar_t message[512] = {};
+    swprintf_s(message, L"%zu samples, %zu missed.\n\n"
+        L"Input to frame: median %.1fms, p90 %.1fms, p95 %.1fms, p99 %.1fms, max %.1fms\n"
+        L"Input to OnFrameArrived: median %.1fms, p90 %.1fms, p95 %.1fms, p99 %.1fms, max %.1fms",
+        report.Samples, report.Missed,
+        toMilliseconds(toFrame.Median), toMilliseconds(toFrame.P90), toMilliseconds(toFrame.P95), toMilliseconds(toFrame.P99), toMilliseconds(toFrame.Max),
+        toMilliseconds(toArrival.Median), toMilliseconds(toArrival.P90), toMilliseconds(toArrival.P95), toMilliseconds(toArrival.P99), toMilliseconds(toArrival.Max));
+    MessageBoxW(m_mainWindow, message, L"Win32CaptureSample", MB_OK);
+}
+
+std::optional<MarkerPhase> App::OnLatencyInput(winrt::TimeSpan timestamp)
+{
+    if (m_capture != nullptr)
+    {
+        return m_capture->OnLatencyInput(timestamp);
+    }
+    return std::nullopt;
+}
+
 winrt::GraphicsCaptureDirtyRegionMode App::DirtyRegionMode()
 {
     if (m_capture != nullptr)
@@ -396,4 +914,19 @@ void App::MinUpdateInterval(winrt::TimeSpan value)
     {
         m_capture->MinUpdateInterval(value);
     }
+}
+
+void App::FramePoolBufferCount(std::optional<uint32_t> value)
+{
+    if (m_capture != nullptr)
+    {
+        if (value.has_value())
+        {
+            m_capture->FramePoolBufferCount(value.value());
+        }
+        else
+        {
+            m_capture->AutoTuneFramePool(true);
+        }
+    }
 }
\ No newline at end of file
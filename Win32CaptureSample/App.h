@@ -1,6 +1,8 @@
 #pragma once
 #include "SimpleCapture.h"
 #include "DirtyRegionVisualizer.h"
+#include "MonitorDiff.h"
+#include "SnapshotEncoder.h"
 
 class App
 {
@@ -11,7 +13,18 @@ public:
     winrt::Windows::Graphics::Capture::GraphicsCaptureItem TryStartCaptureFromWindowHandle(HWND hwnd);
     winrt::Windows::Graphics::Capture::GraphicsCaptureItem TryStartCaptureFromMonitorHandle(HMONITOR hmon);
     winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Graphics::Capture::GraphicsCaptureItem> StartCaptureWithPickerAsync();
-    winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> TakeSnapshotAsync();
+    winrt::Windows::Foundation::IAsyncOperationWithProgress<winrt::Windows::Storage::StorageFile, double> TakeSnapshotAsync();
+    // Compares the capture to a golden image, returns the image of the
+    // differences if the user chose to save it
+    winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> CompareToGoldenAsync();
+    winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> SaveReplayAsync();
+    winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> SaveRepaintReportAsync();
+    // Saves a snapshot of each window, all taken at about the same moment
+    winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFolder> SaveWindowSetAsync(std::vector<HWND> windows);
+    // Each save is handed to onSnapshot on the UI thread as it starts
+    winrt::Windows::Foundation::IAsyncOperation<bool> StartSnapshotOnChangeAsync(
+        std::function<void(winrt::Windows::Foundation::IAsyncOperationWithProgress<winrt::Windows::Storage::StorageFile, double>)> onSnapshot);
+    void StopSnapshotOnChange();
     winrt::Windows::Graphics::DirectX::DirectXPixelFormat PixelFormat() { return m_pixelFormat; }
     void PixelFormat(winrt::Windows::Graphics::DirectX::DirectXPixelFormat pixelFormat);
 
@@ -24,18 +37,36 @@ public:
 
     bool VisualizeDirtyRegions();
     void VisualizeDirtyRegions(bool value);
+    bool DetectScrolling();
+    void DetectScrolling(bool value);
+    void ShowRepaintHeatmap(bool value);
+    bool KeepReplay();
+    void KeepReplay(bool value);
+    // The window should be the one being captured, nullptr stops
+    void RedactPasswordFields(HWND window);
+    // The bounds are where the marker is in the capture
+    void StartMeasuringLatency(RECT const& markerBounds);
+    // Shows the user what was measured
+    void StopMeasuringLatency();
+    std::optional<MarkerPhase> OnLatencyInput(winrt::Windows::Foundation::TimeSpan timestamp);
     winrt::Windows::Graphics::Capture::GraphicsCaptureDirtyRegionMode DirtyRegionMode();
     void DirtyRegionMode(winrt::Windows::Graphics::Capture::GraphicsCaptureDirtyRegionMode value);
 
     winrt::Windows::Foundation::TimeSpan MinUpdateInterval();
     void MinUpdateInterval(winrt::Windows::Foundation::TimeSpan value);
+    // nullopt tunes the buffer count automatically
+    void FramePoolBufferCount(std::optional<uint32_t> value);
 
+    void OnDisplaysChanged(std::vector<MonitorChange> const& changes);
     void StopCapture();
     void InitializeWithWindow(HWND window);
 
 private:
     void StartCaptureFromItem(winrt::Windows::Graphics::Capture::GraphicsCaptureItem item);
     void InitializeObjectWithWindowHandle(winrt::Windows::Foundation::IUnknown const& object);
+    winrt::Windows::Foundation::IAsyncOperationWithProgress<winrt::Windows::Storage::StorageFile, double> SaveChangeSnapshotAsync(
+        winrt::com_ptr<ID3D11Texture2D> texture,
+        winrt::Windows::Storage::StorageFolder folder);
 
 private:
     winrt::Windows::System::DispatcherQueue m_mainThread{ nullptr };
@@ -48,8 +79,12 @@ private:
 
     winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice m_device{ nullptr };
     std::unique_ptr<SimpleCapture> m_capture{ nullptr };
+    // Device name of the monitor being captured, so that display changes
+    // elsewhere can be ignored
+    std::optional<std::wstring> m_capturedDisplayName;
+    bool m_capturedItemFromPicker = false;
     winrt::Windows::Graphics::DirectX::DirectXPixelFormat m_pixelFormat = winrt::Windows::Graphics::DirectX::DirectXPixelFormat::B8G8R8A8UIntNormalized;
     std::shared_ptr<DirtyRegionVisualizer> m_dirtyRegionVisualizer;
 
-    winrt::com_ptr<IWICImagingFactory2> m_wicFactory;
+    std::shared_ptr<SnapshotEncoder> m_snapshotEncoder;
 };
\ No newline at end of file
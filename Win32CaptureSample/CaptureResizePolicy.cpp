@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "CaptureResizePolicy.h"
+
+PixelSize ClampToValidSize(PixelSize size)
+{
+    // Minimized windows can report empty sizes, but we can't have empty buffers
+    return { std::max(size.Width, 1), std::max(size.Height, 1) };
+}
+
+CaptureResizePolicy::CaptureResizePolicy(int32_t bucketSize, Ticks settleTime)
+{
+    m_bucketSize = std::max(bucketSize, 1);
+    m_settleTime = settleTime;
+}
+
+void CaptureResizePolicy::Reset(PixelSize contentSize)
+{
+    contentSize = ClampToValidSize(contentSize);
+    m_bufferSize = contentSize;
+    m_lastContentSize = contentSize;
+    m_lastChangeTime.reset();
+}
+
+std::optional<Ticks> CaptureResizePolicy::ShrinkDeadline() const
+{
+    if (!m_lastChangeTime.has_value() ||
+        ((m_lastContentSize.Width == m_bufferSize.Width) && (m_lastContentSize.Height == m_bufferSize.Height)))
+    {
+        return std::nullopt;
+    }
+    return m_lastChangeTime.value() + m_settleTime;
+}
+
+std::optional<PixelSize> CaptureResizePolicy::Update(PixelSize contentSize, Ticks timestamp)
+{
+    contentSize = ClampToValidSize(contentSize);
+    if ((contentSize.Width != m_lastContentSize.Width) ||
+        (contentSize.Height != m_lastContentSize.Height) ||
+        !m_lastChangeTime.has_value())
+    {
+        m_lastContentSize = contentSize;
+        m_lastChangeTime = timestamp;
+    }
+
+    if ((contentSize.Width > m_bufferSize.Width) ||
+        (contentSize.Height > m_bufferSize.Height))
+    {
+        // Grow to the next bucket so the next few frames of a resize still fit
+        m_bufferSize =
+        {
+            std::max(m_bufferSize.Width, RoundUpToBucket(contentSize.Width)),
+            std::max(m_bufferSize.Height, RoundUpToBucket(contentSize.Height)),
+        };
+        m_reallocationCount++;
+        return m_bufferSize;
+    }
+
+    if (((contentSize.Width != m_bufferSize.Width) ||
+        (contentSize.Height != m_bufferSize.Height)) &&
+        (timestamp - m_lastChangeTime.value() >= m_settleTime))
+    {
+        // The size has settled, stop wasting memory
+        m_bufferSize = contentSize;
+        m_reallocationCount++;
+        return m_bufferSize;
+    }
+
+    return std::nullopt;
+}
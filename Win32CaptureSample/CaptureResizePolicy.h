@@ -0,0 +1,43 @@
+#pragma once
+#include "PortableTypes.h"
+
+// Decides how big the swap chain and frame pool buffers should be while the
+// captured item changes size. Reallocating both on every size change is
+// expensive during an interactive resize, so instead we grow the buffers
+// in buckets and present only the part that has content. Once the content
+// size has stayed the same for a while, the buffers shrink back to fit.
+class CaptureResizePolicy
+{
+public:
+    CaptureResizePolicy(
+        int32_t bucketSize = 256,
+        Ticks settleTime = std::chrono::milliseconds(500));
+    ~CaptureResizePolicy() {}
+
+    // Allocate exactly the given size, no hysteresis
+    void Reset(PixelSize contentSize);
+
+    // Returns the new buffer size if the buffers need to be reallocated
+    std::optional<PixelSize> Update(
+        PixelSize contentSize,
+        Ticks timestamp);
+
+    // When the buffers can shrink back to fit if the size doesn't change
+    // before then. Content that stops changing stops sending frames, so the
+    // caller has to come back to Update by itself.
+    std::optional<Ticks> ShrinkDeadline() const;
+
+    PixelSize BufferSize() const { return m_bufferSize; }
+    uint64_t ReallocationCount() const { return m_reallocationCount; }
+
+private:
+    int32_t RoundUpToBucket(int32_t value) const { return ((value + m_bucketSize - 1) / m_bucketSize) * m_bucketSize; }
+
+private:
+    int32_t m_bucketSize = 0;
+    Ticks m_settleTime = {};
+    PixelSize m_bufferSize = {};
+    PixelSize m_lastContentSize = {};
+    std::optional<Ticks> m_lastChangeTime;
+    uint64_t m_reallocationCount = 0;
+};
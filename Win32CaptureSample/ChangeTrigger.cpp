@@ -0,0 +1,285 @@
+#include "pch.h"
+#include "ChangeTrigger.h"
+
+uint32_t const BlockSize = ChangeTrigger::BlockSize;
+
+uint8_t inline GetBrightness(uint8_t const* pixel)
+{
+    // BT.709 weights, BGRA byte order
+    return static_cast<uint8_t>((pixel[0] * 18 + pixel[1] * 183 + pixel[2] * 55) >> 8);
+}
+
+uint8_t inline AbsoluteDifference(uint8_t left, uint8_t right)
+{
+    return left > right ? left - right : right - left;
+}
+
+// Returns the blocks that a rect touches as [left, right) and [top, bottom)
+PixelRect GetBlockRange(PixelRect const& rect, uint32_t width, uint32_t height)
+{
+    auto left = std::clamp<int32_t>(rect.Left, 0, static_cast<int32_t>(width));
+    auto top = std::clamp<int32_t>(rect.Top, 0, static_cast<int32_t>(height));
+    auto right = std::clamp<int32_t>(rect.Right, 0, static_cast<int32_t>(width));
+    auto bottom = std::clamp<int32_t>(rect.Bottom, 0, static_cast<int32_t>(height));
+    if (left >= right || top >= bottom)
+    {
+        return {};
+    }
+    auto blockSize = static_cast<int32_t>(BlockSize);
+    return { left / blockSize, top / blockSize, (right + blockSize - 1) / blockSize, (bottom + blockSize - 1) / blockSize };
+}
+
+ChangeTrigger::ChangeTrigger(ChangeTriggerSettings const& settings)
+{
+    m_settings = settings;
+}
+
+void ChangeTrigger::Reset()
+{
+    m_width = 0;
+    m_height = 0;
+    m_blocksWide = 0;
+    m_blocksHigh = 0;
+    m_current.clear();
+    m_reference.clear();
+    m_watched.clear();
+    m_dirtyBlocks.clear();
+    m_dirtyMask.clear();
+    m_watchedBlockCount = 0;
+    m_dirtyBlockCount = 0;
+    m_changedBlockCount = 0;
+    m_hasReference = false;
+    m_pending = false;
+    m_lastFired = std::nullopt;
+}
+
+void ChangeTrigger::Resize(uint32_t width, uint32_t height)
+{
+    // The old snapshot can't be compared against a frame of a different size,
+    // so the next one is treated as new content.
+    m_width = width;
+    m_height = height;
+    m_blocksWide = (width + BlockSize - 1) / BlockSize;
+    m_blocksHigh = (height + BlockSize - 1) / BlockSize;
+    auto blockCount = static_cast<size_t>(m_blocksWide) * m_blocksHigh;
+    m_current.assign(blockCount, {});
+    m_reference.assign(blockCount, {});
+    m_dirtyMask.assign(blockCount, 0);
+    m_dirtyBlocks.clear();
+    m_dirtyBlockCount = 0;
+    m_changedBlockCount = 0;
+    m_hasReference = false;
+    m_pending = false;
+
+    m_watched.assign(blockCount, m_settings.Regions.empty() ? 1 : 0);
+    for (auto&& region : m_settings.Regions)
+    {
+        auto blocks = GetBlockRange(region, width, height);
+        for (auto blockY = blocks.Top; blockY < blocks.Bottom; blockY++)
+        {
+            for (auto blockX = blocks.Left; blockX < blocks.Right; blockX++)
+            {
+                m_watched[blockY * m_blocksWide + blockX] = 1;
+            }
+        }
+    }
+    m_watchedBlockCount = std::count(m_watched.begin(), m_watched.end(), 1);
+}
+
+void ChangeTrigger::SummarizeBlock(uint8_t const* pixels, uint32_t stride, uint32_t blockX, uint32_t blockY)
+{
+    auto left = blockX * BlockSize;
+    auto top = blockY * BlockSize;
+    auto width = std::min(BlockSize, m_width - left);
+    auto height = std::min(BlockSize, m_height - top);
+
+    // The average alone misses text being edited, so also look at how
+    // much neighbouring pixels differ.
+    std::array<uint8_t, BlockSize> previousRow{};
+    std::array<uint8_t, BlockSize> currentRow{};
+    uint32_t brightnessSum = 0;
+    uint32_t detailSum = 0;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        auto row = pixels + static_cast<size_t>(top + y) * stride + static_cast<size_t>(left) * 4;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            currentRow[x] = GetBrightness(row + x * 4);
+            brightnessSum += currentRow[x];
+        }
+        for (uint32_t x = 0; x + 1 < width; x++)
+        {
+            detailSum += AbsoluteDifference(currentRow[x], currentRow[x + 1]);
+        }
+        if (y > 0)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                detailSum += AbsoluteDifference(currentRow[x], previousRow[x]);
+            }
+        }
+        std::swap(previousRow, currentRow);
+    }
+    auto detailCount = (width - 1) * height + width * (height - 1);
+
+    auto& summary = m_current[blockY * m_blocksWide + blockX];
+    summary.Brightness = static_cast<uint8_t>(brightnessSum / (width * height));
+    summary.Detail = detailCount > 0 ? static_cast<uint8_t>(std::min(detailSum / detailCount, 255u)) : 0;
+}
+
+bool ChangeTrigger::IsBlockChanged(size_t index) const
+{
+    auto&& current = m_current[index];
+    auto&& reference = m_reference[index];
+    return AbsoluteDifference(current.Brightness, reference.Brightness) > m_settings.BlockThreshold ||
+        AbsoluteDifference(current.Detail, reference.Detail) > m_settings.BlockThreshold;
+}
+
+bool ChangeTrigger::OnFrame(
+    Ticks timestamp,
+    uint8_t const* pixels,
+    uint32_t width,
+    uint32_t height,
+    uint32_t stride,
+    std::optional<std::vector<PixelRect>> const& dirtyRects)
+{
+    auto resized = false;
+    if (width != m_width || height != m_height)
+    {
+        Resize(width, height);
+        resized = true;
+    }
+
+    auto touched = false;
+    auto touchBlock = [&](size_t blockX, size_t blockY)
+    {
+        auto index = static_cast<uint32_t>(blockY * m_blocksWide + blockX);
+        if (!m_watched[index])
+        {
+            return;
+        }
+        SummarizeBlock(pixels, stride, static_cast<uint32_t>(blockX), static_cast<uint32_t>(blockY));
+        if (!m_dirtyMask[index])
+        {
+            m_dirtyMask[index] = 1;
+            m_dirtyBlocks.push_back(index);
+            m_dirtyBlockCount++;
+        }
+        touched = true;
+    };
+
+    // A block touched by more than one rect gets summarized more than once,
+    // which is cheaper than keeping track of it. After a resize we don't
+    // have anything for the untouched blocks yet, so look at all of them.
+    if (dirtyRects.has_value() && !resized)
+    {
+        for (auto&& rect : dirtyRects.value())
+        {
+            auto blocks = GetBlockRange(rect, width, height);
+            for (auto blockY = blocks.Top; blockY < blocks.Bottom; blockY++)
+            {
+                for (auto blockX = blocks.Left; blockX < blocks.Right; blockX++)
+                {
+                    touchBlock(blockX, blockY);
+                }
+            }
+        }
+    }
+    else
+    {
+        // Everything needs to be looked at, so spread it out over the thread pool
+        std::vector<uint32_t> blockRows(m_blocksHigh);
+        std::iota(blockRows.begin(), blockRows.end(), 0);
+        std::for_each(std::execution::par, blockRows.begin(), blockRows.end(), [&](uint32_t blockY)
+        {
+            for (uint32_t blockX = 0; blockX < m_blocksWide; blockX++)
+            {
+                if (m_watched[blockY * m_blocksWide + blockX])
+                {
+                    SummarizeBlock(pixels, stride, blockX, blockY);
+                }
+            }
+        });
+        for (uint32_t index = 0; index < m_watched.size(); index++)
+        {
+            if (m_watched[index] && !m_dirtyMask[index])
+            {
+                m_dirtyMask[index] = 1;
+                m_dirtyBlocks.push_back(index);
+                m_dirtyBlockCount++;
+            }
+        }
+        touched = m_watchedBlockCount > 0;
+    }
+
+    if (touched)
+    {
+        m_lastActivity = timestamp;
+        if (m_hasReference)
+        {
+            m_changedBlockCount = 0;
+            for (auto&& index : m_dirtyBlocks)
+            {
+                m_changedBlockCount += IsBlockChanged(index) ? 1 : 0;
+            }
+        }
+        else
+        {
+            m_changedBlockCount = m_dirtyBlockCount;
+        }
+
+        // Something that changed and then went back to how it was (e.g. a
+        // blinking caret) doesn't count.
+        auto changed = DirtyRatio() >= m_settings.MinDirtyRatio &&
+            (!m_hasReference || ChangedRatio() >= m_settings.MinChangedRatio);
+        if (changed && !m_pending)
+        {
+            m_pendingSince = timestamp;
+        }
+        m_pending = changed;
+    }
+
+    return TryFire(timestamp);
+}
+
+bool ChangeTrigger::Poll(Ticks now)
+{
+    return TryFire(now);
+}
+
+std::optional<Ticks> ChangeTrigger::Deadline() const
+{
+    if (!m_pending)
+    {
+        return std::nullopt;
+    }
+    auto deadline = std::min(m_lastActivity + m_settings.Debounce, m_pendingSince + m_settings.MaxDelay);
+    if (m_lastFired.has_value())
+    {
+        deadline = std::max(deadline, m_lastFired.value() + m_settings.Cooldown);
+    }
+    return deadline;
+}
+
+bool ChangeTrigger::TryFire(Ticks now)
+{
+    auto deadline = Deadline();
+    if (!deadline.has_value() || now < deadline.value())
+    {
+        return false;
+    }
+
+    // What we fired on becomes what the next frames are compared against
+    for (auto&& index : m_dirtyBlocks)
+    {
+        m_reference[index] = m_current[index];
+        m_dirtyMask[index] = 0;
+    }
+    m_dirtyBlocks.clear();
+    m_dirtyBlockCount = 0;
+    m_changedBlockCount = 0;
+    m_hasReference = true;
+    m_pending = false;
+    m_lastFired = now;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include "PortableTypes.h"
+
+struct ChangeTriggerSettings
+{
+    // How much of the watched area has to have been touched by dirty rects
+    // since the last snapshot, from 0 to 1.
+    float MinDirtyRatio = 0.002f;
+    // How much of the watched area has to look different from the last
+    // snapshot, from 0 to 1. Measured in blocks, see BlockThreshold.
+    float MinChangedRatio = 0.001f;
+    // A block counts as different when its average brightness or its amount
+    // of detail moved by more than this (0 to 255).
+    uint8_t BlockThreshold = 6;
+    // Wait for things to settle this long before firing...
+    Ticks Debounce = std::chrono::milliseconds(500);
+    // ...unless the content never settles (e.g. a video).
+    Ticks MaxDelay = std::chrono::seconds(5);
+    // Never fire more often than this.
+    Ticks Cooldown = std::chrono::seconds(2);
+    // Only look at these parts of the frame. Empty means the whole frame.
+    std::vector<PixelRect> Regions;
+};
+
+// Decides when a stream of frames has changed enough to be worth saving.
+//
+// Frames are summarized as a grid of blocks, each with an average brightness
+// and a measure of how much detail it has. Only blocks touched by dirty rects
+// are recomputed. A change is pending while the summary of the latest frame
+// differs enough from the one of the last frame that fired, and it fires once
+// the content has been still for the debounce time and the cooldown has passed.
+//
+// Frames only arrive when something changes, so the caller also needs to call
+// Poll once Deadline has passed. Not thread safe.
+class ChangeTrigger
+{
+public:
+    static uint32_t const BlockSize = 16;
+
+    ChangeTrigger(ChangeTriggerSettings const& settings = {});
+    ~ChangeTrigger() {}
+
+    // Pixels are 32bpp BGRA. Returns true if a snapshot of this frame should
+    // be taken now.
+    bool OnFrame(
+        Ticks timestamp,
+        uint8_t const* pixels,
+        uint32_t width,
+        uint32_t height,
+        uint32_t stride,
+        std::optional<std::vector<PixelRect>> const& dirtyRects);
+    // Returns true if a snapshot of the last frame should be taken now.
+    bool Poll(Ticks now);
+    // When to call Poll next, if anything is pending.
+    std::optional<Ticks> Deadline() const;
+    void Reset();
+
+    float DirtyRatio() const { return m_watchedBlockCount > 0 ? static_cast<float>(m_dirtyBlockCount) / m_watchedBlockCount : 0.0f; }
+    float ChangedRatio() const { return m_watchedBlockCount > 0 ? static_cast<float>(m_changedBlockCount) / m_watchedBlockCount : 0.0f; }
+
+private:
+    struct BlockSummary
+    {
+        uint8_t Brightness = 0;
+        uint8_t Detail = 0;
+    };
+
+    void Resize(uint32_t width, uint32_t height);
+    void SummarizeBlock(uint8_t const* pixels, uint32_t stride, uint32_t blockX, uint32_t blockY);
+    bool IsBlockChanged(size_t index) const;
+    bool TryFire(Ticks now);
+
+private:
+    ChangeTriggerSettings m_settings;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_blocksWide = 0;
+    uint32_t m_blocksHigh = 0;
+    std::vector<BlockSummary> m_current;
+    std::vector<BlockSummary> m_reference;
+    std::vector<uint8_t> m_watched;
+    // Blocks touched since the last time we fired
+    std::vector<uint32_t> m_dirtyBlocks;
+    std::vector<uint8_t> m_dirtyMask;
+    size_t m_watchedBlockCount = 0;
+    size_t m_dirtyBlockCount = 0;
+    size_t m_changedBlockCount = 0;
+    bool m_hasReference = false;
+
+    bool m_pending = false;
+    Ticks m_pendingSince = {};
+    Ticks m_lastActivity = {};
+    std::optional<Ticks> m_lastFired;
+};
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "CpuFrameReader.h"
+#include "StridedCopy.h"
+
+namespace util
+{
+    using namespace robmikh::common::uwp;
+}
+
+CpuFrameReader::CpuFrameReader(winrt::com_ptr<ID3D11Device> const& d3dDevice)
+{
+    m_d3dDevice = d3dDevice;
+    m_d3dDevice->GetImmediateContext(m_d3dContext.put());
+}
+
+void CpuFrameReader::Read(winrt::com_ptr<ID3D11Texture2D> const& texture, uint32_t width, uint32_t height, std::vector<uint8_t>& pixels)
+{
+    RECT bounds = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+    Read(texture, width, height, bounds, pixels);
+}
+
+void CpuFrameReader::Read(winrt::com_ptr<ID3D11Texture2D> const& texture, uint32_t width, uint32_t height, RECT const& bounds, std::vector<uint8_t>& pixels)
+{
+    if (bounds.left < 0 || bounds.top < 0 || bounds.right > static_cast<LONG>(width) || bounds.bottom > static_cast<LONG>(height) ||
+        bounds.right <= bounds.left || bounds.bottom <= bounds.top)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"The bounds have to be inside of the frame.");
+    }
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    texture->GetDesc(&desc);
+    if (m_stagingTexture == nullptr || m_stagingDesc.Width != width || m_stagingDesc.Height != height || m_stagingDesc.Format != desc.Format)
+    {
+        m_stagingDesc = {};
+        m_stagingDesc.Width = width;
+        m_stagingDesc.Height = height;
+        m_stagingDesc.MipLevels = 1;
+        m_stagingDesc.ArraySize = 1;
+        m_stagingDesc.Format = desc.Format;
+        m_stagingDesc.SampleDesc.Count = 1;
+        m_stagingDesc.Usage = D3D11_USAGE_STAGING;
+        m_stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        m_stagingTexture = nullptr;
+        winrt::check_hresult(m_d3dDevice->CreateTexture2D(&m_stagingDesc, nullptr, m_stagingTexture.put()));
+        m_bytesPerPixel = static_cast<uint32_t>(util::GetBytesPerPixel(desc.Format));
+    }
+
+    D3D11_BOX region = {};
+    region.left = static_cast<uint32_t>(bounds.left);
+    region.top = static_cast<uint32_t>(bounds.top);
+    region.right = static_cast<uint32_t>(bounds.right);
+    region.bottom = static_cast<uint32_t>(bounds.bottom);
+    region.back = 1;
+    m_d3dContext->CopySubresourceRegion(m_stagingTexture.get(), 0, region.left, region.top, 0, texture.get(), 0, &region);
+
+    auto stride = Stride();
+    pixels.resize(static_cast<size_t>(stride) * height);
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    winrt::check_hresult(m_d3dContext->Map(m_stagingTexture.get(), 0, D3D11_MAP_READ, 0, &mapped));
+    auto unmap = wil::scope_exit([&]()
+    {
+        m_d3dContext->Unmap(m_stagingTexture.get(), 0);
+    });
+
+    auto source = reinterpret_cast<uint8_t const*>(mapped.pData) + static_cast<size_t>(bounds.top) * mapped.RowPitch + static_cast<size_t>(bounds.left) * m_bytesPerPixel;
+    auto destination = pixels.data() + static_cast<size_t>(bounds.top) * stride + static_cast<size_t>(bounds.left) * m_bytesPerPixel;
+    StridedCopy::Copy(source, mapped.RowPitch, destination, stride,
+        static_cast<size_t>(bounds.right - bounds.left) * m_bytesPerPixel, static_cast<uint32_t>(bounds.bottom - bounds.top));
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+// Copies frames back to the CPU through a staging texture. Mapping waits for
+// the GPU to finish the copy, so this stalls whichever thread calls Read.
+class CpuFrameReader
+{
+public:
+    CpuFrameReader(winrt::com_ptr<ID3D11Device> const& d3dDevice);
+    ~CpuFrameReader() {}
+
+    // Only the top-left width x height pixels of the texture are read, tightly
+    // packed. Pixels is resized to fit, passing the same one in again saves
+    // faulting in new memory every frame.
+    void Read(winrt::com_ptr<ID3D11Texture2D> const& texture, uint32_t width, uint32_t height, std::vector<uint8_t>& pixels);
+    // Same as above, but only the pixels inside of bounds are copied, to
+    // where they are in the frame. The rest of pixels is left alone.
+    void Read(winrt::com_ptr<ID3D11Texture2D> const& texture, uint32_t width, uint32_t height, RECT const& bounds, std::vector<uint8_t>& pixels);
+
+    uint32_t Width() const { return m_stagingDesc.Width; }
+    uint32_t Height() const { return m_stagingDesc.Height; }
+    DXGI_FORMAT Format() const { return m_stagingDesc.Format; }
+    uint32_t BytesPerPixel() const { return m_bytesPerPixel; }
+    uint32_t Stride() const { return m_bytesPerPixel * m_stagingDesc.Width; }
+
+private:
+    winrt::com_ptr<ID3D11Device> m_d3dDevice;
+    winrt::com_ptr<ID3D11DeviceContext> m_d3dContext;
+    winrt::com_ptr<ID3D11Texture2D> m_stagingTexture;
+    D3D11_TEXTURE2D_DESC m_stagingDesc = {};
+    uint32_t m_bytesPerPixel = 0;
+};
\ No newline at end of file
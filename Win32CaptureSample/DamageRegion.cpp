@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "DamageRegion.h"
+
+DamageRegion::DamageRegion(RECT const& rect)
+{
+    if (rect.left < rect.right && rect.top < rect.bottom)
+    {
+        m_bands.push_back({ rect.top, rect.bottom, { { rect.left, rect.right } } });
+    }
+}
+
+DamageRegion::DamageRegion(std::span<RECT const> rects)
+{
+    // Merge in pairs so that each rect only takes part in a logarithmic
+    // number of unions, instead of growing one region a rect at a time.
+    if (rects.size() <= 1)
+    {
+        if (!rects.empty())
+        {
+            *this = DamageRegion(rects.front());
+        }
+        return;
+    }
+    auto middle = rects.size() / 2;
+    *this = DamageRegion(rects.first(middle));
+    Union(DamageRegion(rects.subspan(middle)));
+}
+
+void DamageRegion::UnionSpans(std::vector<Span> const& first, std::vector<Span> const& second, std::vector<Span>& result)
+{
+    result.clear();
+    auto firstSpan = first.begin();
+    auto secondSpan = second.begin();
+    while (firstSpan != first.end() || secondSpan != second.end())
+    {
+        // Take whichever starts first
+        Span next;
+        if (secondSpan == second.end() || (firstSpan != first.end() && firstSpan->Left <= secondSpan->Left))
+        {
+            next = *firstSpan++;
+        }
+        else
+        {
+            next = *secondSpan++;
+        }
+
+        // Spans that overlap or touch become one
+        if (!result.empty() && next.Left <= result.back().Right)
+        {
+            result.back().Right = std::max(result.back().Right, next.Right);
+        }
+        else
+        {
+            result.push_back(next);
+        }
+    }
+}
+
+void DamageRegion::AppendBand(LONG top, LONG bottom, std::vector<Span>&& spans)
+{
+    if (spans.empty())
+    {
+        return;
+    }
+    if (!m_bands.empty() && m_bands.back().Bottom == top && m_bands.back().Spans == spans)
+    {
+        m_bands.back().Bottom = bottom;
+        return;
+    }
+    m_bands.push_back({ top, bottom, std::move(spans) });
+}
+
+void DamageRegion::Union(DamageRegion const& other)
+{
+    if (other.IsEmpty())
+    {
+        return;
+    }
+    if (IsEmpty())
+    {
+        m_bands = other.m_bands;
+        return;
+    }
+
+    // Walk down both lists of bands at once. Every place where a band of
+    // either region starts or ends splits the result into a new band.
+    static std::vector<Span> const noSpans;
+    DamageRegion result;
+    result.m_bands.reserve(m_bands.size() + other.m_bands.size());
+    auto firstBand = m_bands.begin();
+    auto secondBand = other.m_bands.begin();
+    auto y = std::min(firstBand->Top, secondBand->Top);
+    std::vector<Span> spans;
+    while (firstBand != m_bands.end() || secondBand != other.m_bands.end())
+    {
+        auto firstActive = firstBand != m_bands.end() && firstBand->Top <= y;
+        auto secondActive = secondBand != other.m_bands.end() && secondBand->Top <= y;
+
+        // Where the current piece ends: the end of an active band, or the
+        // start of one that isn't active yet
+        auto nextY = std::numeric_limits<LONG>::max();
+        if (firstBand != m_bands.end())
+        {
+            nextY = std::min(nextY, firstActive ? firstBand->Bottom : firstBand->Top);
+        }
+        if (secondBand != other.m_bands.end())
+        {
+            nextY = std::min(nextY, secondActive ? secondBand->Bottom : secondBand->Top);
+        }
+
+        if (firstActive || secondActive)
+        {
+            UnionSpans(firstActive ? firstBand->Spans : noSpans, secondActive ? secondBand->Spans : noSpans, spans);
+            result.AppendBand(y, nextY, std::move(spans));
+            spans = {};
+        }
+
+        y = nextY;
+        if (firstBand != m_bands.end() && firstBand->Bottom <= y)
+        {
+            firstBand++;
+        }
+        if (secondBand != other.m_bands.end() && secondBand->Bottom <= y)
+        {
+            secondBand++;
+        }
+    }
+    m_bands = std::move(result.m_bands);
+}
+
+int64_t DamageRegion::Area() const
+{
+    int64_t area = 0;
+    for (auto&& band : m_bands)
+    {
+        for (auto&& span : band.Spans)
+        {
+            area += static_cast<int64_t>(span.Right - span.Left) * (band.Bottom - band.Top);
+        }
+    }
+    return area;
+}
+
+RECT DamageRegion::Bounds() const
+{
+    if (m_bands.empty())
+    {
+        return {};
+    }
+    RECT bounds = { std::numeric_limits<LONG>::max(), m_bands.front().Top, std::numeric_limits<LONG>::min(), m_bands.back().Bottom };
+    for (auto&& band : m_bands)
+    {
+        bounds.left = std::min(bounds.left, band.Spans.front().Left);
+        bounds.right = std::max(bounds.right, band.Spans.back().Right);
+    }
+    return bounds;
+}
+
+std::vector<RECT> DamageRegion::Rects() const
+{
+    std::vector<RECT> rects;
+    for (auto&& band : m_bands)
+    {
+        for (auto&& span : band.Spans)
+        {
+            rects.push_back({ span.Left, band.Top, span.Right, band.Bottom });
+        }
+    }
+    return rects;
+}
\ No newline at end of file
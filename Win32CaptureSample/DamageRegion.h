@@ -0,0 +1,49 @@
+#pragma once
+
+// A set of pixels stored as y-x banded rects, the same way pixman and X11
+// regions are. The region is a list of bands sorted from top to bottom,
+// each band is a list of spans sorted from left to right, nothing overlaps
+// and nothing touches. Vertically adjacent bands always have different
+// spans, otherwise they would have been merged into one. Because of that,
+// two regions covering the same pixels always have the same bands.
+class DamageRegion
+{
+public:
+    DamageRegion() {}
+    DamageRegion(RECT const& rect);
+    DamageRegion(std::span<RECT const> rects);
+
+    void Union(DamageRegion const& other);
+    void Union(RECT const& rect) { Union(DamageRegion(rect)); }
+    void Clear() { m_bands.clear(); }
+
+    bool IsEmpty() const { return m_bands.empty(); }
+    int64_t Area() const;
+    RECT Bounds() const;
+    // One rect per span of every band, top to bottom and left to right
+    std::vector<RECT> Rects() const;
+
+    bool operator==(DamageRegion const& other) const { return m_bands == other.m_bands; }
+
+private:
+    struct Span
+    {
+        LONG Left;
+        LONG Right;
+        bool operator==(Span const& other) const { return Left == other.Left && Right == other.Right; }
+    };
+
+    struct Band
+    {
+        LONG Top;
+        LONG Bottom;
+        std::vector<Span> Spans;
+        bool operator==(Band const& other) const { return Top == other.Top && Bottom == other.Bottom && Spans == other.Spans; }
+    };
+
+    static void UnionSpans(std::vector<Span> const& first, std::vector<Span> const& second, std::vector<Span>& result);
+    void AppendBand(LONG top, LONG bottom, std::vector<Span>&& spans);
+
+private:
+    std::vector<Band> m_bands;
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "pch.h"
+#include "DamageTracker.h"
+
+size_t DamageTracker::AddConsumer()
+{
+    auto lock = std::scoped_lock(m_lock);
+    m_consumers.push_back({});
+    return m_consumers.size() - 1;
+}
+
+void DamageTracker::AddFrame(std::optional<std::vector<RECT>> const& dirtyRects)
+{
+    // Build the frame's region once, outside of the lock
+    DamageRegion frameRegion;
+    if (dirtyRects.has_value())
+    {
+        frameRegion = DamageRegion(std::span(dirtyRects.value()));
+    }
+
+    auto lock = std::scoped_lock(m_lock);
+    for (auto&& consumer : m_consumers)
+    {
+        if (consumer.Everything)
+        {
+            continue;
+        }
+        if (!dirtyRects.has_value())
+        {
+            consumer.Everything = true;
+            consumer.Region.Clear();
+        }
+        else
+        {
+            consumer.Region.Union(frameRegion);
+        }
+    }
+}
+
+std::optional<std::vector<RECT>> DamageTracker::Take(size_t consumer)
+{
+    auto lock = std::scoped_lock(m_lock);
+    auto& state = m_consumers.at(consumer);
+    std::optional<std::vector<RECT>> result;
+    if (!state.Everything)
+    {
+        result = state.Region.Rects();
+    }
+    state.Everything = false;
+    state.Region.Clear();
+    return result;
+}
+
+void DamageTracker::Invalidate(size_t consumer)
+{
+    auto lock = std::scoped_lock(m_lock);
+    auto& state = m_consumers.at(consumer);
+    state.Everything = true;
+    state.Region.Clear();
+}
\ No newline at end of file
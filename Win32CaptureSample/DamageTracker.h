@@ -0,0 +1,33 @@
+#pragma once
+#include "DamageRegion.h"
+
+// Remembers what changed since each consumer of the capture last looked,
+// so that skipping frames doesn't mean losing their dirty regions. Every
+// frame's dirty rects are added to every consumer, and a consumer takes
+// what it has accumulated when it gets around to using a frame. Safe to
+// use from multiple threads.
+class DamageTracker
+{
+public:
+    DamageTracker() {}
+    ~DamageTracker() {}
+
+    // Consumers start out needing the whole frame
+    size_t AddConsumer();
+    // nullopt means we don't know what changed, so everything did
+    void AddFrame(std::optional<std::vector<RECT>> const& dirtyRects);
+    // Returns nullopt if the consumer needs the whole frame, otherwise
+    // non-overlapping rects covering everything since the last call.
+    std::optional<std::vector<RECT>> Take(size_t consumer);
+    void Invalidate(size_t consumer);
+
+private:
+    struct Consumer
+    {
+        DamageRegion Region;
+        bool Everything = true;
+    };
+
+    std::mutex m_lock;
+    std::vector<Consumer> m_consumers;
+};
\ No newline at end of file
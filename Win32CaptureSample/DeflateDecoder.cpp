@@ -0,0 +1,328 @@
+#include "pch.h"
+#include "DeflateDecoder.h"
+#include "DeflateEncoder.h"
+
+uint32_t const MaxCodeBits = 15;
+uint32_t const LiteralCodeCount = 288;
+uint32_t const DistanceCodeCount = 30;
+uint32_t const EndOfBlock = 256;
+
+// Base values and extra bits for length codes 257-285 and distance codes 0-29
+uint16_t const LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+uint8_t const LengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+uint16_t const DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+uint8_t const DistanceExtraBits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+// The order code length code lengths are written in
+uint8_t const CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+[[noreturn]] void ThrowInvalidDeflateStream()
+{
+    throw winrt::hresult_error(E_INVALIDARG, L"Invalid deflate stream!");
+}
+
+class DeflateBitReader
+{
+public:
+    DeflateBitReader(std::span<uint8_t const> input) : m_input(input) {}
+
+    // Deflate packs bits starting from the least significant one
+    uint32_t Read(uint32_t count)
+    {
+        while (m_count < count)
+        {
+            if (m_position >= m_input.size())
+            {
+                ThrowInvalidDeflateStream();
+            }
+            m_buffer |= static_cast<uint32_t>(m_input[m_position++]) << m_count;
+            m_count += 8;
+        }
+        auto value = m_buffer & ((1u << count) - 1);
+        m_buffer = count < 32 ? m_buffer >> count : 0;
+        m_count -= count;
+        return value;
+    }
+
+    // Stored blocks and the trailer start on a byte
+    void AlignToByte()
+    {
+        m_buffer = 0;
+        m_count = 0;
+    }
+
+    uint8_t const* Take(size_t size)
+    {
+        if (size > m_input.size() - m_position)
+        {
+            ThrowInvalidDeflateStream();
+        }
+        auto result = m_input.data() + m_position;
+        m_position += size;
+        return result;
+    }
+
+    size_t Position() const { return m_position; }
+
+private:
+    std::span<uint8_t const> m_input;
+    size_t m_position = 0;
+    uint32_t m_buffer = 0;
+    uint32_t m_count = 0;
+};
+
+// Canonical Huffman codes, decoded by walking down one length at a time
+class HuffmanTable
+{
+public:
+    HuffmanTable(uint8_t const* lengths, uint32_t count)
+    {
+        for (uint32_t symbol = 0; symbol < count; symbol++)
+        {
+            m_counts[lengths[symbol]]++;
+        }
+        m_counts[0] = 0;
+
+        // More codes than there's room for can't be decoded. Fewer is fine,
+        // e.g. a block with only one distance.
+        int32_t left = 1;
+        for (uint32_t length = 1; length <= MaxCodeBits; length++)
+        {
+            left = (left << 1) - m_counts[length];
+            if (left < 0)
+            {
+                ThrowInvalidDeflateStream();
+            }
+        }
+
+        uint16_t offsets[MaxCodeBits + 1] = {};
+        for (uint32_t length = 1; length < MaxCodeBits; length++)
+        {
+            offsets[length + 1] = offsets[length] + m_counts[length];
+        }
+        for (uint32_t symbol = 0; symbol < count; symbol++)
+        {
+            if (lengths[symbol] != 0)
+            {
+                m_symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+            }
+        }
+    }
+
+    uint32_t Decode(DeflateBitReader& reader) const
+    {
+        // Codes are written starting from their most significant bit
+        int32_t code = 0;
+        int32_t first = 0;
+        int32_t index = 0;
+        for (uint32_t length = 1; length <= MaxCodeBits; length++)
+        {
+            code |= static_cast<int32_t>(reader.Read(1));
+            auto count = static_cast<int32_t>(m_counts[length]);
+            if (code - first < count)
+            {
+                return m_symbols[index + code - first];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        ThrowInvalidDeflateStream();
+    }
+
+private:
+    uint16_t m_counts[MaxCodeBits + 1] = {};
+    uint16_t m_symbols[LiteralCodeCount] = {};
+};
+
+class BlockInflater
+{
+public:
+    BlockInflater(DeflateBitReader& reader, std::span<uint8_t> output) : m_reader(reader), m_output(output) {}
+
+    size_t Written() const { return m_written; }
+
+    void Stored()
+    {
+        m_reader.AlignToByte();
+        auto header = m_reader.Take(4);
+        auto length = static_cast<uint32_t>(header[0] | (header[1] << 8));
+        auto complement = static_cast<uint32_t>(header[2] | (header[3] << 8));
+        if ((length ^ 0xFFFF) != complement || length > m_output.size() - m_written)
+        {
+            ThrowInvalidDeflateStream();
+        }
+        memcpy(m_output.data() + m_written, m_reader.Take(length), length);
+        m_written += length;
+    }
+
+    void Fixed()
+    {
+        uint8_t lengths[LiteralCodeCount] = {};
+        std::fill(lengths, lengths + 144, static_cast<uint8_t>(8));
+        std::fill(lengths + 144, lengths + 256, static_cast<uint8_t>(9));
+        std::fill(lengths + 256, lengths + 280, static_cast<uint8_t>(7));
+        std::fill(lengths + 280, lengths + 288, static_cast<uint8_t>(8));
+        uint8_t distanceLengths[DistanceCodeCount];
+        std::fill(std::begin(distanceLengths), std::end(distanceLengths), static_cast<uint8_t>(5));
+        Codes(HuffmanTable(lengths, LiteralCodeCount), HuffmanTable(distanceLengths, DistanceCodeCount));
+    }
+
+    void Dynamic()
+    {
+        auto literalCount = m_reader.Read(5) + 257;
+        auto distanceCount = m_reader.Read(5) + 1;
+        auto codeLengthCount = m_reader.Read(4) + 4;
+        if (literalCount > 286 || distanceCount > DistanceCodeCount)
+        {
+            ThrowInvalidDeflateStream();
+        }
+
+        uint8_t codeLengthLengths[19] = {};
+        for (uint32_t i = 0; i < codeLengthCount; i++)
+        {
+            codeLengthLengths[CodeLengthOrder[i]] = static_cast<uint8_t>(m_reader.Read(3));
+        }
+        HuffmanTable codeLengthTable(codeLengthLengths, 19);
+
+        // The literal and distance code lengths are one run, repeats can
+        // cross from one to the other
+        uint8_t lengths[286 + DistanceCodeCount] = {};
+        uint32_t index = 0;
+        while (index < literalCount + distanceCount)
+        {
+            auto symbol = codeLengthTable.Decode(m_reader);
+            if (symbol < 16)
+            {
+                lengths[index++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            uint8_t value = 0;
+            uint32_t repeat = 0;
+            if (symbol == 16)
+            {
+                if (index == 0)
+                {
+                    ThrowInvalidDeflateStream();
+                }
+                value = lengths[index - 1];
+                repeat = 3 + m_reader.Read(2);
+            }
+            else if (symbol == 17)
+            {
+                repeat = 3 + m_reader.Read(3);
+            }
+            else
+            {
+                repeat = 11 + m_reader.Read(7);
+            }
+            if (index + repeat > literalCount + distanceCount)
+            {
+                ThrowInvalidDeflateStream();
+            }
+            std::fill(lengths + index, lengths + index + repeat, value);
+            index += repeat;
+        }
+        if (lengths[EndOfBlock] == 0)
+        {
+            ThrowInvalidDeflateStream();
+        }
+        Codes(HuffmanTable(lengths, literalCount), HuffmanTable(lengths + literalCount, distanceCount));
+    }
+
+private:
+    void Codes(HuffmanTable const& literals, HuffmanTable const& distances)
+    {
+        while (true)
+        {
+            auto symbol = literals.Decode(m_reader);
+            if (symbol < 256)
+            {
+                if (m_written >= m_output.size())
+                {
+                    ThrowInvalidDeflateStream();
+                }
+                m_output[m_written++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == EndOfBlock)
+            {
+                return;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29)
+            {
+                ThrowInvalidDeflateStream();
+            }
+            size_t length = LengthBase[symbol] + m_reader.Read(LengthExtraBits[symbol]);
+            auto distanceSymbol = distances.Decode(m_reader);
+            if (distanceSymbol >= DistanceCodeCount)
+            {
+                ThrowInvalidDeflateStream();
+            }
+            size_t distance = DistanceBase[distanceSymbol] + m_reader.Read(DistanceExtraBits[distanceSymbol]);
+            if (distance > m_written || length > m_output.size() - m_written)
+            {
+                ThrowInvalidDeflateStream();
+            }
+            // Matches can overlap what they're writing, so byte by byte
+            auto destination = m_output.data() + m_written;
+            for (size_t i = 0; i < length; i++)
+            {
+                destination[i] = destination[i - distance];
+            }
+            m_written += length;
+        }
+    }
+
+private:
+    DeflateBitReader& m_reader;
+    std::span<uint8_t> m_output;
+    size_t m_written = 0;
+};
+
+size_t DeflateDecoder::Decompress(std::span<uint8_t const> input, std::span<uint8_t> output)
+{
+    DeflateBitReader reader(input);
+    // zlib header: deflate with at most a 32K window, no preset dictionary
+    auto header = reader.Take(2);
+    if ((header[0] & 0x0F) != 8 || (header[0] >> 4) > 7 || ((header[0] << 8) | header[1]) % 31 != 0 || (header[1] & 0x20) != 0)
+    {
+        ThrowInvalidDeflateStream();
+    }
+
+    BlockInflater inflater(reader, output);
+    auto last = false;
+    while (!last)
+    {
+        last = reader.Read(1) != 0;
+        switch (reader.Read(2))
+        {
+        case 0:
+            inflater.Stored();
+            break;
+        case 1:
+            inflater.Fixed();
+            break;
+        case 2:
+            inflater.Dynamic();
+            break;
+        default:
+            ThrowInvalidDeflateStream();
+        }
+    }
+    if (inflater.Written() != output.size())
+    {
+        ThrowInvalidDeflateStream();
+    }
+
+    reader.AlignToByte();
+    auto trailer = reader.Take(4);
+    auto adler = (static_cast<uint32_t>(trailer[0]) << 24) | (static_cast<uint32_t>(trailer[1]) << 16) |
+        (static_cast<uint32_t>(trailer[2]) << 8) | trailer[3];
+    if (adler != ComputeAdler32(output))
+    {
+        ThrowInvalidDeflateStream();
+    }
+    return reader.Position();
+}
\ No newline at end of file
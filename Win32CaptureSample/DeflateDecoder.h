@@ -0,0 +1,17 @@
+#pragma once
+
+// Reads the zlib streams (RFC 1950 wrapping RFC 1951 deflate) that
+// DeflateEncoder writes, or any other encoder, for the formats that use
+// them. Decodes a bit at a time, which is plenty for reading back our own
+// files. Everything is bounds checked and corrupt streams throw. Safe to
+// call from several threads.
+class DeflateDecoder
+{
+public:
+    // The stream has to decompress to exactly output.size() bytes. Returns
+    // how many bytes of the input it used, there can be more after it.
+    static size_t Decompress(std::span<uint8_t const> input, std::span<uint8_t> output);
+
+private:
+    DeflateDecoder() = delete;
+};
\ No newline at end of file
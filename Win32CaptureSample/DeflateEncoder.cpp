@@ -0,0 +1,435 @@
+#include "pch.h"
+#include "DeflateEncoder.h"
+
+int32_t const WindowSize = 32768;
+uint32_t const MinMatch = 3;
+uint32_t const MaxMatch = 258;
+uint32_t const HashBits = 15;
+uint32_t const MaxChainLength = 32;
+size_t const MaxBlockSymbols = 1 << 15;
+uint32_t const EndOfBlock = 256;
+
+// Base values and extra bits for length codes 257-285 and distance codes 0-29
+uint16_t const LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+uint8_t const LengthExtraBits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+uint16_t const DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+uint8_t const DistanceExtraBits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+// The order code length code lengths are written in
+uint8_t const CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+struct Symbol
+{
+    // A literal byte when Distance is 0, otherwise a match length
+    uint16_t Value;
+    uint16_t Distance;
+};
+
+struct CodeLengthSymbol
+{
+    uint8_t Code;
+    uint8_t ExtraValue;
+    uint8_t ExtraBits;
+};
+
+class BitWriter
+{
+public:
+    BitWriter(std::vector<uint8_t>& output) : m_output(output) {}
+
+    // Deflate packs bits starting from the least significant one
+    void Write(uint32_t value, uint32_t count)
+    {
+        m_buffer |= static_cast<uint64_t>(value) << m_count;
+        m_count += count;
+        while (m_count >= 8)
+        {
+            m_output.push_back(static_cast<uint8_t>(m_buffer));
+            m_buffer >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    void Flush()
+    {
+        if (m_count > 0)
+        {
+            m_output.push_back(static_cast<uint8_t>(m_buffer));
+        }
+        m_buffer = 0;
+        m_count = 0;
+    }
+
+private:
+    std::vector<uint8_t>& m_output;
+    uint64_t m_buffer = 0;
+    uint32_t m_count = 0;
+};
+
+uint32_t GetLengthCode(uint32_t length)
+{
+    auto search = std::upper_bound(std::begin(LengthBase), std::end(LengthBase), length);
+    return static_cast<uint32_t>(search - std::begin(LengthBase)) - 1;
+}
+
+uint32_t GetDistanceCode(uint32_t distance)
+{
+    auto search = std::upper_bound(std::begin(DistanceBase), std::end(DistanceBase), distance);
+    return static_cast<uint32_t>(search - std::begin(DistanceBase)) - 1;
+}
+
+// Regular Huffman code lengths, flattened until nothing is longer than
+// maxBits. Halving the frequencies keeps the rare symbols rare without
+// letting them get too deep, and converges quickly.
+std::vector<uint8_t> BuildCodeLengths(std::vector<uint32_t> frequencies, uint32_t maxBits)
+{
+    // Decoders want at least two codes in every table
+    auto used = std::count_if(frequencies.begin(), frequencies.end(), [](auto value) { return value > 0; });
+    for (size_t i = 0; i < frequencies.size() && used < 2; i++)
+    {
+        if (frequencies[i] == 0)
+        {
+            frequencies[i] = 1;
+            used++;
+        }
+    }
+
+    while (true)
+    {
+        // Leaves come first, and every internal node is added after its children
+        std::vector<int32_t> parents(frequencies.size() * 2, -1);
+        using Node = std::pair<uint64_t, int32_t>;
+        std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+        for (size_t i = 0; i < frequencies.size(); i++)
+        {
+            if (frequencies[i] > 0)
+            {
+                queue.push({ frequencies[i], static_cast<int32_t>(i) });
+            }
+        }
+        auto nextNode = static_cast<int32_t>(frequencies.size());
+        while (queue.size() > 1)
+        {
+            auto left = queue.top();
+            queue.pop();
+            auto right = queue.top();
+            queue.pop();
+            parents[left.second] = nextNode;
+            parents[right.second] = nextNode;
+            queue.push({ left.first + right.first, nextNode });
+            nextNode++;
+        }
+
+        std::vector<uint32_t> depths(nextNode, 0);
+        for (auto node = nextNode - 1; node >= 0; node--)
+        {
+            if (parents[node] >= 0)
+            {
+                depths[node] = depths[parents[node]] + 1;
+            }
+        }
+
+        std::vector<uint8_t> lengths(frequencies.size(), 0);
+        auto fits = true;
+        for (size_t i = 0; i < frequencies.size(); i++)
+        {
+            if (frequencies[i] > 0)
+            {
+                lengths[i] = static_cast<uint8_t>(depths[i]);
+                fits = fits && depths[i] <= maxBits;
+            }
+        }
+        if (fits)
+        {
+            return lengths;
+        }
+        for (auto&& frequency : frequencies)
+        {
+            frequency = (frequency + 1) / 2;
+        }
+    }
+}
+
+// Canonical codes (RFC 1951 3.2.2), bit reversed so they can go straight
+// into the BitWriter
+std::vector<uint16_t> BuildCodes(std::vector<uint8_t> const& lengths)
+{
+    std::array<uint16_t, 16> lengthCounts = {};
+    for (auto&& length : lengths)
+    {
+        lengthCounts[length]++;
+    }
+    lengthCounts[0] = 0;
+    std::array<uint16_t, 16> nextCode = {};
+    uint16_t code = 0;
+    for (size_t bits = 1; bits < nextCode.size(); bits++)
+    {
+        code = static_cast<uint16_t>((code + lengthCounts[bits - 1]) << 1);
+        nextCode[bits] = code;
+    }
+
+    std::vector<uint16_t> codes(lengths.size(), 0);
+    for (size_t i = 0; i < lengths.size(); i++)
+    {
+        auto length = lengths[i];
+        if (length == 0)
+        {
+            continue;
+        }
+        auto value = nextCode[length]++;
+        uint16_t reversed = 0;
+        for (uint32_t bit = 0; bit < length; bit++)
+        {
+            reversed = static_cast<uint16_t>((reversed << 1) | ((value >> bit) & 1));
+        }
+        codes[i] = reversed;
+    }
+    return codes;
+}
+
+// Run-length encodes the literal/length and distance code lengths with
+// the code length alphabet (RFC 1951 3.2.7)
+std::vector<CodeLengthSymbol> EncodeCodeLengths(std::vector<uint8_t> const& lengths)
+{
+    std::vector<CodeLengthSymbol> result;
+    size_t i = 0;
+    while (i < lengths.size())
+    {
+        auto value = lengths[i];
+        size_t run = 1;
+        while (i + run < lengths.size() && lengths[i + run] == value)
+        {
+            run++;
+        }
+        i += run;
+
+        if (value == 0)
+        {
+            while (run >= 11)
+            {
+                auto count = std::min<size_t>(run, 138);
+                result.push_back({ 18, static_cast<uint8_t>(count - 11), 7 });
+                run -= count;
+            }
+            if (run >= 3)
+            {
+                result.push_back({ 17, static_cast<uint8_t>(run - 3), 3 });
+                run = 0;
+            }
+        }
+        else
+        {
+            result.push_back({ value, 0, 0 });
+            run--;
+            while (run >= 3)
+            {
+                auto count = std::min<size_t>(run, 6);
+                result.push_back({ 16, static_cast<uint8_t>(count - 3), 2 });
+                run -= count;
+            }
+        }
+        for (; run > 0; run--)
+        {
+            result.push_back({ value, 0, 0 });
+        }
+    }
+    return result;
+}
+
+void WriteBlock(BitWriter& writer, std::vector<Symbol> const& symbols, bool isFinal)
+{
+    std::vector<uint32_t> literalFrequencies(286, 0);
+    std::vector<uint32_t> distanceFrequencies(30, 0);
+    for (auto&& symbol : symbols)
+    {
+        if (symbol.Distance == 0)
+        {
+            literalFrequencies[symbol.Value]++;
+        }
+        else
+        {
+            literalFrequencies[257 + GetLengthCode(symbol.Value)]++;
+            distanceFrequencies[GetDistanceCode(symbol.Distance)]++;
+        }
+    }
+    literalFrequencies[EndOfBlock]++;
+
+    auto literalLengths = BuildCodeLengths(literalFrequencies, 15);
+    auto distanceLengths = BuildCodeLengths(distanceFrequencies, 15);
+    auto literalCodes = BuildCodes(literalLengths);
+    auto distanceCodes = BuildCodes(distanceLengths);
+
+    // Trailing unused codes don't need to be written
+    size_t literalCount = 286;
+    while (literalCount > 257 && literalLengths[literalCount - 1] == 0)
+    {
+        literalCount--;
+    }
+    size_t distanceCount = 30;
+    while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0)
+    {
+        distanceCount--;
+    }
+    std::vector<uint8_t> allLengths(literalLengths.begin(), literalLengths.begin() + literalCount);
+    allLengths.insert(allLengths.end(), distanceLengths.begin(), distanceLengths.begin() + distanceCount);
+    auto codeLengthSymbols = EncodeCodeLengths(allLengths);
+
+    std::vector<uint32_t> codeLengthFrequencies(19, 0);
+    for (auto&& symbol : codeLengthSymbols)
+    {
+        codeLengthFrequencies[symbol.Code]++;
+    }
+    auto codeLengthLengths = BuildCodeLengths(codeLengthFrequencies, 7);
+    auto codeLengthCodes = BuildCodes(codeLengthLengths);
+    size_t codeLengthCount = 19;
+    while (codeLengthCount > 4 && codeLengthLengths[CodeLengthOrder[codeLengthCount - 1]] == 0)
+    {
+        codeLengthCount--;
+    }
+
+    // Block header, type 2 is dynamic Huffman codes
+    writer.Write(isFinal ? 1 : 0, 1);
+    writer.Write(2, 2);
+    writer.Write(static_cast<uint32_t>(literalCount - 257), 5);
+    writer.Write(static_cast<uint32_t>(distanceCount - 1), 5);
+    writer.Write(static_cast<uint32_t>(codeLengthCount - 4), 4);
+    for (size_t i = 0; i < codeLengthCount; i++)
+    {
+        writer.Write(codeLengthLengths[CodeLengthOrder[i]], 3);
+    }
+    for (auto&& symbol : codeLengthSymbols)
+    {
+        writer.Write(codeLengthCodes[symbol.Code], codeLengthLengths[symbol.Code]);
+        writer.Write(symbol.ExtraValue, symbol.ExtraBits);
+    }
+
+    for (auto&& symbol : symbols)
+    {
+        if (symbol.Distance == 0)
+        {
+            writer.Write(literalCodes[symbol.Value], literalLengths[symbol.Value]);
+        }
+        else
+        {
+            auto lengthCode = GetLengthCode(symbol.Value);
+            writer.Write(literalCodes[257 + lengthCode], literalLengths[257 + lengthCode]);
+            writer.Write(symbol.Value - LengthBase[lengthCode], LengthExtraBits[lengthCode]);
+            auto distanceCode = GetDistanceCode(symbol.Distance);
+            writer.Write(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+            writer.Write(symbol.Distance - DistanceBase[distanceCode], DistanceExtraBits[distanceCode]);
+        }
+    }
+    writer.Write(literalCodes[EndOfBlock], literalLengths[EndOfBlock]);
+}
+
+uint32_t ComputeAdler32(std::span<uint8_t const> input)
+{
+    // 5552 is the most bytes we can sum before the low half could overflow
+    uint32_t const modulus = 65521;
+    uint32_t low = 1;
+    uint32_t high = 0;
+    size_t offset = 0;
+    while (offset < input.size())
+    {
+        auto end = std::min(offset + 5552, input.size());
+        for (; offset < end; offset++)
+        {
+            low += input[offset];
+            high += low;
+        }
+        low %= modulus;
+        high %= modulus;
+    }
+    return (high << 16) | low;
+}
+
+std::vector<uint8_t> DeflateEncoder::Compress(std::span<uint8_t const> input)
+{
+    std::vector<uint8_t> output;
+    output.reserve(input.size() / 2 + 64);
+    // zlib header: deflate with a 32K window, no preset dictionary
+    output.push_back(0x78);
+    output.push_back(0x9c);
+
+    BitWriter writer(output);
+    std::vector<int32_t> head(1 << HashBits, -1);
+    std::vector<int32_t> previous(WindowSize, -1);
+    auto hash = [&](size_t position)
+    {
+        uint32_t value = input[position] | (input[position + 1] << 8) | (input[position + 2] << 16);
+        return (value * 2654435761u) >> (32 - HashBits);
+    };
+    auto insert = [&](size_t position)
+    {
+        auto key = hash(position);
+        previous[position % WindowSize] = head[key];
+        head[key] = static_cast<int32_t>(position);
+    };
+
+    std::vector<Symbol> symbols;
+    symbols.reserve(MaxBlockSymbols);
+    size_t position = 0;
+    while (position < input.size())
+    {
+        uint32_t bestLength = 0;
+        uint32_t bestDistance = 0;
+        if (position + MinMatch <= input.size())
+        {
+            auto maxLength = static_cast<uint32_t>(std::min<size_t>(MaxMatch, input.size() - position));
+            auto candidate = head[hash(position)];
+            auto chain = MaxChainLength;
+            while (candidate >= 0 && static_cast<int32_t>(position) - candidate <= WindowSize && chain-- > 0)
+            {
+                // Only worth comparing if it could beat what we have
+                if (input[candidate + bestLength] == input[position + bestLength])
+                {
+                    uint32_t length = 0;
+                    while (length < maxLength && input[candidate + length] == input[position + length])
+                    {
+                        length++;
+                    }
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = static_cast<uint32_t>(position - candidate);
+                        if (length == maxLength)
+                        {
+                            break;
+                        }
+                    }
+                }
+                candidate = previous[candidate % WindowSize];
+            }
+            insert(position);
+        }
+
+        if (bestLength >= MinMatch)
+        {
+            symbols.push_back({ static_cast<uint16_t>(bestLength), static_cast<uint16_t>(bestDistance) });
+            for (size_t i = position + 1; i < position + bestLength && i + MinMatch <= input.size(); i++)
+            {
+                insert(i);
+            }
+            position += bestLength;
+        }
+        else
+        {
+            symbols.push_back({ input[position], 0 });
+            position++;
+        }
+
+        if (symbols.size() >= MaxBlockSymbols)
+        {
+            WriteBlock(writer, symbols, false);
+            symbols.clear();
+        }
+    }
+    WriteBlock(writer, symbols, true);
+    writer.Flush();
+
+    auto adler = ComputeAdler32(input);
+    output.push_back(static_cast<uint8_t>(adler >> 24));
+    output.push_back(static_cast<uint8_t>(adler >> 16));
+    output.push_back(static_cast<uint8_t>(adler >> 8));
+    output.push_back(static_cast<uint8_t>(adler));
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+// Produces zlib streams (RFC 1950 wrapping RFC 1951 deflate) for formats
+// that require them, without taking a dependency on zlib. Matches are found
+// greedily with hash chains over a 32K window, and every block gets its own
+// Huffman codes. That gives up a little ratio compared to zlib's default
+// level in exchange for being quicker. Safe to call from several threads.
+class DeflateEncoder
+{
+public:
+    static std::vector<uint8_t> Compress(std::span<uint8_t const> input);
+
+private:
+    DeflateEncoder() = delete;
+};
+
+// zlib's checksum, also checked by DeflateDecoder
+uint32_t ComputeAdler32(std::span<uint8_t const> input);
\ No newline at end of file
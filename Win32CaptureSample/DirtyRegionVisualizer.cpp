@@ -28,6 +28,8 @@ DirtyRegionVisualizer::DirtyRegionVisualizer(winrt::com_ptr<ID3D11Device> const&
     
     D2D1_COLOR_F color = { 1.0f, 0.0f, 0.0f, 0.6f };
     winrt::check_hresult(m_d2dContext->CreateSolidColorBrush(color, m_brush.put()));
+    D2D1_COLOR_F moveColor = { 0.0f, 1.0f, 0.0f, 0.4f };
+    winrt::check_hresult(m_d2dContext->CreateSolidColorBrush(moveColor, m_moveBrush.put()));
 }
 
 void DirtyRegionVisualizer::Render(
@@ -69,3 +71,124 @@ void DirtyRegionVisualizer::Render(
         }
     }
 }
+
+
+void DirtyRegionVisualizer::RenderMotion(
+    winrt::com_ptr<ID3D11Texture2D> const& renderTargetTexture,
+    std::vector<FrameMotion> const& motion)
+{
+    if (!motion.empty())
+    {
+        auto dxgiTexture = renderTargetTexture.as<IDXGISurface>();
+        winrt::com_ptr<ID2D1Bitmap1> d2dBitmap;
+        winrt::check_hresult(m_d2dContext->CreateBitmapFromDxgiSurface(dxgiTexture.get(), nullptr, d2dBitmap.put()));
+
+        m_d2dContext->SetTarget(d2dBitmap.get());
+        auto unsetTarget = wil::scope_exit([d2dContext = m_d2dContext]()
+            {
+                d2dContext->SetTarget(nullptr);
+            });
+
+        m_d2dContext->BeginDraw();
+        auto endDraw = wil::scope_exit([d2dContext = m_d2dContext]()
+            {
+                winrt::check_hresult(d2dContext->EndDraw());
+            });
+
+        auto toRectF = [](RECT const& rect)
+        {
+            return D2D1_RECT_F
+            {
+                static_cast<float>(rect.left),
+                static_cast<float>(rect.top),
+                static_cast<float>(rect.right),
+                static_cast<float>(rect.bottom),
+            };
+        };
+        for (auto&& regionMotion : motion)
+        {
+            for (auto&& move : regionMotion.Moves)
+            {
+                m_d2dContext->FillRectangle(toRectF(move.Destination), m_moveBrush.get());
+            }
+            for (auto&& residual : regionMotion.Residual)
+            {
+                m_d2dContext->FillRectangle(toRectF(residual), m_brush.get());
+            }
+        }
+    }
+}
+
+// Premultiplied BGRA. Rates are on a log scale so that both a blinking
+// caret and a video stand out from the rest.
+uint32_t GetHeatmapColor(float rate)
+{
+    float const MinRate = 0.1f;
+    float const MaxRate = 60.0f;
+    if (rate < MinRate)
+    {
+        return 0;
+    }
+    auto heat = std::clamp(std::log2(rate / MinRate) / std::log2(MaxRate / MinRate), 0.0f, 1.0f);
+    float red = std::min(heat * 2.0f, 1.0f);
+    float green = heat < 0.5f ? heat * 2.0f : (1.0f - heat) * 2.0f;
+    float blue = std::max(1.0f - heat * 2.0f, 0.0f);
+    float alpha = 0.25f + heat * 0.4f;
+    auto toByte = [alpha](float value)
+    {
+        return static_cast<uint32_t>(value * alpha * 255.0f + 0.5f);
+    };
+    return (toByte(1.0f) << 24) | (toByte(red) << 16) | (toByte(green) << 8) | toByte(blue);
+}
+
+void DirtyRegionVisualizer::RenderHeatmap(
+    winrt::com_ptr<ID3D11Texture2D> const& renderTargetTexture,
+    RepaintHeatmap const& heatmap)
+{
+    auto columns = heatmap.Columns();
+    auto rows = heatmap.Rows();
+    if (columns == 0 || rows == 0)
+    {
+        return;
+    }
+
+    heatmap.Rates(m_heatmapRates);
+    m_heatmapPixels.resize(m_heatmapRates.size());
+    std::transform(m_heatmapRates.begin(), m_heatmapRates.end(), m_heatmapPixels.begin(), GetHeatmapColor);
+
+    auto pitch = columns * static_cast<uint32_t>(sizeof(uint32_t));
+    auto bitmapSize = m_heatmapBitmap != nullptr ? m_heatmapBitmap->GetPixelSize() : D2D1_SIZE_U{};
+    if (bitmapSize.width != columns || bitmapSize.height != rows)
+    {
+        auto properties = D2D1::BitmapProperties1(
+            D2D1_BITMAP_OPTIONS_NONE,
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+        m_heatmapBitmap = nullptr;
+        winrt::check_hresult(m_d2dContext->CreateBitmap(D2D1::SizeU(columns, rows), m_heatmapPixels.data(), pitch, properties, m_heatmapBitmap.put()));
+    }
+    else
+    {
+        winrt::check_hresult(m_heatmapBitmap->CopyFromMemory(nullptr, m_heatmapPixels.data(), pitch));
+    }
+
+    auto dxgiTexture = renderTargetTexture.as<IDXGISurface>();
+    winrt::com_ptr<ID2D1Bitmap1> d2dBitmap;
+    winrt::check_hresult(m_d2dContext->CreateBitmapFromDxgiSurface(dxgiTexture.get(), nullptr, d2dBitmap.put()));
+
+    m_d2dContext->SetTarget(d2dBitmap.get());
+    auto unsetTarget = wil::scope_exit([d2dContext = m_d2dContext]()
+        {
+            d2dContext->SetTarget(nullptr);
+        });
+
+    m_d2dContext->BeginDraw();
+    auto endDraw = wil::scope_exit([d2dContext = m_d2dContext]()
+        {
+            winrt::check_hresult(d2dContext->EndDraw());
+        });
+
+    // The last row and column can hang off the edge, the target clips them
+    auto cellSize = static_cast<float>(heatmap.CellSize());
+    D2D1_RECT_F destination = { 0.0f, 0.0f, columns * cellSize, rows * cellSize };
+    m_d2dContext->DrawBitmap(m_heatmapBitmap.get(), destination, 1.0f, D2D1_INTERPOLATION_MODE_NEAREST_NEIGHBOR, nullptr);
+}
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include "ScrollDetector.h"
+#include "RepaintHeatmap.h"
 
 class DirtyRegionVisualizer
 {
@@ -10,10 +12,24 @@ public:
     void Render(
         winrt::com_ptr<ID3D11Texture2D> const& renderTargetTexture,
         winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame const& captureFrame);
+    // Draws moved blocks in green and the residual in red
+    void RenderMotion(
+        winrt::com_ptr<ID3D11Texture2D> const& renderTargetTexture,
+        std::vector<FrameMotion> const& motion);
+    // Colors each cell by how often it gets repainted, from clear through
+    // blue and yellow to red
+    void RenderHeatmap(
+        winrt::com_ptr<ID3D11Texture2D> const& renderTargetTexture,
+        RepaintHeatmap const& heatmap);
 
 private:
     winrt::com_ptr<ID2D1Device> m_d2dDevice{ nullptr };
     winrt::com_ptr<ID2D1Factory1> m_d2dFactory{ nullptr };
     winrt::com_ptr<ID2D1DeviceContext> m_d2dContext{ nullptr };
     winrt::com_ptr<ID2D1SolidColorBrush> m_brush{ nullptr };
+    winrt::com_ptr<ID2D1SolidColorBrush> m_moveBrush{ nullptr };
+    // One pixel per cell, scaled up when drawn
+    winrt::com_ptr<ID2D1Bitmap1> m_heatmapBitmap{ nullptr };
+    std::vector<float> m_heatmapRates;
+    std::vector<uint32_t> m_heatmapPixels;
 };
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "pch.h"
+#include "EncodeProgress.h"
+
+// Readback is quick, encoding is what takes time
+double const ReadBackProgress = 0.2;
+double const PreparedProgress = 0.3;
+double const EncodedProgress = 0.9;
+
+EncodeProgress::EncodeProgress(std::function<void(double)> report, std::function<bool()> isCanceled) :
+    m_report(std::move(report)),
+    m_isCanceled(std::move(isCanceled))
+{
+}
+
+bool EncodeProgress::Started()
+{
+    return Report(0.0);
+}
+
+bool EncodeProgress::ReadBack()
+{
+    return Report(ReadBackProgress);
+}
+
+bool EncodeProgress::Prepared()
+{
+    return Report(PreparedProgress);
+}
+
+bool EncodeProgress::WroteRows(uint32_t rowsWritten, uint32_t height)
+{
+    auto fraction = height == 0 ? 1.0 : std::min(1.0, static_cast<double>(rowsWritten) / height);
+    return Report(PreparedProgress + (EncodedProgress - PreparedProgress) * fraction);
+}
+
+bool EncodeProgress::Encoded()
+{
+    return Report(EncodedProgress);
+}
+
+bool EncodeProgress::Saved()
+{
+    return Report(1.0);
+}
+
+bool EncodeProgress::Report(double value)
+{
+    if (m_stopped || m_isCanceled())
+    {
+        m_stopped = true;
+        return false;
+    }
+    if (value > m_lastReported)
+    {
+        m_lastReported = value;
+        m_report(value);
+    }
+    return true;
+}
\ No newline at end of file
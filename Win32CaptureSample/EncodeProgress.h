@@ -0,0 +1,29 @@
+#pragma once
+
+// The progress an encode reports, from 0 to 1, and where it checks whether
+// it was canceled. Each step returns false if the encode should stop, in
+// which case nothing more is reported. Progress only ever goes up and the
+// same value isn't reported twice. Not thread safe.
+class EncodeProgress
+{
+public:
+    EncodeProgress(std::function<void(double)> report, std::function<bool()> isCanceled);
+    ~EncodeProgress() {}
+
+    bool Started();
+    bool ReadBack();
+    bool Prepared();
+    // Writing rows is most of the work for the formats WIC encodes
+    bool WroteRows(uint32_t rowsWritten, uint32_t height);
+    bool Encoded();
+    bool Saved();
+
+private:
+    bool Report(double value);
+
+private:
+    std::function<void(double)> m_report;
+    std::function<bool()> m_isCanceled;
+    double m_lastReported = -1.0;
+    bool m_stopped = false;
+};
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "pch.h"
+#include "EncodeSlots.h"
+
+EncodeSlots::EncodeSlots(uint32_t count) : m_freeSlots(std::max(count, 1u))
+{
+}
+
+void EncodeSlots::Acquire(std::function<void()> onAcquired)
+{
+    {
+        auto lock = std::scoped_lock(m_lock);
+        // Slots only come free when nobody is waiting, so a newcomer can't
+        // jump the queue
+        if (m_freeSlots == 0)
+        {
+            m_waiting.push_back(std::move(onAcquired));
+            return;
+        }
+        m_freeSlots--;
+    }
+    onAcquired();
+}
+
+void EncodeSlots::Release()
+{
+    std::function<void()> next;
+    {
+        auto lock = std::scoped_lock(m_lock);
+        if (m_waiting.empty())
+        {
+            m_freeSlots++;
+            return;
+        }
+        // The slot goes straight to the next in line
+        next = std::move(m_waiting.front());
+        m_waiting.pop_front();
+    }
+    next();
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+// Limits how many snapshots encode at once. Slots are handed out in the
+// order they were asked for, so snapshots finish about in the order they
+// were taken. Thread safe.
+class EncodeSlots
+{
+public:
+    EncodeSlots(uint32_t count);
+    ~EncodeSlots() {}
+
+    // Calls onAcquired right away if a slot is free. Otherwise it's called
+    // on the thread that releases the slot it gets, so it should only
+    // signal whoever is waiting.
+    void Acquire(std::function<void()> onAcquired);
+    void Release();
+
+private:
+    std::mutex m_lock;
+    uint32_t m_freeSlots = 0;
+    std::deque<std::function<void()>> m_waiting;
+};
\ No newline at end of file
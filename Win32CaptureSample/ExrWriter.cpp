@@ -0,0 +1,174 @@
+#include "pch.h"
+#include "ExrWriter.h"
+#include "DeflateEncoder.h"
+
+// {15A08EC1-8560-4667-8B4F-6EBB00D4915C}
+winrt::guid const ExrWriter::ContainerFormat{ 0x15a08ec1, 0x8560, 0x4667, { 0x8b, 0x4f, 0x6e, 0xbb, 0x00, 0xd4, 0x91, 0x5c } };
+
+uint32_t const ExrMagic = 20000630;
+// Version 2, single part scanline image
+uint32_t const ExrVersion = 2;
+uint8_t const ZipCompression = 3;
+int32_t const HalfPixelType = 1;
+
+// EXR wants channels sorted by name, this is where each one lives in an
+// RGBA pixel
+struct Channel
+{
+    char Name;
+    uint32_t Offset;
+};
+std::array<Channel, 4> const Channels = { { { 'A', 3 }, { 'B', 2 }, { 'G', 1 }, { 'R', 0 } } };
+
+template <typename T>
+void inline WriteValue(std::vector<uint8_t>& output, T value)
+{
+    auto offset = output.size();
+    output.resize(offset + sizeof(value));
+    memcpy(output.data() + offset, &value, sizeof(value));
+}
+
+void inline WriteString(std::vector<uint8_t>& output, char const* value)
+{
+    output.insert(output.end(), value, value + strlen(value) + 1);
+}
+
+void WriteAttribute(std::vector<uint8_t>& output, char const* name, char const* type, std::vector<uint8_t> const& value)
+{
+    WriteString(output, name);
+    WriteString(output, type);
+    WriteValue(output, static_cast<int32_t>(value.size()));
+    output.insert(output.end(), value.begin(), value.end());
+}
+
+std::vector<uint8_t> CreateHeader(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> header;
+    WriteValue(header, ExrMagic);
+    WriteValue(header, ExrVersion);
+
+    std::vector<uint8_t> channels;
+    for (auto&& channel : Channels)
+    {
+        char name[2] = { channel.Name, 0 };
+        WriteString(channels, name);
+        WriteValue(channels, HalfPixelType);
+        // Perceptually linear flag and three reserved bytes
+        WriteValue(channels, static_cast<uint32_t>(0));
+        // Sampling in x and y
+        WriteValue(channels, static_cast<int32_t>(1));
+        WriteValue(channels, static_cast<int32_t>(1));
+    }
+    channels.push_back(0);
+    WriteAttribute(header, "channels", "chlist", channels);
+
+    WriteAttribute(header, "compression", "compression", { ZipCompression });
+
+    std::vector<uint8_t> window;
+    WriteValue(window, static_cast<int32_t>(0));
+    WriteValue(window, static_cast<int32_t>(0));
+    WriteValue(window, static_cast<int32_t>(width) - 1);
+    WriteValue(window, static_cast<int32_t>(height) - 1);
+    WriteAttribute(header, "dataWindow", "box2i", window);
+    WriteAttribute(header, "displayWindow", "box2i", window);
+
+    // Increasing y
+    WriteAttribute(header, "lineOrder", "lineOrder", { 0 });
+
+    std::vector<uint8_t> one;
+    WriteValue(one, 1.0f);
+    WriteAttribute(header, "pixelAspectRatio", "float", one);
+    std::vector<uint8_t> center;
+    WriteValue(center, 0.0f);
+    WriteValue(center, 0.0f);
+    WriteAttribute(header, "screenWindowCenter", "v2f", center);
+    WriteAttribute(header, "screenWindowWidth", "float", one);
+
+    header.push_back(0);
+    return header;
+}
+
+// Returns the block as it goes in the file, without the y and size fields
+std::vector<uint8_t> EncodeBlock(uint8_t const* pixels, uint32_t width, uint32_t stride, uint32_t top, uint32_t height)
+{
+    // Rows one after the other, each row one channel after the other
+    std::vector<uint8_t> raw(static_cast<size_t>(width) * height * Channels.size() * sizeof(uint16_t));
+    auto values = reinterpret_cast<uint16_t*>(raw.data());
+    for (auto y = top; y < top + height; y++)
+    {
+        auto row = reinterpret_cast<uint16_t const*>(pixels + static_cast<size_t>(y) * stride);
+        for (auto&& channel : Channels)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                *values++ = row[x * 4 + channel.Offset];
+            }
+        }
+    }
+
+    // Low bytes go in the first half and high bytes in the second, then
+    // each byte is replaced with its difference from the one before it.
+    // Neighbouring halves tend to share their high byte, so that half
+    // ends up mostly the same value.
+    std::vector<uint8_t> split(raw.size());
+    auto halfSize = (raw.size() + 1) / 2;
+    for (size_t i = 0; i < raw.size(); i++)
+    {
+        split[(i % 2) * halfSize + i / 2] = raw[i];
+    }
+    for (auto i = split.size() - 1; i > 0; i--)
+    {
+        split[i] = static_cast<uint8_t>(split[i] - split[i - 1] + 128);
+    }
+
+    auto compressed = DeflateEncoder::Compress(split);
+    if (compressed.size() >= raw.size())
+    {
+        return raw;
+    }
+    return compressed;
+}
+
+std::vector<uint8_t> ExrWriter::Encode(uint8_t const* pixels, uint32_t width, uint32_t height, uint32_t stride)
+{
+    if (width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"Invalid image size!");
+    }
+
+    auto blockCount = (height + RowsPerBlock - 1) / RowsPerBlock;
+    std::vector<std::vector<uint8_t>> blocks(blockCount);
+    std::vector<uint32_t> blockIndices(blockCount);
+    std::iota(blockIndices.begin(), blockIndices.end(), 0);
+    std::for_each(std::execution::par, blockIndices.begin(), blockIndices.end(), [&](uint32_t blockIndex)
+    {
+        auto top = blockIndex * RowsPerBlock;
+        blocks[blockIndex] = EncodeBlock(pixels, width, stride, top, std::min(RowsPerBlock, height - top));
+    });
+
+    auto output = CreateHeader(width, height);
+    // Each block is preceded by its first row and its size
+    size_t const blockHeaderSize = sizeof(int32_t) * 2;
+    auto offsetTableSize = static_cast<size_t>(blockCount) * sizeof(uint64_t);
+    uint64_t blockOffset = output.size() + offsetTableSize;
+    auto totalSize = blockOffset;
+    for (auto&& block : blocks)
+    {
+        totalSize += blockHeaderSize + block.size();
+    }
+    output.reserve(static_cast<size_t>(totalSize));
+
+    for (auto&& block : blocks)
+    {
+        WriteValue(output, blockOffset);
+        blockOffset += blockHeaderSize + block.size();
+    }
+    for (uint32_t blockIndex = 0; blockIndex < blockCount; blockIndex++)
+    {
+        auto&& block = blocks[blockIndex];
+        WriteValue(output, static_cast<int32_t>(blockIndex * RowsPerBlock));
+        WriteValue(output, static_cast<int32_t>(block.size()));
+        output.insert(output.end(), block.begin(), block.end());
+    }
+    return output;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+// Writes half float images as OpenEXR files, which keeps every bit of an
+// FP16 capture and can be opened by most HDR tools.
+//
+// Uses scanline blocks with ZIP compression: every 16 rows are split into
+// two byte planes, delta encoded and deflated. Blocks are compressed in
+// parallel. A block that doesn't get any smaller is stored as is.
+class ExrWriter
+{
+public:
+    // Passed to the snapshot encoder in place of a WIC container format
+    static winrt::guid const ContainerFormat;
+    static uint32_t const RowsPerBlock = 16;
+
+    // Pixels are DXGI_FORMAT_R16G16B16A16_FLOAT (scRGB, which is what EXR
+    // assumes when there are no chromaticities)
+    static std::vector<uint8_t> Encode(uint8_t const* pixels, uint32_t width, uint32_t height, uint32_t stride);
+
+private:
+    ExrWriter() = delete;
+};
\ No newline at end of file
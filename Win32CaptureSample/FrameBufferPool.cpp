@@ -0,0 +1,289 @@
+#include "pch.h"
+#include "FrameBufferPool.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+size_t const SmallPageSize = 4096;
+
+// One block of memory straight from the OS
+struct FrameBufferAllocation
+{
+    uint8_t* Data = nullptr;
+    size_t Capacity = 0;
+    bool LargePages = false;
+};
+
+struct FrameBufferFreeList
+{
+    std::mutex Lock;
+    std::deque<FrameBufferAllocation> Allocations;
+    size_t MaxCount = 0;
+};
+
+size_t inline RoundUp(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Makes the OS fault in every page now rather than on first touch
+void PrefaultPages(uint8_t* data, size_t size)
+{
+#if !defined(_WIN32) && defined(MADV_POPULATE_WRITE)
+    if (madvise(data, size, MADV_POPULATE_WRITE) == 0)
+    {
+        return;
+    }
+#endif
+    for (size_t offset = 0; offset < size; offset += SmallPageSize)
+    {
+        // Fresh pages are already zero, this only makes them exist
+        reinterpret_cast<volatile uint8_t*>(data)[offset] = 0;
+    }
+}
+
+#ifdef _WIN32
+// Large pages can only be used with SeLockMemoryPrivilege, which has to be
+// granted to the user and enabled on our token. It's only enabled for as
+// long as the allocation takes and then put back the way it was, so that
+// the rest of the process doesn't end up running with it. The lock keeps
+// one thread from putting it back while another is still allocating.
+std::mutex LockMemoryPrivilegeLock;
+// Cleared once we know the user wasn't granted it
+std::atomic<bool> MightHaveLockMemoryPrivilege = true;
+
+void* AllocateLargePages(size_t capacity)
+{
+    if (!MightHaveLockMemoryPrivilege.load())
+    {
+        return nullptr;
+    }
+    auto lock = std::scoped_lock(LockMemoryPrivilegeLock);
+    wil::unique_handle token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, token.put()))
+    {
+        return nullptr;
+    }
+    TOKEN_PRIVILEGES privileges = {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    if (!LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid))
+    {
+        return nullptr;
+    }
+    // Succeeds without enabling anything if the user doesn't have it
+    TOKEN_PRIVILEGES previous = {};
+    DWORD previousSize = 0;
+    if (!AdjustTokenPrivileges(token.get(), FALSE, &privileges, sizeof(previous), &previous, &previousSize) || GetLastError() != ERROR_SUCCESS)
+    {
+        MightHaveLockMemoryPrivilege.store(false);
+        return nullptr;
+    }
+    auto data = VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    // Nothing to put back if it was already enabled
+    if (previous.PrivilegeCount > 0)
+    {
+        AdjustTokenPrivileges(token.get(), FALSE, &previous, 0, nullptr, nullptr);
+    }
+    return data;
+}
+
+FrameBufferAllocation Allocate(size_t size)
+{
+    static auto const largePageSize = GetLargePageMinimum();
+    // Large pages are always resident, so they don't need faulting in. They
+    // can still fail once physical memory gets fragmented.
+    if (largePageSize != 0 && size >= largePageSize)
+    {
+        auto capacity = RoundUp(size, largePageSize);
+        if (auto data = AllocateLargePages(capacity))
+        {
+            return { static_cast<uint8_t*>(data), capacity, true };
+        }
+    }
+
+    auto capacity = RoundUp(size, SmallPageSize);
+    auto data = static_cast<uint8_t*>(VirtualAlloc(nullptr, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+    if (data == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    PrefaultPages(data, capacity);
+    return { data, capacity, false };
+}
+
+void Free(FrameBufferAllocation const& allocation)
+{
+    VirtualFree(allocation.Data, 0, MEM_RELEASE);
+}
+#else
+size_t const HugePageSize = 2 * 1024 * 1024;
+
+FrameBufferAllocation Allocate(size_t size)
+{
+    // Only works if huge pages have been reserved (vm.nr_hugepages)
+    if (size >= HugePageSize)
+    {
+        auto capacity = RoundUp(size, HugePageSize);
+        auto data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (data != MAP_FAILED)
+        {
+            return { static_cast<uint8_t*>(data), capacity, true };
+        }
+    }
+
+    // Otherwise transparent huge pages can still back the parts that are
+    // aligned to them, so ask for a little more and line it up.
+    auto capacity = RoundUp(size, SmallPageSize);
+    auto extra = size >= HugePageSize ? HugePageSize : 0;
+    auto mapped = mmap(nullptr, capacity + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    auto start = reinterpret_cast<uintptr_t>(mapped);
+    auto aligned = extra != 0 ? RoundUp(start, HugePageSize) : start;
+    if (aligned != start)
+    {
+        munmap(mapped, aligned - start);
+    }
+    if (auto tail = start + capacity + extra - (aligned + capacity))
+    {
+        munmap(reinterpret_cast<void*>(aligned + capacity), tail);
+    }
+    auto data = reinterpret_cast<uint8_t*>(aligned);
+#ifdef MADV_HUGEPAGE
+    if (extra != 0)
+    {
+        madvise(data, capacity, MADV_HUGEPAGE);
+    }
+#endif
+    PrefaultPages(data, capacity);
+    return { data, capacity, false };
+}
+
+void Free(FrameBufferAllocation const& allocation)
+{
+    munmap(allocation.Data, allocation.Capacity);
+}
+#endif
+
+FrameBuffer& FrameBuffer::operator=(FrameBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        m_freeList = std::move(other.m_freeList);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_capacity = std::exchange(other.m_capacity, 0);
+        m_largePages = std::exchange(other.m_largePages, false);
+        m_stride = std::exchange(other.m_stride, 0);
+        m_height = std::exchange(other.m_height, 0);
+    }
+    return *this;
+}
+
+void FrameBuffer::Release()
+{
+    if (m_data == nullptr)
+    {
+        return;
+    }
+    FrameBufferAllocation allocation = { m_data, m_capacity, m_largePages };
+    m_data = nullptr;
+    m_capacity = 0;
+    m_largePages = false;
+    m_stride = 0;
+    m_height = 0;
+
+    std::optional<FrameBufferAllocation> dropped = allocation;
+    if (auto freeList = m_freeList.lock())
+    {
+        auto lock = std::scoped_lock(freeList->Lock);
+        if (freeList->MaxCount > 0)
+        {
+            freeList->Allocations.push_back(allocation);
+            dropped.reset();
+            if (freeList->Allocations.size() > freeList->MaxCount)
+            {
+                dropped = freeList->Allocations.front();
+                freeList->Allocations.pop_front();
+            }
+        }
+    }
+    m_freeList.reset();
+    // Unmapping hundreds of megabytes isn't free, don't hold the lock for it
+    if (dropped.has_value())
+    {
+        Free(dropped.value());
+    }
+}
+
+FrameBufferPool::FrameBufferPool(size_t maxSpareBuffers)
+{
+    m_freeList = std::make_shared<FrameBufferFreeList>();
+    m_freeList->MaxCount = maxSpareBuffers;
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+    // Buffers still out there get freed when they're released
+    auto lock = std::scoped_lock(m_freeList->Lock);
+    for (auto&& allocation : m_freeList->Allocations)
+    {
+        Free(allocation);
+    }
+    m_freeList->Allocations.clear();
+    m_freeList->MaxCount = 0;
+}
+
+uint32_t FrameBufferPool::AlignStride(uint32_t rowBytes)
+{
+    return static_cast<uint32_t>(RoundUp(rowBytes, RowAlignment));
+}
+
+size_t FrameBufferPool::SpareBufferCount() const
+{
+    auto lock = std::scoped_lock(m_freeList->Lock);
+    return m_freeList->Allocations.size();
+}
+
+FrameBuffer FrameBufferPool::Acquire(uint32_t rowBytes, uint32_t height)
+{
+    auto stride = AlignStride(rowBytes);
+    auto size = std::max<size_t>(static_cast<size_t>(stride) * height, 1);
+
+    // The smallest spare that fits wastes the least
+    std::optional<FrameBufferAllocation> allocation;
+    {
+        auto lock = std::scoped_lock(m_freeList->Lock);
+        auto& allocations = m_freeList->Allocations;
+        auto best = allocations.end();
+        for (auto it = allocations.begin(); it != allocations.end(); it++)
+        {
+            if (it->Capacity >= size && (best == allocations.end() || it->Capacity < best->Capacity))
+            {
+                best = it;
+            }
+        }
+        if (best != allocations.end())
+        {
+            allocation = *best;
+            allocations.erase(best);
+        }
+    }
+    if (!allocation.has_value())
+    {
+        allocation = Allocate(size);
+    }
+
+    FrameBuffer buffer;
+    buffer.m_freeList = m_freeList;
+    buffer.m_data = allocation->Data;
+    buffer.m_capacity = allocation->Capacity;
+    buffer.m_largePages = allocation->LargePages;
+    buffer.m_stride = stride;
+    buffer.m_height = height;
+    return buffer;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+struct FrameBufferFreeList;
+
+// Memory for one frame's pixels, from a FrameBufferPool. Nothing is zeroed,
+// the contents are whatever the last user left behind. Goes back to the
+// pool when destroyed, or is freed if the pool is gone by then.
+class FrameBuffer
+{
+public:
+    FrameBuffer() {}
+    FrameBuffer(FrameBuffer&& other) noexcept { *this = std::move(other); }
+    FrameBuffer& operator=(FrameBuffer&& other) noexcept;
+    FrameBuffer(FrameBuffer const&) = delete;
+    FrameBuffer& operator=(FrameBuffer const&) = delete;
+    ~FrameBuffer() { Release(); }
+
+    uint8_t* Data() const { return m_data; }
+    uint32_t Stride() const { return m_stride; }
+    uint32_t Height() const { return m_height; }
+    size_t Size() const { return static_cast<size_t>(m_stride) * m_height; }
+    // Whether the memory is backed by large pages
+    bool IsLargePage() const { return m_largePages; }
+    explicit operator bool() const { return m_data != nullptr; }
+
+    void Release();
+
+private:
+    friend class FrameBufferPool;
+
+    std::weak_ptr<FrameBufferFreeList> m_freeList;
+    uint8_t* m_data = nullptr;
+    size_t m_capacity = 0;
+    bool m_largePages = false;
+    uint32_t m_stride = 0;
+    uint32_t m_height = 0;
+};
+
+// Hands out memory for frames and takes it back when they're done with it.
+// Fresh memory costs more to fault in than the frame costs to copy, and
+// at 8K a vector of bytes also zeroes hundreds of megabytes for nothing.
+//
+// New buffers come straight from the OS. They use large pages where we're
+// allowed to (SeLockMemoryPrivilege on Windows, which is only enabled while
+// allocating, or reserved huge pages on Linux), which saves most of the TLB
+// misses on a frame this size, and are faulted in up front otherwise. Released buffers are kept, up to
+// maxSpareBuffers of them, oldest dropped first, and handed back out to any
+// frame that fits. Rows start on a RowAlignment boundary so that SIMD code
+// can use aligned loads and stores.
+//
+// Thread safe.
+class FrameBufferPool
+{
+public:
+    static uint32_t const RowAlignment = 64;
+
+    FrameBufferPool(size_t maxSpareBuffers);
+    ~FrameBufferPool();
+
+    FrameBuffer Acquire(uint32_t rowBytes, uint32_t height);
+    static uint32_t AlignStride(uint32_t rowBytes);
+    size_t SpareBufferCount() const;
+
+private:
+    std::shared_ptr<FrameBufferFreeList> m_freeList;
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "pch.h"
+#include "FrameMotionTracker.h"
+
+namespace winrt
+{
+    using namespace Windows::Foundation;
+    using namespace Windows::Foundation::Collections;
+    using namespace Windows::Graphics;
+}
+
+void FrameMotionTracker::Reset()
+{
+    m_previousFrame.clear();
+    m_previousWidth = 0;
+    m_previousHeight = 0;
+    m_previousBytesPerPixel = 0;
+    m_motion.clear();
+}
+
+std::vector<FrameMotion> const& FrameMotionTracker::Update(
+    std::vector<uint8_t> const& pixels,
+    uint32_t width,
+    uint32_t height,
+    uint32_t bytesPerPixel,
+    winrt::IVectorView<winrt::RectInt32> const& dirtyRegions)
+{
+    m_motion.clear();
+    auto sameLayout = width == m_previousWidth && height == m_previousHeight && bytesPerPixel == m_previousBytesPerPixel;
+    if (sameLayout && !m_previousFrame.empty())
+    {
+        auto stride = width * bytesPerPixel;
+        for (auto&& dirtyRegion : dirtyRegions)
+        {
+            RECT rect =
+            {
+                std::max(dirtyRegion.X, 0),
+                std::max(dirtyRegion.Y, 0),
+                std::min(dirtyRegion.X + dirtyRegion.Width, static_cast<int32_t>(width)),
+                std::min(dirtyRegion.Y + dirtyRegion.Height, static_cast<int32_t>(height)),
+            };
+            if (rect.right > rect.left && rect.bottom > rect.top)
+            {
+                m_motion.push_back(m_detector.Detect(m_previousFrame.data(), pixels.data(), stride, bytesPerPixel, rect));
+            }
+        }
+    }
+
+    m_previousFrame.assign(pixels.begin(), pixels.end());
+    m_previousWidth = width;
+    m_previousHeight = height;
+    m_previousBytesPerPixel = bytesPerPixel;
+    return m_motion;
+}
\ No newline at end of file
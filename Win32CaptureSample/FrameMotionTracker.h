@@ -0,0 +1,29 @@
+#pragma once
+#include "ScrollDetector.h"
+
+// Runs the ScrollDetector over each dirty rect of a frame against the
+// previous frame it was given.
+class FrameMotionTracker
+{
+public:
+    FrameMotionTracker() {}
+    ~FrameMotionTracker() {}
+
+    // Pixels are tightly packed. Returns nothing for the first frame, or when
+    // the size or format changes.
+    std::vector<FrameMotion> const& Update(
+        std::vector<uint8_t> const& pixels,
+        uint32_t width,
+        uint32_t height,
+        uint32_t bytesPerPixel,
+        winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Graphics::RectInt32> const& dirtyRegions);
+    void Reset();
+
+private:
+    ScrollDetector m_detector;
+    std::vector<uint8_t> m_previousFrame;
+    uint32_t m_previousWidth = 0;
+    uint32_t m_previousHeight = 0;
+    uint32_t m_previousBytesPerPixel = 0;
+    std::vector<FrameMotion> m_motion;
+};
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "pch.h"
+#include "FramePacer.h"
+
+int64_t const TicksPerSecond = 10'000'000;
+
+FramePacer::FramePacer(FramePacerSettings const& settings)
+{
+    if (settings.FrameRateNumerator == 0 || settings.FrameRateDenominator == 0)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"The frame rate can't be zero.");
+    }
+    m_settings = settings;
+    m_interval = static_cast<double>(TicksPerSecond) * settings.FrameRateDenominator / settings.FrameRateNumerator;
+}
+
+std::vector<PacedFrame> FramePacer::Push(Ticks timestamp)
+{
+    auto source = m_inputFrames++;
+    if (!m_origin.has_value())
+    {
+        m_origin = timestamp;
+    }
+
+    auto relative = static_cast<double>((timestamp - m_origin.value()).count());
+    auto slot = static_cast<int64_t>(std::llround((relative - m_phase) / m_interval));
+    auto residual = relative - m_phase - slot * m_interval;
+
+    // A frame that shows up after its output frame was decided (or after the
+    // grid wrapped backwards) goes to the first one that is still open.
+    slot = std::max(slot, m_candidate.has_value() ? m_candidate->Slot : m_nextSlot);
+    if (m_candidate.has_value() && m_candidate->Slot == slot)
+    {
+        if (std::abs(residual) < std::abs(m_candidate->Residual))
+        {
+            m_candidate = Candidate{ slot, source, residual };
+        }
+        m_droppedFrames++;
+        return {};
+    }
+
+    std::vector<PacedFrame> output;
+    if (m_candidate.has_value())
+    {
+        EmitCandidate(output);
+    }
+    EmitUntil(slot, output);
+    m_candidate = Candidate{ slot, source, residual };
+    return output;
+}
+
+std::vector<PacedFrame> FramePacer::Advance(Ticks now)
+{
+    if (!m_origin.has_value())
+    {
+        return {};
+    }
+
+    // An output frame is done waiting once the latency has passed since the
+    // last moment an input frame could have been assigned to it.
+    auto relative = static_cast<double>((now - m_origin.value() - m_settings.Latency).count());
+    auto endSlot = static_cast<int64_t>(std::floor((relative - m_phase) / m_interval + 0.5));
+    std::vector<PacedFrame> output;
+    if (m_candidate.has_value() && m_candidate->Slot < endSlot)
+    {
+        EmitCandidate(output);
+    }
+    EmitUntil(endSlot, output);
+    return output;
+}
+
+std::vector<PacedFrame> FramePacer::Flush()
+{
+    std::vector<PacedFrame> output;
+    if (m_candidate.has_value())
+    {
+        EmitCandidate(output);
+    }
+    return output;
+}
+
+PacingStatistics FramePacer::Statistics() const
+{
+    PacingStatistics statistics;
+    statistics.InputFrames = m_inputFrames;
+    statistics.OutputFrames = m_outputFrames;
+    statistics.RepeatedFrames = m_repeatedFrames;
+    statistics.DroppedFrames = m_droppedFrames;
+    if (m_shownFrames > 0)
+    {
+        statistics.MeanError = Ticks(static_cast<int64_t>(m_totalError / m_shownFrames));
+    }
+    statistics.MaxError = Ticks(static_cast<int64_t>(m_maxError));
+    statistics.Phase = Ticks(static_cast<int64_t>(m_phase));
+    return statistics;
+}
+
+Ticks FramePacer::OutputTime(int64_t index) const
+{
+    // Computed from the fraction each time so that rates like 30000/1001
+    // don't accumulate rounding errors.
+    return Ticks(index * TicksPerSecond * m_settings.FrameRateDenominator / m_settings.FrameRateNumerator);
+}
+
+void FramePacer::EmitUntil(int64_t slot, std::vector<PacedFrame>& output)
+{
+    // Nothing to repeat until the first frame was shown
+    if (!m_lastSource.has_value())
+    {
+        return;
+    }
+    for (; m_nextSlot < slot; m_nextSlot++)
+    {
+        output.push_back({ static_cast<uint64_t>(m_nextSlot), OutputTime(m_nextSlot), m_lastSource.value(), true });
+        m_outputFrames++;
+        m_repeatedFrames++;
+    }
+}
+
+void FramePacer::EmitCandidate(std::vector<PacedFrame>& output)
+{
+    auto candidate = m_candidate.value();
+    m_candidate.reset();
+    EmitUntil(candidate.Slot, output);
+
+    output.push_back({ static_cast<uint64_t>(candidate.Slot), OutputTime(candidate.Slot), candidate.Source, false });
+    m_outputFrames++;
+    m_lastSource = candidate.Source;
+    m_nextSlot = candidate.Slot + 1;
+
+    // Only frames that get shown move the grid. Otherwise, when there are
+    // several input frames per output frame, the phase would settle halfway
+    // between them and every output frame would be equally far off.
+    m_phase += m_settings.PhaseSmoothing * candidate.Residual;
+    // Wrap a little past the halfway point, otherwise input that sits right
+    // on it would make the phase flip back and forth.
+    auto wrapAt = m_interval * 5.0 / 8.0;
+    if (m_phase > wrapAt)
+    {
+        m_phase -= m_interval;
+    }
+    else if (m_phase < -wrapAt)
+    {
+        m_phase += m_interval;
+    }
+
+    auto error = std::abs(candidate.Residual);
+    m_shownFrames++;
+    m_totalError += error;
+    m_maxError = std::max(m_maxError, error);
+}
\ No newline at end of file
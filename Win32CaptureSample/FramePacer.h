@@ -0,0 +1,103 @@
+#pragma once
+#include "PortableTypes.h"
+
+struct FramePacerSettings
+{
+    // The output frame rate as a fraction, e.g. 30000/1001
+    uint32_t FrameRateNumerator = 60;
+    uint32_t FrameRateDenominator = 1;
+    // How long an output frame waits for an input frame to show up before
+    // the previous one gets repeated. Only used by Advance.
+    Ticks Latency = std::chrono::milliseconds(50);
+    // How quickly the output frames follow the phase of the input frames
+    double PhaseSmoothing = 1.0 / 16.0;
+};
+
+struct PacedFrame
+{
+    uint64_t Index = 0;
+    // Relative to the first input frame
+    Ticks Time = {};
+    // The input frame to show, counting from 0 in the order they were pushed
+    uint64_t Source = 0;
+    bool IsRepeat = false;
+};
+
+struct PacingStatistics
+{
+    uint64_t InputFrames = 0;
+    uint64_t OutputFrames = 0;
+    uint64_t RepeatedFrames = 0;
+    uint64_t DroppedFrames = 0;
+    // How far the input frames that were shown are from the time of their
+    // output frame, not counting the phase below since a constant offset
+    // doesn't make playback any less smooth. Repeats aren't counted.
+    Ticks MeanError = {};
+    Ticks MaxError = {};
+    // Where the input frames currently sit compared to the output frames,
+    // never more than 5/8 of an output frame away.
+    Ticks Phase = {};
+};
+
+// Maps the variable rate timestamps of captured frames onto a constant
+// frame rate, deciding which input frame each output frame shows.
+//
+// Each input frame goes to the nearest output frame. If more than one lands
+// on the same output frame the closest one wins and the rest are dropped,
+// if none do the previous one is repeated. Rather than rounding against a
+// fixed grid, which makes jittery input flip between repeating and dropping
+// whenever the input sits halfway between two output frames, the grid is
+// shifted to follow the average phase of the input. The shift only goes a
+// little past half an output frame; when the input drifts that far the grid
+// wraps around, which costs exactly one repeat or drop instead of a burst of
+// them, and the output never falls behind or runs ahead of the input.
+class FramePacer
+{
+public:
+    FramePacer(FramePacerSettings const& settings = {});
+    ~FramePacer() {}
+
+    // Timestamps are expected to go up. Each call returns the output frames
+    // that can't change anymore, in order.
+    std::vector<PacedFrame> Push(Ticks timestamp);
+    // Gives up on output frames that have waited longer than the latency,
+    // use this to keep the output going while no frames are captured.
+    std::vector<PacedFrame> Advance(Ticks now);
+    // Decides the output frame that is still waiting on input, if any
+    std::vector<PacedFrame> Flush();
+
+    PacingStatistics Statistics() const;
+    // Relative to the first input frame
+    Ticks OutputTime(int64_t index) const;
+
+private:
+    struct Candidate
+    {
+        int64_t Slot = 0;
+        uint64_t Source = 0;
+        // How far it is from the center of its output frame
+        double Residual = 0.0;
+    };
+
+    void EmitUntil(int64_t slot, std::vector<PacedFrame>& output);
+    void EmitCandidate(std::vector<PacedFrame>& output);
+
+private:
+    FramePacerSettings m_settings;
+    // In 100ns units
+    double m_interval = 0.0;
+    double m_phase = 0.0;
+
+    std::optional<Ticks> m_origin;
+    int64_t m_nextSlot = 0;
+    std::optional<Candidate> m_candidate;
+    std::optional<uint64_t> m_lastSource;
+
+    uint64_t m_inputFrames = 0;
+    uint64_t m_outputFrames = 0;
+    uint64_t m_repeatedFrames = 0;
+    uint64_t m_droppedFrames = 0;
+    uint64_t m_shownFrames = 0;
+    double m_totalError = 0.0;
+    double m_maxError = 0.0;
+};
\ No newline at end of file
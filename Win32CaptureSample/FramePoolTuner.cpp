@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "FramePoolTuner.h"
+
+// Until we've seen two frames in a row
+Ticks const DefaultFrameInterval = std::chrono::microseconds(16667);
+
+FramePoolTuner::FramePoolTuner(uint32_t bufferCount, uint64_t bytesPerBuffer, FramePoolTunerSettings const& settings)
+{
+    if (settings.MinBufferCount == 0 || settings.MinBufferCount > settings.MaxBufferCount)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"Invalid buffer count range.");
+    }
+    m_settings = settings;
+    Reset(bufferCount, bytesPerBuffer);
+}
+
+void FramePoolTuner::Reset(uint32_t bufferCount, uint64_t bytesPerBuffer)
+{
+    m_bufferCount = bufferCount;
+    m_bytesPerBuffer = bytesPerBuffer;
+    // The frames of the old pool don't hold on to any of the new buffers
+    m_releases.clear();
+    m_saturation.reset();
+    m_windowStart.reset();
+}
+
+std::optional<uint32_t> FramePoolTuner::OnFrame(Ticks captured, Ticks released)
+{
+    if (m_lastCaptured.has_value() && captured > m_lastCaptured.value())
+    {
+        m_shortestGap = std::min(m_shortestGap, captured - m_lastCaptured.value());
+    }
+    m_lastCaptured = captured;
+    auto interval = FrameInterval();
+
+    // Only now do we know if a frame came in right after the pool was full
+    auto dropped = false;
+    if (m_saturation.has_value())
+    {
+        auto [start, end] = m_saturation.value();
+        m_saturation.reset();
+        if (end - start > interval && captured - end <= interval + interval / 2)
+        {
+            dropped = true;
+            m_droppedInWindow = true;
+            m_droppedFrames += static_cast<uint64_t>((end - start) / interval);
+        }
+    }
+
+    // Count the buffers in use when this frame was captured, itself included
+    while (!m_releases.empty() && m_releases.front() <= captured)
+    {
+        m_releases.pop_front();
+    }
+    auto buffersInUse = static_cast<uint32_t>(m_releases.size()) + 1;
+    m_peakBuffersInUse = std::max(m_peakBuffersInUse, buffersInUse);
+
+    // Frames are handled one at a time, so this one had to wait for the last
+    auto handled = m_releases.empty() ? captured : std::max(captured, m_releases.back());
+    auto holdTime = static_cast<double>((released - handled).count());
+    m_meanHoldTime = m_meanHoldTime.has_value() ? m_meanHoldTime.value() + (holdTime - m_meanHoldTime.value()) / 16.0 : holdTime;
+    m_releases.push_back(released);
+    if (buffersInUse >= m_bufferCount)
+    {
+        // Full until the oldest frame gives its buffer back
+        m_saturation = std::pair(captured, m_releases.front());
+    }
+
+    if (!m_windowStart.has_value())
+    {
+        StartWindow(captured);
+    }
+
+    auto maxBufferCount = MaxAllowedBufferCount();
+    if (m_bufferCount > maxBufferCount)
+    {
+        return ChangeBufferCount(maxBufferCount);
+    }
+
+    auto canKeepUp = m_meanHoldTime.value() < static_cast<double>(interval.count());
+    if (dropped && canKeepUp && m_bufferCount < maxBufferCount && captured - m_lastGrowth >= m_settings.GrowCooldown)
+    {
+        m_lastGrowth = captured;
+        return ChangeBufferCount(m_bufferCount + 1);
+    }
+
+    if (captured - m_windowStart.value() >= m_settings.ShrinkAfter)
+    {
+        auto shrink = !m_droppedInWindow && m_peakBuffersInUse < m_bufferCount && m_bufferCount > m_settings.MinBufferCount;
+        StartWindow(captured);
+        if (shrink)
+        {
+            return ChangeBufferCount(m_bufferCount - 1);
+        }
+    }
+    return std::nullopt;
+}
+
+FramePoolStatistics FramePoolTuner::Statistics() const
+{
+    FramePoolStatistics statistics;
+    statistics.BufferCount = m_bufferCount;
+    statistics.PoolBytes = m_bytesPerBuffer * m_bufferCount;
+    statistics.PeakBuffersInUse = m_peakBuffersInUse;
+    statistics.EstimatedDroppedFrames = m_droppedFrames;
+    statistics.MeanHoldTime = Ticks(static_cast<int64_t>(m_meanHoldTime.value_or(0.0)));
+    statistics.FrameInterval = FrameInterval();
+    return statistics;
+}
+
+uint32_t FramePoolTuner::MaxAllowedBufferCount() const
+{
+    if (m_bytesPerBuffer == 0)
+    {
+        return m_settings.MaxBufferCount;
+    }
+    auto affordable = static_cast<uint32_t>(std::min<uint64_t>(m_settings.MaxBytes / m_bytesPerBuffer, m_settings.MaxBufferCount));
+    return std::max(affordable, m_settings.MinBufferCount);
+}
+
+Ticks FramePoolTuner::FrameInterval() const
+{
+    auto shortestGap = std::min(m_shortestGap, m_previousShortestGap);
+    return shortestGap == Ticks::max() ? DefaultFrameInterval : shortestGap;
+}
+
+void FramePoolTuner::StartWindow(Ticks time)
+{
+    m_windowStart = time;
+    m_peakBuffersInUse = 0;
+    m_droppedInWindow = false;
+    m_previousShortestGap = m_shortestGap;
+    m_shortestGap = Ticks::max();
+}
+
+uint32_t FramePoolTuner::ChangeBufferCount(uint32_t bufferCount)
+{
+    Reset(bufferCount, m_bytesPerBuffer);
+    return bufferCount;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+#include "PortableTypes.h"
+
+struct FramePoolTunerSettings
+{
+    uint32_t MinBufferCount = 1;
+    uint32_t MaxBufferCount = 6;
+    // The pool doesn't grow past this many bytes of buffers, no matter what
+    uint64_t MaxBytes = 512 * 1024 * 1024;
+    // How long the last buffer has to go unused before it's given back
+    Ticks ShrinkAfter = std::chrono::seconds(10);
+    // How long to wait after growing before growing again, so that the
+    // last change has a chance to show an effect
+    Ticks GrowCooldown = std::chrono::seconds(1);
+};
+
+struct FramePoolStatistics
+{
+    uint32_t BufferCount = 0;
+    uint64_t PoolBytes = 0;
+    // The most buffers that were in use at once since the last shrink check
+    uint32_t PeakBuffersInUse = 0;
+    uint64_t EstimatedDroppedFrames = 0;
+    // How long frames take to get handled once they could be
+    Ticks MeanHoldTime = {};
+    // The shortest time between two frames lately, usually the refresh rate
+    Ticks FrameInterval = {};
+};
+
+// Picks how many buffers a frame pool should have by watching how long
+// frames are held on to.
+//
+// A frame occupies a buffer from the moment it's captured until it's closed.
+// While every buffer is occupied, new frames can't be captured, and once a
+// buffer frees up the next one comes in right away. So a stretch of the pool
+// being full that's longer than a frame, followed by a frame that shows up
+// promptly, means frames were dropped. If that happens while frames are
+// handled faster than they arrive on average, the holds are bursty and
+// another buffer absorbs them; if frames are handled slower than they
+// arrive, no number of buffers helps, so the pool stays as it is. A buffer
+// is given back once the pool goes ShrinkAfter without every buffer being
+// in use at the same time.
+class FramePoolTuner
+{
+public:
+    FramePoolTuner(uint32_t bufferCount, uint64_t bytesPerBuffer, FramePoolTunerSettings const& settings = {});
+    ~FramePoolTuner() {}
+
+    // Call whenever the pool is recreated, e.g. after a resize
+    void Reset(uint32_t bufferCount, uint64_t bytesPerBuffer);
+
+    // Call once per frame after it's closed. Captured is the frame's
+    // SystemRelativeTime. Returns a new buffer count when the pool should
+    // be recreated with it.
+    std::optional<uint32_t> OnFrame(
+        Ticks captured,
+        Ticks released);
+
+    uint32_t BufferCount() const { return m_bufferCount; }
+    FramePoolStatistics Statistics() const;
+
+private:
+    uint32_t MaxAllowedBufferCount() const;
+    Ticks FrameInterval() const;
+    void StartWindow(Ticks time);
+    uint32_t ChangeBufferCount(uint32_t bufferCount);
+
+private:
+    FramePoolTunerSettings m_settings;
+    uint32_t m_bufferCount = 0;
+    uint64_t m_bytesPerBuffer = 0;
+
+    // When the frames that may still be holding a buffer are released
+    std::deque<Ticks> m_releases;
+    std::optional<Ticks> m_lastCaptured;
+    // A stretch where every buffer was in use, checked once the next frame arrives
+    std::optional<std::pair<Ticks, Ticks>> m_saturation;
+
+    std::optional<Ticks> m_windowStart;
+    uint32_t m_peakBuffersInUse = 0;
+    bool m_droppedInWindow = false;
+    Ticks m_lastGrowth = {};
+    // The shortest gap between frames in this window and the one before
+    Ticks m_shortestGap = Ticks::max();
+    Ticks m_previousShortestGap = Ticks::max();
+    std::optional<double> m_meanHoldTime;
+    uint64_t m_droppedFrames = 0;
+};
\ No newline at end of file
@@ -0,0 +1,523 @@
+#include "pch.h"
+#include "FrameRedactor.h"
+#include "StridedCopy.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define FRAME_REDACTOR_SSE2
+#endif
+
+uint32_t const BytesPerPixel = 4;
+// Updates at least this big are split into bands of rows on the thread pool
+size_t const ParallelPixels = 512 * 512;
+LONG const MinRowsPerBand = 64;
+
+bool inline IsEmptyRect(RECT const& rect)
+{
+    return rect.right <= rect.left || rect.bottom <= rect.top;
+}
+
+RECT inline IntersectRects(RECT const& first, RECT const& second)
+{
+    return { std::max(first.left, second.left), std::max(first.top, second.top),
+        std::min(first.right, second.right), std::min(first.bottom, second.bottom) };
+}
+
+RECT inline UnionRects(RECT const& first, RECT const& second)
+{
+    return { std::min(first.left, second.left), std::min(first.top, second.top),
+        std::max(first.right, second.right), std::max(first.bottom, second.bottom) };
+}
+
+RECT inline GrowRect(RECT const& rect, LONG amount)
+{
+    return { rect.left - amount, rect.top - amount, rect.right + amount, rect.bottom + amount };
+}
+
+bool inline IsSameRegion(RedactionRegion const& first, RedactionRegion const& second)
+{
+    return first.Bounds.left == second.Bounds.left && first.Bounds.top == second.Bounds.top &&
+        first.Bounds.right == second.Bounds.right && first.Bounds.bottom == second.Bounds.bottom &&
+        first.Style == second.Style && first.Strength == second.Strength && first.FillColor == second.FillColor;
+}
+
+void FrameRedactor::CheckRegions(std::vector<RedactionRegion> const& regions)
+{
+    for (auto&& region : regions)
+    {
+        if (region.Style != RedactionStyle::Fill && region.Strength == 0)
+        {
+            throw winrt::hresult_error(E_INVALIDARG, L"Blurring and pixelating need a strength of at least one pixel.");
+        }
+        if (region.Style == RedactionStyle::Blur && region.Strength > MaxBlurRadius)
+        {
+            throw winrt::hresult_error(E_INVALIDARG, L"The blur radius is too large.");
+        }
+    }
+}
+
+void FrameRedactor::Regions(std::vector<RedactionRegion> const& regions)
+{
+    if (regions.size() == m_regions.size() && std::equal(regions.begin(), regions.end(), m_regions.begin(), IsSameRegion))
+    {
+        return;
+    }
+    CheckRegions(regions);
+
+    // Whatever was redacted before shows the frame again
+    for (auto&& state : m_states)
+    {
+        if (!IsEmptyRect(state.Bounds))
+        {
+            m_removed.push_back(state.Bounds);
+        }
+    }
+    m_regions = regions;
+    m_regionsChanged = true;
+}
+
+void FrameRedactor::Resize(uint32_t width, uint32_t height)
+{
+    m_width = width;
+    m_height = height;
+    RECT frame = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+    m_states.resize(m_regions.size());
+    for (size_t i = 0; i < m_regions.size(); i++)
+    {
+        auto& state = m_states[i];
+        state.Bounds = IntersectRects(m_regions[i].Bounds, frame);
+        if (IsEmptyRect(state.Bounds))
+        {
+            state.Bounds = {};
+        }
+        state.Stride = static_cast<uint32_t>(state.Bounds.right - state.Bounds.left) * BytesPerPixel;
+        state.Pixels.resize(static_cast<size_t>(state.Stride) * (state.Bounds.bottom - state.Bounds.top));
+        state.Pending = std::nullopt;
+    }
+}
+
+bool FrameRedactor::Prepare(uint32_t width, uint32_t height, std::optional<std::vector<RECT>> const& dirtyRects)
+{
+    m_damage = std::move(m_removed);
+    m_removed.clear();
+    m_updated.clear();
+    m_sourceBounds = {};
+
+    auto everything = m_invalid || !dirtyRects.has_value();
+    if (m_regionsChanged || width != m_width || height != m_height)
+    {
+        Resize(width, height);
+        m_regionsChanged = false;
+        everything = true;
+    }
+    m_invalid = false;
+
+    auto needsUpdate = false;
+    for (size_t i = 0; i < m_regions.size(); i++)
+    {
+        auto& state = m_states[i];
+        auto const& region = m_regions[i];
+        state.Pending = std::nullopt;
+        if (IsEmptyRect(state.Bounds))
+        {
+            continue;
+        }
+
+        std::optional<RECT> pending;
+        if (everything)
+        {
+            pending = state.Bounds;
+        }
+        else if (region.Style != RedactionStyle::Fill)
+        {
+            // A changed pixel moves every blurred pixel within the radius
+            auto reach = region.Style == RedactionStyle::Blur ? static_cast<LONG>(region.Strength) : 0;
+            for (auto&& dirtyRect : dirtyRects.value())
+            {
+                auto rect = IntersectRects(GrowRect(dirtyRect, reach), state.Bounds);
+                if (!IsEmptyRect(rect))
+                {
+                    pending = pending.has_value() ? UnionRects(pending.value(), rect) : rect;
+                }
+            }
+        }
+        if (!pending.has_value())
+        {
+            continue;
+        }
+
+        auto update = pending.value();
+        if (region.Style == RedactionStyle::Pixelate)
+        {
+            // Blocks start at the top-left of the region
+            auto blockSize = static_cast<LONG>(region.Strength);
+            auto const& bounds = state.Bounds;
+            update.left = bounds.left + (update.left - bounds.left) / blockSize * blockSize;
+            update.top = bounds.top + (update.top - bounds.top) / blockSize * blockSize;
+            update.right = std::min(bounds.left + (update.right - bounds.left + blockSize - 1) / blockSize * blockSize, bounds.right);
+            update.bottom = std::min(bounds.top + (update.bottom - bounds.top + blockSize - 1) / blockSize * blockSize, bounds.bottom);
+        }
+        state.Pending = update;
+        m_damage.push_back(update);
+        needsUpdate = true;
+
+        if (region.Style != RedactionStyle::Fill)
+        {
+            auto source = update;
+            if (region.Style == RedactionStyle::Blur)
+            {
+                source = IntersectRects(GrowRect(update, static_cast<LONG>(region.Strength)), state.Bounds);
+            }
+            m_sourceBounds = IsEmptyRect(m_sourceBounds) ? source : UnionRects(m_sourceBounds, source);
+        }
+    }
+    return needsUpdate;
+}
+
+void FrameRedactor::Update(uint8_t const* pixels, uint32_t stride)
+{
+    m_updated.clear();
+    for (size_t i = 0; i < m_regions.size(); i++)
+    {
+        auto& state = m_states[i];
+        auto const& region = m_regions[i];
+        if (!state.Pending.has_value())
+        {
+            continue;
+        }
+
+        auto update = state.Pending.value();
+        switch (region.Style)
+        {
+        case RedactionStyle::Blur:
+            Blur(state, region, update, pixels, stride);
+            break;
+        case RedactionStyle::Pixelate:
+            Pixelate(state, region, update, pixels, stride);
+            break;
+        case RedactionStyle::Fill:
+            Fill(state, region, update);
+            break;
+        }
+
+        auto offset = static_cast<size_t>(update.top - state.Bounds.top) * state.Stride +
+            static_cast<size_t>(update.left - state.Bounds.left) * BytesPerPixel;
+        m_updated.push_back({ update, state.Pixels.data() + offset, state.Stride });
+        state.Pending = std::nullopt;
+    }
+}
+
+// Sums of columns [first - radius, first + radius], clipped to the columns
+// there are, for count pixels in a row starting at first
+void SumAlongRow(uint16_t const* columnSums, LONG columns, uint32_t* rowSums, LONG first, LONG count, LONG radius)
+{
+    auto windowEnd = std::min(first + radius + 1, columns);
+#ifdef FRAME_REDACTOR_SSE2
+    // The running sum is a chain from one pixel to the next, but the four
+    // channels of a pixel fit in one register
+    auto zero = _mm_setzero_si128();
+    auto loadColumn = [&](LONG column)
+    {
+        auto values = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(columnSums + static_cast<size_t>(column) * BytesPerPixel));
+        return _mm_unpacklo_epi16(values, zero);
+    };
+    auto sums = zero;
+    for (auto column = std::max(first - radius, 0L); column < windowEnd; column++)
+    {
+        sums = _mm_add_epi32(sums, loadColumn(column));
+    }
+    for (LONG i = 0; i < count; i++)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rowSums + static_cast<size_t>(i) * BytesPerPixel), sums);
+        auto x = first + i;
+        if (x + radius + 1 < columns && i + 1 < count)
+        {
+            sums = _mm_add_epi32(sums, loadColumn(x + radius + 1));
+        }
+        if (x - radius >= 0)
+        {
+            sums = _mm_sub_epi32(sums, loadColumn(x - radius));
+        }
+    }
+#else
+    uint32_t sums[BytesPerPixel] = {};
+    auto addColumn = [&](LONG column, int32_t sign)
+    {
+        auto values = columnSums + static_cast<size_t>(column) * BytesPerPixel;
+        for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+        {
+            sums[channel] += static_cast<uint32_t>(sign * values[channel]);
+        }
+    };
+    for (auto column = std::max(first - radius, 0L); column < windowEnd; column++)
+    {
+        addColumn(column, 1);
+    }
+    for (LONG i = 0; i < count; i++)
+    {
+        memcpy(rowSums + static_cast<size_t>(i) * BytesPerPixel, sums, sizeof(sums));
+        auto x = first + i;
+        if (x + radius + 1 < columns && i + 1 < count)
+        {
+            addColumn(x + radius + 1, 1);
+        }
+        if (x - radius >= 0)
+        {
+            addColumn(x - radius, -1);
+        }
+    }
+#endif
+}
+
+// Turns window sums into averages
+void ScaleRow(uint32_t const* rowSums, float const* scales, float rowScale, uint8_t* output, size_t values)
+{
+    size_t i = 0;
+#ifdef FRAME_REDACTOR_SSE2
+    auto rowScales = _mm_set1_ps(rowScale);
+    auto half = _mm_set1_ps(0.5f);
+    for (; i + 16 <= values; i += 16)
+    {
+        __m128i quarters[4];
+        for (size_t quarter = 0; quarter < 4; quarter++)
+        {
+            auto offset = i + quarter * 4;
+            auto sums = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(rowSums + offset)));
+            auto averages = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sums, _mm_loadu_ps(scales + offset)), rowScales), half);
+            quarters[quarter] = _mm_cvttps_epi32(averages);
+        }
+        // Saturates, so no need to clamp
+        auto first = _mm_packs_epi32(quarters[0], quarters[1]);
+        auto second = _mm_packs_epi32(quarters[2], quarters[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(first, second));
+    }
+#endif
+    for (; i < values; i++)
+    {
+        // Going through int32 is a lot cheaper than converting unsigned
+        auto average = static_cast<float>(static_cast<int32_t>(rowSums[i])) * scales[i] * rowScale + 0.5f;
+        output[i] = static_cast<uint8_t>(static_cast<int32_t>(std::min(average, 255.0f)));
+    }
+}
+
+void FrameRedactor::Blur(RegionState& state, RedactionRegion const& region, RECT const& update, uint8_t const* pixels, uint32_t stride)
+{
+    auto const& bounds = state.Bounds;
+    auto radius = static_cast<LONG>(region.Strength);
+    // Everything the window can reach, the sums are relative to this
+    auto source = IntersectRects(GrowRect(update, radius), bounds);
+    auto columns = source.right - source.left;
+    auto first = update.left - source.left;
+    auto count = update.right - update.left;
+    auto sourceValues = static_cast<size_t>(columns) * BytesPerPixel;
+    auto values = static_cast<size_t>(count) * BytesPerPixel;
+
+    // The window shrinks at the edges of the region rather than reaching
+    // outside of it
+    m_scales.resize(values);
+    for (LONG i = 0; i < count; i++)
+    {
+        auto x = first + i;
+        auto scale = 1.0f / static_cast<float>(std::min(x + radius + 1, columns) - std::max(x - radius, 0L));
+        for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+        {
+            m_scales[static_cast<size_t>(i) * BytesPerPixel + channel] = scale;
+        }
+    }
+
+    auto blurRows = [&](LONG bandTop, LONG bandBottom, BlurScratch& scratch)
+    {
+        scratch.ColumnSums.assign(sourceValues, 0);
+        scratch.RowSums.resize(values);
+        // Writing bytes could alias anything, so don't go through the vectors
+        auto columnSums = scratch.ColumnSums.data();
+        auto rowSums = scratch.RowSums.data();
+        auto scales = m_scales.data();
+
+        auto windowTop = std::max(bandTop - radius, source.top);
+        auto windowBottom = windowTop;
+        for (auto y = bandTop; y < bandBottom; y++)
+        {
+            // Slide the window down. The column sums cover whole rows of the
+            // source, so these run over contiguous bytes.
+            auto top = std::max(y - radius, source.top);
+            auto bottom = std::min(y + radius + 1, source.bottom);
+            for (; windowTop < top; windowTop++)
+            {
+                auto row = pixels + static_cast<size_t>(windowTop) * stride + static_cast<size_t>(source.left) * BytesPerPixel;
+                for (size_t i = 0; i < sourceValues; i++)
+                {
+                    columnSums[i] -= row[i];
+                }
+            }
+            for (; windowBottom < bottom; windowBottom++)
+            {
+                auto row = pixels + static_cast<size_t>(windowBottom) * stride + static_cast<size_t>(source.left) * BytesPerPixel;
+                for (size_t i = 0; i < sourceValues; i++)
+                {
+                    columnSums[i] += row[i];
+                }
+            }
+
+            // Then along the row
+            SumAlongRow(columnSums, columns, rowSums, first, count, radius);
+            auto output = state.Pixels.data() + static_cast<size_t>(y - bounds.top) * state.Stride +
+                static_cast<size_t>(update.left - bounds.left) * BytesPerPixel;
+            ScaleRow(rowSums, scales, 1.0f / static_cast<float>(bottom - top), output, values);
+        }
+    };
+
+    auto rows = update.bottom - update.top;
+    auto threads = static_cast<LONG>(std::thread::hardware_concurrency());
+    if (static_cast<size_t>(count) * rows < ParallelPixels || threads < 2)
+    {
+        blurRows(update.top, update.bottom, m_blurScratch);
+        return;
+    }
+
+    // Every band starts its window over, so one band per thread
+    auto rowsPerBand = std::max(MinRowsPerBand, (rows + threads - 1) / threads);
+    std::vector<LONG> bands((rows + rowsPerBand - 1) / rowsPerBand);
+    std::iota(bands.begin(), bands.end(), 0);
+    if (m_bandBlurScratch.size() < bands.size())
+    {
+        m_bandBlurScratch.resize(bands.size());
+    }
+    std::for_each(std::execution::par, bands.begin(), bands.end(), [&](LONG band)
+    {
+        auto bandTop = update.top + band * rowsPerBand;
+        blurRows(bandTop, std::min(bandTop + rowsPerBand, update.bottom), m_bandBlurScratch[band]);
+    });
+}
+
+void FrameRedactor::Pixelate(RegionState& state, RedactionRegion const& region, RECT const& update, uint8_t const* pixels, uint32_t stride)
+{
+    // Prepare rounded the update out to whole blocks
+    auto const& bounds = state.Bounds;
+    auto blockSize = static_cast<LONG>(region.Strength);
+    auto values = static_cast<size_t>(update.right - update.left) * BytesPerPixel;
+
+    auto pixelateBlocks = [&](LONG blockTop, std::vector<uint32_t>& columnSums)
+    {
+        auto blockBottom = std::min(blockTop + blockSize, update.bottom);
+        columnSums.assign(values, 0);
+        auto sums = columnSums.data();
+        for (auto y = blockTop; y < blockBottom; y++)
+        {
+            auto row = pixels + static_cast<size_t>(y) * stride + static_cast<size_t>(update.left) * BytesPerPixel;
+            for (size_t i = 0; i < values; i++)
+            {
+                sums[i] += row[i];
+            }
+        }
+
+        // Fill in the first row of the blocks, then copy it down
+        auto firstRow = state.Pixels.data() + static_cast<size_t>(blockTop - bounds.top) * state.Stride +
+            static_cast<size_t>(update.left - bounds.left) * BytesPerPixel;
+        for (auto blockLeft = update.left; blockLeft < update.right; blockLeft += blockSize)
+        {
+            auto blockRight = std::min(blockLeft + blockSize, update.right);
+            uint32_t blockSums[BytesPerPixel] = {};
+            for (auto x = blockLeft; x < blockRight; x++)
+            {
+                for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+                {
+                    blockSums[channel] += sums[(x - update.left) * BytesPerPixel + channel];
+                }
+            }
+            auto count = static_cast<uint32_t>((blockRight - blockLeft) * (blockBottom - blockTop));
+            uint8_t color[BytesPerPixel] = {};
+            for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+            {
+                color[channel] = static_cast<uint8_t>((blockSums[channel] + count / 2) / count);
+            }
+            for (auto x = blockLeft; x < blockRight; x++)
+            {
+                memcpy(firstRow + (x - update.left) * BytesPerPixel, color, BytesPerPixel);
+            }
+        }
+        for (auto y = blockTop + 1; y < blockBottom; y++)
+        {
+            memcpy(firstRow + static_cast<size_t>(y - blockTop) * state.Stride, firstRow, values);
+        }
+    };
+
+    auto rows = update.bottom - update.top;
+    auto blockRows = (rows + blockSize - 1) / blockSize;
+    auto threads = static_cast<LONG>(std::thread::hardware_concurrency());
+    if (static_cast<size_t>(update.right - update.left) * rows < ParallelPixels || threads < 2)
+    {
+        for (LONG blockRow = 0; blockRow < blockRows; blockRow++)
+        {
+            pixelateBlocks(update.top + blockRow * blockSize, m_blockSums);
+        }
+        return;
+    }
+
+    // Rows of blocks don't share anything, so a band is a few of them with
+    // one set of sums
+    auto blockRowsPerBand = (blockRows + threads - 1) / threads;
+    std::vector<LONG> bands((blockRows + blockRowsPerBand - 1) / blockRowsPerBand);
+    std::iota(bands.begin(), bands.end(), 0);
+    if (m_bandBlockSums.size() < bands.size())
+    {
+        m_bandBlockSums.resize(bands.size());
+    }
+    std::for_each(std::execution::par, bands.begin(), bands.end(), [&](LONG band)
+    {
+        auto& columnSums = m_bandBlockSums[band];
+        auto lastBlockRow = std::min((band + 1) * blockRowsPerBand, blockRows);
+        for (auto blockRow = band * blockRowsPerBand; blockRow < lastBlockRow; blockRow++)
+        {
+            pixelateBlocks(update.top + blockRow * blockSize, columnSums);
+        }
+    });
+}
+
+void FrameRedactor::Fill(RegionState& state, RedactionRegion const& region, RECT const& update)
+{
+    auto const& bounds = state.Bounds;
+    auto values = static_cast<size_t>(update.right - update.left) * BytesPerPixel;
+    auto firstRow = state.Pixels.data() + static_cast<size_t>(update.top - bounds.top) * state.Stride +
+        static_cast<size_t>(update.left - bounds.left) * BytesPerPixel;
+    // Little endian, so 0xAARRGGBB comes out as BGRA
+    for (size_t i = 0; i < values; i += BytesPerPixel)
+    {
+        memcpy(firstRow + i, &region.FillColor, BytesPerPixel);
+    }
+    for (auto y = update.top + 1; y < update.bottom; y++)
+    {
+        memcpy(firstRow + static_cast<size_t>(y - update.top) * state.Stride, firstRow, values);
+    }
+}
+
+void FrameRedactor::Apply(uint8_t* pixels, uint32_t width, uint32_t height, uint32_t stride) const
+{
+    RECT frame = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+    for (auto&& state : m_states)
+    {
+        auto bounds = IntersectRects(state.Bounds, frame);
+        if (IsEmptyRect(bounds))
+        {
+            continue;
+        }
+        auto source = state.Pixels.data() + static_cast<size_t>(bounds.top - state.Bounds.top) * state.Stride +
+            static_cast<size_t>(bounds.left - state.Bounds.left) * BytesPerPixel;
+        auto destination = pixels + static_cast<size_t>(bounds.top) * stride + static_cast<size_t>(bounds.left) * BytesPerPixel;
+        StridedCopy::Copy(source, state.Stride, destination, stride,
+            static_cast<size_t>(bounds.right - bounds.left) * BytesPerPixel, static_cast<uint32_t>(bounds.bottom - bounds.top));
+    }
+}
+
+std::vector<RECT> FrameRedactor::RedactedBounds() const
+{
+    std::vector<RECT> result;
+    for (auto&& state : m_states)
+    {
+        if (!IsEmptyRect(state.Bounds))
+        {
+            result.push_back(state.Bounds);
+        }
+    }
+    return result;
+}
\ No newline at end of file
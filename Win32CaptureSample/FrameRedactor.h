@@ -0,0 +1,127 @@
+#pragma once
+
+enum class RedactionStyle
+{
+    Blur,
+    Pixelate,
+    Fill,
+};
+
+struct RedactionRegion
+{
+    // In pixels of the captured content
+    RECT Bounds = {};
+    RedactionStyle Style = RedactionStyle::Blur;
+    // Blur radius or pixelate block size, in pixels
+    uint32_t Strength = 16;
+    // BGRA, only used by Fill
+    uint32_t FillColor = 0xFF000000;
+};
+
+// Hides parts of a stream of frames by blurring, pixelating or filling them.
+//
+// The redacted pixels of every region are cached, and only the parts of a
+// region that a dirty rect can reach get recomputed: the dirty rects grown by
+// the blur radius or rounded out to whole blocks. A region only ever looks at
+// pixels inside of it. Blurs are a box blur with running sums in both
+// directions, so the cost doesn't depend on the radius. The sums down the
+// columns are kept per byte and updated a whole row at a time, which the
+// compiler vectorizes. The pass along a row and the averaging use SSE2 on
+// x64. Big updates are split into bands of rows on the thread pool.
+//
+// Each frame, call Prepare with what changed. If it returns true, read back
+// at least the pixels inside of SourceBounds and pass them to Update. Apply
+// then writes the cached results over a frame. Pixels are 32bpp BGRA.
+//
+// Not thread safe.
+class FrameRedactor
+{
+public:
+    struct RedactedRect
+    {
+        RECT Bounds = {};
+        // Points at the pixel in the top-left corner of Bounds
+        uint8_t const* Pixels = nullptr;
+        uint32_t Stride = 0;
+    };
+
+    // Keeps the column sums of a blur within 16 bits
+    static uint32_t const MaxBlurRadius = 128;
+
+    FrameRedactor() {}
+    ~FrameRedactor() {}
+
+    // Throws if any of the regions can't be redacted
+    static void CheckRegions(std::vector<RedactionRegion> const& regions);
+
+    // Regions that overlap are redacted in order, the later one wins. Setting
+    // the same regions again doesn't throw anything away.
+    void Regions(std::vector<RedactionRegion> const& regions);
+    std::vector<RedactionRegion> const& Regions() const { return m_regions; }
+    bool HasRegions() const { return !m_regions.empty(); }
+    // Everything gets recomputed next frame, e.g. after frames went by that
+    // the redactor didn't see.
+    void Invalidate() { m_invalid = true; }
+
+    // nullopt means we don't know what changed, so everything did. A new size
+    // recomputes everything. Returns true if Update needs to be called.
+    bool Prepare(uint32_t width, uint32_t height, std::optional<std::vector<RECT>> const& dirtyRects);
+    // Where Update reads from, can be empty (e.g. only fills changed)
+    RECT SourceBounds() const { return m_sourceBounds; }
+    // Pixels is the whole frame, only what's inside SourceBounds is read.
+    void Update(uint8_t const* pixels, uint32_t stride);
+    // Writes every region over a width x height frame, which may be smaller
+    // than the one the regions were prepared for.
+    void Apply(uint8_t* pixels, uint32_t width, uint32_t height, uint32_t stride) const;
+
+    // What the last Update recomputed
+    std::vector<RedactedRect> const& Updated() const { return m_updated; }
+    // Where the output differs from the frame beyond its dirty rects: what
+    // Prepare is about to recompute and any regions that went away.
+    std::vector<RECT> const& Damage() const { return m_damage; }
+    // Every region clipped to the frame
+    std::vector<RECT> RedactedBounds() const;
+
+private:
+    struct RegionState
+    {
+        // Clipped to the frame
+        RECT Bounds = {};
+        std::vector<uint8_t> Pixels;
+        uint32_t Stride = 0;
+        std::optional<RECT> Pending;
+    };
+
+    struct BlurScratch
+    {
+        std::vector<uint16_t> ColumnSums;
+        std::vector<uint32_t> RowSums;
+    };
+
+    void Resize(uint32_t width, uint32_t height);
+    void Blur(RegionState& state, RedactionRegion const& region, RECT const& update, uint8_t const* pixels, uint32_t stride);
+    void Pixelate(RegionState& state, RedactionRegion const& region, RECT const& update, uint8_t const* pixels, uint32_t stride);
+    void Fill(RegionState& state, RedactionRegion const& region, RECT const& update);
+
+private:
+    std::vector<RedactionRegion> m_regions;
+    std::vector<RegionState> m_states;
+    bool m_regionsChanged = false;
+    bool m_invalid = true;
+    // Bounds of regions that were replaced, for the next Damage
+    std::vector<RECT> m_removed;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    RECT m_sourceBounds = {};
+    std::vector<RedactedRect> m_updated;
+    std::vector<RECT> m_damage;
+
+    // Scratch space, kept around so it isn't reallocated every frame. Big
+    // updates are split into bands that each get their own.
+    BlurScratch m_blurScratch;
+    std::vector<float> m_scales;
+    std::vector<uint32_t> m_blockSums;
+    std::vector<BlurScratch> m_bandBlurScratch;
+    std::vector<std::vector<uint32_t>> m_bandBlockSums;
+};
\ No newline at end of file
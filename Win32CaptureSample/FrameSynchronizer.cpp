@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "FrameSynchronizer.h"
+
+FrameSynchronizer::FrameSynchronizer(FrameSynchronizerSettings const& settings)
+{
+    if (settings.Tolerance.count() < 0 || settings.MaxLatency.count() < 0)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"The tolerance and latency can't be negative.");
+    }
+    m_settings = settings;
+}
+
+size_t FrameSynchronizer::AddSource(Ticks clockOffset)
+{
+    Source source;
+    source.ClockOffset = clockOffset;
+    m_sources.push_back(std::move(source));
+    m_emptySources++;
+    return m_sources.size() - 1;
+}
+
+void FrameSynchronizer::Reset()
+{
+    for (auto&& source : m_sources)
+    {
+        source.Pending.clear();
+        source.Last = std::nullopt;
+        source.LastQueued = std::nullopt;
+    }
+    m_now = std::nullopt;
+    m_oldestPending = std::nullopt;
+    m_emptySources = m_sources.size();
+    m_statistics = {};
+}
+
+std::vector<FrameSet> FrameSynchronizer::AddFrame(
+    size_t source,
+    Ticks timestamp,
+    std::shared_ptr<void const> const& content)
+{
+    if (source >= m_sources.size())
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"Unknown source.");
+    }
+
+    std::vector<FrameSet> sets;
+    auto& target = m_sources[source];
+    auto time = timestamp - target.ClockOffset;
+    if (target.LastQueued.has_value() && time <= target.LastQueued.value())
+    {
+        m_statistics.OutOfOrderFrames++;
+        return sets;
+    }
+    target.LastQueued = time;
+    if (target.Pending.empty())
+    {
+        m_emptySources--;
+        if (!m_oldestPending.has_value() || time < m_oldestPending.value())
+        {
+            m_oldestPending = time;
+        }
+    }
+    target.Pending.push_back({ time, content, false });
+    if (!m_now.has_value() || time > m_now.value())
+    {
+        m_now = time;
+    }
+
+    EmitReadySets(sets);
+    return sets;
+}
+
+std::vector<FrameSet> FrameSynchronizer::Poll(Ticks now)
+{
+    std::vector<FrameSet> sets;
+    if (!m_now.has_value() || now > m_now.value())
+    {
+        m_now = now;
+    }
+    EmitReadySets(sets);
+    return sets;
+}
+
+std::optional<Ticks> FrameSynchronizer::Deadline() const
+{
+    if (!m_oldestPending.has_value())
+    {
+        return std::nullopt;
+    }
+    return m_oldestPending.value() + m_settings.MaxLatency;
+}
+
+void FrameSynchronizer::UpdateOldestPending()
+{
+    m_oldestPending = std::nullopt;
+    for (auto&& source : m_sources)
+    {
+        if (!source.Pending.empty() && (!m_oldestPending.has_value() || source.Pending.front().Time < m_oldestPending.value()))
+        {
+            m_oldestPending = source.Pending.front().Time;
+        }
+    }
+}
+
+void FrameSynchronizer::EmitReadySets(std::vector<FrameSet>& sets)
+{
+    while (true)
+    {
+        if (!m_oldestPending.has_value())
+        {
+            return;
+        }
+        auto anchor = m_oldestPending.value();
+
+        // Sources that haven't sent anything since might still send a frame
+        // for this moment, unless we've waited long enough
+        auto timedOut = m_now.value() >= anchor + m_settings.MaxLatency;
+        if (m_emptySources > 0 && !timedOut)
+        {
+            return;
+        }
+
+        // Frames are queued in order and none are older than the anchor, so
+        // the first one in the window is the closest
+        auto windowEnd = anchor + m_settings.Tolerance;
+        FrameSet set;
+        set.Time = anchor;
+        set.Frames.reserve(m_sources.size());
+        auto complete = true;
+        uint64_t heldFrames = 0;
+        auto latest = anchor;
+        for (auto&& source : m_sources)
+        {
+            if (!source.Pending.empty() && source.Pending.front().Time <= windowEnd)
+            {
+                auto frame = std::move(source.Pending.front());
+                source.Pending.pop_front();
+                if (source.Pending.empty())
+                {
+                    m_emptySources++;
+                }
+                latest = std::max(latest, frame.Time);
+                source.Last = frame;
+                set.Frames.push_back(std::move(frame));
+            }
+            else if (m_settings.MissingFrames == MissingFramePolicy::HoldLast && source.Last.has_value())
+            {
+                auto frame = source.Last.value();
+                frame.IsHeld = true;
+                set.Frames.push_back(std::move(frame));
+                heldFrames++;
+            }
+            else
+            {
+                complete = false;
+            }
+        }
+        UpdateOldestPending();
+
+        if (complete)
+        {
+            m_statistics.Sets++;
+            m_statistics.HeldFrames += heldFrames;
+            m_statistics.MaxSpread = std::max(m_statistics.MaxSpread, latest - anchor);
+            sets.push_back(std::move(set));
+        }
+        else
+        {
+            m_statistics.SkippedSets++;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+#include "PortableTypes.h"
+
+enum class MissingFramePolicy
+{
+    // Use the last frame the source sent, as long as it sent one
+    HoldLast,
+    // Drop the whole set
+    Skip,
+};
+
+struct FrameSynchronizerSettings
+{
+    // How far apart frames can be and still count as the same moment
+    Ticks Tolerance = std::chrono::milliseconds(8);
+    // How long to wait for a source before deciding it has no frame for a set
+    Ticks MaxLatency = std::chrono::milliseconds(100);
+    MissingFramePolicy MissingFrames = MissingFramePolicy::HoldLast;
+};
+
+struct SynchronizedFrame
+{
+    // On the shared clock, i.e. with the source's clock offset taken out
+    Ticks Time = {};
+    std::shared_ptr<void const> Content;
+    // The source had nothing for this set, so this is its last frame again
+    bool IsHeld = false;
+};
+
+struct FrameSet
+{
+    Ticks Time = {};
+    // One for each source, in the order they were added
+    std::vector<SynchronizedFrame> Frames;
+};
+
+struct SynchronizerStatistics
+{
+    uint64_t Sets = 0;
+    uint64_t SkippedSets = 0;
+    uint64_t HeldFrames = 0;
+    // Frames that showed up older than one the source already sent
+    uint64_t OutOfOrderFrames = 0;
+    // The furthest apart two frames in a set were, held frames aside
+    Ticks MaxSpread = {};
+};
+
+// Lines up frames from several captures that happened at the same time.
+//
+// Each source's frames are moved onto a shared clock by its clock offset and
+// queued in order. A set is built around the oldest queued frame of any
+// source, and each source contributes the first of its frames within the
+// tolerance of it. A source is known to have nothing for the set once its
+// next frame is past the tolerance, or once MaxLatency has passed without it
+// sending anything, and then the missing frame policy decides what happens.
+// Every set looks at each source once, so the cost grows linearly with the
+// number of sources.
+//
+// Frames only arrive when something changes, so the caller also needs to call
+// Poll once Deadline has passed. Not thread safe.
+class FrameSynchronizer
+{
+public:
+    FrameSynchronizer(FrameSynchronizerSettings const& settings = {});
+    ~FrameSynchronizer() {}
+
+    // The offset is added to the shared clock to get the source's clock.
+    // Returns the source's index.
+    size_t AddSource(Ticks clockOffset = {});
+    size_t SourceCount() const { return m_sources.size(); }
+
+    // Returns any sets that are complete now, oldest first
+    std::vector<FrameSet> AddFrame(
+        size_t source,
+        Ticks timestamp,
+        std::shared_ptr<void const> const& content);
+    std::vector<FrameSet> Poll(Ticks now);
+    // When to call Poll next, on the shared clock, if anything is waiting
+    std::optional<Ticks> Deadline() const;
+    void Reset();
+
+    SynchronizerStatistics Statistics() const { return m_statistics; }
+
+private:
+    struct Source
+    {
+        Ticks ClockOffset = {};
+        std::deque<SynchronizedFrame> Pending;
+        std::optional<SynchronizedFrame> Last;
+        std::optional<Ticks> LastQueued;
+    };
+
+    void EmitReadySets(std::vector<FrameSet>& sets);
+    void UpdateOldestPending();
+
+private:
+    FrameSynchronizerSettings m_settings;
+    std::vector<Source> m_sources;
+    // The latest time we know of, from frames or from Poll
+    std::optional<Ticks> m_now;
+    // Kept up to date so that a frame that can't complete a set doesn't
+    // have to look at every source
+    std::optional<Ticks> m_oldestPending;
+    size_t m_emptySources = 0;
+    SynchronizerStatistics m_statistics;
+};
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include "pch.h"
+#include "Hdr10Converter.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define HDR10_CONVERTER_SSE2
+#endif
+
+float const Hdr10Converter::ScRgbWhiteNits = 80.0f;
+float const Hdr10Converter::MaxNits = 10000.0f;
+
+// The PQ curve is steep near black and flat near white, so the table is
+// spaced by octave instead of linearly. Each octave from 2^-MinExponent up
+// to 1 gets PQSamplesPerOctave samples and we interpolate between them.
+// Smaller values are looked up in the first octave, which is close enough
+// to black that it makes no difference. Against a double precision
+// reference this is within 0.004 of a 10-bit code value everywhere.
+int32_t const PQMinExponent = 48;
+uint32_t const PQSamplesPerOctaveBits = 6;
+uint32_t const PQSamplesPerOctave = 1 << PQSamplesPerOctaveBits;
+
+// BT.709 to BT.2020 primaries, both linear (ITU-R BT.2087)
+float const Rec709ToRec2020[3][3] =
+{
+    { 0.6274040f, 0.3292820f, 0.0433136f },
+    { 0.0690970f, 0.9195400f, 0.0113612f },
+    { 0.0163916f, 0.0880132f, 0.8955950f },
+};
+
+double PQReference(double value)
+{
+    double const m1 = 2610.0 / 16384.0;
+    double const m2 = 2523.0 / 4096.0 * 128.0;
+    double const c1 = 3424.0 / 4096.0;
+    double const c2 = 2413.0 / 4096.0 * 32.0;
+    double const c3 = 2392.0 / 4096.0 * 32.0;
+    auto power = std::pow(std::max(value, 0.0), m1);
+    return std::pow((c1 + c2 * power) / (1.0 + c3 * power), m2);
+}
+
+std::vector<float> CreatePQTable()
+{
+    // 1.0 itself lands one past the last octave, and it needs a sample to
+    // interpolate towards as well.
+    std::vector<float> table(PQMinExponent * PQSamplesPerOctave + 2);
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        auto octave = static_cast<int32_t>(i / PQSamplesPerOctave) - PQMinExponent;
+        auto fraction = static_cast<double>(i % PQSamplesPerOctave) / PQSamplesPerOctave;
+        table[i] = static_cast<float>(PQReference(std::ldexp(1.0 + fraction, octave)));
+    }
+    return table;
+}
+
+float Hdr10Converter::HalfToFloat(uint16_t value)
+{
+    // Moving the bits into place and rescaling by 2^112 fixes up the exponent
+    // bias and handles denormals. Infinity and NaN end up as large numbers,
+    // which is fine since we clamp to 10000 nits anyway.
+    uint32_t bits = static_cast<uint32_t>(value & 0x7fff) << 13;
+    float magnitude = 0.0f;
+    memcpy(&magnitude, &bits, sizeof(magnitude));
+    magnitude *= 5.192296858534828e+33f;
+    return (value & 0x8000) ? -magnitude : magnitude;
+}
+
+std::vector<float> const& GetPQTable()
+{
+    static auto const table = CreatePQTable();
+    return table;
+}
+
+float inline EncodePQWithTable(float value, float const* table)
+{
+    // Written without branches, this runs for every channel of every pixel.
+    // The comparison also turns NaN into 0.
+    value = value > 0.0f ? std::min(value, 1.0f) : 0.0f;
+
+    // The float's exponent picks the octave and the top bits of its
+    // mantissa pick the sample, the rest is how far to the next one.
+    uint32_t const remainderBits = 23 - PQSamplesPerOctaveBits;
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    auto exponent = std::max(static_cast<int32_t>(bits >> 23) - 127, -PQMinExponent);
+    auto mantissa = bits & 0x7fffff;
+    auto index = static_cast<uint32_t>(exponent + PQMinExponent) * PQSamplesPerOctave + (mantissa >> remainderBits);
+    auto weight = static_cast<float>(mantissa & ((1u << remainderBits) - 1)) * (1.0f / (1u << remainderBits));
+    return table[index] + (table[index + 1] - table[index]) * weight;
+}
+
+uint32_t inline ConvertPixelWithTable(uint16_t const* halfPixel, float const* table)
+{
+    float const scale = Hdr10Converter::ScRgbWhiteNits / Hdr10Converter::MaxNits;
+    auto red = Hdr10Converter::HalfToFloat(halfPixel[0]) * scale;
+    auto green = Hdr10Converter::HalfToFloat(halfPixel[1]) * scale;
+    auto blue = Hdr10Converter::HalfToFloat(halfPixel[2]) * scale;
+    auto alpha = std::clamp(Hdr10Converter::HalfToFloat(halfPixel[3]), 0.0f, 1.0f);
+
+    uint32_t result = static_cast<uint32_t>(alpha * 3.0f + 0.5f) << 30;
+    for (uint32_t channel = 0; channel < 3; channel++)
+    {
+        auto&& row = Rec709ToRec2020[channel];
+        // Colors outside of BT.709 can have negative components in scRGB,
+        // but anything left negative after this is outside of BT.2020 too.
+        auto linear = row[0] * red + row[1] * green + row[2] * blue;
+        auto code = static_cast<uint32_t>(EncodePQWithTable(linear, table) * 1023.0f + 0.5f);
+        result |= code << (channel * 10);
+    }
+    return result;
+}
+
+float Hdr10Converter::EncodePQ(float value)
+{
+    return EncodePQWithTable(value, GetPQTable().data());
+}
+
+uint32_t Hdr10Converter::ConvertPixel(uint16_t const* halfPixel)
+{
+    return ConvertPixelWithTable(halfPixel, GetPQTable().data());
+}
+
+#ifdef HDR10_CONVERTER_SSE2
+// HalfToFloat for four halves that have been widened to 32 bits
+__m128 inline HalfToFloat4(__m128i value)
+{
+    auto magnitude = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(value, _mm_set1_epi32(0x7fff)), 13));
+    magnitude = _mm_mul_ps(magnitude, _mm_set1_ps(5.192296858534828e+33f));
+    auto sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(value, _mm_set1_epi32(0x8000)), 16));
+    return _mm_or_ps(magnitude, sign);
+}
+
+// EncodePQWithTable for four values. SSE2 can't gather, so the table is
+// read one lane at a time.
+__m128 inline EncodePQ4(__m128 value, float const* table)
+{
+    // The order matters for NaN: min returns its second operand and max
+    // then picks 0 over it, same as the comparison in the scalar version.
+    value = _mm_max_ps(_mm_min_ps(_mm_set1_ps(1.0f), value), _mm_setzero_ps());
+
+    uint32_t const remainderBits = 23 - PQSamplesPerOctaveBits;
+    auto bits = _mm_castps_si128(value);
+    // There's no max for 32-bit integers until SSE4.1. The value isn't
+    // negative, so the biased exponent is all that's above the mantissa.
+    auto biasedExponent = _mm_srli_epi32(bits, 23);
+    auto minBiasedExponent = _mm_set1_epi32(127 - PQMinExponent);
+    auto tooSmall = _mm_cmplt_epi32(biasedExponent, minBiasedExponent);
+    biasedExponent = _mm_or_si128(_mm_and_si128(tooSmall, minBiasedExponent), _mm_andnot_si128(tooSmall, biasedExponent));
+    auto mantissa = _mm_and_si128(bits, _mm_set1_epi32(0x7fffff));
+    auto index = _mm_add_epi32(
+        _mm_slli_epi32(_mm_sub_epi32(biasedExponent, minBiasedExponent), PQSamplesPerOctaveBits),
+        _mm_srli_epi32(mantissa, remainderBits));
+    auto weight = _mm_mul_ps(
+        _mm_cvtepi32_ps(_mm_and_si128(mantissa, _mm_set1_epi32((1 << remainderBits) - 1))),
+        _mm_set1_ps(1.0f / (1u << remainderBits)));
+
+    alignas(16) uint32_t indices[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+    auto low = _mm_setr_ps(table[indices[0]], table[indices[1]], table[indices[2]], table[indices[3]]);
+    auto high = _mm_setr_ps(table[indices[0] + 1], table[indices[1] + 1], table[indices[2] + 1], table[indices[3] + 1]);
+    return _mm_add_ps(low, _mm_mul_ps(_mm_sub_ps(high, low), weight));
+}
+
+// ConvertPixelWithTable for four pixels, one channel per register
+void inline ConvertPixels4(uint16_t const* halfPixels, float const* table, uint32_t* destination)
+{
+    auto zero = _mm_setzero_si128();
+    auto first = _mm_loadu_si128(reinterpret_cast<__m128i const*>(halfPixels));
+    auto second = _mm_loadu_si128(reinterpret_cast<__m128i const*>(halfPixels + 8));
+    auto pixel0 = _mm_castsi128_ps(_mm_unpacklo_epi16(first, zero));
+    auto pixel1 = _mm_castsi128_ps(_mm_unpackhi_epi16(first, zero));
+    auto pixel2 = _mm_castsi128_ps(_mm_unpacklo_epi16(second, zero));
+    auto pixel3 = _mm_castsi128_ps(_mm_unpackhi_epi16(second, zero));
+    _MM_TRANSPOSE4_PS(pixel0, pixel1, pixel2, pixel3);
+
+    auto scale = _mm_set1_ps(Hdr10Converter::ScRgbWhiteNits / Hdr10Converter::MaxNits);
+    auto red = _mm_mul_ps(HalfToFloat4(_mm_castps_si128(pixel0)), scale);
+    auto green = _mm_mul_ps(HalfToFloat4(_mm_castps_si128(pixel1)), scale);
+    auto blue = _mm_mul_ps(HalfToFloat4(_mm_castps_si128(pixel2)), scale);
+    auto alpha = _mm_min_ps(_mm_max_ps(HalfToFloat4(_mm_castps_si128(pixel3)), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+    auto result = _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(alpha, _mm_set1_ps(3.0f)), _mm_set1_ps(0.5f))), 30);
+    for (uint32_t channel = 0; channel < 3; channel++)
+    {
+        // Same order of operations as the scalar version, so the results match
+        auto&& row = Rec709ToRec2020[channel];
+        auto linear = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[0]), red), _mm_mul_ps(_mm_set1_ps(row[1]), green)), _mm_mul_ps(_mm_set1_ps(row[2]), blue));
+        auto code = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(EncodePQ4(linear, table), _mm_set1_ps(1023.0f)), _mm_set1_ps(0.5f)));
+        result = _mm_or_si128(result, _mm_slli_epi32(code, static_cast<int>(channel * 10)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), result);
+}
+#endif
+
+void Hdr10Converter::Convert(uint8_t const* source, uint32_t width, uint32_t height, uint32_t sourceStride, uint32_t* destination)
+{
+    auto table = GetPQTable().data();
+    std::vector<uint32_t> rows(height);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32_t y)
+    {
+        auto sourceRow = reinterpret_cast<uint16_t const*>(source + static_cast<size_t>(y) * sourceStride);
+        auto destinationRow = destination + static_cast<size_t>(y) * width;
+        uint32_t x = 0;
+#ifdef HDR10_CONVERTER_SSE2
+        for (; x + 4 <= width; x += 4)
+        {
+            ConvertPixels4(sourceRow + x * 4, table, destinationRow + x);
+        }
+#endif
+        for (; x < width; x++)
+        {
+            destinationRow[x] = ConvertPixelWithTable(sourceRow + x * 4, table);
+        }
+    });
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+// Converts scRGB (linear BT.709 primaries, 1.0 is 80 nits) half float
+// pixels to HDR10, which is BT.2020 primaries with the PQ (SMPTE ST 2084)
+// curve packed into 10 bits per channel. That's half the size of the half
+// float pixels while keeping everything up to 10000 nits. On x64 four pixels
+// are converted at a time with SSE2, which gives the same results as the
+// scalar version.
+class Hdr10Converter
+{
+public:
+    static float const ScRgbWhiteNits;
+    static float const MaxNits;
+
+    // Source pixels are DXGI_FORMAT_R16G16B16A16_FLOAT. Destination pixels
+    // are DXGI_FORMAT_R10G10B10A2_UNORM, tightly packed.
+    static void Convert(uint8_t const* source, uint32_t width, uint32_t height, uint32_t sourceStride, uint32_t* destination);
+    static uint32_t ConvertPixel(uint16_t const* halfPixel);
+
+    // PQ code value (0 to 1) for a luminance from 0 to 1, where 1 is MaxNits.
+    // Uses a table, see Hdr10Converter.cpp for how close it gets.
+    static float EncodePQ(float value);
+
+    static float HalfToFloat(uint16_t value);
+};
+
+// The PQ curve in double precision, which EncodePQ's table is made from.
+// Far too slow to run for every pixel.
+double PQReference(double value);
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include "pch.h"
+#include "ImageComparer.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define IMAGE_COMPARER_SSE2
+#endif
+
+uint32_t const BytesPerPixel = 4;
+// Images at least this big are split into bands of rows on the thread pool
+size_t const ParallelPixels = 512 * 512;
+// A multiple of the block size, so bands never share a block
+uint32_t const RowsPerBand = 64;
+// Little endian, so 0xAARRGGBB comes out as BGRA
+uint32_t const DifferentColor = 0xFFFF0000;
+uint32_t const AntiAliasedColor = 0xFFFFFF00;
+
+struct ImageView
+{
+    uint8_t const* Pixels;
+    uint32_t Stride;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t ChannelMask;
+
+    uint32_t const* Row(uint32_t y) const { return reinterpret_cast<uint32_t const*>(Pixels + static_cast<size_t>(y) * Stride); }
+    uint32_t Pixel(uint32_t x, uint32_t y) const { return Row(y)[x] & ChannelMask; }
+};
+
+bool inline IsEmptyRect(RECT const& rect)
+{
+    return rect.right <= rect.left || rect.bottom <= rect.top;
+}
+
+RECT inline UnionRects(RECT const& first, RECT const& second)
+{
+    return { std::min(first.left, second.left), std::min(first.top, second.top),
+        std::max(first.right, second.right), std::max(first.bottom, second.bottom) };
+}
+
+// Weighted so that the deltas between two pixels follow how bright they
+// look, but kept in full so that any change in color moves it
+int32_t inline Brightness(uint32_t pixel)
+{
+    auto blue = static_cast<int32_t>(pixel & 0xFF);
+    auto green = static_cast<int32_t>((pixel >> 8) & 0xFF);
+    auto red = static_cast<int32_t>((pixel >> 16) & 0xFF);
+    return red * 77 + green * 150 + blue * 29;
+}
+
+bool inline IsDifferent(uint32_t expected, uint32_t actual, uint32_t channelMask, uint32_t tolerance)
+{
+    if (((expected ^ actual) & channelMask) == 0)
+    {
+        return false;
+    }
+    for (uint32_t shift = 0; shift < 32; shift += 8)
+    {
+        if (((channelMask >> shift) & 0xFF) == 0)
+        {
+            continue;
+        }
+        auto first = static_cast<int32_t>((expected >> shift) & 0xFF);
+        auto second = static_cast<int32_t>((actual >> shift) & 0xFF);
+        if (static_cast<uint32_t>(std::abs(first - second)) > tolerance)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Calls onDifferent for every pixel in [begin, end) of the row with a channel
+// that's further apart than the tolerance
+template <typename Callback>
+void ForEachDifferentPixel(
+    uint32_t const* expected,
+    uint32_t const* actual,
+    uint32_t begin,
+    uint32_t end,
+    uint32_t channelMask,
+    uint8_t tolerance,
+    Callback&& onDifferent)
+{
+    auto x = begin;
+#ifdef IMAGE_COMPARER_SSE2
+    auto mask = _mm_set1_epi32(static_cast<int>(channelMask));
+    auto limit = _mm_set1_epi8(static_cast<char>(tolerance));
+    auto zero = _mm_setzero_si128();
+    // Almost everything matches, so look at 16 pixels at once and only work
+    // out which ones are off when any of them are
+    for (; x + 16 <= end; x += 16)
+    {
+        __m128i over[4];
+        auto anyOver = zero;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            auto first = _mm_loadu_si128(reinterpret_cast<__m128i const*>(expected + x + i * 4));
+            auto second = _mm_loadu_si128(reinterpret_cast<__m128i const*>(actual + x + i * 4));
+            auto difference = _mm_or_si128(_mm_subs_epu8(first, second), _mm_subs_epu8(second, first));
+            over[i] = _mm_subs_epu8(_mm_and_si128(difference, mask), limit);
+            anyOver = _mm_or_si128(anyOver, over[i]);
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(anyOver, zero)) == 0xFFFF)
+        {
+            continue;
+        }
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            auto same = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(over[i], zero)));
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                if ((same & (1 << lane)) == 0)
+                {
+                    onDifferent(x + i * 4 + lane);
+                }
+            }
+        }
+    }
+#endif
+    for (; x < end; x++)
+    {
+        if (IsDifferent(expected[x], actual[x], channelMask, tolerance))
+        {
+            onDifferent(x);
+        }
+    }
+}
+
+// Whether at least 3 of the pixel's neighbors are the same as it. The edge of
+// the image counts as one.
+bool HasManySiblings(ImageView const& image, uint32_t x, uint32_t y)
+{
+    auto left = x > 0 ? x - 1 : x;
+    auto top = y > 0 ? y - 1 : y;
+    auto right = std::min(x + 1, image.Width - 1);
+    auto bottom = std::min(y + 1, image.Height - 1);
+    auto center = image.Pixel(x, y);
+    uint32_t same = (x == left || x == right || y == top || y == bottom) ? 1 : 0;
+    for (auto neighborY = top; neighborY <= bottom; neighborY++)
+    {
+        for (auto neighborX = left; neighborX <= right; neighborX++)
+        {
+            if ((neighborX != x || neighborY != y) && image.Pixel(neighborX, neighborY) == center)
+            {
+                if (++same > 2)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Whether the pixel of image looks like a blend of the two sides of an edge,
+// see the comment on ImageComparer
+bool IsAntiAliased(ImageView const& image, ImageView const& other, uint32_t x, uint32_t y)
+{
+    auto left = x > 0 ? x - 1 : x;
+    auto top = y > 0 ? y - 1 : y;
+    auto right = std::min(x + 1, image.Width - 1);
+    auto bottom = std::min(y + 1, image.Height - 1);
+    auto center = image.Pixel(x, y);
+
+    // Most different pixels are inside of something flat that changed, which
+    // three neighbors of the same color are enough to tell
+    if (left < x && x < right && top < y)
+    {
+        if (image.Pixel(left, y) == center && image.Pixel(right, y) == center && image.Pixel(x, top) == center)
+        {
+            return false;
+        }
+    }
+
+    auto centerBrightness = Brightness(center);
+    uint32_t same = (x == left || x == right || y == top || y == bottom) ? 1 : 0;
+    int32_t darkest = 0;
+    int32_t brightest = 0;
+    uint32_t darkestX = 0;
+    uint32_t darkestY = 0;
+    uint32_t brightestX = 0;
+    uint32_t brightestY = 0;
+    for (auto neighborY = top; neighborY <= bottom; neighborY++)
+    {
+        for (auto neighborX = left; neighborX <= right; neighborX++)
+        {
+            if (neighborX == x && neighborY == y)
+            {
+                continue;
+            }
+            auto delta = Brightness(image.Pixel(neighborX, neighborY)) - centerBrightness;
+            if (delta == 0)
+            {
+                // Inside of a flat area, not on an edge
+                if (++same > 2)
+                {
+                    return false;
+                }
+            }
+            else if (delta < darkest)
+            {
+                darkest = delta;
+                darkestX = neighborX;
+                darkestY = neighborY;
+            }
+            else if (delta > brightest)
+            {
+                brightest = delta;
+                brightestX = neighborX;
+                brightestY = neighborY;
+            }
+        }
+    }
+    if (darkest == 0 || brightest == 0)
+    {
+        return false;
+    }
+    return (HasManySiblings(image, darkestX, darkestY) && HasManySiblings(other, darkestX, darkestY)) ||
+        (HasManySiblings(image, brightestX, brightestY) && HasManySiblings(other, brightestX, brightestY));
+}
+
+// Mostly white and without color, so that the differences stand out
+void FadeRow(uint32_t const* expected, uint32_t* output, uint32_t width)
+{
+    for (uint32_t x = 0; x < width; x++)
+    {
+        auto brightness = static_cast<uint32_t>(Brightness(expected[x])) >> 8;
+        auto faded = 255 - (((255 - brightness) * 26) >> 8);
+        output[x] = 0xFF000000 | (faded * 0x010101);
+    }
+}
+
+ImageComparer::ImageComparer(ImageCompareSettings const& settings)
+{
+    m_settings = settings;
+}
+
+ImageCompareResult ImageComparer::Compare(
+    uint8_t const* expected,
+    uint32_t expectedStride,
+    uint8_t const* actual,
+    uint32_t actualStride,
+    uint32_t width,
+    uint32_t height)
+{
+    if (width == 0 || height == 0 || expectedStride < width * BytesPerPixel || actualStride < width * BytesPerPixel)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"Invalid image size.");
+    }
+
+    auto channelMask = m_settings.CompareAlpha ? 0xFFFFFFFF : 0x00FFFFFF;
+    ImageView expectedImage = { expected, expectedStride, width, height, channelMask };
+    ImageView actualImage = { actual, actualStride, width, height, channelMask };
+
+    m_blocksWide = (width + BlockSize - 1) / BlockSize;
+    m_blocksHigh = (height + BlockSize - 1) / BlockSize;
+    m_blockBounds.assign(static_cast<size_t>(m_blocksWide) * m_blocksHigh, RECT{});
+
+    std::vector<RECT> ignoreRegions;
+    for (auto&& region : m_settings.IgnoreRegions)
+    {
+        RECT clipped = { std::max(region.left, 0L), std::max(region.top, 0L),
+            std::min(region.right, static_cast<LONG>(width)), std::min(region.bottom, static_cast<LONG>(height)) };
+        if (!IsEmptyRect(clipped))
+        {
+            ignoreRegions.push_back(clipped);
+        }
+    }
+
+    ImageCompareResult result;
+    if (m_settings.CreateDiffImage)
+    {
+        result.DiffImage.resize(static_cast<size_t>(width) * height * BytesPerPixel);
+    }
+    auto diffImage = reinterpret_cast<uint32_t*>(result.DiffImage.data());
+
+    // Only used to stop early
+    std::atomic<uint64_t> totalDifferent = 0;
+    std::atomic<bool> stopped = false;
+
+    auto compareRows = [&](uint32_t top, uint32_t bottom, std::vector<std::pair<LONG, LONG>>& ignoredSpans)
+    {
+        BandCounts counts;
+        for (auto y = top; y < bottom; y++)
+        {
+            if (stopped.load(std::memory_order_relaxed))
+            {
+                break;
+            }
+            auto expectedRow = expectedImage.Row(y);
+            auto actualRow = actualImage.Row(y);
+            auto diffRow = diffImage != nullptr ? diffImage + static_cast<size_t>(y) * width : nullptr;
+            if (diffRow != nullptr)
+            {
+                FadeRow(expectedRow, diffRow, width);
+            }
+
+            uint64_t rowDifferent = 0;
+            auto onDifferent = [&](uint32_t x)
+            {
+                if (m_settings.IgnoreAntiAliasing &&
+                    (IsAntiAliased(expectedImage, actualImage, x, y) || IsAntiAliased(actualImage, expectedImage, x, y)))
+                {
+                    counts.AntiAliasedPixels++;
+                    if (diffRow != nullptr)
+                    {
+                        diffRow[x] = AntiAliasedColor;
+                    }
+                    return;
+                }
+
+                rowDifferent++;
+                if (diffRow != nullptr)
+                {
+                    diffRow[x] = DifferentColor;
+                }
+                auto& block = m_blockBounds[static_cast<size_t>(y / BlockSize) * m_blocksWide + x / BlockSize];
+                RECT pixel = { static_cast<LONG>(x), static_cast<LONG>(y), static_cast<LONG>(x + 1), static_cast<LONG>(y + 1) };
+                block = IsEmptyRect(block) ? pixel : UnionRects(block, pixel);
+            };
+
+            // Walk the parts of the row between the ignored regions
+            ignoredSpans.clear();
+            for (auto&& region : ignoreRegions)
+            {
+                if (region.top <= static_cast<LONG>(y) && static_cast<LONG>(y) < region.bottom)
+                {
+                    ignoredSpans.push_back({ region.left, region.right });
+                }
+            }
+            std::sort(ignoredSpans.begin(), ignoredSpans.end());
+            uint32_t begin = 0;
+            for (auto&& [spanLeft, spanRight] : ignoredSpans)
+            {
+                if (static_cast<uint32_t>(spanLeft) > begin)
+                {
+                    ForEachDifferentPixel(expectedRow, actualRow, begin, static_cast<uint32_t>(spanLeft), channelMask, m_settings.Tolerance, onDifferent);
+                }
+                begin = std::max(begin, static_cast<uint32_t>(spanRight));
+            }
+            if (begin < width)
+            {
+                ForEachDifferentPixel(expectedRow, actualRow, begin, width, channelMask, m_settings.Tolerance, onDifferent);
+            }
+
+            counts.DifferentPixels += rowDifferent;
+            if (m_settings.StopOnFailure && rowDifferent > 0)
+            {
+                auto total = totalDifferent.fetch_add(rowDifferent, std::memory_order_relaxed) + rowDifferent;
+                if (total > m_settings.MaxDifferentPixels)
+                {
+                    stopped.store(true, std::memory_order_relaxed);
+                }
+            }
+        }
+        return counts;
+    };
+
+    std::vector<BandCounts> bandCounts;
+    if (static_cast<size_t>(width) * height < ParallelPixels || std::thread::hardware_concurrency() < 2)
+    {
+        std::vector<std::pair<LONG, LONG>> ignoredSpans;
+        bandCounts.push_back(compareRows(0, height, ignoredSpans));
+    }
+    else
+    {
+        // Bands don't share anything but the early out
+        bandCounts.resize((height + RowsPerBand - 1) / RowsPerBand);
+        std::vector<uint32_t> bands(bandCounts.size());
+        std::iota(bands.begin(), bands.end(), 0);
+        std::for_each(std::execution::par, bands.begin(), bands.end(), [&](uint32_t band)
+        {
+            auto top = band * RowsPerBand;
+            std::vector<std::pair<LONG, LONG>> ignoredSpans;
+            bandCounts[band] = compareRows(top, std::min(top + RowsPerBand, height), ignoredSpans);
+        });
+    }
+
+    for (auto&& counts : bandCounts)
+    {
+        result.DifferentPixels += counts.DifferentPixels;
+        result.AntiAliasedPixels += counts.AntiAliasedPixels;
+    }
+    result.Matches = result.DifferentPixels <= m_settings.MaxDifferentPixels;
+    result.Complete = !stopped.load();
+    result.DiffRects = CollectDiffRects();
+    return result;
+}
+
+std::vector<RECT> ImageComparer::CollectDiffRects() const
+{
+    // Runs of blocks in a row, and the rects they're growing
+    struct OpenRect
+    {
+        uint32_t FirstBlock;
+        uint32_t EndBlock;
+        RECT Bounds;
+    };
+    std::vector<OpenRect> open;
+    std::vector<OpenRect> next;
+    std::vector<RECT> rects;
+
+    for (uint32_t blockY = 0; blockY < m_blocksHigh; blockY++)
+    {
+        auto row = m_blockBounds.data() + static_cast<size_t>(blockY) * m_blocksWide;
+        size_t openIndex = 0;
+        next.clear();
+        uint32_t blockX = 0;
+        while (blockX < m_blocksWide)
+        {
+            if (IsEmptyRect(row[blockX]))
+            {
+                blockX++;
+                continue;
+            }
+            auto firstBlock = blockX;
+            auto bounds = row[blockX];
+            while (++blockX < m_blocksWide && !IsEmptyRect(row[blockX]))
+            {
+                bounds = UnionRects(bounds, row[blockX]);
+            }
+
+            // Rects above that end before this run can't grow anymore. One
+            // with exactly the same span keeps going.
+            while (openIndex < open.size() && open[openIndex].FirstBlock < firstBlock)
+            {
+                rects.push_back(open[openIndex++].Bounds);
+            }
+            if (openIndex < open.size() && open[openIndex].FirstBlock == firstBlock && open[openIndex].EndBlock == blockX)
+            {
+                bounds = UnionRects(bounds, open[openIndex++].Bounds);
+            }
+            next.push_back({ firstBlock, blockX, bounds });
+        }
+        for (; openIndex < open.size(); openIndex++)
+        {
+            rects.push_back(open[openIndex].Bounds);
+        }
+        std::swap(open, next);
+    }
+    for (auto&& rect : open)
+    {
+        rects.push_back(rect.Bounds);
+    }
+
+    std::sort(rects.begin(), rects.end(), [](auto&& first, auto&& second)
+    {
+        return first.top != second.top ? first.top < second.top : first.left < second.left;
+    });
+    return rects;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+struct ImageCompareSettings
+{
+    // How far apart each channel of two pixels can be (0 to 255) and still
+    // count as the same.
+    uint8_t Tolerance = 0;
+    // Captures of windows don't agree on alpha, so it's ignored unless asked for
+    bool CompareAlpha = false;
+    // Don't count pixels that only differ because an edge was anti-aliased
+    // differently, e.g. text drawn at a slightly different offset.
+    bool IgnoreAntiAliasing = true;
+    // Parts of the images that aren't compared, e.g. a clock
+    std::vector<RECT> IgnoreRegions;
+    // The images match if no more than this many pixels differ...
+    uint64_t MaxDifferentPixels = 0;
+    // ...and once more do, stop looking. The diff rects and the diff image
+    // then only cover the rows that were looked at.
+    bool StopOnFailure = false;
+    bool CreateDiffImage = true;
+};
+
+struct ImageCompareResult
+{
+    bool Matches = false;
+    // False if the comparison stopped early
+    bool Complete = false;
+    uint64_t DifferentPixels = 0;
+    uint64_t AntiAliasedPixels = 0;
+    // Bounds of the different pixels. They don't overlap, like the dirty
+    // rects of a frame.
+    std::vector<RECT> DiffRects;
+    // 32bpp BGRA, tightly packed. The expected image faded out, with the
+    // different pixels in red and the anti-aliased ones in yellow.
+    std::vector<uint8_t> DiffImage;
+};
+
+// Compares an image, usually a capture, to the one it's expected to look like.
+//
+// Most pixels of a passing UI test match exactly, so the images are compared
+// 16 pixels at a time with SSE2 on x64, and only pixels where a channel is
+// off by more than the tolerance are looked at more closely. Those are
+// checked for anti-aliasing the way pixelmatch does it: a pixel on an edge
+// (with both a darker and a brighter neighbor) whose darkest or brightest
+// neighbor sits in a flat area in both images is a blend of the two sides of
+// the edge, and doesn't count. Different pixels are gathered into a grid of
+// blocks, and rows of blocks with the same span are merged into rects, which
+// are then shrunk to fit what's inside of them. Big images are split into
+// bands of rows on the thread pool.
+//
+// Not thread safe.
+class ImageComparer
+{
+public:
+    static uint32_t const BlockSize = 16;
+
+    ImageComparer(ImageCompareSettings const& settings = {});
+    ~ImageComparer() {}
+
+    ImageCompareSettings const& Settings() const { return m_settings; }
+
+    // Both images are 32bpp BGRA and the same size
+    ImageCompareResult Compare(
+        uint8_t const* expected,
+        uint32_t expectedStride,
+        uint8_t const* actual,
+        uint32_t actualStride,
+        uint32_t width,
+        uint32_t height);
+
+private:
+    struct BandCounts
+    {
+        uint64_t DifferentPixels = 0;
+        uint64_t AntiAliasedPixels = 0;
+    };
+
+    std::vector<RECT> CollectDiffRects() const;
+
+private:
+    ImageCompareSettings m_settings;
+
+    uint32_t m_blocksWide = 0;
+    uint32_t m_blocksHigh = 0;
+    // Bounds of the different pixels in each block, empty if there aren't any
+    std::vector<RECT> m_blockBounds;
+};
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "LatencyMarkerWindow.h"
+#include "SimpleCapture.h"
+
+const std::wstring LatencyMarkerWindow::ClassName = L"Win32CaptureSample.LatencyMarkerWindow";
+std::once_flag LatencyMarkerWindowClassRegistration;
+LatencyMarkerWindow* LatencyMarkerWindow::s_current = nullptr;
+
+void LatencyMarkerWindow::RegisterWindowClass()
+{
+    auto instance = winrt::check_pointer(GetModuleHandleW(nullptr));
+    WNDCLASSEX wcex = {};
+    wcex.cbSize = sizeof(wcex);
+    wcex.lpfnWndProc = WndProc;
+    wcex.hInstance = instance;
+    wcex.hCursor = LoadCursorW(nullptr, IDC_ARROW);
+    wcex.lpszClassName = ClassName.c_str();
+    winrt::check_bool(RegisterClassExW(&wcex));
+}
+
+LatencyMarkerWindow::LatencyMarkerWindow(HMONITOR monitor, MarkerPhase initialPhase, InputHandler handler)
+{
+    if (s_current != nullptr)
+    {
+        throw winrt::hresult_error(E_ILLEGAL_METHOD_CALL, L"Only one latency marker can be shown at a time.");
+    }
+    auto instance = winrt::check_pointer(GetModuleHandleW(nullptr));
+    std::call_once(LatencyMarkerWindowClassRegistration, []() { RegisterWindowClass(); });
+    m_handler = handler;
+    m_phase = initialPhase;
+
+    // We aren't DPI aware, but the marker has to be at an exact spot in the
+    // capture, which is in physical pixels. The window keeps the awareness
+    // it was created with.
+    auto previousContext = SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+    auto restoreContext = wil::scope_exit([previousContext]()
+    {
+        SetThreadDpiAwarenessContext(previousContext);
+    });
+
+    MONITORINFO monitorInfo = {};
+    monitorInfo.cbSize = sizeof(monitorInfo);
+    winrt::check_bool(GetMonitorInfoW(monitor, &monitorInfo));
+
+    // Input goes right through it and it never takes focus, otherwise we
+    // would be measuring ourselves.
+    auto exStyle = WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE | WS_EX_LAYERED | WS_EX_TRANSPARENT;
+    m_window.reset(CreateWindowExW(exStyle, ClassName.c_str(), L"Latency Marker", WS_POPUP,
+        monitorInfo.rcMonitor.left + MarkerOffset, monitorInfo.rcMonitor.top + MarkerOffset, MarkerSize, MarkerSize,
+        nullptr, nullptr, instance, this));
+    winrt::check_bool(m_window.get() != nullptr);
+    winrt::check_bool(SetLayeredWindowAttributes(m_window.get(), 0, 255, LWA_ALPHA));
+    ShowWindow(m_window.get(), SW_SHOWNOACTIVATE);
+    UpdateWindow(m_window.get());
+
+    s_current = this;
+    m_keyboardHook.reset(SetWindowsHookExW(WH_KEYBOARD_LL, KeyboardHookProc, instance, 0));
+    m_mouseHook.reset(SetWindowsHookExW(WH_MOUSE_LL, MouseHookProc, instance, 0));
+    if (!m_keyboardHook || !m_mouseHook)
+    {
+        s_current = nullptr;
+        winrt::throw_last_error();
+    }
+}
+
+LatencyMarkerWindow::~LatencyMarkerWindow()
+{
+    m_keyboardHook.reset();
+    m_mouseHook.reset();
+    s_current = nullptr;
+}
+
+LRESULT CALLBACK LatencyMarkerWindow::WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lparam)
+{
+    if (message == WM_NCCREATE)
+    {
+        auto createStruct = reinterpret_cast<CREATESTRUCTW*>(lparam);
+        SetWindowLongPtrW(window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(createStruct->lpCreateParams));
+    }
+    else if (message == WM_PAINT)
+    {
+        auto marker = reinterpret_cast<LatencyMarkerWindow*>(GetWindowLongPtrW(window, GWLP_USERDATA));
+        if (marker != nullptr)
+        {
+            marker->Paint();
+            return 0;
+        }
+    }
+    return DefWindowProcW(window, message, wparam, lparam);
+}
+
+LRESULT CALLBACK LatencyMarkerWindow::KeyboardHookProc(int code, WPARAM wparam, LPARAM lparam)
+{
+    // Key repeats would flash the marker faster than we can see it
+    if (code == HC_ACTION && s_current != nullptr && (wparam == WM_KEYDOWN || wparam == WM_SYSKEYDOWN))
+    {
+        auto info = reinterpret_cast<KBDLLHOOKSTRUCT*>(lparam);
+        if ((info->flags & LLKHF_INJECTED) == 0)
+        {
+            s_current->OnInput();
+        }
+    }
+    return CallNextHookEx(nullptr, code, wparam, lparam);
+}
+
+LRESULT CALLBACK LatencyMarkerWindow::MouseHookProc(int code, WPARAM wparam, LPARAM lparam)
+{
+    if (code == HC_ACTION && s_current != nullptr &&
+        (wparam == WM_LBUTTONDOWN || wparam == WM_RBUTTONDOWN || wparam == WM_MBUTTONDOWN || wparam == WM_XBUTTONDOWN))
+    {
+        auto info = reinterpret_cast<MSLLHOOKSTRUCT*>(lparam);
+        if ((info->flags & LLMHF_INJECTED) == 0)
+        {
+            s_current->OnInput();
+        }
+    }
+    return CallNextHookEx(nullptr, code, wparam, lparam);
+}
+
+void LatencyMarkerWindow::OnInput()
+{
+    // Take the time before anything else
+    auto timestamp = GetSystemRelativeTime();
+    auto phase = m_handler(timestamp);
+    if (phase.has_value() && phase.value() != m_phase)
+    {
+        m_phase = phase.value();
+        // Paint now rather than whenever the message queue gets to it
+        InvalidateRect(m_window.get(), nullptr, false);
+        UpdateWindow(m_window.get());
+    }
+}
+
+void LatencyMarkerWindow::Paint()
+{
+    PAINTSTRUCT paint = {};
+    auto dc = BeginPaint(m_window.get(), &paint);
+    auto restoreDC = wil::scope_exit([&]()
+    {
+        EndPaint(m_window.get(), &paint);
+    });
+
+    // Same layout the MarkerDetector expects: the top left and bottom right
+    // squares are light in the light phase, the others are the opposite.
+    auto half = MarkerSize / 2;
+    auto light = static_cast<HBRUSH>(GetStockObject(WHITE_BRUSH));
+    auto dark = static_cast<HBRUSH>(GetStockObject(BLACK_BRUSH));
+    auto diagonal = m_phase == MarkerPhase::Light ? light : dark;
+    auto antiDiagonal = m_phase == MarkerPhase::Light ? dark : light;
+    RECT topLeft = { 0, 0, half, half };
+    RECT topRight = { half, 0, MarkerSize, half };
+    RECT bottomLeft = { 0, half, half, MarkerSize };
+    RECT bottomRight = { half, half, MarkerSize, MarkerSize };
+    FillRect(dc, &topLeft, diagonal);
+    FillRect(dc, &bottomRight, diagonal);
+    FillRect(dc, &topRight, antiDiagonal);
+    FillRect(dc, &bottomLeft, antiDiagonal);
+}
\ No newline at end of file
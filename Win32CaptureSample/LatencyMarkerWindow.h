@@ -0,0 +1,45 @@
+#pragma once
+#include "MarkerDetector.h"
+
+// Shows the marker a LatencyMeter looks for in the corner of a monitor and
+// flashes it whenever a key or mouse button goes down anywhere on the
+// desktop. The input is timestamped in the low level hook, which is as
+// early as we can see it without a driver. Has to be created and used on a
+// thread with a message loop, or the hooks stall all input until they time
+// out.
+class LatencyMarkerWindow
+{
+public:
+    static int32_t const MarkerOffset = 16;
+    static int32_t const MarkerSize = 32;
+
+    // Gets the time of the input, returns the phase to flash the marker to or
+    // nullopt to leave it alone.
+    using InputHandler = std::function<std::optional<MarkerPhase>(winrt::Windows::Foundation::TimeSpan)>;
+
+    LatencyMarkerWindow(HMONITOR monitor, MarkerPhase initialPhase, InputHandler handler);
+    ~LatencyMarkerWindow();
+
+    // Where to look for the marker in the monitor's capture
+    RECT MarkerBounds() const { return { MarkerOffset, MarkerOffset, MarkerOffset + MarkerSize, MarkerOffset + MarkerSize }; }
+
+private:
+    static const std::wstring ClassName;
+    static void RegisterWindowClass();
+    static LRESULT CALLBACK WndProc(HWND window, UINT message, WPARAM wparam, LPARAM lparam);
+    static LRESULT CALLBACK KeyboardHookProc(int code, WPARAM wparam, LPARAM lparam);
+    static LRESULT CALLBACK MouseHookProc(int code, WPARAM wparam, LPARAM lparam);
+
+    void OnInput();
+    void Paint();
+
+private:
+    // Hooks don't get any context
+    static LatencyMarkerWindow* s_current;
+
+    wil::unique_hwnd m_window;
+    wil::unique_hhook m_keyboardHook;
+    wil::unique_hhook m_mouseHook;
+    InputHandler m_handler;
+    MarkerPhase m_phase = MarkerPhase::None;
+};
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "LatencyMeter.h"
+
+LatencyPercentiles ComputePercentiles(std::vector<Ticks>& latencies)
+{
+    LatencyPercentiles result;
+    if (latencies.empty())
+    {
+        return result;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](size_t percent)
+    {
+        auto rank = (latencies.size() * percent + 99) / 100;
+        return latencies[std::max(rank, size_t(1)) - 1];
+    };
+    result.Min = latencies.front();
+    result.Median = percentile(50);
+    result.P90 = percentile(90);
+    result.P95 = percentile(95);
+    result.P99 = percentile(99);
+    result.Max = latencies.back();
+    return result;
+}
+
+LatencyMeter::LatencyMeter(Ticks timeout)
+{
+    if (timeout <= Ticks{ 0 })
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"The timeout has to be positive.");
+    }
+    m_timeout = timeout;
+}
+
+std::optional<MarkerPhase> LatencyMeter::OnInput(Ticks timestamp)
+{
+    ExpirePendingFlash(timestamp);
+    if (m_pending.has_value())
+    {
+        return std::nullopt;
+    }
+
+    // Flash away from what the frames show rather than from what we flashed
+    // last. If a flash never showed up, the two could be the same, and that
+    // flash would count as soon as the marker came back.
+    auto phase = m_shownPhase == MarkerPhase::Light ? MarkerPhase::Dark : MarkerPhase::Light;
+    m_pending = PendingFlash{ timestamp, phase };
+    return phase;
+}
+
+void LatencyMeter::OnFrame(Ticks frameTime, Ticks arrivalTime, MarkerPhase phase)
+{
+    if (phase != MarkerPhase::None)
+    {
+        m_shownPhase = phase;
+    }
+    // Frames composed before the input can't show it, even if they arrive later
+    if (m_pending.has_value() && phase == m_pending->Phase && frameTime >= m_pending->InputTime)
+    {
+        m_samples.push_back({ frameTime - m_pending->InputTime, arrivalTime - m_pending->InputTime });
+        if (m_samples.size() > MaxSamples)
+        {
+            m_samples.pop_front();
+        }
+        m_pending.reset();
+        return;
+    }
+    ExpirePendingFlash(arrivalTime);
+}
+
+LatencyReport LatencyMeter::Report() const
+{
+    LatencyReport report;
+    report.Samples = m_samples.size();
+    report.Missed = m_missed;
+
+    std::vector<Ticks> latencies;
+    latencies.reserve(m_samples.size());
+    for (auto&& sample : m_samples)
+    {
+        latencies.push_back(sample.ToFrame);
+    }
+    report.ToFrame = ComputePercentiles(latencies);
+    latencies.clear();
+    for (auto&& sample : m_samples)
+    {
+        latencies.push_back(sample.ToArrival);
+    }
+    report.ToArrival = ComputePercentiles(latencies);
+    return report;
+}
+
+void LatencyMeter::Reset()
+{
+    m_pending.reset();
+    m_samples.clear();
+    m_missed = 0;
+}
+
+void LatencyMeter::ExpirePendingFlash(Ticks now)
+{
+    if (m_pending.has_value() && now - m_pending->InputTime > m_timeout)
+    {
+        m_missed++;
+        m_pending.reset();
+    }
+}
\ No newline at end of file
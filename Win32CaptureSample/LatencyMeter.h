@@ -0,0 +1,79 @@
+#pragma once
+#include "PortableTypes.h"
+#include "MarkerDetector.h"
+
+struct LatencyPercentiles
+{
+    Ticks Min = {};
+    Ticks Median = {};
+    Ticks P90 = {};
+    Ticks P95 = {};
+    Ticks P99 = {};
+    Ticks Max = {};
+};
+
+struct LatencyReport
+{
+    size_t Samples = 0;
+    // Flashes that didn't show up in a frame in time
+    size_t Missed = 0;
+    // Until the frame with the flash was composed (its SystemRelativeTime)...
+    LatencyPercentiles ToFrame;
+    // ...and until it made it to OnFrameArrived
+    LatencyPercentiles ToArrival;
+};
+
+// Pairs up input events with the first frame that shows their effect.
+//
+// Each input flashes the marker over to the other phase from the one the
+// frames show, and the first frame where the marker is in that phase is the
+// one that shows it. Input that comes in while a flash is still on its way
+// is ignored, since there would be no telling which one a frame showed. A
+// flash that doesn't show up within the timeout counts as missed. The latest MaxSamples latencies are kept, and
+// percentiles are nearest rank.
+//
+// Timestamps are on the same clock as Direct3D11CaptureFrame::SystemRelativeTime.
+// Not thread safe.
+class LatencyMeter
+{
+public:
+    static size_t const MaxSamples = 10000;
+    // The marker starts out in this phase
+    static MarkerPhase const InitialPhase = MarkerPhase::Dark;
+
+    LatencyMeter(Ticks timeout = std::chrono::seconds(1));
+    ~LatencyMeter() {}
+
+    // Returns the phase to flash the marker to, or nullopt if this input
+    // should be ignored
+    std::optional<MarkerPhase> OnInput(Ticks timestamp);
+    void OnFrame(
+        Ticks frameTime,
+        Ticks arrivalTime,
+        MarkerPhase phase);
+    LatencyReport Report() const;
+    void Reset();
+
+private:
+    struct PendingFlash
+    {
+        Ticks InputTime = {};
+        MarkerPhase Phase = MarkerPhase::None;
+    };
+
+    struct Sample
+    {
+        Ticks ToFrame = {};
+        Ticks ToArrival = {};
+    };
+
+    void ExpirePendingFlash(Ticks now);
+
+private:
+    Ticks m_timeout = {};
+    // What the latest frame with the marker in it showed
+    MarkerPhase m_shownPhase = InitialPhase;
+    std::optional<PendingFlash> m_pending;
+    std::deque<Sample> m_samples;
+    size_t m_missed = 0;
+};
\ No newline at end of file
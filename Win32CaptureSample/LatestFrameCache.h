@@ -0,0 +1,86 @@
+#pragma once
+
+// The most recent frame, which one thread keeps replacing, and a copy of it
+// that's only made when someone asks. Everyone who asks before the next
+// frame gets the same copy. Publishing never waits, and neither does asking
+// for a copy that's already been made. Asking for a new one waits for
+// whoever is already making it instead of making another.
+//
+// A frame that's changed in place (SimpleCapture reuses its texture) is
+// published again to bump the version. The copy then has to be made under
+// whatever guards those changes, otherwise it might catch one half done.
+template <typename Frame, typename Copy>
+class LatestFrameCache
+{
+public:
+    LatestFrameCache() {}
+    ~LatestFrameCache() {}
+
+    void Publish(std::shared_ptr<Frame> frame)
+    {
+        m_frame.store(std::move(frame));
+        m_version.fetch_add(1);
+    }
+
+    // A copy that's being made right now still lands afterwards, but it's
+    // of an older version and nobody gets it
+    void Clear()
+    {
+        m_frame.store(nullptr);
+        m_copy.store(nullptr);
+        m_version.fetch_add(1);
+    }
+
+    std::shared_ptr<Frame> Load() const { return m_frame.load(); }
+    uint64_t Version() const { return m_version.load(); }
+
+    // Returns a copy of the frame, made by makeCopy(Frame const&) if the one
+    // we have is out of date. makeCopy returns a std::shared_ptr<Copy const>,
+    // or nullptr if it can't copy this frame. Nullptr if there's no frame.
+    template <typename MakeCopy>
+    std::shared_ptr<Copy const> GetCopy(MakeCopy&& makeCopy)
+    {
+        auto version = m_version.load();
+        auto cached = m_copy.load();
+        if (cached != nullptr && cached->Version == version)
+        {
+            return cached->Value;
+        }
+
+        auto lock = std::scoped_lock(m_copyLock);
+        // Someone else could have copied it while we waited. The version is
+        // read before the frame, so the frame is at least this new and the
+        // copy never claims to be newer than it is.
+        version = m_version.load();
+        cached = m_copy.load();
+        if (cached != nullptr && cached->Version == version)
+        {
+            return cached->Value;
+        }
+        auto frame = m_frame.load();
+        if (frame == nullptr)
+        {
+            return nullptr;
+        }
+        std::shared_ptr<Copy const> copy = makeCopy(*frame);
+        if (copy == nullptr)
+        {
+            return nullptr;
+        }
+        m_copy.store(std::make_shared<CachedCopy const>(CachedCopy{ version, copy }));
+        return copy;
+    }
+
+private:
+    struct CachedCopy
+    {
+        uint64_t Version = 0;
+        std::shared_ptr<Copy const> Value;
+    };
+
+    std::atomic<std::shared_ptr<Frame>> m_frame;
+    std::atomic<uint64_t> m_version = 0;
+    std::atomic<std::shared_ptr<CachedCopy const>> m_copy;
+    // Only taken by whoever makes a copy
+    std::mutex m_copyLock;
+};
\ No newline at end of file
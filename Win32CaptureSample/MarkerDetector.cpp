@@ -0,0 +1,89 @@
+#include "pch.h"
+#include "MarkerDetector.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define MARKER_DETECTOR_SSE2
+#endif
+
+uint32_t const BytesPerPixel = 4;
+
+// Adds up the blue, green and red channels of a run of pixels
+uint64_t SumColorChannels(uint8_t const* pixels, uint32_t count)
+{
+    uint64_t sum = 0;
+    uint32_t x = 0;
+#ifdef MARKER_DETECTOR_SSE2
+    auto colorMask = _mm_set1_epi32(0x00FFFFFF);
+    auto zero = _mm_setzero_si128();
+    auto sums = zero;
+    for (; x + 4 <= count; x += 4)
+    {
+        auto values = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(pixels + x * BytesPerPixel)), colorMask);
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(values, zero));
+    }
+    uint64_t lanes[2] = {};
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sums);
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; x < count; x++)
+    {
+        auto pixel = pixels + x * BytesPerPixel;
+        sum += static_cast<uint64_t>(pixel[0]) + pixel[1] + pixel[2];
+    }
+    return sum;
+}
+
+MarkerDetector::MarkerDetector(RECT const& bounds)
+{
+    if (bounds.left < 0 || bounds.top < 0 || bounds.right - bounds.left < 2 || bounds.bottom - bounds.top < 2)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"The marker has to be at least 2x2 pixels.");
+    }
+    m_bounds = bounds;
+}
+
+MarkerPhase MarkerDetector::Detect(uint8_t const* pixels, uint32_t stride, uint32_t width, uint32_t height) const
+{
+    if (m_bounds.right > static_cast<LONG>(width) || m_bounds.bottom > static_cast<LONG>(height))
+    {
+        return MarkerPhase::None;
+    }
+
+    auto middleX = (m_bounds.left + m_bounds.right) / 2;
+    auto middleY = (m_bounds.top + m_bounds.bottom) / 2;
+    auto leftWidth = static_cast<uint32_t>(middleX - m_bounds.left);
+    auto rightWidth = static_cast<uint32_t>(m_bounds.right - middleX);
+
+    // Top-left, top-right, bottom-left, bottom-right
+    uint64_t sums[4] = {};
+    for (auto y = m_bounds.top; y < m_bounds.bottom; y++)
+    {
+        auto row = pixels + static_cast<size_t>(y) * stride;
+        auto square = y < middleY ? 0 : 2;
+        sums[square] += SumColorChannels(row + static_cast<size_t>(m_bounds.left) * BytesPerPixel, leftWidth);
+        sums[square + 1] += SumColorChannels(row + static_cast<size_t>(middleX) * BytesPerPixel, rightWidth);
+    }
+
+    auto topHeight = static_cast<uint64_t>(middleY - m_bounds.top);
+    auto bottomHeight = static_cast<uint64_t>(m_bounds.bottom - middleY);
+    uint64_t const counts[4] = { topHeight * leftWidth, topHeight * rightWidth, bottomHeight * leftWidth, bottomHeight * rightWidth };
+    auto isLight = [&](size_t square)
+    {
+        return sums[square] > counts[square] * 3 * LightThreshold;
+    };
+    auto isDark = [&](size_t square)
+    {
+        return sums[square] < counts[square] * 3 * DarkThreshold;
+    };
+
+    if (isLight(0) && isLight(3) && isDark(1) && isDark(2))
+    {
+        return MarkerPhase::Light;
+    }
+    if (isDark(0) && isDark(3) && isLight(1) && isLight(2))
+    {
+        return MarkerPhase::Dark;
+    }
+    return MarkerPhase::None;
+}
\ No newline at end of file
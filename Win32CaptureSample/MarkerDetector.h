@@ -0,0 +1,40 @@
+#pragma once
+
+enum class MarkerPhase
+{
+    None,
+    Light,
+    Dark,
+};
+
+// Finds the marker that LatencyMarkerWindow flashes: a 2x2 checkerboard whose
+// top-left and bottom-right squares are light in one phase and dark in the
+// other, with the other two squares the opposite.
+//
+// Only the pixels inside of the bounds are looked at. The color channels of
+// each square are added up with SSE2 on x64 (a sum of absolute differences
+// against zero adds up 8 bytes at a time), with a plain loop everywhere else.
+// A square is light if it averages above LightThreshold and dark below
+// DarkThreshold. Anything in between, like a window in front of the marker,
+// means there's no marker.
+//
+// Not thread safe.
+class MarkerDetector
+{
+public:
+    static uint8_t const LightThreshold = 160;
+    static uint8_t const DarkThreshold = 96;
+
+    // In pixels of the captured content, at least 2x2
+    MarkerDetector(RECT const& bounds);
+    ~MarkerDetector() {}
+
+    RECT Bounds() const { return m_bounds; }
+
+    // Pixels are 32bpp BGRA and point at the top-left corner of the frame.
+    // Returns None if the bounds aren't inside of the frame.
+    MarkerPhase Detect(uint8_t const* pixels, uint32_t stride, uint32_t width, uint32_t height) const;
+
+private:
+    RECT m_bounds = {};
+};
\ No newline at end of file
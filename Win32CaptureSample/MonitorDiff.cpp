@@ -0,0 +1,49 @@
+#include "pch.h"
+#include "MonitorDiff.h"
+
+std::vector<MonitorChange> DiffMonitors(std::vector<MonitorSnapshot> const& oldMonitors, std::vector<MonitorSnapshot> const& newMonitors)
+{
+    std::unordered_map<std::wstring, MonitorSnapshot const*> newMonitorsByName;
+    for (auto& monitor : newMonitors)
+    {
+        newMonitorsByName.insert({ monitor.DisplayName, &monitor });
+    }
+
+    std::vector<MonitorChange> removals;
+    std::vector<MonitorChange> modifications;
+    std::unordered_set<std::wstring> oldNames;
+    for (auto& oldMonitor : oldMonitors)
+    {
+        oldNames.insert(oldMonitor.DisplayName);
+        auto search = newMonitorsByName.find(oldMonitor.DisplayName);
+        if (search == newMonitorsByName.end())
+        {
+            removals.push_back({ MonitorChangeKind::Removed, oldMonitor.DisplayName });
+            continue;
+        }
+
+        auto& newMonitor = *search->second;
+        MonitorChange change = { MonitorChangeKind::Modified, oldMonitor.DisplayName };
+        change.HandleChanged = oldMonitor.Handle != newMonitor.Handle;
+        change.PositionChanged = oldMonitor.Bounds.Left != newMonitor.Bounds.Left || oldMonitor.Bounds.Top != newMonitor.Bounds.Top;
+        change.ResolutionChanged =
+            (oldMonitor.Bounds.Right - oldMonitor.Bounds.Left) != (newMonitor.Bounds.Right - newMonitor.Bounds.Left) ||
+            (oldMonitor.Bounds.Bottom - oldMonitor.Bounds.Top) != (newMonitor.Bounds.Bottom - newMonitor.Bounds.Top);
+        change.DpiChanged = oldMonitor.Dpi != newMonitor.Dpi;
+        if (change.HandleChanged || change.PositionChanged || change.ResolutionChanged || change.DpiChanged)
+        {
+            modifications.push_back(change);
+        }
+    }
+
+    auto changes = std::move(removals);
+    changes.insert(changes.end(), modifications.begin(), modifications.end());
+    for (auto& newMonitor : newMonitors)
+    {
+        if (oldNames.find(newMonitor.DisplayName) == oldNames.end())
+        {
+            changes.push_back({ MonitorChangeKind::Added, newMonitor.DisplayName });
+        }
+    }
+    return changes;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "PortableTypes.h"
+
+// What the diff compares about a monitor. MonitorList makes these from its
+// MonitorInfos so that the diff doesn't need any Win32 types.
+struct MonitorSnapshot
+{
+    std::wstring DisplayName;
+    // The HMONITOR, only ever compared
+    uintptr_t Handle = 0;
+    PixelRect Bounds;
+    uint32_t Dpi = 0;
+};
+
+enum class MonitorChangeKind
+{
+    Added,
+    Removed,
+    Modified,
+};
+
+struct MonitorChange
+{
+    MonitorChangeKind Kind;
+    // Device names (e.g. \\.\DISPLAY1) survive topology changes, HMONITORs don't.
+    std::wstring DisplayName;
+    bool HandleChanged = false;
+    bool PositionChanged = false;
+    bool ResolutionChanged = false;
+    bool DpiChanged = false;
+};
+
+// Removals come first (in the old order), then modifications, then additions (in the new order).
+std::vector<MonitorChange> DiffMonitors(std::vector<MonitorSnapshot> const& oldMonitors, std::vector<MonitorSnapshot> const& newMonitors);
@@ -13,63 +13,80 @@ std::vector<MonitorInfo> EnumerateAllMonitors(bool includeAllMonitors)
     }, reinterpret_cast<LPARAM>(&monitors));
     if (monitors.size() > 1 && includeAllMonitors)
     {
-        monitors.push_back(MonitorInfo(nullptr, L"All Displays"));
+        RECT virtualScreen = {};
+        virtualScreen.left = GetSystemMetrics(SM_XVIRTUALSCREEN);
+        virtualScreen.top = GetSystemMetrics(SM_YVIRTUALSCREEN);
+        virtualScreen.right = virtualScreen.left + GetSystemMetrics(SM_CXVIRTUALSCREEN);
+        virtualScreen.bottom = virtualScreen.top + GetSystemMetrics(SM_CYVIRTUALSCREEN);
+        monitors.push_back(MonitorInfo(nullptr, L"All Displays", virtualScreen));
     }
     return monitors;
 }
 
+std::vector<MonitorSnapshot> ToSnapshots(std::vector<MonitorInfo> const& monitors)
+{
+    std::vector<MonitorSnapshot> snapshots;
+    snapshots.reserve(monitors.size());
+    for (auto&& monitor : monitors)
+    {
+        snapshots.push_back({
+            monitor.DisplayName,
+            reinterpret_cast<uintptr_t>(monitor.MonitorHandle),
+            { monitor.Bounds.left, monitor.Bounds.top, monitor.Bounds.right, monitor.Bounds.bottom },
+            monitor.Dpi });
+    }
+    return snapshots;
+}
+
 MonitorList::MonitorList(bool includeAllMonitors)
 {
     m_includeAllMonitors = includeAllMonitors;
     m_monitors = EnumerateAllMonitors(m_includeAllMonitors);
 }
 
-void MonitorList::Update()
+std::vector<MonitorChange> MonitorList::Update()
 {
     auto monitors = EnumerateAllMonitors(m_includeAllMonitors);
-    std::map<HMONITOR, MonitorInfo> newMonitors;
-    for (auto& monitor : monitors)
+    auto changes = DiffMonitors(ToSnapshots(m_monitors), ToSnapshots(monitors));
+
+    auto findMonitor = [&](std::vector<MonitorInfo>& list, std::wstring const& displayName)
     {
-        newMonitors.insert({ monitor.MonitorHandle, monitor });
-    }
+        return std::find_if(list.begin(), list.end(), [&](auto&& monitor) { return monitor.DisplayName == displayName; });
+    };
 
-    std::vector<int> monitorIndexesToRemove;
-    auto index = 0;
-    for (auto& monitor : m_monitors)
+    for (auto& change : changes)
     {
-        auto search = newMonitors.find(monitor.MonitorHandle);
-        if (search == newMonitors.end())
+        switch (change.Kind)
         {
-            monitorIndexesToRemove.push_back(index);
-        }
-        else
+        case MonitorChangeKind::Removed:
         {
-            newMonitors.erase(search);
+            auto monitor = findMonitor(m_monitors, change.DisplayName);
+            auto removalIndex = std::distance(m_monitors.begin(), monitor);
+            m_monitors.erase(monitor);
+            for (auto& comboBox : m_comboBoxes)
+            {
+                winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_DELETESTRING, removalIndex, 0)));
+            }
         }
-        index++;
-    }
-
-    // Remove old monitors
-    std::sort(monitorIndexesToRemove.begin(), monitorIndexesToRemove.end(), std::greater<int>());
-    for (auto& removalIndex : monitorIndexesToRemove)
-    {
-        m_monitors.erase(m_monitors.begin() + removalIndex);
-        for (auto& comboBox : m_comboBoxes)
+        break;
+        case MonitorChangeKind::Modified:
+            // The name doesn't change, so there's nothing to do for the combo boxes
+            *findMonitor(m_monitors, change.DisplayName) = *findMonitor(monitors, change.DisplayName);
+            break;
+        case MonitorChangeKind::Added:
         {
-            winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_DELETESTRING, removalIndex, 0)));
+            auto& monitor = *findMonitor(monitors, change.DisplayName);
+            m_monitors.push_back(monitor);
+            for (auto& comboBox : m_comboBoxes)
+            {
+                winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_ADDSTRING, 0, (LPARAM)monitor.DisplayName.c_str())));
+            }
         }
-    }
-
-    // Add new monitors
-    for (auto& pair : newMonitors)
-    {
-        auto monitor = pair.second;
-        m_monitors.push_back(monitor);
-        for (auto& comboBox : m_comboBoxes)
-        {
-            winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_ADDSTRING, 0, (LPARAM)monitor.DisplayName.c_str())));
+        break;
         }
     }
+
+    return changes;
 }
 
 void MonitorList::ForceUpdateComboBox(HWND comboBoxHandle)
@@ -1,4 +1,5 @@
 #pragma once
+#include "MonitorDiff.h"
 
 struct MonitorInfo
 {
@@ -9,15 +10,25 @@ struct MonitorInfo
         winrt::check_bool(GetMonitorInfo(MonitorHandle, &monitorInfo));
         std::wstring displayName(monitorInfo.szDevice);
         DisplayName = displayName;
+        Bounds = monitorInfo.rcMonitor;
+        UINT dpiX = 0;
+        UINT dpiY = 0;
+        if (SUCCEEDED(GetDpiForMonitor(MonitorHandle, MDT_EFFECTIVE_DPI, &dpiX, &dpiY)))
+        {
+            Dpi = dpiX;
+        }
     }
-    MonitorInfo(HMONITOR monitorHandle, std::wstring const& displayName)
+    MonitorInfo(HMONITOR monitorHandle, std::wstring const& displayName, RECT const& bounds)
     {
         MonitorHandle = monitorHandle;
         DisplayName = displayName;
+        Bounds = bounds;
     }
 
     HMONITOR MonitorHandle;
     std::wstring DisplayName;
+    RECT Bounds = {};
+    uint32_t Dpi = 0;
 
     bool operator==(const MonitorInfo& monitor) { return MonitorHandle == monitor.MonitorHandle; }
     bool operator!=(const MonitorInfo& monitor) { return !(*this == monitor); }
@@ -28,7 +39,8 @@ class MonitorList
 public:
     MonitorList(bool includeAllMonitors);
     
-    void Update();
+    // Returns what changed since the last update
+    std::vector<MonitorChange> Update();
     void RegisterComboBoxForUpdates(HWND comboBoxHandle) { m_comboBoxes.push_back(comboBoxHandle); ForceUpdateComboBox(comboBoxHandle); }
     void UnregisterComboBox(HWND comboBoxHandle) { m_comboBoxes.erase(std::remove(m_comboBoxes.begin(), m_comboBoxes.end(), comboBoxHandle), m_comboBoxes.end()); }
     const std::vector<MonitorInfo> GetCurrentMonitors() { return m_monitors; }
@@ -0,0 +1,75 @@
+#include "pch.h"
+#include "PaletteIndexer.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define PALETTE_INDEXER_SSE2
+#endif
+
+// How many colors from the start of the range are the same as this one
+size_t RunLength(uint32_t const* colors, size_t count, uint32_t color)
+{
+    // Short runs (e.g. text) are common enough to check for first
+    if (count == 0 || colors[0] != color)
+    {
+        return 0;
+    }
+    size_t length = 1;
+#ifdef PALETTE_INDEXER_SSE2
+    auto repeated = _mm_set1_epi32(static_cast<int>(color));
+    for (; length + 4 <= count; length += 4)
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(colors + length));
+        auto same = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi32(block, repeated)));
+        if (same != 0xFFFF)
+        {
+            // Four mask bits per color
+            return length + std::countr_one(same) / 4;
+        }
+    }
+#endif
+    while (length < count && colors[length] == color)
+    {
+        length++;
+    }
+    return length;
+}
+
+void PaletteIndexer::Reset()
+{
+    m_slots.fill(-1);
+    m_colors.clear();
+    m_colors.reserve(MaxColors);
+}
+
+bool PaletteIndexer::TryAddRange(uint32_t const* colors, size_t count)
+{
+    size_t i = 0;
+    while (i < count)
+    {
+        uint8_t index = 0;
+        if (!TryAdd(colors[i], index))
+        {
+            return false;
+        }
+        i += 1 + RunLength(colors + i + 1, count - i - 1, colors[i]);
+    }
+    return true;
+}
+
+bool PaletteIndexer::TryIndexRange(uint32_t const* colors, size_t count, uint8_t* indices)
+{
+    size_t i = 0;
+    while (i < count)
+    {
+        uint8_t index = 0;
+        if (!TryAdd(colors[i], index))
+        {
+            return false;
+        }
+        auto run = 1 + RunLength(colors + i + 1, count - i - 1, colors[i]);
+        memset(indices + i, index, run);
+        i += run;
+    }
+    return true;
+}
\ No newline at end of file
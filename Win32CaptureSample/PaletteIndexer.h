@@ -0,0 +1,73 @@
+#pragma once
+
+// Assigns palette indices to 32bpp colors, up to 256 of them. Used to find
+// out whether an image (or part of one) can be stored with a palette without
+// losing anything. Lookups go through a small open addressing table, and
+// repeats of the previous color skip the table entirely since screen content
+// is mostly runs of the same color. The range functions skip over those
+// runs four colors at a time with SSE2 (on x64).
+class PaletteIndexer
+{
+public:
+    static uint32_t const MaxColors = 256;
+
+    PaletteIndexer() { Reset(); }
+    ~PaletteIndexer() {}
+
+    void Reset();
+    std::vector<uint32_t> const& Colors() const { return m_colors; }
+
+    // Same as TryAdd for each color, without writing out the indices. Used
+    // to find out whether an image fits before paying for its indices.
+    bool TryAddRange(uint32_t const* colors, size_t count);
+    bool TryIndexRange(uint32_t const* colors, size_t count, uint8_t* indices);
+
+    // Returns false once there are more colors than fit in a palette
+    bool TryAdd(uint32_t color, uint8_t& index)
+    {
+        if (!m_colors.empty() && color == m_lastColor)
+        {
+            index = m_lastIndex;
+            return true;
+        }
+
+        auto slot = (color * 0x9E3779B1u) >> (32 - TableBits);
+        while (m_slots[slot] >= 0)
+        {
+            if (m_keys[slot] == color)
+            {
+                index = static_cast<uint8_t>(m_slots[slot]);
+                Remember(color, index);
+                return true;
+            }
+            slot = (slot + 1) % TableSize;
+        }
+        if (m_colors.size() == MaxColors)
+        {
+            return false;
+        }
+        index = static_cast<uint8_t>(m_colors.size());
+        m_keys[slot] = color;
+        m_slots[slot] = static_cast<int16_t>(index);
+        m_colors.push_back(color);
+        Remember(color, index);
+        return true;
+    }
+
+private:
+    static uint32_t const TableBits = 10;
+    static uint32_t const TableSize = 1 << TableBits;
+
+    void Remember(uint32_t color, uint8_t index)
+    {
+        m_lastColor = color;
+        m_lastIndex = index;
+    }
+
+private:
+    std::array<uint32_t, TableSize> m_keys;
+    std::array<int16_t, TableSize> m_slots;
+    std::vector<uint32_t> m_colors;
+    uint32_t m_lastColor = 0;
+    uint8_t m_lastIndex = 0;
+};
\ No newline at end of file
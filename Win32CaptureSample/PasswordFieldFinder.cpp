@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "PasswordFieldFinder.h"
+
+struct PasswordFieldSearch
+{
+    POINT Origin = {};
+    std::vector<RECT> Fields;
+};
+
+BOOL CALLBACK AddPasswordField(HWND child, LPARAM param)
+{
+    auto search = reinterpret_cast<PasswordFieldSearch*>(param);
+    if (!IsWindowVisible(child))
+    {
+        return TRUE;
+    }
+
+    // The style bit means something else for other controls. Common control
+    // and framework subclasses of edit controls keep "edit" in their names.
+    auto style = static_cast<uint32_t>(GetWindowLongW(child, GWL_STYLE));
+    if ((style & ES_PASSWORD) == 0)
+    {
+        return TRUE;
+    }
+    std::wstring className(256, 0);
+    className.resize(static_cast<size_t>(GetClassNameW(child, className.data(), static_cast<int>(className.size()))));
+    for (auto& character : className)
+    {
+        character = static_cast<wchar_t>(towlower(character));
+    }
+    if (className.find(L"edit") == std::wstring::npos)
+    {
+        return TRUE;
+    }
+
+    RECT rect = {};
+    if (GetWindowRect(child, &rect))
+    {
+        OffsetRect(&rect, -search->Origin.x, -search->Origin.y);
+        search->Fields.push_back(rect);
+    }
+    return TRUE;
+}
+
+std::vector<RECT> PasswordFieldFinder::Find(HWND window)
+{
+    if (!IsWindow(window) || IsIconic(window))
+    {
+        return {};
+    }
+
+    // We aren't DPI aware, but the capture is in physical pixels. Extended
+    // frame bounds always are.
+    auto previousContext = SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+    auto restoreContext = wil::scope_exit([previousContext]()
+    {
+        SetThreadDpiAwarenessContext(previousContext);
+    });
+
+    RECT frameBounds = {};
+    if (FAILED(DwmGetWindowAttribute(window, DWMWA_EXTENDED_FRAME_BOUNDS, &frameBounds, sizeof(frameBounds))))
+    {
+        return {};
+    }
+
+    PasswordFieldSearch search;
+    search.Origin = { frameBounds.left, frameBounds.top };
+    EnumChildWindows(window, AddPasswordField, reinterpret_cast<LPARAM>(&search));
+    return search.Fields;
+}
\ No newline at end of file
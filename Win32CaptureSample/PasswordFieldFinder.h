@@ -0,0 +1,16 @@
+#pragma once
+
+// Finds the password boxes in a window so that they can be redacted. Only
+// sees standard edit controls (including common control subclasses of them),
+// anything that draws its own text fields (e.g. browsers, XAML) has nowhere
+// for us to look.
+class PasswordFieldFinder
+{
+public:
+    // In pixels of the window's capture, which starts at its extended frame
+    // bounds. Only visible fields are returned.
+    static std::vector<RECT> Find(HWND window);
+
+private:
+    PasswordFieldFinder() = delete;
+};
\ No newline at end of file
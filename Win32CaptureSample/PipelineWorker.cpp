@@ -0,0 +1,89 @@
+#include "pch.h"
+#include "PipelineWorker.h"
+
+PipelineWorker::PipelineWorker(uint32_t capacity)
+{
+    if (capacity == 0)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"A worker needs to queue at least one piece of work.");
+    }
+    m_capacity = capacity;
+    m_thread = std::thread([this]() { Run(); });
+}
+
+bool PipelineWorker::CanSubmit()
+{
+    auto lock = std::scoped_lock(m_lock);
+    return !m_closed && m_queue.size() < m_capacity;
+}
+
+bool PipelineWorker::TrySubmit(std::function<void()> work)
+{
+    {
+        auto lock = std::scoped_lock(m_lock);
+        if (m_closed || m_queue.size() >= m_capacity)
+        {
+            return false;
+        }
+        m_queue.push_back(std::move(work));
+    }
+    m_changed.notify_all();
+    return true;
+}
+
+void PipelineWorker::Drain()
+{
+    auto lock = std::unique_lock(m_lock);
+    m_changed.wait(lock, [&]() { return m_queue.empty() && !m_running; });
+}
+
+void PipelineWorker::Close()
+{
+    // Whatever was queued lets go of its frames outside of the lock
+    std::deque<std::function<void()>> dropped;
+    {
+        auto lock = std::scoped_lock(m_lock);
+        m_closed = true;
+        dropped.swap(m_queue);
+    }
+    m_changed.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void PipelineWorker::Run()
+{
+    while (true)
+    {
+        std::function<void()> work;
+        {
+            auto lock = std::unique_lock(m_lock);
+            m_changed.wait(lock, [&]() { return m_closed || !m_queue.empty(); });
+            if (m_closed)
+            {
+                return;
+            }
+            work = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_running = true;
+        }
+
+        try
+        {
+            work();
+        }
+        catch (...)
+        {
+        }
+        // Let go of what the work holds on to before anyone hears it's done
+        work = nullptr;
+
+        {
+            auto lock = std::scoped_lock(m_lock);
+            m_running = false;
+        }
+        m_changed.notify_all();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+// Runs work for one consumer of frames on its own thread, one piece at a
+// time and in the order it was submitted. At most capacity pieces wait
+// behind the one that's running, past that TrySubmit says no so that the
+// caller can skip a frame instead of piling up work. Work that throws is
+// dropped.
+//
+// Thread safe, but work must not call Drain or Close.
+class PipelineWorker
+{
+public:
+    PipelineWorker(uint32_t capacity);
+    ~PipelineWorker() { Close(); }
+
+    // Whether TrySubmit would take work right now. Only stays true until
+    // someone else submits.
+    bool CanSubmit();
+    bool TrySubmit(std::function<void()> work);
+
+    // Waits until nothing is queued or running
+    void Drain();
+    // Drops anything queued and waits for running work to finish. Nothing
+    // can be submitted afterwards.
+    void Close();
+
+private:
+    void Run();
+
+private:
+    uint32_t m_capacity = 0;
+    std::mutex m_lock;
+    // Signaled when work is submitted, finishes, or we're closing
+    std::condition_variable m_changed;
+    std::deque<std::function<void()>> m_queue;
+    bool m_running = false;
+    bool m_closed = false;
+    std::thread m_thread;
+};
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+// Plain types for the classes that don't depend on Windows, so that they
+// build anywhere. Convert from RECT, SizeInt32 and winrt::TimeSpan where
+// frames are handed to them.
+
+// 100ns units, the same as winrt::Windows::Foundation::TimeSpan and the
+// timestamps of captured frames
+using Ticks = std::chrono::duration<int64_t, std::ratio<1, 10'000'000>>;
+
+// In pixels, the right and bottom edges are exclusive
+struct PixelRect
+{
+    int32_t Left = 0;
+    int32_t Top = 0;
+    int32_t Right = 0;
+    int32_t Bottom = 0;
+};
+
+struct PixelSize
+{
+    int32_t Width = 0;
+    int32_t Height = 0;
+};
\ No newline at end of file
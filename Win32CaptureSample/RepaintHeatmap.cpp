@@ -0,0 +1,226 @@
+#include "pch.h"
+#include "RepaintHeatmap.h"
+
+// Past this the stored activity gets large enough to lose precision
+double const MinScale = 1e-12;
+double const TicksPerSecond = 10'000'000.0;
+
+RepaintHeatmap::RepaintHeatmap(RepaintHeatmapSettings const& settings)
+{
+    if (settings.CellSize == 0 || settings.HalfLife.count() <= 0)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"The heatmap needs a cell size and a half-life.");
+    }
+    m_settings = settings;
+    m_decayRate = std::log(2.0) / static_cast<double>(settings.HalfLife.count());
+}
+
+void RepaintHeatmap::Reset()
+{
+    m_width = 0;
+    m_height = 0;
+    m_columns = 0;
+    m_rows = 0;
+    m_activity.clear();
+    m_lastTouched.clear();
+    m_scale = 1.0;
+    m_frameStamp = 0;
+    m_frameCount = 0;
+    m_lastTimestamp = std::nullopt;
+}
+
+void RepaintHeatmap::Resize(uint32_t width, uint32_t height)
+{
+    auto cellSize = m_settings.CellSize;
+    m_width = width;
+    m_height = height;
+    m_columns = (width + cellSize - 1) / cellSize;
+    m_rows = (height + cellSize - 1) / cellSize;
+    auto cellCount = static_cast<size_t>(m_columns) * m_rows;
+    m_activity.assign(cellCount, 0.0f);
+    m_lastTouched.assign(cellCount, 0);
+    m_scale = 1.0;
+    m_frameStamp = 0;
+    m_frameCount = 0;
+}
+
+void RepaintHeatmap::Renormalize()
+{
+    auto scale = static_cast<float>(m_scale);
+    for (auto&& activity : m_activity)
+    {
+        activity *= scale;
+    }
+    m_scale = 1.0;
+}
+
+void RepaintHeatmap::AddFrame(
+    Ticks timestamp,
+    uint32_t width,
+    uint32_t height,
+    std::optional<std::vector<RECT>> const& dirtyRects)
+{
+    if (width != m_width || height != m_height)
+    {
+        Resize(width, height);
+    }
+    if (m_lastTimestamp.has_value() && timestamp > m_lastTimestamp.value())
+    {
+        auto elapsed = static_cast<double>((timestamp - m_lastTimestamp.value()).count());
+        m_scale *= std::exp(-m_decayRate * elapsed);
+        if (m_scale < MinScale)
+        {
+            Renormalize();
+        }
+    }
+    if (!m_lastTimestamp.has_value() || timestamp > m_lastTimestamp.value())
+    {
+        m_lastTimestamp = timestamp;
+    }
+    if (m_activity.empty())
+    {
+        return;
+    }
+
+    m_frameStamp++;
+    if (m_frameStamp == 0)
+    {
+        std::fill(m_lastTouched.begin(), m_lastTouched.end(), 0);
+        m_frameStamp = 1;
+    }
+    m_frameCount++;
+
+    auto amount = static_cast<float>(1.0 / m_scale);
+    if (dirtyRects.has_value())
+    {
+        for (auto&& rect : dirtyRects.value())
+        {
+            AddRect(rect, amount);
+        }
+    }
+    else
+    {
+        AddRect({ 0, 0, static_cast<LONG>(m_width), static_cast<LONG>(m_height) }, amount);
+    }
+}
+
+void RepaintHeatmap::AddRect(RECT const& rect, float amount)
+{
+    auto left = std::clamp<LONG>(rect.left, 0, static_cast<LONG>(m_width));
+    auto top = std::clamp<LONG>(rect.top, 0, static_cast<LONG>(m_height));
+    auto right = std::clamp<LONG>(rect.right, 0, static_cast<LONG>(m_width));
+    auto bottom = std::clamp<LONG>(rect.bottom, 0, static_cast<LONG>(m_height));
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+    auto cellSize = m_settings.CellSize;
+    auto firstColumn = static_cast<uint32_t>(left) / cellSize;
+    auto lastColumn = (static_cast<uint32_t>(right) + cellSize - 1) / cellSize;
+    auto firstRow = static_cast<uint32_t>(top) / cellSize;
+    auto lastRow = (static_cast<uint32_t>(bottom) + cellSize - 1) / cellSize;
+
+    auto stamp = m_frameStamp;
+    for (auto row = firstRow; row < lastRow; row++)
+    {
+        auto activity = m_activity.data() + static_cast<size_t>(row) * m_columns;
+        auto lastTouched = m_lastTouched.data() + static_cast<size_t>(row) * m_columns;
+        // Branchless so that it vectorizes
+        for (auto column = firstColumn; column < lastColumn; column++)
+        {
+            activity[column] += lastTouched[column] != stamp ? amount : 0.0f;
+            lastTouched[column] = stamp;
+        }
+    }
+}
+
+void RepaintHeatmap::Rates(std::vector<float>& rates) const
+{
+    // An activity of one means a repaint every mean lifetime
+    auto factor = static_cast<float>(m_scale * m_decayRate * TicksPerSecond);
+    rates.resize(m_activity.size());
+    std::transform(m_activity.begin(), m_activity.end(), rates.begin(), [factor](auto activity)
+    {
+        return activity * factor;
+    });
+}
+
+std::vector<RepaintHotspot> RepaintHeatmap::Hotspots(float minRate, size_t maxCount) const
+{
+    std::vector<float> rates;
+    Rates(rates);
+
+    auto cellSize = m_settings.CellSize;
+    std::vector<uint8_t> visited(rates.size(), 0);
+    std::vector<uint32_t> pending;
+    std::vector<RepaintHotspot> hotspots;
+    for (uint32_t start = 0; start < rates.size(); start++)
+    {
+        if (visited[start] || rates[start] < minRate)
+        {
+            continue;
+        }
+
+        // Flood fill the neighbouring cells that are hot too
+        auto minColumn = m_columns;
+        auto minRow = m_rows;
+        uint32_t maxColumn = 0;
+        uint32_t maxRow = 0;
+        RepaintHotspot hotspot;
+        double rateSum = 0.0;
+        visited[start] = 1;
+        pending.push_back(start);
+        while (!pending.empty())
+        {
+            auto index = pending.back();
+            pending.pop_back();
+            auto column = index % m_columns;
+            auto row = index / m_columns;
+            auto rate = rates[index];
+            auto cellWidth = std::min(cellSize, m_width - column * cellSize);
+            auto cellHeight = std::min(cellSize, m_height - row * cellSize);
+
+            minColumn = std::min(minColumn, column);
+            minRow = std::min(minRow, row);
+            maxColumn = std::max(maxColumn, column);
+            maxRow = std::max(maxRow, row);
+            hotspot.Cells++;
+            hotspot.PeakRate = std::max(hotspot.PeakRate, rate);
+            hotspot.PixelsPerSecond += static_cast<double>(rate) * cellWidth * cellHeight;
+            rateSum += rate;
+
+            auto visit = [&](uint32_t neighbour)
+            {
+                if (!visited[neighbour] && rates[neighbour] >= minRate)
+                {
+                    visited[neighbour] = 1;
+                    pending.push_back(neighbour);
+                }
+            };
+            if (column > 0) { visit(index - 1); }
+            if (column + 1 < m_columns) { visit(index + 1); }
+            if (row > 0) { visit(index - m_columns); }
+            if (row + 1 < m_rows) { visit(index + m_columns); }
+        }
+
+        hotspot.MeanRate = static_cast<float>(rateSum / hotspot.Cells);
+        hotspot.Bounds =
+        {
+            static_cast<LONG>(minColumn * cellSize),
+            static_cast<LONG>(minRow * cellSize),
+            static_cast<LONG>(std::min((maxColumn + 1) * cellSize, m_width)),
+            static_cast<LONG>(std::min((maxRow + 1) * cellSize, m_height)),
+        };
+        hotspots.push_back(hotspot);
+    }
+
+    std::sort(hotspots.begin(), hotspots.end(), [](auto&& left, auto&& right)
+    {
+        return left.PixelsPerSecond > right.PixelsPerSecond;
+    });
+    if (hotspots.size() > maxCount)
+    {
+        hotspots.resize(maxCount);
+    }
+    return hotspots;
+}
\ No newline at end of file
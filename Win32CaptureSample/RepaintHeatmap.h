@@ -0,0 +1,85 @@
+#pragma once
+#include "PortableTypes.h"
+
+struct RepaintHeatmapSettings
+{
+    // Size of a grid cell in pixels
+    uint32_t CellSize = 16;
+    // How long it takes for a repaint to count half as much
+    Ticks HalfLife = std::chrono::seconds(2);
+};
+
+struct RepaintHotspot
+{
+    // In pixels, rounded out to whole cells
+    RECT Bounds = {};
+    uint32_t Cells = 0;
+    // Repaints per second of the busiest cell and of the average cell
+    float PeakRate = 0.0f;
+    float MeanRate = 0.0f;
+    // Repaint rate weighted by area, what the hotspots are ranked by
+    double PixelsPerSecond = 0.0;
+};
+
+// Keeps track of how often each part of the capture gets repainted.
+//
+// The capture is split into a grid of cells and every cell touched by a dirty
+// rect gets a repaint added to it, at most once per frame. Old repaints decay
+// exponentially, so a cell's activity divided by the mean lifetime of a repaint
+// is its recent repaint rate. Rather than decaying every cell on every frame,
+// the cells are stored divided by a common scale that does the decaying, and
+// only the touched cells are written. The cells are only renormalized once
+// the scale gets small, which is a single pass over a float array.
+//
+// Not thread safe.
+class RepaintHeatmap
+{
+public:
+    RepaintHeatmap(RepaintHeatmapSettings const& settings = {});
+    ~RepaintHeatmap() {}
+
+    // nullopt means we don't know what changed, so everything did. A new
+    // size starts over.
+    void AddFrame(
+        Ticks timestamp,
+        uint32_t width,
+        uint32_t height,
+        std::optional<std::vector<RECT>> const& dirtyRects);
+    void Reset();
+
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+    uint32_t Columns() const { return m_columns; }
+    uint32_t Rows() const { return m_rows; }
+    uint32_t CellSize() const { return m_settings.CellSize; }
+    uint64_t FrameCount() const { return m_frameCount; }
+
+    // Repaints per second of every cell, row by row
+    void Rates(std::vector<float>& rates) const;
+    // Groups of neighbouring cells repainted at least minRate times a second,
+    // busiest first.
+    std::vector<RepaintHotspot> Hotspots(float minRate = 1.0f, size_t maxCount = 16) const;
+
+private:
+    void Resize(uint32_t width, uint32_t height);
+    void AddRect(RECT const& rect, float amount);
+    void Renormalize();
+
+private:
+    RepaintHeatmapSettings m_settings;
+    // Decay per 100ns tick
+    double m_decayRate = 0.0;
+
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint32_t m_columns = 0;
+    uint32_t m_rows = 0;
+    // A cell's activity is m_activity[i] * m_scale
+    std::vector<float> m_activity;
+    double m_scale = 1.0;
+    // The last frame that touched each cell, so overlapping rects count once
+    std::vector<uint32_t> m_lastTouched;
+    uint32_t m_frameStamp = 0;
+    uint64_t m_frameCount = 0;
+    std::optional<Ticks> m_lastTimestamp;
+};
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include "pch.h"
+#include "ReplayBuffer.h"
+#include "ScreenTileCodec.h"
+
+uint32_t const TileSize = ScreenTileCodec::TileSize;
+// Timestamp, keyframe flag, width, height and data size
+size_t const SerializedFrameHeaderSize = sizeof(int64_t) + 1 + 3 * sizeof(uint32_t);
+
+void inline AppendUInt32(std::vector<uint8_t>& output, uint32_t value)
+{
+    auto offset = output.size();
+    output.resize(offset + sizeof(value));
+    memcpy(output.data() + offset, &value, sizeof(value));
+}
+
+uint32_t inline ReadUInt32(uint8_t const* data)
+{
+    uint32_t value = 0;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+void AppendFrame(
+    std::vector<uint8_t>& output,
+    Ticks timestamp,
+    bool isKeyframe,
+    uint32_t width,
+    uint32_t height,
+    std::span<uint8_t const> data)
+{
+    int64_t ticks = timestamp.count();
+    auto offset = output.size();
+    output.resize(offset + sizeof(ticks));
+    memcpy(output.data() + offset, &ticks, sizeof(ticks));
+    output.push_back(isKeyframe ? 1 : 0);
+    AppendUInt32(output, width);
+    AppendUInt32(output, height);
+    AppendUInt32(output, static_cast<uint32_t>(data.size()));
+    output.insert(output.end(), data.begin(), data.end());
+}
+
+// Combines deltas that apply one after the other into a single delta
+std::vector<uint8_t> MergeDeltas(std::span<std::shared_ptr<ReplayFrame const> const> deltas)
+{
+    // Later tiles replace earlier ones
+    std::map<uint32_t, std::span<uint8_t const>> tiles;
+    for (auto&& delta : deltas)
+    {
+        auto data = delta->Data.data();
+        auto tileCount = ReadUInt32(data);
+        size_t offset = sizeof(uint32_t);
+        for (uint32_t i = 0; i < tileCount; i++)
+        {
+            auto tile = ReadUInt32(data + offset);
+            auto size = ReadUInt32(data + offset + sizeof(uint32_t));
+            offset += 2 * sizeof(uint32_t);
+            tiles[tile] = std::span(data + offset, size);
+            offset += size;
+        }
+    }
+
+    std::vector<uint8_t> result;
+    AppendUInt32(result, static_cast<uint32_t>(tiles.size()));
+    for (auto&& [tile, image] : tiles)
+    {
+        AppendUInt32(result, tile);
+        AppendUInt32(result, static_cast<uint32_t>(image.size()));
+        result.insert(result.end(), image.begin(), image.end());
+    }
+    return result;
+}
+
+ReplayBuffer::ReplayBuffer(Ticks maxDuration, size_t maxBytes, Ticks keyframeInterval)
+{
+    m_maxDuration = maxDuration;
+    m_maxBytes = maxBytes;
+    m_keyframeInterval = keyframeInterval;
+}
+
+void ReplayBuffer::AddFrame(
+    Ticks timestamp,
+    uint8_t const* pixels,
+    uint32_t width,
+    uint32_t height,
+    std::optional<std::vector<PixelRect>> const& dirtyRects)
+{
+    // Start a new segment on a schedule, or when the old frames can't be used as a
+    // reference. Segments are also kept small compared to the budget, otherwise
+    // the one being written to could push us well past it.
+    auto needsKeyframe = m_previousFrame.empty() || width != m_previousWidth || height != m_previousHeight ||
+        timestamp - m_lastKeyframeTime >= m_keyframeInterval;
+    {
+        auto lock = std::scoped_lock(m_lock);
+        needsKeyframe = needsKeyframe || m_segments.empty() || m_segments.back().Bytes >= m_maxBytes / 4;
+    }
+
+    std::shared_ptr<ReplayFrame> frame;
+    if (needsKeyframe)
+    {
+        frame = EncodeKeyframe(pixels, width, height);
+        m_lastKeyframeTime = timestamp;
+    }
+    else
+    {
+        frame = EncodeDelta(pixels, width, height, dirtyRects);
+    }
+    frame->Timestamp = timestamp;
+    auto frameBytes = sizeof(ReplayFrame) + frame->Data.size();
+
+    auto lock = std::scoped_lock(m_lock);
+    if (frame->IsKeyframe)
+    {
+        m_segments.emplace_back();
+    }
+    auto& segment = m_segments.back();
+    segment.Frames.push_back(std::move(frame));
+    segment.Bytes += frameBytes;
+    m_bytes += frameBytes;
+    EvictLocked(timestamp);
+}
+
+std::shared_ptr<ReplayFrame> ReplayBuffer::EncodeKeyframe(uint8_t const* pixels, uint32_t width, uint32_t height)
+{
+    auto frame = std::make_shared<ReplayFrame>();
+    frame->Width = width;
+    frame->Height = height;
+    frame->IsKeyframe = true;
+    frame->Data = ScreenTileCodec::Encode(pixels, width, height, width * 4);
+
+    m_previousFrame.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    m_previousWidth = width;
+    m_previousHeight = height;
+    return frame;
+}
+
+std::shared_ptr<ReplayFrame> ReplayBuffer::EncodeDelta(uint8_t const* pixels, uint32_t width, uint32_t height, std::optional<std::vector<PixelRect>> const& dirtyRects)
+{
+    auto tilesX = (width + TileSize - 1) / TileSize;
+    auto tilesY = (height + TileSize - 1) / TileSize;
+    auto stride = static_cast<size_t>(width) * 4;
+
+    // Figure out which tiles could have changed
+    m_tileMask.assign(static_cast<size_t>(tilesX) * tilesY, dirtyRects.has_value() ? 0 : 1);
+    if (dirtyRects.has_value())
+    {
+        for (auto&& rect : dirtyRects.value())
+        {
+            auto left = static_cast<uint32_t>(std::clamp<int32_t>(rect.Left, 0, static_cast<int32_t>(width))) / TileSize;
+            auto top = static_cast<uint32_t>(std::clamp<int32_t>(rect.Top, 0, static_cast<int32_t>(height))) / TileSize;
+            auto right = (static_cast<uint32_t>(std::clamp<int32_t>(rect.Right, 0, static_cast<int32_t>(width))) + TileSize - 1) / TileSize;
+            auto bottom = (static_cast<uint32_t>(std::clamp<int32_t>(rect.Bottom, 0, static_cast<int32_t>(height))) + TileSize - 1) / TileSize;
+            for (auto y = top; y < bottom; y++)
+            {
+                std::fill(m_tileMask.begin() + y * tilesX + left, m_tileMask.begin() + y * tilesX + right, 1);
+            }
+        }
+    }
+
+    auto frame = std::make_shared<ReplayFrame>();
+    frame->Width = width;
+    frame->Height = height;
+    frame->IsKeyframe = false;
+    AppendUInt32(frame->Data, 0);
+    uint32_t tileCount = 0;
+    for (uint32_t tile = 0; tile < m_tileMask.size(); tile++)
+    {
+        if (!m_tileMask[tile])
+        {
+            continue;
+        }
+
+        auto left = (tile % tilesX) * TileSize;
+        auto top = (tile / tilesX) * TileSize;
+        auto tileWidth = std::min(TileSize, width - left);
+        auto tileHeight = std::min(TileSize, height - top);
+        auto offset = top * stride + static_cast<size_t>(left) * 4;
+        auto changed = false;
+        for (uint32_t y = 0; y < tileHeight && !changed; y++)
+        {
+            changed = memcmp(pixels + offset + y * stride, m_previousFrame.data() + offset + y * stride, static_cast<size_t>(tileWidth) * 4) != 0;
+        }
+        if (!changed)
+        {
+            continue;
+        }
+
+        auto encoded = ScreenTileCodec::Encode(pixels + offset, tileWidth, tileHeight, static_cast<uint32_t>(stride));
+        AppendUInt32(frame->Data, tile);
+        AppendUInt32(frame->Data, static_cast<uint32_t>(encoded.size()));
+        frame->Data.insert(frame->Data.end(), encoded.begin(), encoded.end());
+        tileCount++;
+
+        for (uint32_t y = 0; y < tileHeight; y++)
+        {
+            memcpy(m_previousFrame.data() + offset + y * stride, pixels + offset + y * stride, static_cast<size_t>(tileWidth) * 4);
+        }
+    }
+    memcpy(frame->Data.data(), &tileCount, sizeof(tileCount));
+    return frame;
+}
+
+void ReplayBuffer::EvictLocked(Ticks now)
+{
+    // The newest segment is the one being written to, so it always stays
+    while (m_segments.size() > 1)
+    {
+        auto overBudget = m_bytes > m_maxBytes;
+        // Dropping the oldest segment is fine as long as the rest still covers maxDuration
+        auto nextStart = m_segments[1].Frames.front()->Timestamp;
+        auto coveredWithout = now - nextStart >= m_maxDuration;
+        if (!overBudget && !coveredWithout)
+        {
+            break;
+        }
+        m_bytes -= m_segments.front().Bytes;
+        m_segments.pop_front();
+    }
+}
+
+std::vector<std::shared_ptr<ReplayFrame const>> ReplayBuffer::Frames() const
+{
+    auto lock = std::scoped_lock(m_lock);
+    std::vector<std::shared_ptr<ReplayFrame const>> frames;
+    for (auto&& segment : m_segments)
+    {
+        frames.insert(frames.end(), segment.Frames.begin(), segment.Frames.end());
+    }
+    return frames;
+}
+
+size_t ReplayBuffer::SizeInBytes() const
+{
+    auto lock = std::scoped_lock(m_lock);
+    return m_bytes;
+}
+
+void ReplayBuffer::Clear()
+{
+    auto lock = std::scoped_lock(m_lock);
+    m_segments.clear();
+    m_bytes = 0;
+}
+
+std::vector<uint8_t> ReplayBuffer::Serialize(std::vector<std::shared_ptr<ReplayFrame const>> const& frames)
+{
+    std::vector<uint8_t> result;
+    auto dataSize = std::accumulate(frames.begin(), frames.end(), size_t(0), [](size_t total, auto&& frame) { return total + SerializedFrameHeaderSize + frame->Data.size(); });
+    result.reserve(2 * sizeof(uint32_t) + dataSize);
+    result.insert(result.end(), { 'S', 'T', 'R', '1' });
+    AppendUInt32(result, static_cast<uint32_t>(frames.size()));
+    for (auto&& frame : frames)
+    {
+        AppendFrame(result, frame->Timestamp - frames.front()->Timestamp, frame->IsKeyframe, frame->Width, frame->Height, frame->Data);
+    }
+    return result;
+}
+
+std::vector<uint8_t> ReplayBuffer::SerializePaced(
+    std::vector<std::shared_ptr<ReplayFrame const>> const& frames,
+    FramePacerSettings const& settings)
+{
+    std::vector<uint8_t> result;
+    auto dataSize = std::accumulate(frames.begin(), frames.end(), size_t(0), [](size_t total, auto&& frame) { return total + SerializedFrameHeaderSize + frame->Data.size(); });
+    result.reserve(2 * sizeof(uint32_t) + dataSize);
+    result.insert(result.end(), { 'S', 'T', 'R', '1' });
+    // The frame count is filled in at the end
+    AppendUInt32(result, 0);
+    if (frames.empty())
+    {
+        return result;
+    }
+
+    FramePacer pacer(settings);
+    std::vector<PacedFrame> pacedFrames;
+    for (auto&& frame : frames)
+    {
+        auto decided = pacer.Push(frame->Timestamp);
+        pacedFrames.insert(pacedFrames.end(), decided.begin(), decided.end());
+    }
+    auto decided = pacer.Flush();
+    pacedFrames.insert(pacedFrames.end(), decided.begin(), decided.end());
+
+    // Frames that were captured but haven't been written yet
+    std::vector<std::shared_ptr<ReplayFrame const>> pending;
+    size_t nextFrame = 0;
+    uint32_t frameCount = 0;
+    auto width = frames.front()->Width;
+    auto height = frames.front()->Height;
+    auto writeFrame = [&](Ticks time)
+    {
+        // A keyframe makes everything before it irrelevant. The deltas after
+        // it can't be merged into it, so they wait for the next frame.
+        auto keyframe = std::find_if(pending.rbegin(), pending.rend(), [](auto&& frame) { return frame->IsKeyframe; });
+        if (keyframe != pending.rend())
+        {
+            auto& frame = *keyframe;
+            width = frame->Width;
+            height = frame->Height;
+            AppendFrame(result, time, true, width, height, frame->Data);
+            pending.erase(pending.begin(), keyframe.base());
+        }
+        else if (pending.size() == 1)
+        {
+            AppendFrame(result, time, false, width, height, pending.front()->Data);
+            pending.clear();
+        }
+        else
+        {
+            // Also covers repeats, which end up as a delta with no tiles
+            AppendFrame(result, time, false, width, height, MergeDeltas(pending));
+            pending.clear();
+        }
+        frameCount++;
+    };
+
+    int64_t nextIndex = 0;
+    for (auto&& pacedFrame : pacedFrames)
+    {
+        for (; nextFrame <= pacedFrame.Source; nextFrame++)
+        {
+            pending.push_back(frames[nextFrame]);
+        }
+        writeFrame(pacedFrame.Time);
+        nextIndex = static_cast<int64_t>(pacedFrame.Index) + 1;
+    }
+    // The newest frames may have lost out to an older one, and deltas can be
+    // stuck behind a keyframe. Show them late rather than not at all.
+    pending.insert(pending.end(), frames.begin() + nextFrame, frames.end());
+    while (!pending.empty())
+    {
+        writeFrame(pacer.OutputTime(nextIndex++));
+    }
+
+    memcpy(result.data() + 4, &frameCount, sizeof(frameCount));
+    return result;
+}
\ No newline at end of file
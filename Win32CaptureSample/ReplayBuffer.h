@@ -0,0 +1,89 @@
+#pragma once
+#include "PortableTypes.h"
+#include "FramePacer.h"
+
+struct ReplayFrame
+{
+    Ticks Timestamp = {};
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    bool IsKeyframe = false;
+    // Keyframes are a ScreenTileCodec image. Delta frames are a list of the
+    // tiles that changed since the previous frame, each one its own image.
+    std::vector<uint8_t> Data;
+};
+
+// Keeps the last few seconds of a capture in memory so that it can be saved
+// after something interesting already happened.
+//
+// Frames are grouped into segments that start with a keyframe, and the rest
+// of the segment only stores the tiles that changed. Whole segments are
+// dropped from the front once the buffer covers more than maxDuration or
+// uses more than maxBytes, so what's left always starts with a keyframe. The
+// segment currently being written to is never dropped, so the buffer can go
+// over maxBytes by up to a quarter of it (or one keyframe, if that's bigger).
+class ReplayBuffer
+{
+public:
+    ReplayBuffer(
+        Ticks maxDuration = std::chrono::seconds(30),
+        size_t maxBytes = 512 * 1024 * 1024,
+        Ticks keyframeInterval = std::chrono::seconds(2));
+    ~ReplayBuffer() {}
+
+    // Pixels are tightly packed 32bpp BGRA. If we know which parts of the frame
+    // changed, only tiles touching those rects are compared. Only call this
+    // from one thread at a time.
+    void AddFrame(
+        Ticks timestamp,
+        uint8_t const* pixels,
+        uint32_t width,
+        uint32_t height,
+        std::optional<std::vector<PixelRect>> const& dirtyRects);
+
+    // These are safe to call while frames are being added
+    std::vector<std::shared_ptr<ReplayFrame const>> Frames() const;
+    size_t SizeInBytes() const;
+    void Clear();
+
+    // Layout (little-endian):
+    //   "STR1", frame count (uint32)
+    //   frames: timestamp relative to the first frame in 100ns units (int64),
+    //           keyframe (uint8), width, height, data size (uint32 each), data
+    // Delta data is a tile count (uint32) and then for each tile its index,
+    // its size (uint32 each) and the tile image.
+    static std::vector<uint8_t> Serialize(std::vector<std::shared_ptr<ReplayFrame const>> const& frames);
+    // Same as above, but the frames are resampled to a constant frame rate
+    // first. Repeated frames are written as deltas without any tiles, and
+    // the tiles of dropped deltas are merged into the next frame written.
+    static std::vector<uint8_t> SerializePaced(
+        std::vector<std::shared_ptr<ReplayFrame const>> const& frames,
+        FramePacerSettings const& settings);
+
+private:
+    struct Segment
+    {
+        std::vector<std::shared_ptr<ReplayFrame const>> Frames;
+        size_t Bytes = 0;
+    };
+
+    std::shared_ptr<ReplayFrame> EncodeKeyframe(uint8_t const* pixels, uint32_t width, uint32_t height);
+    std::shared_ptr<ReplayFrame> EncodeDelta(uint8_t const* pixels, uint32_t width, uint32_t height, std::optional<std::vector<PixelRect>> const& dirtyRects);
+    void EvictLocked(Ticks now);
+
+private:
+    Ticks m_maxDuration = {};
+    size_t m_maxBytes = 0;
+    Ticks m_keyframeInterval = {};
+
+    mutable std::mutex m_lock;
+    std::deque<Segment> m_segments;
+    size_t m_bytes = 0;
+
+    // Only used by AddFrame
+    std::vector<uint8_t> m_previousFrame;
+    uint32_t m_previousWidth = 0;
+    uint32_t m_previousHeight = 0;
+    Ticks m_lastKeyframeTime = {};
+    std::vector<uint8_t> m_tileMask;
+};
\ No newline at end of file
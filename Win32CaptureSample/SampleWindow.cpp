@@ -3,6 +3,7 @@
 #include "SampleWindow.h"
 #include "WindowList.h"
 #include "MonitorList.h"
+#include "LatencyMarkerWindow.h"
 
 namespace winrt
 {
@@ -10,6 +11,7 @@ namespace winrt
     using namespace Windows::Foundation::Metadata;
     using namespace Windows::Graphics::Capture;
     using namespace Windows::Graphics::DirectX;
+    using namespace Windows::Storage;
     using namespace Windows::System;
     using namespace Windows::UI;
     using namespace Windows::UI::Composition;
@@ -69,7 +71,8 @@ SampleWindow::SampleWindow(int width, int height, std::shared_ptr<App> app)
     m_pixelFormats = 
     {
         { L"B8G8R8A8UIntNormalized", winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized },
-        { L"R16G16B16A16Float", winrt::DirectXPixelFormat::R16G16B16A16Float }
+        { L"R16G16B16A16Float", winrt::DirectXPixelFormat::R16G16B16A16Float },
+        { L"R10G10B10A2UIntNormalized (HDR10)", winrt::DirectXPixelFormat::R10G10B10A2UIntNormalized }
     };
     m_dirtyRegionModes =
     {
@@ -82,6 +85,14 @@ SampleWindow::SampleWindow(int width, int height, std::shared_ptr<App> app)
         { L"1s", std::chrono::seconds(1) },
         { L"5s", std::chrono::seconds(5) },
     };
+    m_framePoolBufferCounts =
+    {
+        { L"Auto", std::nullopt },
+        { L"1", 1 },
+        { L"2", 2 },
+        { L"3", 3 },
+        { L"4", 4 },
+    };
 
     CreateControls(instance);
 
@@ -109,10 +120,15 @@ LRESULT SampleWindow::MessageHandler(UINT const message, WPARAM const wparam, LP
                 auto index = SendMessageW(hwnd, CB_GETCURSEL, 0, 0);
                 if (hwnd == m_windowComboBox)
                 {
-                    auto window = m_windows->GetCurrentWindows()[index];
-                    auto item = m_app->TryStartCaptureFromWindowHandle(window.WindowHandle);
+                    auto windowHandle = m_windows->GetDisplayedWindowHandle(index);
+                    if (windowHandle == nullptr)
+                    {
+                        break;
+                    }
+                    auto item = m_app->TryStartCaptureFromWindowHandle(windowHandle);
                     if (item != nullptr)
                     {
+                        m_currentWindow = windowHandle;
                         OnCaptureStarted(item, CaptureType::ProgrammaticWindow);
                     }
                     else
@@ -126,6 +142,7 @@ LRESULT SampleWindow::MessageHandler(UINT const message, WPARAM const wparam, LP
                     auto item = m_app->TryStartCaptureFromMonitorHandle(monitor.MonitorHandle);
                     if (item != nullptr)
                     {
+                        m_currentMonitor = monitor.MonitorHandle;
                         OnCaptureStarted(item, CaptureType::ProgrammaticMonitor);
                     }
                     else
@@ -148,6 +165,23 @@ LRESULT SampleWindow::MessageHandler(UINT const message, WPARAM const wparam, LP
                     auto interval = m_updateIntervals[index];
                     m_app->MinUpdateInterval(interval.Interval);
                 }
+                else if (hwnd == m_sectionComboBox)
+                {
+                    ShowSection(index);
+                }
+                else if (hwnd == m_framePoolBufferCountComboBox)
+                {
+                    auto bufferCount = m_framePoolBufferCounts[index];
+                    m_app->FramePoolBufferCount(bufferCount.BufferCount);
+                }
+            }
+            break;
+        case EN_CHANGE:
+            {
+                if (hwnd == m_windowSearchEdit)
+                {
+                    OnWindowSearchTextChanged();
+                }
             }
             break;
         case BN_CLICKED:
@@ -164,6 +198,10 @@ LRESULT SampleWindow::MessageHandler(UINT const message, WPARAM const wparam, LP
                 {
                     OnSnapshotButtonClicked();
                 }
+                else if (hwnd == m_compareToGoldenButton)
+                {
+                    OnCompareToGoldenButtonClicked();
+                }
                 else if (hwnd == m_cursorCheckBox)
                 {
                     auto value = SendMessageW(m_cursorCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED;
@@ -189,14 +227,72 @@ LRESULT SampleWindow::MessageHandler(UINT const message, WPARAM const wparam, LP
                     auto value = SendMessageW(m_visualizeDirtyRegionCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED;
                     m_app->VisualizeDirtyRegions(value);
                 }
+                else if (hwnd == m_detectScrollingCheckBox)
+                {
+                    auto value = SendMessageW(m_detectScrollingCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED;
+                    m_app->DetectScrolling(value);
+                }
+                else if (hwnd == m_repaintHeatmapCheckBox)
+                {
+                    auto value = SendMessageW(m_repaintHeatmapCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED;
+                    m_app->ShowRepaintHeatmap(value);
+                    EnableWindow(m_saveRepaintReportButton, value);
+                }
+                else if (hwnd == m_saveRepaintReportButton)
+                {
+                    OnSaveRepaintReportButtonClicked();
+                }
+                else if (hwnd == m_keepReplayCheckBox)
+                {
+                    auto value = SendMessageW(m_keepReplayCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED;
+                    m_app->KeepReplay(value);
+                    EnableWindow(m_saveReplayButton, value);
+                }
+                else if (hwnd == m_saveReplayButton)
+                {
+                    OnSaveReplayButtonClicked();
+                }
+                else if (hwnd == m_snapshotOnChangeCheckBox)
+                {
+                    OnSnapshotOnChangeCheckBoxClicked();
+                }
+                else if (hwnd == m_addToWindowSetButton)
+                {
+                    OnAddToWindowSetButtonClicked();
+                }
+                else if (hwnd == m_saveWindowSetButton)
+                {
+                    OnSaveWindowSetButtonClicked();
+                }
+                else if (hwnd == m_redactPasswordFieldsCheckBox)
+                {
+                    auto value = SendMessageW(m_redactPasswordFieldsCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED;
+                    m_app->RedactPasswordFields(value ? m_currentWindow : nullptr);
+                }
+                else if (hwnd == m_measureLatencyCheckBox)
+                {
+                    OnMeasureLatencyCheckBoxClicked();
+                }
             }
             break;
         }
     }
     break;
     case WM_DISPLAYCHANGE:
-        m_monitors->Update();
+        OnDisplaysChanged();
         break;
+    case WM_SETTINGCHANGE:
+        // DPI changes show up here instead of WM_DISPLAYCHANGE
+        OnDisplaysChanged();
+        return base_type::MessageHandler(message, wparam, lparam);
+    case WM_DESTROY:
+        // Anything still encoding won't finish before we exit. The encoder
+        // stays alive until they notice, and they come back to us while the
+        // dispatcher queue drains, which happens before we're destroyed.
+        m_closing = true;
+        m_app->StopSnapshotOnChange();
+        CancelPendingSnapshots();
+        return base_type::MessageHandler(message, wparam, lparam);
     case WM_CTLCOLORSTATIC:
         return util::StaticControlColorMessageHandler(wparam, lparam);
     default:
@@ -214,6 +310,7 @@ void SampleWindow::OnCaptureStarted(winrt::GraphicsCaptureItem const& item, Capt
     switch (captureType)
     {
     case CaptureType::ProgrammaticWindow:
+        m_currentMonitor = nullptr;
         SendMessageW(m_monitorComboBox, CB_SETCURSEL, -1, 0);
         if (m_isSecondaryWindowsFeaturePresent)
         {
@@ -221,6 +318,7 @@ void SampleWindow::OnCaptureStarted(winrt::GraphicsCaptureItem const& item, Capt
         }
         break;
     case CaptureType::ProgrammaticMonitor:
+        m_currentWindow = nullptr;
         SendMessageW(m_windowComboBox, CB_SETCURSEL, -1, 0);
         if (m_isSecondaryWindowsFeaturePresent)
         {
@@ -228,6 +326,8 @@ void SampleWindow::OnCaptureStarted(winrt::GraphicsCaptureItem const& item, Capt
         }
         break;
     case CaptureType::Picker:
+        m_currentWindow = nullptr;
+        m_currentMonitor = nullptr;
         SendMessageW(m_windowComboBox, CB_SETCURSEL, -1, 0);
         SendMessageW(m_monitorComboBox, CB_SETCURSEL, -1, 0);
         if (m_isSecondaryWindowsFeaturePresent)
@@ -247,10 +347,47 @@ void SampleWindow::OnCaptureStarted(winrt::GraphicsCaptureItem const& item, Capt
     SendMessageW(m_cursorCheckBox, BM_SETCHECK, BST_CHECKED, 0);
     SendMessageW(m_borderRequiredCheckBox, BM_SETCHECK, BST_CHECKED, 0);
     SendMessageW(m_visualizeDirtyRegionCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_detectScrollingCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_repaintHeatmapCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_keepReplayCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_snapshotOnChangeCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_redactPasswordFieldsCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_measureLatencyCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
     SendMessageW(m_dirtyRegionModeComboBox, CB_SETCURSEL, 0, 0);
     SendMessageW(m_minUpdateIntervalComboBox, CB_SETCURSEL, 0, 0);
+    SendMessageW(m_framePoolBufferCountComboBox, CB_SETCURSEL, 2, 0);
+    m_latencyMarker.reset();
     EnableWindow(m_stopButton, true);
     EnableWindow(m_snapshotButton, true);
+    EnableWindow(m_compareToGoldenButton, true);
+    EnableWindow(m_keepReplayCheckBox, true);
+    EnableWindow(m_saveReplayButton, false);
+    EnableWindow(m_saveRepaintReportButton, false);
+    EnableWindow(m_snapshotOnChangeCheckBox, true);
+    // We only know where to look for password fields if we picked the window
+    EnableWindow(m_redactPasswordFieldsCheckBox, m_currentWindow != nullptr);
+    // The marker goes in the corner of a monitor
+    EnableWindow(m_measureLatencyCheckBox, m_currentMonitor != nullptr);
+    UpdateWindowSetButtons();
+}
+
+void SampleWindow::OnMeasureLatencyCheckBoxClicked()
+{
+    auto value = SendMessageW(m_measureLatencyCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED;
+    if (value)
+    {
+        m_latencyMarker = std::make_unique<LatencyMarkerWindow>(m_currentMonitor, LatencyMeter::InitialPhase, [app = m_app](auto&& timestamp)
+        {
+            return app->OnLatencyInput(timestamp);
+        });
+        m_app->StartMeasuringLatency(m_latencyMarker->MarkerBounds());
+    }
+    else
+    {
+        // Take the marker down first, the report is modal
+        m_latencyMarker.reset();
+        m_app->StopMeasuringLatency();
+    }
 }
 
 winrt::fire_and_forget SampleWindow::OnPickerButtonClicked()
@@ -265,13 +402,218 @@ winrt::fire_and_forget SampleWindow::OnPickerButtonClicked()
 
 winrt::fire_and_forget SampleWindow::OnSnapshotButtonClicked()
 {
-    auto file = co_await m_app->TakeSnapshotAsync();
-    if (file != nullptr)
+    auto dispatcherQueue = winrt::DispatcherQueue::GetForCurrentThread();
+    auto operation = m_app->TakeSnapshotAsync();
+    m_pendingSnapshots.push_back({ operation, std::nullopt, false });
+    // Progress is reported from the thread pool
+    operation.Progress([this, dispatcherQueue](auto&& sender, double progress)
     {
+        dispatcherQueue.TryEnqueue([this, sender, progress]()
+        {
+            auto search = std::find_if(m_pendingSnapshots.begin(), m_pendingSnapshots.end(), [&](auto&& snapshot) { return snapshot.Operation == sender; });
+            if (search != m_pendingSnapshots.end())
+            {
+                search->Progress = progress;
+                UpdateSnapshotButtonText();
+            }
+        });
+    });
+
+    winrt::StorageFile file{ nullptr };
+    std::optional<winrt::hstring> errorMessage;
+    try
+    {
+        file = co_await operation;
+    }
+    catch (winrt::hresult_canceled const&)
+    {
+        // We're shutting down
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        errorMessage = error.message();
+    }
+    auto search = std::find_if(m_pendingSnapshots.begin(), m_pendingSnapshots.end(), [&](auto&& snapshot) { return snapshot.Operation == operation; });
+    m_pendingSnapshots.erase(search);
+    UpdateSnapshotButtonText();
+
+    if (errorMessage.has_value())
+    {
+        MessageBoxW(m_window,
+            errorMessage->c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+    }
+    else if (file != nullptr && file.FileType() != L".stc")
+    {
+        // Nothing else can open our own format
         co_await winrt::Launcher::LaunchFileAsync(file);
     }
 }
 
+winrt::fire_and_forget SampleWindow::OnCompareToGoldenButtonClicked()
+{
+    // Goldens can be anything the user picks, including files WIC can't
+    // decode
+    try
+    {
+        auto file = co_await m_app->CompareToGoldenAsync();
+        if (file != nullptr)
+        {
+            co_await winrt::Launcher::LaunchFileAsync(file);
+        }
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        MessageBoxW(m_window,
+            error.message().c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+    }
+}
+
+winrt::fire_and_forget SampleWindow::OnSaveReplayButtonClicked()
+{
+    // Nothing else can open these, so there's nothing to launch
+    try
+    {
+        co_await m_app->SaveReplayAsync();
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        MessageBoxW(m_window,
+            error.message().c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+    }
+}
+
+winrt::fire_and_forget SampleWindow::OnSaveRepaintReportButtonClicked()
+{
+    try
+    {
+        auto file = co_await m_app->SaveRepaintReportAsync();
+        if (file != nullptr)
+        {
+            co_await winrt::Launcher::LaunchFileAsync(file);
+        }
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        MessageBoxW(m_window,
+            error.message().c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+    }
+}
+
+void SampleWindow::OnAddToWindowSetButtonClicked()
+{
+    if (m_currentWindow != nullptr && std::find(m_windowSet.begin(), m_windowSet.end(), m_currentWindow) == m_windowSet.end())
+    {
+        m_windowSet.push_back(m_currentWindow);
+    }
+    UpdateWindowSetButtons();
+}
+
+winrt::fire_and_forget SampleWindow::OnSaveWindowSetButtonClicked()
+{
+    // Windows can go away while they wait in the set
+    m_windowSet.erase(std::remove_if(m_windowSet.begin(), m_windowSet.end(), [](auto&& window) { return !IsWindow(window); }), m_windowSet.end());
+    UpdateWindowSetButtons();
+    auto windows = m_windowSet;
+
+    // The set is only cleared once it's saved, so the user can try again
+    // after a failure. Windows added while we save stay in it.
+    try
+    {
+        auto folder = co_await m_app->SaveWindowSetAsync(windows);
+        if (folder != nullptr)
+        {
+            m_windowSet.erase(std::remove_if(m_windowSet.begin(), m_windowSet.end(), [&](auto&& window)
+            {
+                return std::find(windows.begin(), windows.end(), window) != windows.end();
+            }), m_windowSet.end());
+            UpdateWindowSetButtons();
+            co_await winrt::Launcher::LaunchFolderAsync(folder);
+        }
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        MessageBoxW(m_window,
+            error.message().c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+    }
+}
+
+void SampleWindow::UpdateWindowSetButtons()
+{
+    EnableWindow(m_addToWindowSetButton, m_currentWindow != nullptr);
+    EnableWindow(m_saveWindowSetButton, !m_windowSet.empty());
+    auto text = m_windowSet.empty() ? std::wstring(L"Save Window Set") : L"Save Window Set (" + std::to_wstring(m_windowSet.size()) + L")";
+    SetWindowTextW(m_saveWindowSetButton, text.c_str());
+}
+
+winrt::fire_and_forget SampleWindow::OnSnapshotOnChangeCheckBoxClicked()
+{
+    auto value = SendMessageW(m_snapshotOnChangeCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED;
+    if (!value)
+    {
+        m_app->StopSnapshotOnChange();
+        co_return;
+    }
+
+    // Stay unchecked if the user didn't pick a folder
+    auto started = co_await m_app->StartSnapshotOnChangeAsync([this](auto&& operation)
+    {
+        OnChangeSnapshotStarted(operation);
+    });
+    if (!started)
+    {
+        SendMessageW(m_snapshotOnChangeCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    }
+}
+
+winrt::fire_and_forget SampleWindow::OnChangeSnapshotStarted(winrt::IAsyncOperationWithProgress<winrt::StorageFile, double> operation)
+{
+    // Could have been queued up before we stopped it
+    if (m_closing)
+    {
+        operation.Cancel();
+        co_return;
+    }
+
+    m_pendingSnapshots.push_back({ operation, std::nullopt, true });
+    std::optional<winrt::hstring> errorMessage;
+    try
+    {
+        co_await operation;
+    }
+    catch (winrt::hresult_canceled const&)
+    {
+        // We're shutting down
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        errorMessage = error.message();
+    }
+    auto search = std::find_if(m_pendingSnapshots.begin(), m_pendingSnapshots.end(), [&](auto&& snapshot) { return snapshot.Operation == operation; });
+    m_pendingSnapshots.erase(search);
+
+    // Whatever went wrong will most likely go wrong for the next one too.
+    // Only the first failure gets reported.
+    if (errorMessage.has_value() && SendMessageW(m_snapshotOnChangeCheckBox, BM_GETCHECK, 0, 0) == BST_CHECKED)
+    {
+        m_app->StopSnapshotOnChange();
+        SendMessageW(m_snapshotOnChangeCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+        MessageBoxW(m_window,
+            (L"Failed to save a change snapshot, snapshot on change was stopped. " + *errorMessage).c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+    }
+}
+
 // Not DPI aware but could be by multiplying the constants based on the monitor scale factor
 void SampleWindow::CreateControls(HINSTANCE instance)
 {
@@ -305,6 +647,24 @@ void SampleWindow::CreateControls(HINSTANCE instance)
 
     auto windowLabel = controls.CreateControl(util::ControlType::Label, L"Windows:");
 
+    // Create window search box
+    // NOTE: The stack panel doesn't create edit controls, so we reserve a slot
+    //       with an empty label and put our edit control in its place.
+    {
+        auto placeholder = controls.CreateControl(util::ControlType::Label, L"");
+        RECT rect = {};
+        winrt::check_bool(GetWindowRect(placeholder, &rect));
+        MapWindowPoints(HWND_DESKTOP, m_window, reinterpret_cast<POINT*>(&rect), 2);
+        auto font = SendMessageW(placeholder, WM_GETFONT, 0, 0);
+        DestroyWindow(placeholder);
+
+        m_windowSearchEdit = winrt::check_pointer(CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", L"",
+            WS_TABSTOP | WS_CHILD | WS_VISIBLE | ES_AUTOHSCROLL | win32ProgrammaticStyle,
+            rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top, m_window, nullptr, instance, nullptr));
+        SendMessageW(m_windowSearchEdit, WM_SETFONT, font, TRUE);
+        SendMessageW(m_windowSearchEdit, EM_SETCUEBANNER, FALSE, (LPARAM)L"Search windows");
+    }
+
     // Create window combo box
     m_windowComboBox = controls.CreateControl(util::ControlType::ComboBox, L"", win32ProgrammaticStyle);
 
@@ -328,10 +688,27 @@ void SampleWindow::CreateControls(HINSTANCE instance)
     // Create independent snapshot button
     m_snapshotButton = controls.CreateControl(util::ControlType::Button, L"Take Snapshot", WS_DISABLED);
 
-    auto pixelFormatLabel = controls.CreateControl(util::ControlType::Label, L"Pixel Format:");
+    // The rest of the options are split into sections that take turns in
+    // the same spot, all of them in one column wouldn't fit on a 1080p
+    // display
+    m_sectionComboBox = controls.CreateControl(util::ControlType::ComboBox, L"");
+    for (auto&& name : { L"Capture options", L"Dirty regions", L"Tools" })
+    {
+        SendMessageW(m_sectionComboBox, CB_ADDSTRING, 0, (LPARAM)name);
+    }
+    SendMessageW(m_sectionComboBox, CB_SETCURSEL, 0, 0);
+    auto addToSection = [&](HWND control)
+    {
+        m_sections.back().push_back(control);
+        return control;
+    };
+
+    // Capture options
+    m_sections.emplace_back();
+    addToSection(controls.CreateControl(util::ControlType::Label, L"Pixel Format:"));
 
     // Create pixel format combo box
-    m_pixelFormatComboBox = controls.CreateControl(util::ControlType::ComboBox, L"");
+    m_pixelFormatComboBox = addToSection(controls.CreateControl(util::ControlType::ComboBox, L""));
 
     // Populate pixel format combo box
     for (auto& pixelFormat : m_pixelFormats)
@@ -343,7 +720,7 @@ void SampleWindow::CreateControls(HINSTANCE instance)
     SendMessageW(m_pixelFormatComboBox, CB_SETCURSEL, 0, 0);
   
     // Create cursor checkbox
-    m_cursorCheckBox = controls.CreateControl(util::ControlType::CheckBox, L"Enable Cursor", cursorEnableStyle);
+    m_cursorCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Enable Cursor", cursorEnableStyle));
 
     // The default state is true for cursor rendering
     SendMessageW(m_cursorCheckBox, BM_SETCHECK, BST_CHECKED, 0);
@@ -353,34 +730,60 @@ void SampleWindow::CreateControls(HINSTANCE instance)
     //       setting WDA_MONITOR on older builds of Windows. We're changing the label here to try and 
     //       limit any user confusion.
     std::wstring excludeCheckBoxLabel = isWin32CaptureExcludePresent ? L"Exclude this window" : L"Block this window";
-    m_captureExcludeCheckBox = controls.CreateControl(util::ControlType::CheckBox, excludeCheckBoxLabel.c_str());
+    m_captureExcludeCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, excludeCheckBoxLabel.c_str()));
 
     // The default state is false for capture exclusion
     SendMessageW(m_captureExcludeCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
 
     // Border required checkbox
-    m_borderRequiredCheckBox = controls.CreateControl(util::ControlType::CheckBox, L"Border required", borderEnableSytle);
+    m_borderRequiredCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Border required", borderEnableSytle));
 
     // The default state is true for border required checkbox
     SendMessageW(m_borderRequiredCheckBox, BM_SETCHECK, BST_CHECKED, 0);
 
     // Include secondary windows checkbox
     // NOTE: We always start disabled until a window capture is started
-    m_secondaryWindowsCheckBox = controls.CreateControl(util::ControlType::CheckBox, L"Include secondary windows", WS_DISABLED);
+    m_secondaryWindowsCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Include secondary windows", WS_DISABLED));
 
     // The default state is false for the secondary windows checkbox
     SendMessageW(m_secondaryWindowsCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
 
+    addToSection(controls.CreateControl(util::ControlType::Label, L"Frame pool buffers:"));
+
+    // Create the frame pool buffer count combo box
+    m_framePoolBufferCountComboBox = addToSection(controls.CreateControl(util::ControlType::ComboBox, L""));
+
+    // Populate the frame pool buffer count combo box
+    for (auto& data : m_framePoolBufferCounts)
+    {
+        SendMessageW(m_framePoolBufferCountComboBox, CB_ADDSTRING, 0, (LPARAM)data.Name.c_str());
+    }
+
+    // The default is 2 buffers (index 2)
+    SendMessageW(m_framePoolBufferCountComboBox, CB_SETCURSEL, 2, 0);
+
+    // Dirty regions
+    m_sections.emplace_back();
+
     // Border required checkbox
-    m_visualizeDirtyRegionCheckBox = controls.CreateControl(util::ControlType::CheckBox, L"Visualize dirty region", dirtyRegionStyle);
+    m_visualizeDirtyRegionCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Visualize dirty region", dirtyRegionStyle));
 
     // The default state is false for dirty region checkbox
     SendMessageW(m_visualizeDirtyRegionCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
 
-    auto dirtyRegionModeLabel = controls.CreateControl(util::ControlType::Label, L"Dirty region mode:");
+    // Scroll detection checkbox, shows up as part of the dirty region visualization
+    m_detectScrollingCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Detect scrolling", dirtyRegionStyle));
+    SendMessageW(m_detectScrollingCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+
+    // Repaint heatmap, also drawn over the preview
+    m_repaintHeatmapCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Repaint heatmap", dirtyRegionStyle));
+    SendMessageW(m_repaintHeatmapCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    m_saveRepaintReportButton = addToSection(controls.CreateControl(util::ControlType::Button, L"Save Repaint Report", WS_DISABLED));
+
+    addToSection(controls.CreateControl(util::ControlType::Label, L"Dirty region mode:"));
 
     // Create the dirty region mode combo box
-    m_dirtyRegionModeComboBox = controls.CreateControl(util::ControlType::ComboBox, L"", dirtyRegionStyle);
+    m_dirtyRegionModeComboBox = addToSection(controls.CreateControl(util::ControlType::ComboBox, L"", dirtyRegionStyle));
 
     // Populate the dirty region mode combo box
     for (auto& mode : m_dirtyRegionModes)
@@ -391,10 +794,10 @@ void SampleWindow::CreateControls(HINSTANCE instance)
     // The default dirty region mode is ReportOnly (index 0)
     SendMessageW(m_dirtyRegionModeComboBox, CB_SETCURSEL, 0, 0);
 
-    auto minUpdateIntervalLabel = controls.CreateControl(util::ControlType::Label, L"Min update interval:");
+    addToSection(controls.CreateControl(util::ControlType::Label, L"Min update interval:"));
 
     // Create the min update interval combo box
-    m_minUpdateIntervalComboBox = controls.CreateControl(util::ControlType::ComboBox, L"", minUpdateIntervalStyle);
+    m_minUpdateIntervalComboBox = addToSection(controls.CreateControl(util::ControlType::ComboBox, L"", minUpdateIntervalStyle));
 
     // Populate the min update interval mode combo box
     for (auto& data : m_updateIntervals)
@@ -404,6 +807,123 @@ void SampleWindow::CreateControls(HINSTANCE instance)
 
     // The default min update interval is None (index 0)
     SendMessageW(m_minUpdateIntervalComboBox, CB_SETCURSEL, 0, 0);
+
+    // Tools
+    m_sections.emplace_back();
+
+    // Compare the capture to a golden image
+    m_compareToGoldenButton = addToSection(controls.CreateControl(util::ControlType::Button, L"Compare To Golden", WS_DISABLED));
+
+    // Replay buffer, only useful while a capture is running
+    m_keepReplayCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Keep replay buffer", WS_DISABLED));
+    SendMessageW(m_keepReplayCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    m_saveReplayButton = addToSection(controls.CreateControl(util::ControlType::Button, L"Save Replay", WS_DISABLED));
+
+    // Saves a snapshot to a folder whenever the content changes enough
+    m_snapshotOnChangeCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Snapshot on change", WS_DISABLED));
+    SendMessageW(m_snapshotOnChangeCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+
+    // Snapshots a few windows picked from the list at the same moment
+    m_addToWindowSetButton = addToSection(controls.CreateControl(util::ControlType::Button, L"Add To Window Set", WS_DISABLED));
+    m_saveWindowSetButton = addToSection(controls.CreateControl(util::ControlType::Button, L"Save Window Set", WS_DISABLED));
+
+    // Blurs the password fields of the window being captured
+    m_redactPasswordFieldsCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Redact password fields", WS_DISABLED));
+    SendMessageW(m_redactPasswordFieldsCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+
+    // Flashes a marker in the corner of the monitor on input and measures
+    // how long it takes to show up in the capture
+    m_measureLatencyCheckBox = addToSection(controls.CreateControl(util::ControlType::CheckBox, L"Measure latency", WS_DISABLED));
+    SendMessageW(m_measureLatencyCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+
+    // The stack panel put the sections one after the other, move them all
+    // up to where the first one starts
+    auto getRect = [&](HWND control)
+    {
+        RECT rect = {};
+        winrt::check_bool(GetWindowRect(control, &rect));
+        MapWindowPoints(HWND_DESKTOP, m_window, reinterpret_cast<POINT*>(&rect), 2);
+        return rect;
+    };
+    auto sectionTop = getRect(m_sections.front().front()).top;
+    for (auto&& section : m_sections)
+    {
+        auto offset = getRect(section.front()).top - sectionTop;
+        for (auto&& control : section)
+        {
+            auto rect = getRect(control);
+            SetWindowPos(control, nullptr, rect.left, rect.top - offset, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+        }
+    }
+    ShowSection(0);
+}
+
+void SampleWindow::ShowSection(size_t index)
+{
+    for (size_t i = 0; i < m_sections.size(); i++)
+    {
+        for (auto&& control : m_sections[i])
+        {
+            ShowWindow(control, i == index ? SW_SHOW : SW_HIDE);
+        }
+    }
+}
+
+void SampleWindow::OnDisplaysChanged()
+{
+    auto changes = m_monitors->Update();
+    if (!changes.empty())
+    {
+        m_app->OnDisplaysChanged(changes);
+    }
+}
+
+void SampleWindow::OnWindowSearchTextChanged()
+{
+    auto textLength = GetWindowTextLengthW(m_windowSearchEdit);
+    std::wstring text(textLength + 1, 0);
+    auto copied = GetWindowTextW(m_windowSearchEdit, text.data(), textLength + 1);
+    text.resize(copied);
+
+    // Filtering rebuilds the combo box, which drops the selection.
+    // The capture keeps going, so we don't treat this as a stop.
+    m_windows->SetSearchQuery(text);
+}
+
+void SampleWindow::UpdateSnapshotButtonText()
+{
+    // Only count snapshots that are past the picker and encoding
+    auto encoding = 0;
+    auto totalProgress = 0.0;
+    for (auto&& snapshot : m_pendingSnapshots)
+    {
+        if (!snapshot.OnChange && snapshot.Progress.has_value())
+        {
+            encoding++;
+            totalProgress += snapshot.Progress.value();
+        }
+    }
+
+    std::wstring text(L"Take Snapshot");
+    if (encoding > 0)
+    {
+        auto percent = static_cast<int>(100.0 * totalProgress / encoding);
+        text = L"Saving";
+        if (encoding > 1)
+        {
+            text += L" " + std::to_wstring(encoding);
+        }
+        text += L"... " + std::to_wstring(percent) + L"%";
+    }
+    SetWindowTextW(m_snapshotButton, text.c_str());
+}
+
+void SampleWindow::CancelPendingSnapshots()
+{
+    for (auto&& snapshot : m_pendingSnapshots)
+    {
+        snapshot.Operation.Cancel();
+    }
 }
 
 void SampleWindow::SetSubTitle(std::wstring const& text)
@@ -426,10 +946,28 @@ void SampleWindow::StopCapture()
     SendMessageW(m_borderRequiredCheckBox, BM_SETCHECK, BST_CHECKED, 0);
     SendMessageW(m_secondaryWindowsCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
     SendMessageW(m_visualizeDirtyRegionCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_detectScrollingCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_repaintHeatmapCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_keepReplayCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_snapshotOnChangeCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_redactPasswordFieldsCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
+    SendMessageW(m_measureLatencyCheckBox, BM_SETCHECK, BST_UNCHECKED, 0);
     SendMessageW(m_dirtyRegionModeComboBox, CB_SETCURSEL, 0, 0);
     SendMessageW(m_minUpdateIntervalComboBox, CB_SETCURSEL, 0, 0);
+    SendMessageW(m_framePoolBufferCountComboBox, CB_SETCURSEL, 2, 0);
+    m_latencyMarker.reset();
     EnableWindow(m_stopButton, false);
     EnableWindow(m_snapshotButton, false);
+    EnableWindow(m_compareToGoldenButton, false);
+    EnableWindow(m_keepReplayCheckBox, false);
+    EnableWindow(m_saveReplayButton, false);
+    EnableWindow(m_saveRepaintReportButton, false);
+    EnableWindow(m_snapshotOnChangeCheckBox, false);
+    EnableWindow(m_redactPasswordFieldsCheckBox, false);
+    EnableWindow(m_measureLatencyCheckBox, false);
+    m_currentWindow = nullptr;
+    m_currentMonitor = nullptr;
+    UpdateWindowSetButtons();
 }
 
 void SampleWindow::OnCaptureItemClosed(winrt::GraphicsCaptureItem const&, winrt::IInspectable const&)
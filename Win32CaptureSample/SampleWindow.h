@@ -4,6 +4,7 @@
 class App;
 class WindowList;
 class MonitorList;
+class LatencyMarkerWindow;
 
 struct SampleWindow : robmikh::common::desktop::DesktopWindow<SampleWindow>
 {
@@ -33,6 +34,21 @@ private:
         winrt::Windows::Foundation::TimeSpan Interval;
     };
 
+    struct FramePoolBufferCountData
+    {
+        std::wstring Name;
+        // nullopt means the buffer count is tuned automatically
+        std::optional<uint32_t> BufferCount;
+    };
+
+    struct PendingSnapshot
+    {
+        winrt::Windows::Foundation::IAsyncOperationWithProgress<winrt::Windows::Storage::StorageFile, double> Operation;
+        std::optional<double> Progress;
+        // Saved by snapshot on change rather than the snapshot button
+        bool OnChange = false;
+    };
+
     enum class CaptureType
     {
         ProgrammaticWindow,
@@ -42,9 +58,23 @@ private:
 
     static void RegisterWindowClass();
     void CreateControls(HINSTANCE instance);
+    void ShowSection(size_t index);
     void SetSubTitle(std::wstring const& text);
+    void OnWindowSearchTextChanged();
+    void OnDisplaysChanged();
     winrt::fire_and_forget OnPickerButtonClicked();
     winrt::fire_and_forget OnSnapshotButtonClicked();
+    winrt::fire_and_forget OnCompareToGoldenButtonClicked();
+    winrt::fire_and_forget OnSaveReplayButtonClicked();
+    winrt::fire_and_forget OnSaveRepaintReportButtonClicked();
+    void OnAddToWindowSetButtonClicked();
+    winrt::fire_and_forget OnSaveWindowSetButtonClicked();
+    void UpdateWindowSetButtons();
+    winrt::fire_and_forget OnSnapshotOnChangeCheckBoxClicked();
+    winrt::fire_and_forget OnChangeSnapshotStarted(winrt::Windows::Foundation::IAsyncOperationWithProgress<winrt::Windows::Storage::StorageFile, double> operation);
+    void OnMeasureLatencyCheckBoxClicked();
+    void UpdateSnapshotButtonText();
+    void CancelPendingSnapshots();
     void StopCapture();
     void OnCaptureItemClosed(winrt::Windows::Graphics::Capture::GraphicsCaptureItem const&, winrt::Windows::Foundation::IInspectable const&);
     void OnCaptureStarted(
@@ -52,25 +82,51 @@ private:
         CaptureType captureType);
 
 private:
+    HWND m_windowSearchEdit = nullptr;
     HWND m_windowComboBox = nullptr;
     HWND m_monitorComboBox = nullptr;
     HWND m_pickerButton = nullptr;
     HWND m_stopButton = nullptr;
     HWND m_snapshotButton = nullptr;
+    HWND m_sectionComboBox = nullptr;
+    HWND m_compareToGoldenButton = nullptr;
     HWND m_pixelFormatComboBox = nullptr;
     HWND m_cursorCheckBox = nullptr;
     HWND m_captureExcludeCheckBox = nullptr;
     HWND m_borderRequiredCheckBox = nullptr;
     HWND m_secondaryWindowsCheckBox = nullptr;
     HWND m_visualizeDirtyRegionCheckBox = nullptr;
+    HWND m_detectScrollingCheckBox = nullptr;
+    HWND m_repaintHeatmapCheckBox = nullptr;
+    HWND m_saveRepaintReportButton = nullptr;
+    HWND m_keepReplayCheckBox = nullptr;
+    HWND m_saveReplayButton = nullptr;
+    HWND m_snapshotOnChangeCheckBox = nullptr;
+    HWND m_addToWindowSetButton = nullptr;
+    HWND m_saveWindowSetButton = nullptr;
+    HWND m_redactPasswordFieldsCheckBox = nullptr;
+    HWND m_measureLatencyCheckBox = nullptr;
     HWND m_dirtyRegionModeComboBox = nullptr;
     HWND m_minUpdateIntervalComboBox = nullptr;
+    HWND m_framePoolBufferCountComboBox = nullptr;
     std::unique_ptr<WindowList> m_windows;
     std::unique_ptr<MonitorList> m_monitors;
     std::vector<PixelFormatData> m_pixelFormats;
     std::vector<DirtyRegionModeData> m_dirtyRegionModes;
     std::vector<MinUpdateIntervalData> m_updateIntervals;
+    std::vector<FramePoolBufferCountData> m_framePoolBufferCounts;
+    // The controls of each section, only one section is shown at a time
+    std::vector<std::vector<HWND>> m_sections;
     std::shared_ptr<App> m_app;
+    std::vector<PendingSnapshot> m_pendingSnapshots;
+    bool m_closing = false;
+    // The window we're capturing if it was picked from the list, and the
+    // ones set aside to be snapshotted together
+    HWND m_currentWindow = nullptr;
+    std::vector<HWND> m_windowSet;
+    // The monitor we're capturing if it was picked from the list
+    HMONITOR m_currentMonitor = nullptr;
+    std::unique_ptr<LatencyMarkerWindow> m_latencyMarker;
     winrt::Windows::Graphics::Capture::GraphicsCaptureItem::Closed_revoker m_itemClosedRevoker;
     bool m_isSecondaryWindowsFeaturePresent = false;
 };
\ No newline at end of file
@@ -0,0 +1,409 @@
+#include "pch.h"
+#include "ScreenTileCodec.h"
+#include "PaletteIndexer.h"
+#include "DeflateEncoder.h"
+#include "DeflateDecoder.h"
+
+// {6C1F3B52-8A0E-4F57-9D41-27B35E0C94D8}
+winrt::guid const ScreenTileCodec::ContainerFormat{ 0x6c1f3b52, 0x8a0e, 0x4f57, { 0x9d, 0x41, 0x27, 0xb3, 0x5e, 0x0c, 0x94, 0xd8 } };
+
+enum class TileMode : uint8_t
+{
+    Solid = 0,
+    Palette = 1,
+    Raw = 2,
+    // Raw, then deflated
+    Deflated = 3,
+};
+
+uint8_t const OpaqueFlag = 0x80;
+uint32_t const MaxDimension = 1 << 16;
+// A mode byte and an opaque color, the smallest a tile can be
+uint32_t const MinTileBytes = 4;
+char const Magic[4] = { 'S', 'T', 'C', '2' };
+
+// Scratch space for a single tile, reused across the tiles of a band
+struct TileScratch
+{
+    PaletteIndexer Palette;
+    std::array<uint8_t, ScreenTileCodec::TileSize * ScreenTileCodec::TileSize> Indices;
+};
+
+void inline WriteUInt32(std::vector<uint8_t>& output, uint32_t value)
+{
+    auto offset = output.size();
+    output.resize(offset + sizeof(value));
+    memcpy(output.data() + offset, &value, sizeof(value));
+}
+
+void inline WriteUInt64(std::vector<uint8_t>& output, uint64_t value)
+{
+    auto offset = output.size();
+    output.resize(offset + sizeof(value));
+    memcpy(output.data() + offset, &value, sizeof(value));
+}
+
+void inline WriteColor(std::vector<uint8_t>& output, uint32_t color, bool opaque)
+{
+    auto offset = output.size();
+    auto size = opaque ? 3 : 4;
+    output.resize(offset + size);
+    memcpy(output.data() + offset, &color, size);
+}
+
+void inline WriteVarint(std::vector<uint8_t>& output, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+void EncodeTile(uint8_t const* pixels, uint32_t stride, uint32_t left, uint32_t top, uint32_t width, uint32_t height, bool deflate, TileScratch& scratch, std::vector<uint8_t>& output)
+{
+    scratch.Palette.Reset();
+    auto opaque = true;
+    auto fitsPalette = true;
+    size_t indexCount = 0;
+    for (auto y = top; y < top + height; y++)
+    {
+        auto row = reinterpret_cast<uint32_t const*>(pixels + static_cast<size_t>(y) * stride) + left;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            auto color = row[x];
+            opaque = opaque && (color >> 24) == 0xFF;
+            fitsPalette = fitsPalette && scratch.Palette.TryAdd(color, scratch.Indices[indexCount++]);
+        }
+    }
+    auto opaqueFlag = opaque ? OpaqueFlag : 0;
+    auto& colors = scratch.Palette.Colors();
+
+    if (fitsPalette && colors.size() == 1)
+    {
+        output.push_back(static_cast<uint8_t>(TileMode::Solid) | opaqueFlag);
+        WriteColor(output, colors.front(), opaque);
+        return;
+    }
+
+    auto rawSize = static_cast<size_t>(width) * height * (opaque ? 3 : 4);
+    if (fitsPalette)
+    {
+        auto start = output.size();
+        output.push_back(static_cast<uint8_t>(TileMode::Palette) | opaqueFlag);
+        output.push_back(static_cast<uint8_t>(colors.size() - 1));
+        for (auto&& color : colors)
+        {
+            WriteColor(output, color, opaque);
+        }
+        auto& indices = scratch.Indices;
+        for (size_t i = 0; i < indexCount;)
+        {
+            size_t run = 1;
+            while (i + run < indexCount && indices[i + run] == indices[i])
+            {
+                run++;
+            }
+            output.push_back(indices[i]);
+            WriteVarint(output, static_cast<uint32_t>(run - 1));
+            i += run;
+        }
+
+        if (output.size() - start <= rawSize)
+        {
+            return;
+        }
+        // Too noisy, raw is smaller
+        output.resize(start);
+    }
+
+    auto rawStart = output.size();
+    output.push_back(static_cast<uint8_t>(TileMode::Raw) | opaqueFlag);
+    for (auto y = top; y < top + height; y++)
+    {
+        auto row = reinterpret_cast<uint32_t const*>(pixels + static_cast<size_t>(y) * stride) + left;
+        if (opaque)
+        {
+            auto offset = output.size();
+            output.resize(offset + static_cast<size_t>(width) * 3);
+            auto destination = output.data() + offset;
+            for (uint32_t x = 0; x < width; x++)
+            {
+                memcpy(destination + x * 3, row + x, 3);
+            }
+        }
+        else
+        {
+            auto offset = output.size();
+            output.resize(offset + static_cast<size_t>(width) * 4);
+            memcpy(output.data() + offset, row, static_cast<size_t>(width) * 4);
+        }
+    }
+
+    if (deflate)
+    {
+        // Anti-aliased text and photos have too many colors for a palette,
+        // but still repeat themselves
+        auto compressed = DeflateEncoder::Compress(std::span<uint8_t const>(output.data() + rawStart + 1, rawSize));
+        if (compressed.size() < rawSize)
+        {
+            output.resize(rawStart);
+            output.push_back(static_cast<uint8_t>(TileMode::Deflated) | opaqueFlag);
+            output.insert(output.end(), compressed.begin(), compressed.end());
+        }
+    }
+}
+
+std::vector<uint8_t> ScreenTileCodec::Encode(uint8_t const* pixels, uint32_t width, uint32_t height, uint32_t stride, bool deflateRawTiles)
+{
+    if (width == 0 || height == 0 || width > MaxDimension || height > MaxDimension)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"Invalid image size!");
+    }
+
+    auto tilesX = (width + TileSize - 1) / TileSize;
+    auto tilesY = (height + TileSize - 1) / TileSize;
+    std::vector<std::vector<uint8_t>> bands(tilesY);
+    std::vector<uint64_t> tileSizes(static_cast<size_t>(tilesX) * tilesY);
+    std::vector<uint32_t> tileRows(tilesY);
+    std::iota(tileRows.begin(), tileRows.end(), 0);
+    std::for_each(std::execution::par, tileRows.begin(), tileRows.end(), [&](uint32_t tileRow)
+    {
+        auto scratch = std::make_unique<TileScratch>();
+        auto& band = bands[tileRow];
+        auto top = tileRow * TileSize;
+        auto tileHeight = std::min(TileSize, height - top);
+        for (uint32_t tileColumn = 0; tileColumn < tilesX; tileColumn++)
+        {
+            auto left = tileColumn * TileSize;
+            auto tileWidth = std::min(TileSize, width - left);
+            auto start = band.size();
+            EncodeTile(pixels, stride, left, top, tileWidth, tileHeight, deflateRawTiles, *scratch, band);
+            tileSizes[static_cast<size_t>(tileRow) * tilesX + tileColumn] = band.size() - start;
+        }
+    });
+
+    std::vector<uint8_t> result(std::begin(Magic), std::end(Magic));
+    auto dataSize = std::accumulate(bands.begin(), bands.end(), size_t(0), [](size_t total, auto&& band) { return total + band.size(); });
+    result.reserve(sizeof(Magic) + 4 * sizeof(uint32_t) + tileSizes.size() * sizeof(uint64_t) + dataSize);
+    WriteUInt32(result, width);
+    WriteUInt32(result, height);
+    WriteUInt32(result, TileSize);
+    WriteUInt32(result, static_cast<uint32_t>(tileSizes.size()));
+    uint64_t offset = 0;
+    for (auto&& tileSize : tileSizes)
+    {
+        WriteUInt64(result, offset);
+        offset += tileSize;
+    }
+    for (auto&& band : bands)
+    {
+        result.insert(result.end(), band.begin(), band.end());
+    }
+    return result;
+}
+
+// Bounds checked reading, any overrun means the data is corrupt
+class TileReader
+{
+public:
+    TileReader(std::span<uint8_t const> data) : m_data(data) {}
+
+    uint8_t ReadByte()
+    {
+        return *Take(1);
+    }
+
+    uint32_t ReadUInt32()
+    {
+        uint32_t value = 0;
+        memcpy(&value, Take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    uint64_t ReadUInt64()
+    {
+        uint64_t value = 0;
+        memcpy(&value, Take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    uint32_t ReadColor(bool opaque)
+    {
+        uint32_t color = opaque ? 0xFF000000 : 0;
+        auto size = opaque ? 3 : 4;
+        memcpy(&color, Take(size), size);
+        return color;
+    }
+
+    uint32_t ReadVarint()
+    {
+        uint32_t value = 0;
+        for (uint32_t shift = 0; shift < 32; shift += 7)
+        {
+            auto byte = ReadByte();
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        ThrowInvalid();
+    }
+
+    uint8_t const* Take(size_t size)
+    {
+        if (size > m_data.size() - m_position)
+        {
+            ThrowInvalid();
+        }
+        auto result = m_data.data() + m_position;
+        m_position += size;
+        return result;
+    }
+
+    size_t Position() const { return m_position; }
+    std::span<uint8_t const> Remaining() const { return m_data.subspan(m_position); }
+    void Seek(uint64_t position)
+    {
+        if (position > m_data.size())
+        {
+            ThrowInvalid();
+        }
+        m_position = static_cast<size_t>(position);
+    }
+
+    [[noreturn]] static void ThrowInvalid()
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"Invalid screen tile image!");
+    }
+
+private:
+    std::span<uint8_t const> m_data;
+    size_t m_position = 0;
+};
+
+ScreenTileImage ScreenTileCodec::Decode(std::span<uint8_t const> data)
+{
+    TileReader reader(data);
+    if (memcmp(reader.Take(sizeof(Magic)), Magic, sizeof(Magic)) != 0)
+    {
+        TileReader::ThrowInvalid();
+    }
+
+    ScreenTileImage image;
+    image.Width = reader.ReadUInt32();
+    image.Height = reader.ReadUInt32();
+    auto tileSize = reader.ReadUInt32();
+    auto tileCount = reader.ReadUInt32();
+    // Encode only writes one tile size, anything else is corrupt
+    if (image.Width == 0 || image.Height == 0 || image.Width > MaxDimension || image.Height > MaxDimension || tileSize != TileSize)
+    {
+        TileReader::ThrowInvalid();
+    }
+    auto tilesX = (image.Width + tileSize - 1) / tileSize;
+    auto tilesY = (image.Height + tileSize - 1) / tileSize;
+    if (static_cast<uint64_t>(tilesX) * tilesY != tileCount)
+    {
+        TileReader::ThrowInvalid();
+    }
+
+    // Every tile has its own data after the ones before it, and even a solid
+    // tile takes a few bytes. Checking that before allocating the pixels
+    // means a small file can't ask for more than a few thousand times its
+    // own size, however big its header says the image is.
+    auto offsetTable = reader.Take(static_cast<size_t>(tileCount) * sizeof(uint64_t));
+    std::vector<uint64_t> offsets(tileCount);
+    memcpy(offsets.data(), offsetTable, offsets.size() * sizeof(uint64_t));
+    auto dataStart = reader.Position();
+    auto tileDataSize = static_cast<uint64_t>(data.size() - dataStart);
+    for (uint32_t tile = 0; tile < tileCount; tile++)
+    {
+        auto end = tile + 1 < tileCount ? offsets[tile + 1] : tileDataSize;
+        if (offsets[tile] > tileDataSize || end > tileDataSize || end < offsets[tile] || end - offsets[tile] < MinTileBytes)
+        {
+            TileReader::ThrowInvalid();
+        }
+    }
+
+    image.Pixels.resize(static_cast<size_t>(image.Width) * image.Height * 4);
+    auto stride = static_cast<size_t>(image.Width) * 4;
+    std::vector<uint32_t> palette;
+    std::vector<uint8_t> inflated;
+    for (uint32_t tile = 0; tile < tileCount; tile++)
+    {
+        reader.Seek(dataStart + offsets[tile]);
+        auto left = (tile % tilesX) * tileSize;
+        auto top = (tile / tilesX) * tileSize;
+        auto width = std::min(tileSize, image.Width - left);
+        auto height = std::min(tileSize, image.Height - top);
+        auto pixelAt = [&](uint32_t index)
+        {
+            auto x = left + index % width;
+            auto y = top + index / width;
+            return reinterpret_cast<uint32_t*>(image.Pixels.data() + y * stride) + x;
+        };
+
+        auto modeByte = reader.ReadByte();
+        auto opaque = (modeByte & OpaqueFlag) != 0;
+        auto mode = static_cast<TileMode>(modeByte & ~OpaqueFlag);
+        auto pixelCount = static_cast<uint64_t>(width) * height;
+        switch (mode)
+        {
+        case TileMode::Solid:
+        {
+            auto color = reader.ReadColor(opaque);
+            for (auto y = top; y < top + height; y++)
+            {
+                auto row = reinterpret_cast<uint32_t*>(image.Pixels.data() + y * stride) + left;
+                std::fill(row, row + width, color);
+            }
+        }
+        break;
+        case TileMode::Palette:
+        {
+            palette.resize(static_cast<size_t>(reader.ReadByte()) + 1);
+            for (auto& color : palette)
+            {
+                color = reader.ReadColor(opaque);
+            }
+            uint32_t index = 0;
+            while (index < pixelCount)
+            {
+                auto paletteIndex = reader.ReadByte();
+                auto run = static_cast<uint64_t>(reader.ReadVarint()) + 1;
+                if (paletteIndex >= palette.size() || run > pixelCount - index)
+                {
+                    TileReader::ThrowInvalid();
+                }
+                for (uint64_t i = 0; i < run; i++)
+                {
+                    *pixelAt(index++) = palette[paletteIndex];
+                }
+            }
+        }
+        break;
+        case TileMode::Raw:
+            for (uint32_t index = 0; index < pixelCount; index++)
+            {
+                *pixelAt(index) = reader.ReadColor(opaque);
+            }
+            break;
+        case TileMode::Deflated:
+        {
+            inflated.resize(static_cast<size_t>(pixelCount) * (opaque ? 3 : 4));
+            reader.Take(DeflateDecoder::Decompress(reader.Remaining(), inflated));
+            TileReader rawReader(inflated);
+            for (uint32_t index = 0; index < pixelCount; index++)
+            {
+                *pixelAt(index) = rawReader.ReadColor(opaque);
+            }
+        }
+        break;
+        default:
+            TileReader::ThrowInvalid();
+        }
+    }
+    return image;
+}
\ No newline at end of file
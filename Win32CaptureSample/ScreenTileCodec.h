@@ -0,0 +1,41 @@
+#pragma once
+
+struct ScreenTileImage
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    // 32bpp BGRA, tightly packed
+    std::vector<uint8_t> Pixels;
+};
+
+// A lossless image format for screen content. The image is split into tiles,
+// and each tile is stored as whichever of these is smallest:
+//
+//   - a single color
+//   - a palette of up to 256 colors and run-length encoded indices
+//   - raw pixels, optionally deflated
+//
+// Alpha is left out of tiles that are fully opaque. Tiles are encoded in
+// parallel, one row of tiles per task.
+//
+// Layout (little-endian):
+//   "STC2", width, height, tile size, tile count (uint32 each)
+//   tile offsets, relative to the end of the offset table (uint64 each)
+//   tiles: mode byte (high bit set if opaque), followed by the tile's data.
+//   Deflated tiles are a zlib stream of what a raw tile would hold.
+class ScreenTileCodec
+{
+public:
+    // Passed to the snapshot encoder in place of a WIC container format
+    static winrt::guid const ContainerFormat;
+    static uint32_t const TileSize = 64;
+
+    // Pixels are 32bpp BGRA. Deflating raw tiles can halve the size of text
+    // heavy images, but it's the slowest part of encoding by far. Leave it
+    // off for anything that encodes at frame rate.
+    static std::vector<uint8_t> Encode(uint8_t const* pixels, uint32_t width, uint32_t height, uint32_t stride, bool deflateRawTiles = false);
+    static ScreenTileImage Decode(std::span<uint8_t const> data);
+
+private:
+    ScreenTileCodec() = delete;
+};
\ No newline at end of file
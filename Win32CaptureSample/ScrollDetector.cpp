@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "ScrollDetector.h"
+
+// Changed lines that have to agree on an offset before we call it a scroll
+int32_t const MinimumMatchingLines = 8;
+
+uint64_t inline MixHash(uint64_t hash, uint64_t value)
+{
+    hash ^= value;
+    hash *= 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 29);
+}
+
+uint64_t HashBytes(uint8_t const* data, size_t size)
+{
+    uint64_t hash = size;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word = 0;
+        memcpy(&word, data + i, sizeof(word));
+        hash = MixHash(hash, word);
+    }
+    if (i < size)
+    {
+        uint64_t word = 0;
+        memcpy(&word, data + i, size - i);
+        hash = MixHash(hash, word);
+    }
+    return hash;
+}
+
+void HashRows(uint8_t const* pixels, uint32_t stride, uint32_t bytesPerPixel, RECT const& region, std::vector<uint64_t>& hashes)
+{
+    auto rowSize = static_cast<size_t>(region.right - region.left) * bytesPerPixel;
+    hashes.resize(static_cast<size_t>(region.bottom - region.top));
+    for (auto y = region.top; y < region.bottom; y++)
+    {
+        auto row = pixels + static_cast<size_t>(y) * stride + static_cast<size_t>(region.left) * bytesPerPixel;
+        hashes[y - region.top] = HashBytes(row, rowSize);
+    }
+}
+
+void HashColumns(uint8_t const* pixels, uint32_t stride, uint32_t bytesPerPixel, RECT const& region, std::vector<uint64_t>& hashes)
+{
+    // Walk the pixels row by row to stay cache friendly
+    auto width = static_cast<size_t>(region.right - region.left);
+    hashes.assign(width, static_cast<uint64_t>(region.bottom - region.top));
+    for (auto y = region.top; y < region.bottom; y++)
+    {
+        auto row = pixels + static_cast<size_t>(y) * stride + static_cast<size_t>(region.left) * bytesPerPixel;
+        for (size_t x = 0; x < width; x++)
+        {
+            uint64_t pixel = 0;
+            memcpy(&pixel, row + x * bytesPerPixel, bytesPerPixel);
+            hashes[x] = MixHash(hashes[x], pixel);
+        }
+    }
+}
+
+template <typename LinesEqual, typename MakeRect>
+void AddResidual(
+    std::vector<uint64_t> const& previousHashes,
+    std::vector<uint64_t> const& currentHashes,
+    int32_t movedFirst,
+    int32_t movedLast,
+    LinesEqual&& linesEqual,
+    MakeRect&& makeRect,
+    std::vector<RECT>& residual)
+{
+    auto count = static_cast<int32_t>(currentHashes.size());
+    int32_t bandStart = -1;
+    for (int32_t i = 0; i <= count; i++)
+    {
+        auto changed = false;
+        if (i < count && (i < movedFirst || i >= movedLast))
+        {
+            changed = currentHashes[i] != previousHashes[i] || !linesEqual(i, i);
+        }
+        if (changed && bandStart < 0)
+        {
+            bandStart = i;
+        }
+        else if (!changed && bandStart >= 0)
+        {
+            residual.push_back(makeRect(bandStart, i));
+            bandStart = -1;
+        }
+    }
+}
+
+template <typename LinesEqual>
+std::optional<ScrollDetector::Shift> ScrollDetector::FindShift(
+    std::vector<uint64_t> const& previousHashes,
+    std::vector<uint64_t> const& currentHashes,
+    LinesEqual&& linesEqual)
+{
+    auto count = static_cast<int32_t>(currentHashes.size());
+    if (count < MinimumMatchingLines)
+    {
+        return std::nullopt;
+    }
+
+    // Lines that show up more than once (e.g. blank lines) can't tell us where they came from
+    m_lineIndices.clear();
+    for (int32_t i = 0; i < count; i++)
+    {
+        auto [search, inserted] = m_lineIndices.try_emplace(previousHashes[i], i);
+        if (!inserted)
+        {
+            search->second = -1;
+        }
+    }
+
+    // Offsets go from -(count - 1) to (count - 1)
+    m_votes.assign(static_cast<size_t>(count) * 2, 0);
+    int32_t changedLines = 0;
+    for (int32_t i = 0; i < count; i++)
+    {
+        if (currentHashes[i] == previousHashes[i])
+        {
+            continue;
+        }
+        changedLines++;
+        auto search = m_lineIndices.find(currentHashes[i]);
+        if (search == m_lineIndices.end() || search->second < 0)
+        {
+            continue;
+        }
+        auto offset = i - search->second;
+        if (std::abs(offset) <= m_maxShift)
+        {
+            m_votes[offset + count]++;
+        }
+    }
+
+    int32_t bestOffset = 0;
+    uint32_t bestVotes = 0;
+    for (int32_t offset = -(count - 1); offset < count; offset++)
+    {
+        auto votes = m_votes[offset + count];
+        if (votes > bestVotes || (votes == bestVotes && votes > 0 && std::abs(offset) < std::abs(bestOffset)))
+        {
+            bestOffset = offset;
+            bestVotes = votes;
+        }
+    }
+    auto requiredVotes = std::max(MinimumMatchingLines, changedLines / 4);
+    if (bestOffset == 0 || static_cast<int32_t>(bestVotes) < requiredVotes)
+    {
+        return std::nullopt;
+    }
+
+    // The longest run of lines that really match at that offset. Unlike the
+    // votes, this includes repeated lines.
+    Shift best = {};
+    int32_t runStart = -1;
+    auto first = std::max(0, bestOffset);
+    auto last = std::min(count, count + bestOffset);
+    for (auto i = first; i <= last; i++)
+    {
+        auto matches = i < last && currentHashes[i] == previousHashes[i - bestOffset] && linesEqual(i, i - bestOffset);
+        if (matches && runStart < 0)
+        {
+            runStart = i;
+        }
+        else if (!matches && runStart >= 0)
+        {
+            if (i - runStart > best.Last - best.First)
+            {
+                best = { bestOffset, runStart, i };
+            }
+            runStart = -1;
+        }
+    }
+    if (best.Last - best.First < MinimumMatchingLines)
+    {
+        return std::nullopt;
+    }
+    return best;
+}
+
+FrameMotion ScrollDetector::Detect(
+    uint8_t const* previous,
+    uint8_t const* current,
+    uint32_t stride,
+    uint32_t bytesPerPixel,
+    RECT const& region)
+{
+    FrameMotion result;
+    auto width = region.right - region.left;
+    auto height = region.bottom - region.top;
+    if (width <= 0 || height <= 0 || bytesPerPixel == 0 || bytesPerPixel > sizeof(uint64_t))
+    {
+        return result;
+    }
+
+    auto pixelAt = [&](uint8_t const* pixels, int32_t x, int32_t y)
+    {
+        return pixels + static_cast<size_t>(region.top + y) * stride + static_cast<size_t>(region.left + x) * bytesPerPixel;
+    };
+
+    auto rowRect = [&](int32_t first, int32_t last) { return RECT{ region.left, region.top + first, region.right, region.top + last }; };
+    auto columnRect = [&](int32_t first, int32_t last) { return RECT{ region.left + first, region.top, region.left + last, region.bottom }; };
+
+    // Vertical scrolling is by far the most common, so try it first
+    auto rowsEqual = [&](int32_t currentRow, int32_t previousRow)
+    {
+        return memcmp(pixelAt(current, 0, currentRow), pixelAt(previous, 0, previousRow), static_cast<size_t>(width) * bytesPerPixel) == 0;
+    };
+    HashRows(previous, stride, bytesPerPixel, region, m_previousRowHashes);
+    HashRows(current, stride, bytesPerPixel, region, m_currentRowHashes);
+    if (auto shift = FindShift(m_previousRowHashes, m_currentRowHashes, rowsEqual))
+    {
+        MoveRect move = {};
+        move.Destination = rowRect(shift->First, shift->Last);
+        move.Source = { region.left, region.top + shift->First - shift->Offset };
+        result.Moves.push_back(move);
+        AddResidual(m_previousRowHashes, m_currentRowHashes, shift->First, shift->Last, rowsEqual, rowRect, result.Residual);
+        return result;
+    }
+
+    auto columnsEqual = [&](int32_t currentColumn, int32_t previousColumn)
+    {
+        for (int32_t y = 0; y < height; y++)
+        {
+            if (memcmp(pixelAt(current, currentColumn, y), pixelAt(previous, previousColumn, y), bytesPerPixel) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+    HashColumns(previous, stride, bytesPerPixel, region, m_previousColumnHashes);
+    HashColumns(current, stride, bytesPerPixel, region, m_currentColumnHashes);
+    if (auto shift = FindShift(m_previousColumnHashes, m_currentColumnHashes, columnsEqual))
+    {
+        MoveRect move = {};
+        move.Destination = columnRect(shift->First, shift->Last);
+        move.Source = { region.left + shift->First - shift->Offset, region.top };
+        result.Moves.push_back(move);
+        AddResidual(m_previousColumnHashes, m_currentColumnHashes, shift->First, shift->Last, columnsEqual, columnRect, result.Residual);
+        return result;
+    }
+
+    // Nothing moved, but we can still leave out the rows that didn't change
+    AddResidual(m_previousRowHashes, m_currentRowHashes, 0, 0, rowsEqual, rowRect, result.Residual);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+// A block of pixels that moved between two frames. Destination is where the
+// pixels are in the current frame, Source is the top-left corner of where
+// they were in the previous frame.
+struct MoveRect
+{
+    RECT Destination;
+    POINT Source;
+};
+
+// What changed inside a dirty rect: the blocks that can be copied from the
+// previous frame, and the rects that still need new pixels.
+struct FrameMotion
+{
+    std::vector<MoveRect> Moves;
+    std::vector<RECT> Residual;
+};
+
+// Finds content that scrolled vertically or horizontally between two frames.
+// Every row of the region is hashed in both frames, and rows that changed vote
+// for the offset at which they appear in the previous frame. The winning
+// offset is checked against the actual pixels before it's reported. If no
+// vertical scroll is found, the same is tried with columns.
+//
+// Only one move is reported per region, which is what scrolling a single
+// view looks like. Changed lines that aren't part of the move are reported
+// as residual bands, unchanged lines are left out entirely.
+class ScrollDetector
+{
+public:
+    ScrollDetector(int32_t maxShift = 4096) : m_maxShift(maxShift) {}
+    ~ScrollDetector() {}
+
+    // Both buffers must have the same layout and contain the whole region.
+    // Pixels can be at most 8 bytes.
+    FrameMotion Detect(
+        uint8_t const* previous,
+        uint8_t const* current,
+        uint32_t stride,
+        uint32_t bytesPerPixel,
+        RECT const& region);
+
+private:
+    // Destination lines [First, Last) came from (line - Offset) in the previous frame
+    struct Shift
+    {
+        int32_t Offset = 0;
+        int32_t First = 0;
+        int32_t Last = 0;
+    };
+
+    template <typename LinesEqual>
+    std::optional<Shift> FindShift(
+        std::vector<uint64_t> const& previousHashes,
+        std::vector<uint64_t> const& currentHashes,
+        LinesEqual&& linesEqual);
+
+private:
+    int32_t m_maxShift = 0;
+    // Reused between calls to avoid allocating for every region
+    std::vector<uint64_t> m_previousRowHashes;
+    std::vector<uint64_t> m_currentRowHashes;
+    std::vector<uint64_t> m_previousColumnHashes;
+    std::vector<uint64_t> m_currentColumnHashes;
+    std::unordered_map<uint64_t, int32_t> m_lineIndices;
+    std::vector<uint32_t> m_votes;
+};
\ No newline at end of file
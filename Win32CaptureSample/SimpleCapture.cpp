@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "SimpleCapture.h"
+#include "PasswordFieldFinder.h"
 
 namespace winrt
 {
@@ -19,6 +20,60 @@ namespace util
     using namespace robmikh::common::uwp;
 }
 
+// The swap chain only ever shows the latest frame
+uint32_t const SwapChainBufferCount = 2;
+uint32_t const DefaultFramePoolBufferCount = 2;
+// One for the frame pool's thread and one for each worker covers a steady
+// state, more than that is a burst we don't need to keep memory around for
+size_t const MaxSparePipelineBuffers = 3;
+// Password fields are looked for again when something tells us they moved,
+// this only catches what nothing told us about
+winrt::TimeSpan const PasswordFieldSearchInterval = std::chrono::milliseconds(200);
+// A frame can be older than the layout we looked at, so where the fields used
+// to be stays redacted for a little while after they move
+winrt::TimeSpan const PasswordFieldMoveGracePeriod = std::chrono::milliseconds(100);
+
+// The WinEvent callback doesn't get a context, and hooks belong to the thread
+// that set them
+thread_local std::unordered_map<HWINEVENTHOOK, SimpleCapture*> PasswordFieldHooksForThread;
+
+winrt::TimeSpan GetSystemRelativeTime()
+{
+    LARGE_INTEGER counter = {};
+    LARGE_INTEGER frequency = {};
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    // Split up so that the multiplication doesn't overflow
+    auto seconds = counter.QuadPart / frequency.QuadPart;
+    auto remainder = counter.QuadPart % frequency.QuadPart;
+    return winrt::TimeSpan{ seconds * 10'000'000 + remainder * 10'000'000 / frequency.QuadPart };
+}
+
+PixelSize ToPixelSize(winrt::SizeInt32 size)
+{
+    return { size.Width, size.Height };
+}
+
+winrt::SizeInt32 ToSizeInt32(PixelSize size)
+{
+    return { size.Width, size.Height };
+}
+
+std::optional<std::vector<PixelRect>> ToPixelRects(std::optional<std::vector<RECT>> const& rects)
+{
+    if (!rects.has_value())
+    {
+        return std::nullopt;
+    }
+    std::vector<PixelRect> pixelRects;
+    pixelRects.reserve(rects->size());
+    for (auto&& rect : *rects)
+    {
+        pixelRects.push_back({ rect.left, rect.top, rect.right, rect.bottom });
+    }
+    return pixelRects;
+}
+
 SimpleCapture::SimpleCapture(
     winrt::IDirect3DDevice const& device,
     std::shared_ptr<DirtyRegionVisualizer> const& dirtyRegionVisualizer,
@@ -32,10 +87,24 @@ SimpleCapture::SimpleCapture(
 
     m_d3dDevice = GetDXGIInterfaceFromObject<ID3D11Device>(m_device);
     m_d3dDevice->GetImmediateContext(m_d3dContext.put());
+    m_frameReader = std::make_unique<CpuFrameReader>(m_d3dDevice);
+    m_replayBuffer = std::make_unique<ReplayBuffer>();
+    m_changeTrigger = std::make_unique<ChangeTrigger>();
+    m_replayDamage = m_damageTracker.AddConsumer();
+    m_changeTriggerDamage = m_damageTracker.AddConsumer();
+    m_changeTriggerTimer.reset(winrt::check_pointer(CreateThreadpoolTimer(&SimpleCapture::OnChangeTriggerTimer, this, nullptr)));
+    m_resizeTimer.reset(winrt::check_pointer(CreateThreadpoolTimer(&SimpleCapture::OnResizeTimer, this, nullptr)));
+    CreatePipeline();
+
+    m_resizePolicy.Reset(ToPixelSize(m_item.Size()));
+    m_lastSize = m_item.Size();
+    m_bufferSize = ToSizeInt32(m_resizePolicy.BufferSize());
+    m_framePoolBufferCount = DefaultFramePoolBufferCount;
+    m_framePoolTuner = std::make_unique<FramePoolTuner>(m_framePoolBufferCount.load(), GetFramePoolBufferBytes());
 
     auto format = static_cast<DXGI_FORMAT>(m_pixelFormat);
-    m_swapChain = util::CreateDXGISwapChain(m_d3dDevice, static_cast<uint32_t>(m_item.Size().Width), static_cast<uint32_t>(m_item.Size().Height),
-        format, 2).as<IDXGISwapChain3>();
+    m_swapChain = util::CreateDXGISwapChain(m_d3dDevice, static_cast<uint32_t>(m_bufferSize.Width), static_cast<uint32_t>(m_bufferSize.Height),
+        format, SwapChainBufferCount).as<IDXGISwapChain3>();
     winrt::check_hresult(m_swapChain->SetColorSpace1(GetColorSpaceFromPixelFormat(format)));
 
     // We use 'CreateFreeThreaded' instead of 'Create' so that the FrameArrived
@@ -43,9 +112,8 @@ SimpleCapture::SimpleCapture(
     // method, it's best not to do it on the UI thread. Using the 'Create' method
     // also means you must have a DispatcherQueue on that thread and you must be
     // pumping messages.
-    m_framePool = winrt::Direct3D11CaptureFramePool::CreateFreeThreaded(m_device, m_pixelFormat, 2, m_item.Size());
+    m_framePool = winrt::Direct3D11CaptureFramePool::CreateFreeThreaded(m_device, m_pixelFormat, m_framePoolBufferCount.load(), m_bufferSize);
     m_session = m_framePool.CreateCaptureSession(m_item);
-    m_lastSize = m_item.Size();
     m_framePool.FrameArrived({ this, &SimpleCapture::OnFrameArrived });
 }
 
@@ -70,43 +138,767 @@ void SimpleCapture::VisualizeDirtyRegions(bool value)
     }
 }
 
+void SimpleCapture::ShowRepaintHeatmap(bool value)
+{
+    CheckClosed();
+    if (m_dirtyRegionVisualizer != nullptr)
+    {
+        m_showRepaintHeatmap.store(value);
+        if (!value)
+        {
+            auto lock = std::scoped_lock(m_repaintHeatmapLock);
+            m_repaintHeatmap.Reset();
+        }
+    }
+}
+
+std::vector<RepaintHotspot> SimpleCapture::RepaintHotspots(float minRate, size_t maxCount)
+{
+    CheckClosed();
+    auto lock = std::scoped_lock(m_repaintHeatmapLock);
+    return m_repaintHeatmap.Hotspots(minRate, maxCount);
+}
+
+void SimpleCapture::RedactionRegions(std::vector<RedactionRegion> const& regions)
+{
+    CheckClosed();
+    // Better to find out here than on the frame pool's thread
+    FrameRedactor::CheckRegions(regions);
+    m_redactionRegions.store(std::make_shared<std::vector<RedactionRegion> const>(regions));
+}
+
+void UnhookPasswordFieldEvents(wil::unique_hwineventhook& hook)
+{
+    if (hook)
+    {
+        PasswordFieldHooksForThread.erase(hook.get());
+        hook.reset();
+    }
+}
+
+void SimpleCapture::RedactPasswordFields(HWND window)
+{
+    CheckClosed();
+    UnhookPasswordFieldEvents(m_passwordFieldHook);
+    if (window != nullptr)
+    {
+        // The fields can belong to other threads of the window's process
+        DWORD processId = 0;
+        winrt::check_bool(GetWindowThreadProcessId(window, &processId));
+        m_passwordFieldHook.reset(winrt::check_pointer(SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_LOCATIONCHANGE, nullptr,
+            OnPasswordFieldWindowEvent, processId, 0, WINEVENT_OUTOFCONTEXT)));
+        PasswordFieldHooksForThread[m_passwordFieldHook.get()] = this;
+    }
+    m_passwordFieldWindow.store(window);
+}
+
+void CALLBACK SimpleCapture::OnPasswordFieldWindowEvent(HWINEVENTHOOK eventHook, DWORD, HWND hwnd, LONG objectId, LONG, DWORD, DWORD)
+{
+    if (objectId != OBJID_WINDOW || hwnd == nullptr)
+    {
+        return;
+    }
+    auto search = PasswordFieldHooksForThread.find(eventHook);
+    if (search == PasswordFieldHooksForThread.end())
+    {
+        return;
+    }
+    auto capture = search->second;
+    auto window = capture->m_passwordFieldWindow.load();
+    if (hwnd == window || IsChild(window, hwnd))
+    {
+        capture->m_passwordFieldsMoved.store(true);
+    }
+}
+
+void SimpleCapture::MeasureLatency(std::optional<RECT> const& markerBounds)
+{
+    CheckClosed();
+    // Better to find out here than on the frame pool's thread
+    std::optional<MarkerDetector> detector;
+    if (markerBounds.has_value())
+    {
+        detector.emplace(markerBounds.value());
+    }
+    auto lock = std::scoped_lock(m_latencyLock);
+    m_markerDetector = detector;
+    m_latencyMeter.Reset();
+}
+
+std::optional<MarkerPhase> SimpleCapture::OnLatencyInput(winrt::TimeSpan timestamp)
+{
+    CheckClosed();
+    auto lock = std::scoped_lock(m_latencyLock);
+    if (!m_markerDetector.has_value())
+    {
+        return std::nullopt;
+    }
+    return m_latencyMeter.OnInput(timestamp);
+}
+
+LatencyReport SimpleCapture::MeasuredLatency()
+{
+    CheckClosed();
+    auto lock = std::scoped_lock(m_latencyLock);
+    return m_latencyMeter.Report();
+}
+
 void SimpleCapture::Close()
 {
     auto expected = false;
     if (m_closed.compare_exchange_strong(expected, true))
     {
+        // Waits for a shrink that's already running
+        m_resizeTimer.reset();
+        UnhookPasswordFieldEvents(m_passwordFieldHook);
         m_session.Close();
         m_framePool.Close();
+        m_replayWorker->Close();
+        m_changeTriggerWorker->Close();
+
+        // Waits for any poll that's already running
+        m_snapshotOnChange.store(false);
+        m_changeTriggerTimer.reset();
 
         m_swapChain = nullptr;
+        m_latestFrame.Clear();
         m_framePool = nullptr;
         m_session = nullptr;
         m_item = nullptr;
     }
 }
 
+winrt::com_ptr<ID3D11Texture2D> SimpleCapture::TryGetLatestFrame(winrt::DirectXPixelFormat pixelFormat)
+{
+    CheckClosed();
+    return CopyLatestFrame(pixelFormat);
+}
+
+winrt::com_ptr<ID3D11Texture2D> SimpleCapture::CopyLatestFrame(winrt::DirectXPixelFormat pixelFormat)
+{
+    // Nothing new since the last time someone asked, reuse the copy. Copies
+    // go through the immediate context, which UpdateLatestFrame holds while
+    // it changes the frame.
+    auto copy = m_latestFrame.GetCopy([&](LatestFrame const& latestFrame) -> std::shared_ptr<LatestFrameCopy const>
+    {
+        if (latestFrame.PixelFormat != pixelFormat)
+        {
+            return nullptr;
+        }
+        auto copy = std::make_shared<LatestFrameCopy>();
+        copy->Texture = util::CopyD3DTexture(m_d3dDevice, latestFrame.Texture, true);
+        copy->PixelFormat = pixelFormat;
+        return copy;
+    });
+    // The frame of the copy we already had could be in another format
+    if (copy == nullptr || copy->PixelFormat != pixelFormat)
+    {
+        return nullptr;
+    }
+    return copy->Texture;
+}
+
+void SimpleCapture::UpdateLatestFrame(winrt::com_ptr<ID3D11Texture2D> const& surfaceTexture, uint32_t width, uint32_t height, bool redact)
+{
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+    // We can only redact BGRA8 frames, don't hand out anything else
+    if (redact && m_pixelFormat != winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized)
+    {
+        m_latestFrame.Clear();
+        return;
+    }
+
+    auto latestFrame = m_latestFrame.Load();
+    D3D11_TEXTURE2D_DESC desc = {};
+    if (latestFrame != nullptr)
+    {
+        latestFrame->Texture->GetDesc(&desc);
+    }
+    if (latestFrame == nullptr || latestFrame->PixelFormat != m_pixelFormat || desc.Width != width || desc.Height != height)
+    {
+        desc = {};
+        desc.Width = width;
+        desc.Height = height;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = static_cast<DXGI_FORMAT>(m_pixelFormat);
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+
+        latestFrame = std::make_shared<LatestFrame>();
+        winrt::check_hresult(m_d3dDevice->CreateTexture2D(&desc, nullptr, latestFrame->Texture.put()));
+        latestFrame->PixelFormat = m_pixelFormat;
+    }
+
+    // Someone taking a snapshot on another thread mustn't get the frame
+    // in between the copy and the redaction
+    auto multithread = m_d3dContext.as<ID3D11Multithread>();
+    multithread->Enter();
+    auto leave = wil::scope_exit([&]()
+    {
+        multithread->Leave();
+    });
+
+    // This is a GPU copy, nothing gets read back unless someone asks for a snapshot
+    D3D11_BOX region = {};
+    region.right = width;
+    region.bottom = height;
+    region.back = 1;
+    m_d3dContext->CopySubresourceRegion(latestFrame->Texture.get(), 0, 0, 0, 0, surfaceTexture.get(), 0, &region);
+    if (redact)
+    {
+        RedactTexture(latestFrame->Texture, width, height);
+    }
+    m_latestFrame.Publish(latestFrame);
+}
+
+bool TouchesAny(std::optional<std::vector<RECT>> const& dirtyRects, std::vector<RECT> const& rects)
+{
+    // We don't know what changed, so it might have
+    if (!dirtyRects.has_value())
+    {
+        return true;
+    }
+    for (auto&& dirtyRect : *dirtyRects)
+    {
+        for (auto&& rect : rects)
+        {
+            RECT intersection = {};
+            if (IntersectRect(&intersection, &dirtyRect, &rect))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void SimpleCapture::UpdateRedactionRegions(winrt::TimeSpan frameTime, std::optional<std::vector<RECT>> const& dirtyRects)
+{
+    auto passwordFieldWindow = m_passwordFieldWindow.load();
+    auto moved = m_passwordFieldsMoved.exchange(false);
+    if (passwordFieldWindow == nullptr)
+    {
+        m_passwordFields.clear();
+        m_movedPasswordFields.clear();
+    }
+    else if (passwordFieldWindow != m_passwordFieldSearchWindow)
+    {
+        m_passwordFields = PasswordFieldFinder::Find(passwordFieldWindow);
+        m_movedPasswordFields.clear();
+        m_lastPasswordFieldSearch = frameTime;
+    }
+    else if (moved || TouchesAny(dirtyRects, m_passwordFields) || frameTime - m_lastPasswordFieldSearch >= PasswordFieldSearchInterval)
+    {
+        // Repainting a field is how scrolling it away shows up
+        auto fields = PasswordFieldFinder::Find(passwordFieldWindow);
+        auto same = std::equal(fields.begin(), fields.end(), m_passwordFields.begin(), m_passwordFields.end(), [](auto&& first, auto&& second)
+        {
+            return EqualRect(&first, &second) != FALSE;
+        });
+        if (!same)
+        {
+            m_movedPasswordFields.insert(m_movedPasswordFields.end(), m_passwordFields.begin(), m_passwordFields.end());
+            m_passwordFieldsMovedTime = frameTime;
+            m_passwordFields = std::move(fields);
+        }
+        m_lastPasswordFieldSearch = frameTime;
+    }
+    m_passwordFieldSearchWindow = passwordFieldWindow;
+    if (!m_movedPasswordFields.empty() && frameTime - m_passwordFieldsMovedTime >= PasswordFieldMoveGracePeriod)
+    {
+        m_movedPasswordFields.clear();
+    }
+
+    std::vector<RedactionRegion> regions;
+    auto configuredRegions = m_redactionRegions.load();
+    if (configuredRegions != nullptr)
+    {
+        regions = *configuredRegions;
+    }
+    for (auto&& field : m_passwordFields)
+    {
+        RedactionRegion region = {};
+        region.Bounds = field;
+        regions.push_back(region);
+    }
+    for (auto&& field : m_movedPasswordFields)
+    {
+        RedactionRegion region = {};
+        region.Bounds = field;
+        regions.push_back(region);
+    }
+    // Nothing gets recomputed if these are the same as last time
+    m_redactor.Regions(regions);
+}
+
+void SimpleCapture::PrepareRedaction(uint32_t width, uint32_t height, DXGI_FORMAT format, std::optional<std::vector<RECT>>& dirtyRects)
+{
+    m_redactionPending = false;
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+    if (format != DXGI_FORMAT_B8G8R8A8_UNORM)
+    {
+        // These get blacked out instead, start over once we can see them again
+        m_redactor.Invalidate();
+        return;
+    }
+
+    if (!m_redactor.HasRegions())
+    {
+        m_redactionTexture = nullptr;
+    }
+    else
+    {
+        D3D11_TEXTURE2D_DESC desc = {};
+        if (m_redactionTexture != nullptr)
+        {
+            m_redactionTexture->GetDesc(&desc);
+        }
+        if (m_redactionTexture == nullptr || desc.Width != width || desc.Height != height)
+        {
+            desc = {};
+            desc.Width = width;
+            desc.Height = height;
+            desc.MipLevels = 1;
+            desc.ArraySize = 1;
+            desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+            desc.SampleDesc.Count = 1;
+            desc.Usage = D3D11_USAGE_DEFAULT;
+            m_redactionTexture = nullptr;
+            winrt::check_hresult(m_d3dDevice->CreateTexture2D(&desc, nullptr, m_redactionTexture.put()));
+            m_redactor.Invalidate();
+        }
+    }
+
+    // Even without regions, ones that just went away need to be repainted
+    m_redactionPending = m_redactor.Prepare(width, height, dirtyRects);
+    if (dirtyRects.has_value())
+    {
+        // The redacted pixels change further out than the dirty rects
+        auto const& damage = m_redactor.Damage();
+        dirtyRects->insert(dirtyRects->end(), damage.begin(), damage.end());
+    }
+}
+
+void SimpleCapture::UpdateRedaction(winrt::com_ptr<ID3D11Texture2D> const& surfaceTexture, uint32_t width, uint32_t height, std::vector<uint8_t> const* framePixels)
+{
+    // Only read back what the redactor is going to look at
+    auto stride = width * 4;
+    auto pixels = framePixels;
+    auto bounds = m_redactor.SourceBounds();
+    if (pixels == nullptr && bounds.right > bounds.left && bounds.bottom > bounds.top)
+    {
+        m_frameReader->Read(surfaceTexture, width, height, bounds, m_redactionPixels);
+        pixels = &m_redactionPixels;
+    }
+    m_redactor.Update(pixels != nullptr ? pixels->data() : nullptr, stride);
+
+    for (auto&& updated : m_redactor.Updated())
+    {
+        D3D11_BOX region = {};
+        region.left = static_cast<uint32_t>(updated.Bounds.left);
+        region.top = static_cast<uint32_t>(updated.Bounds.top);
+        region.right = static_cast<uint32_t>(updated.Bounds.right);
+        region.bottom = static_cast<uint32_t>(updated.Bounds.bottom);
+        region.back = 1;
+        m_d3dContext->UpdateSubresource(m_redactionTexture.get(), 0, &region, updated.Pixels, updated.Stride, 0);
+    }
+}
+
+void SimpleCapture::DetectLatencyMarker(
+    winrt::com_ptr<ID3D11Texture2D> const& surfaceTexture,
+    uint32_t width,
+    uint32_t height,
+    DXGI_FORMAT format,
+    std::optional<std::vector<RECT>> const& dirtyRects,
+    winrt::TimeSpan frameTime,
+    winrt::TimeSpan arrivalTime,
+    std::vector<uint8_t> const* framePixels)
+{
+    std::optional<MarkerDetector> detector;
+    {
+        auto lock = std::scoped_lock(m_latencyLock);
+        detector = m_markerDetector;
+    }
+    if (!detector.has_value())
+    {
+        m_lastMarkerPhase.reset();
+        return;
+    }
+
+    auto bounds = detector->Bounds();
+    auto phase = MarkerPhase::None;
+    if (format == DXGI_FORMAT_B8G8R8A8_UNORM && bounds.right <= static_cast<LONG>(width) && bounds.bottom <= static_cast<LONG>(height))
+    {
+        auto sameMarker = m_lastMarkerPhase.has_value() && EqualRect(&bounds, &m_lastMarkerBounds) &&
+            m_lastMarkerFrameSize.Width == static_cast<int32_t>(width) && m_lastMarkerFrameSize.Height == static_cast<int32_t>(height);
+        auto drawnOver = !dirtyRects.has_value() || std::any_of(dirtyRects->begin(), dirtyRects->end(), [&](auto&& rect)
+            {
+                RECT intersection = {};
+                return IntersectRect(&intersection, &rect, &bounds) != FALSE;
+            });
+        if (sameMarker && !drawnOver)
+        {
+            phase = m_lastMarkerPhase.value();
+        }
+        else
+        {
+            // Only read back the marker
+            auto pixels = framePixels;
+            if (pixels == nullptr)
+            {
+                m_frameReader->Read(surfaceTexture, width, height, bounds, m_markerPixels);
+                pixels = &m_markerPixels;
+            }
+            phase = detector->Detect(pixels->data(), width * 4, width, height);
+        }
+    }
+    m_lastMarkerPhase = phase;
+    m_lastMarkerBounds = bounds;
+    m_lastMarkerFrameSize = { static_cast<int32_t>(width), static_cast<int32_t>(height) };
+
+    auto lock = std::scoped_lock(m_latencyLock);
+    // We could have been stopped in the meantime
+    if (m_markerDetector.has_value())
+    {
+        m_latencyMeter.OnFrame(frameTime, arrivalTime, phase);
+    }
+}
+
+void SimpleCapture::RedactTexture(winrt::com_ptr<ID3D11Texture2D> const& texture, uint32_t width, uint32_t height)
+{
+    if (m_redactionTexture == nullptr)
+    {
+        return;
+    }
+    for (auto&& bounds : m_redactor.RedactedBounds())
+    {
+        D3D11_BOX region = {};
+        region.left = static_cast<uint32_t>(bounds.left);
+        region.top = static_cast<uint32_t>(bounds.top);
+        region.right = std::min(static_cast<uint32_t>(bounds.right), width);
+        region.bottom = std::min(static_cast<uint32_t>(bounds.bottom), height);
+        region.back = 1;
+        if (region.left < region.right && region.top < region.bottom)
+        {
+            m_d3dContext->CopySubresourceRegion(texture.get(), 0, region.left, region.top, 0, m_redactionTexture.get(), 0, &region);
+        }
+    }
+}
+
+void SimpleCapture::BlackOutRedactions(winrt::com_ptr<ID3D11Texture2D> const& texture)
+{
+    std::vector<D3D11_RECT> rects;
+    for (auto&& region : m_redactor.Regions())
+    {
+        rects.push_back(region.Bounds);
+    }
+    winrt::com_ptr<ID3D11RenderTargetView> rtv;
+    winrt::check_hresult(m_d3dDevice->CreateRenderTargetView(texture.get(), nullptr, rtv.put()));
+    float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    m_d3dContext.as<ID3D11DeviceContext1>()->ClearView(rtv.get(), clearColor, rects.data(), static_cast<uint32_t>(rects.size()));
+}
+
+void SimpleCapture::KeepReplay(bool value)
+{
+    CheckClosed();
+    m_keepReplay.store(value);
+    if (!value)
+    {
+        // Nothing new gets submitted, but what's already in there would
+        // end up in the buffer after clearing it
+        m_replayWorker->Drain();
+        m_replayBuffer->Clear();
+        m_damageTracker.Invalidate(m_replayDamage);
+    }
+}
+
+void SimpleCapture::FramePoolBufferCount(uint32_t value)
+{
+    CheckClosed();
+    if (value == 0)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"The frame pool needs at least one buffer.");
+    }
+    m_autoTuneFramePool.store(false);
+    auto newCount = std::optional(value);
+    m_framePoolBufferCountUpdate.exchange(newCount);
+}
+
+void SimpleCapture::SnapshotOnChange(
+    std::function<void(winrt::com_ptr<ID3D11Texture2D> const&)> handler,
+    ChangeTriggerSettings const& settings)
+{
+    CheckClosed();
+    auto lock = std::scoped_lock(m_changeTriggerLock);
+    m_changeHandler = handler;
+    m_changeTrigger = std::make_unique<ChangeTrigger>(settings);
+    m_damageTracker.Invalidate(m_changeTriggerDamage);
+    m_snapshotOnChange.store(handler != nullptr);
+    SetThreadpoolTimer(m_changeTriggerTimer.get(), nullptr, 0, 0);
+}
+
+void SimpleCapture::CreatePipeline()
+{
+    // Frames have to stay in order, and one waiting is plenty
+    m_replayWorker = std::make_unique<PipelineWorker>(1);
+    m_changeTriggerWorker = std::make_unique<PipelineWorker>(1);
+    m_pipelineBuffers = std::make_shared<PipelineBufferList>();
+}
+
+void SimpleCapture::OnReplayFrame(CpuFrame const& frame)
+{
+    if (m_keepReplay.load())
+    {
+        m_replayBuffer->AddFrame(frame.Time, frame.Pixels->data(), frame.Width, frame.Height, frame.DirtyRects);
+    }
+}
+
+void SimpleCapture::OnChangeTriggerFrame(CpuFrame const& frame)
+{
+    auto changeTriggered = false;
+    {
+        auto lock = std::scoped_lock(m_changeTriggerLock);
+        if (!m_snapshotOnChange.load())
+        {
+            return;
+        }
+        changeTriggered = m_changeTrigger->OnFrame(frame.Time, frame.Pixels->data(), frame.Width, frame.Height,
+            frame.Stride, frame.DirtyRects);
+        ScheduleChangeTriggerPoll();
+    }
+    if (changeTriggered)
+    {
+        OnChangeTriggered();
+    }
+}
+
+std::shared_ptr<std::vector<uint8_t>> SimpleCapture::GetPipelineBuffer()
+{
+    std::unique_ptr<std::vector<uint8_t>> buffer;
+    {
+        auto lock = std::scoped_lock(m_pipelineBuffers->Lock);
+        if (!m_pipelineBuffers->Buffers.empty())
+        {
+            buffer = std::move(m_pipelineBuffers->Buffers.back());
+            m_pipelineBuffers->Buffers.pop_back();
+        }
+    }
+    if (buffer == nullptr)
+    {
+        buffer = std::make_unique<std::vector<uint8_t>>();
+    }
+
+    // Whoever lets go of the buffer last hands it back, which can be a
+    // worker after we're gone
+    std::weak_ptr<PipelineBufferList> weakBuffers = m_pipelineBuffers;
+    return std::shared_ptr<std::vector<uint8_t>>(buffer.release(), [weakBuffers](std::vector<uint8_t>* released)
+    {
+        std::unique_ptr<std::vector<uint8_t>> returned(released);
+        if (auto buffers = weakBuffers.lock())
+        {
+            auto lock = std::scoped_lock(buffers->Lock);
+            if (buffers->Buffers.size() < MaxSparePipelineBuffers)
+            {
+                buffers->Buffers.push_back(std::move(returned));
+            }
+        }
+    });
+}
+
+void SimpleCapture::OnChangeTriggered()
+{
+    std::function<void(winrt::com_ptr<ID3D11Texture2D> const&)> handler;
+    {
+        auto lock = std::scoped_lock(m_changeTriggerLock);
+        handler = m_changeHandler;
+    }
+    if (handler == nullptr || m_closed.load())
+    {
+        return;
+    }
+
+    // The trigger only looks at BGRA8 frames
+    auto texture = CopyLatestFrame(winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized);
+    if (texture != nullptr)
+    {
+        handler(texture);
+    }
+}
+
+void SetTimerDeadline(PTP_TIMER timer, winrt::TimeSpan deadline)
+{
+    auto delay = std::max(deadline - GetSystemRelativeTime(), winrt::TimeSpan{ 0 });
+    // Negative means relative to now
+    ULARGE_INTEGER dueTime = {};
+    dueTime.QuadPart = static_cast<ULONGLONG>(-delay.count());
+    FILETIME fileTime = {};
+    fileTime.dwLowDateTime = dueTime.LowPart;
+    fileTime.dwHighDateTime = dueTime.HighPart;
+    SetThreadpoolTimer(timer, &fileTime, 0, 0);
+}
+
+void SimpleCapture::ScheduleChangeTriggerPoll()
+{
+    // Frames stop showing up once the content settles, which is exactly when
+    // the trigger wants to fire. Come back when it's ready.
+    auto deadline = m_changeTrigger->Deadline();
+    if (deadline.has_value())
+    {
+        SetTimerDeadline(m_changeTriggerTimer.get(), winrt::TimeSpan{ deadline.value() });
+    }
+}
+
+void CALLBACK SimpleCapture::OnChangeTriggerTimer(PTP_CALLBACK_INSTANCE, void* context, PTP_TIMER)
+{
+    auto capture = reinterpret_cast<SimpleCapture*>(context);
+    auto fire = false;
+    {
+        auto lock = std::scoped_lock(capture->m_changeTriggerLock);
+        if (!capture->m_snapshotOnChange.load())
+        {
+            return;
+        }
+        fire = capture->m_changeTrigger->Poll(Ticks{ GetSystemRelativeTime() });
+        if (!fire)
+        {
+            capture->ScheduleChangeTriggerPoll();
+        }
+    }
+    if (fire)
+    {
+        capture->OnChangeTriggered();
+    }
+}
+
+uint64_t SimpleCapture::GetFramePoolBufferBytes()
+{
+    auto bytesPerPixel = util::GetBytesPerPixel(static_cast<DXGI_FORMAT>(m_pixelFormat));
+    return static_cast<uint64_t>(m_bufferSize.Width) * m_bufferSize.Height * bytesPerPixel;
+}
+
+std::optional<std::vector<RECT>> SimpleCapture::GetDirtyRects(winrt::Direct3D11CaptureFrame const& frame)
+{
+    // Without the dirty region API we have to assume everything changed
+    if (m_dirtyRegionVisualizer == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<RECT> rects;
+    for (auto&& dirtyRegion : frame.DirtyRegions())
+    {
+        rects.push_back({ dirtyRegion.X, dirtyRegion.Y, dirtyRegion.X + dirtyRegion.Width, dirtyRegion.Y + dirtyRegion.Height });
+    }
+    return rects;
+}
+
 void SimpleCapture::ResizeSwapChain()
 {
     auto format = static_cast<DXGI_FORMAT>(m_pixelFormat);
-    winrt::check_hresult(m_swapChain->ResizeBuffers(2, static_cast<uint32_t>(m_lastSize.Width), static_cast<uint32_t>(m_lastSize.Height),
+    winrt::check_hresult(m_swapChain->ResizeBuffers(SwapChainBufferCount, static_cast<uint32_t>(m_bufferSize.Width), static_cast<uint32_t>(m_bufferSize.Height),
         format, 0));
     winrt::check_hresult(m_swapChain->SetColorSpace1(GetColorSpaceFromPixelFormat(format)));
+    UpdateSwapChainSourceSize();
+}
+
+void SimpleCapture::UpdateSwapChainSourceSize()
+{
+    // Only present the part of the buffers that has content
+    auto width = std::clamp(m_lastSize.Width, 1, m_bufferSize.Width);
+    auto height = std::clamp(m_lastSize.Height, 1, m_bufferSize.Height);
+    winrt::check_hresult(m_swapChain->SetSourceSize(static_cast<uint32_t>(width), static_cast<uint32_t>(height)));
 }
 
 bool SimpleCapture::TryResizeSwapChain(winrt::Direct3D11CaptureFrame const& frame)
 {
     auto const contentSize = frame.ContentSize();
-    if ((contentSize.Width != m_lastSize.Width) ||
-        (contentSize.Height != m_lastSize.Height))
+    auto newBufferSize = m_resizePolicy.Update(ToPixelSize(contentSize), Ticks{ frame.SystemRelativeTime() });
+    auto contentSizeChanged = (contentSize.Width != m_lastSize.Width) || (contentSize.Height != m_lastSize.Height);
+    m_lastSize = contentSize;
+    ScheduleResizeSettle();
+    if (newBufferSize.has_value())
     {
-        // The thing we have been capturing has changed size, resize the swap chain to match.
-        m_lastSize = contentSize;
+        // The thing we have been capturing no longer fits (or the size has settled), 
+        // resize the swap chain to match.
+        m_bufferSize = ToSizeInt32(newBufferSize.value());
         ResizeSwapChain();
         return true;
     }
+    else if (contentSizeChanged)
+    {
+        UpdateSwapChainSourceSize();
+    }
     return false;
 }
 
+void SimpleCapture::ScheduleResizeSettle()
+{
+    auto deadline = m_resizePolicy.ShrinkDeadline();
+    if (deadline.has_value())
+    {
+        SetTimerDeadline(m_resizeTimer.get(), winrt::TimeSpan{ deadline.value() });
+    }
+    else
+    {
+        SetThreadpoolTimer(m_resizeTimer.get(), nullptr, 0, 0);
+    }
+}
+
+void CALLBACK SimpleCapture::OnResizeTimer(PTP_CALLBACK_INSTANCE, void* context, PTP_TIMER)
+{
+    auto capture = reinterpret_cast<SimpleCapture*>(context);
+    auto lock = std::scoped_lock(capture->m_frameLock);
+    if (!capture->m_closed.load())
+    {
+        capture->ShrinkSettledSwapChain();
+    }
+}
+
+void SimpleCapture::ShrinkSettledSwapChain()
+{
+    // Resizing throws away what's on screen, and content that isn't changing
+    // won't send a frame to replace it. The swap chain is flip model, so its
+    // buffer 0 holds an older frame than the one on screen, put the latest
+    // frame back instead. Without one, the next frame does the shrinking.
+    auto latestFrame = m_latestFrame.Load();
+    if (latestFrame == nullptr || latestFrame->PixelFormat != m_pixelFormat)
+    {
+        return;
+    }
+
+    // A frame could have come in and changed the size since we were scheduled
+    auto newBufferSize = m_resizePolicy.Update(ToPixelSize(m_lastSize), Ticks{ GetSystemRelativeTime() });
+    if (!newBufferSize.has_value())
+    {
+        ScheduleResizeSettle();
+        return;
+    }
+
+    m_bufferSize = ToSizeInt32(newBufferSize.value());
+    ResizeSwapChain();
+    winrt::com_ptr<ID3D11Texture2D> backBuffer;
+    winrt::check_hresult(m_swapChain->GetBuffer(0, winrt::guid_of<ID3D11Texture2D>(), backBuffer.put_void()));
+    D3D11_TEXTURE2D_DESC desc = {};
+    latestFrame->Texture->GetDesc(&desc);
+    D3D11_BOX region = {};
+    region.right = std::min(desc.Width, static_cast<uint32_t>(m_bufferSize.Width));
+    region.bottom = std::min(desc.Height, static_cast<uint32_t>(m_bufferSize.Height));
+    region.back = 1;
+    m_d3dContext->CopySubresourceRegion(backBuffer.get(), 0, 0, 0, 0, latestFrame->Texture.get(), 0, &region);
+    DXGI_PRESENT_PARAMETERS presentParameters{};
+    m_swapChain->Present1(1, 0, &presentParameters);
+
+    m_framePool.Recreate(m_device, m_pixelFormat, m_framePoolBufferCount.load(), m_bufferSize);
+    m_framePoolTuner->Reset(m_framePoolBufferCount.load(), GetFramePoolBufferBytes());
+}
+
 bool SimpleCapture::TryUpdatePixelFormat()
 {
     auto newFormat = m_pixelFormatUpdate.exchange(std::nullopt);
@@ -123,6 +915,26 @@ bool SimpleCapture::TryUpdatePixelFormat()
     return false;
 }
 
+bool SimpleCapture::TryUpdateItemSize()
+{
+    auto newSize = m_itemSizeUpdate.exchange(std::nullopt);
+    if (newSize.has_value())
+    {
+        auto size = newSize.value();
+        if ((size.Width != m_lastSize.Width) ||
+            (size.Height != m_lastSize.Height))
+        {
+            m_lastSize = size;
+            m_resizePolicy.Reset(size);
+            m_bufferSize = ToSizeInt32(m_resizePolicy.BufferSize());
+            ScheduleResizeSettle();
+            ResizeSwapChain();
+            return true;
+        }
+    }
+    return false;
+}
+
 DXGI_COLOR_SPACE_TYPE SimpleCapture::GetColorSpaceFromPixelFormat(DXGI_FORMAT format)
 {
     switch (format)
@@ -132,6 +944,8 @@ DXGI_COLOR_SPACE_TYPE SimpleCapture::GetColorSpaceFromPixelFormat(DXGI_FORMAT fo
         return DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
     case DXGI_FORMAT_R16G16B16A16_FLOAT:
         return DXGI_COLOR_SPACE_RGB_FULL_G10_NONE_P709;
+    case DXGI_FORMAT_R10G10B10A2_UNORM:
+        return DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020;
     default:
         throw winrt::hresult_error(E_INVALIDARG, L"Unknown color space for pixel format.");
     }
@@ -139,11 +953,17 @@ DXGI_COLOR_SPACE_TYPE SimpleCapture::GetColorSpaceFromPixelFormat(DXGI_FORMAT fo
 
 void SimpleCapture::OnFrameArrived(winrt::Direct3D11CaptureFramePool const& sender, winrt::IInspectable const&)
 {
+    auto frameLock = std::scoped_lock(m_frameLock);
     auto swapChainResizedToFrame = false;
+    winrt::TimeSpan frameTime = {};
+    auto arrivalTime = GetSystemRelativeTime();
 
     {
         auto frame = sender.TryGetNextFrame();
-        swapChainResizedToFrame = TryResizeSwapChain(frame);
+        frameTime = frame.SystemRelativeTime();
+        // If we've been told the item's new size, this frame is still from the
+        // old frame pool. Don't size the swap chain back down to it.
+        swapChainResizedToFrame = TryUpdateItemSize() || TryResizeSwapChain(frame);
 
         winrt::com_ptr<ID3D11Texture2D> backBuffer;
         winrt::check_hresult(m_swapChain->GetBuffer(0, winrt::guid_of<ID3D11Texture2D>(), backBuffer.put_void()));
@@ -154,13 +974,47 @@ void SimpleCapture::OnFrameArrived(winrt::Direct3D11CaptureFramePool const& send
         // of Windows that supports dirty regions.
         bool renderRects = m_dirtyRegionVisualizer && frame.DirtyRegionMode() == winrt::GraphicsCaptureDirtyRegionMode::ReportAndRender;
 
+        D3D11_TEXTURE2D_DESC desc = {};
+        surfaceTexture->GetDesc(&desc);
+        D3D11_TEXTURE2D_DESC backBufferDesc = {};
+        backBuffer->GetDesc(&backBufferDesc);
+        int textureWidth = static_cast<int>(std::min(desc.Width, backBufferDesc.Width));
+        int textureHeight = static_cast<int>(std::min(desc.Height, backBufferDesc.Height));
+        int contentWidth = std::max(frame.ContentSize().Width, 0);
+        int contentHeight = std::max(frame.ContentSize().Height, 0);
+        // All of the frame that could end up in a snapshot, not just what fits
+        // in the swap chain
+        auto frameWidth = static_cast<uint32_t>(std::min(static_cast<int>(desc.Width), contentWidth));
+        auto frameHeight = static_cast<uint32_t>(std::min(static_cast<int>(desc.Height), contentHeight));
+
+        // Every frame counts towards what consumers need to refresh, even
+        // the ones they don't get to see.
+        auto dirtyRects = GetDirtyRects(frame);
+        UpdateRedactionRegions(frameTime, dirtyRects);
+        auto redact = m_redactor.HasRegions();
+        PrepareRedaction(frameWidth, frameHeight, desc.Format, dirtyRects);
+        m_damageTracker.AddFrame(dirtyRects);
+
+        auto showRepaintHeatmap = m_dirtyRegionVisualizer && m_showRepaintHeatmap.load();
+        if (showRepaintHeatmap)
+        {
+            auto lock = std::scoped_lock(m_repaintHeatmapLock);
+            m_repaintHeatmap.AddFrame(frameTime, static_cast<uint32_t>(contentWidth), static_cast<uint32_t>(contentHeight), dirtyRects);
+        }
+
         if (!renderRects)
         {
             // On builds of Windows that don't support dirty regions or when the dirty
             // region mode is set to ReportOnly, the entire frame has been rendered.
 
-            // copy surfaceTexture to backBuffer
-            m_d3dContext->CopyResource(backBuffer.get(), surfaceTexture.get());
+            // copy surfaceTexture to backBuffer. The two may not be the same size
+            // (e.g. while the frame pool is catching up to a resize), so only
+            // copy the part that overlaps.
+            D3D11_BOX region = {};
+            region.right = static_cast<uint32_t>(std::min(textureWidth, contentWidth));
+            region.bottom = static_cast<uint32_t>(std::min(textureHeight, contentHeight));
+            region.back = 1;
+            m_d3dContext->CopySubresourceRegion(backBuffer.get(), 0, 0, 0, 0, surfaceTexture.get(), 0, &region);
         }
         else
         {
@@ -168,17 +1022,15 @@ void SimpleCapture::OnFrameArrived(winrt::Direct3D11CaptureFramePool const& send
             // the dirty region are valid. To visualize this, we'll clear our render target
             // to opaque black and copy out the dirty regions.
 
+            // Only part of this frame is valid, so it's no good for snapshots
+            m_latestFrame.Clear();
+
             // First, let's clear our render target
             winrt::com_ptr<ID3D11RenderTargetView> rtv;
             winrt::check_hresult(m_d3dDevice->CreateRenderTargetView(backBuffer.get(), nullptr, rtv.put()));
             float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
             m_d3dContext->ClearRenderTargetView(rtv.get(), clearColor);
 
-            D3D11_TEXTURE2D_DESC desc = {};
-            surfaceTexture->GetDesc(&desc);
-            int textureWidth = static_cast<int>(desc.Width);
-            int textureHeight = static_cast<int>(desc.Height);
-
             // Next, let's copy out each dirty region
             auto dirtyRegion = frame.DirtyRegions();
             for (auto&& dirtyRegion : dirtyRegion)
@@ -215,19 +1067,124 @@ void SimpleCapture::OnFrameArrived(winrt::Direct3D11CaptureFramePool const& send
             }
         }
 
-        if (m_dirtyRegionVisualizer && m_visualizeDirtyRegions.load())
+        // Scroll detection, the replay buffer and the change trigger all need the
+        // whole frame on the CPU
+        auto visualizeDirtyRegions = m_dirtyRegionVisualizer && m_visualizeDirtyRegions.load();
+        auto detectScrolling = visualizeDirtyRegions && m_detectScrolling.load() && !renderRects;
+        // Stages that are still busy skip this frame. Their damage stays in
+        // the tracker until they take a frame again.
+        auto keepReplay = m_keepReplay.load() && !renderRects && desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM &&
+            m_replayWorker->CanSubmit();
+        auto snapshotOnChange = m_snapshotOnChange.load() && !renderRects && desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM &&
+            m_changeTriggerWorker->CanSubmit();
+        std::vector<FrameMotion> const* motion = nullptr;
+        auto width = static_cast<uint32_t>(std::min(textureWidth, contentWidth));
+        auto height = static_cast<uint32_t>(std::min(textureHeight, contentHeight));
+        std::shared_ptr<std::vector<uint8_t>> pixels;
+        uint32_t stride = 0;
+        if ((detectScrolling || keepReplay || snapshotOnChange) && width > 0 && height > 0)
+        {
+            pixels = GetPipelineBuffer();
+            m_frameReader->Read(surfaceTexture, width, height, *pixels);
+            stride = m_frameReader->Stride();
+        }
+        // No need to read anything again if we already have all of it
+        auto haveFrame = pixels != nullptr && width == frameWidth && height == frameHeight;
+        if (m_redactionPending)
+        {
+            UpdateRedaction(surfaceTexture, frameWidth, frameHeight, haveFrame ? pixels.get() : nullptr);
+        }
+        DetectLatencyMarker(surfaceTexture, frameWidth, frameHeight, desc.Format, dirtyRects, frameTime, arrivalTime, haveFrame ? pixels.get() : nullptr);
+        if (pixels != nullptr)
+        {
+            if (redact && desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM)
+            {
+                m_redactor.Apply(pixels->data(), width, height, stride);
+            }
+            auto makeFrame = [&](size_t damageConsumer)
+            {
+                return std::make_shared<CpuFrame const>(CpuFrame{ Ticks{ frameTime }, pixels, width, height,
+                    stride, ToPixelRects(m_damageTracker.Take(damageConsumer)) });
+            };
+            // We're the only ones submitting, so these can't fill up in between
+            if (keepReplay)
+            {
+                m_replayWorker->TrySubmit([this, replayFrame = makeFrame(m_replayDamage)]() { OnReplayFrame(*replayFrame); });
+            }
+            if (snapshotOnChange)
+            {
+                m_changeTriggerWorker->TrySubmit([this, changeFrame = makeFrame(m_changeTriggerDamage)]() { OnChangeTriggerFrame(*changeFrame); });
+            }
+            if (detectScrolling)
+            {
+                motion = &m_motionTracker.Update(*pixels, width, height, m_frameReader->BytesPerPixel(), frame.DirtyRegions());
+            }
+        }
+        if (motion == nullptr)
+        {
+            m_motionTracker.Reset();
+        }
+
+        // Now that the redaction is up to date, cover it up everywhere
+        if (redact && desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM)
+        {
+            RedactTexture(backBuffer, backBufferDesc.Width, backBufferDesc.Height);
+        }
+        else if (redact)
+        {
+            BlackOutRedactions(backBuffer);
+        }
+        // Keep the full frame around for snapshots
+        if (!renderRects && desc.Format == static_cast<DXGI_FORMAT>(m_pixelFormat))
+        {
+            UpdateLatestFrame(surfaceTexture, frameWidth, frameHeight, redact);
+        }
+
+        // Under the dirty rects, so that the current frame stands out
+        if (showRepaintHeatmap)
         {
-            m_dirtyRegionVisualizer->Render(backBuffer, frame);
+            auto lock = std::scoped_lock(m_repaintHeatmapLock);
+            m_dirtyRegionVisualizer->RenderHeatmap(backBuffer, m_repaintHeatmap);
+        }
+        if (visualizeDirtyRegions)
+        {
+            if (motion != nullptr)
+            {
+                m_dirtyRegionVisualizer->RenderMotion(backBuffer, *motion);
+            }
+            else
+            {
+                m_dirtyRegionVisualizer->Render(backBuffer, frame);
+            }
         }
     }
 
+    // The frame is closed now, its buffer is back in the pool
+    auto frameReleaseTime = GetSystemRelativeTime();
+
     DXGI_PRESENT_PARAMETERS presentParameters{};
     m_swapChain->Present1(1, 0, &presentParameters);
 
     swapChainResizedToFrame = swapChainResizedToFrame || TryUpdatePixelFormat();
 
-    if (swapChainResizedToFrame)
+    auto bufferCount = m_framePoolBufferCountUpdate.exchange(std::nullopt);
+    if (m_autoTuneFramePool.load())
     {
-        m_framePool.Recreate(m_device, m_pixelFormat, 2, m_lastSize);
+        auto tunedCount = m_framePoolTuner->OnFrame(frameTime, frameReleaseTime);
+        if (tunedCount.has_value())
+        {
+            bufferCount = tunedCount;
+        }
+    }
+    auto bufferCountChanged = bufferCount.has_value() && bufferCount.value() != m_framePoolBufferCount.load();
+
+    if (swapChainResizedToFrame || bufferCountChanged)
+    {
+        if (bufferCountChanged)
+        {
+            m_framePoolBufferCount.store(bufferCount.value());
+        }
+        m_framePool.Recreate(m_device, m_pixelFormat, m_framePoolBufferCount.load(), m_bufferSize);
+        m_framePoolTuner->Reset(m_framePoolBufferCount.load(), GetFramePoolBufferBytes());
     }
 }
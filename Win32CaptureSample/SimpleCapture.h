@@ -1,5 +1,19 @@
 #pragma once
 #include "DirtyRegionVisualizer.h"
+#include "CaptureResizePolicy.h"
+#include "FrameMotionTracker.h"
+#include "CpuFrameReader.h"
+#include "ReplayBuffer.h"
+#include "ChangeTrigger.h"
+#include "DamageTracker.h"
+#include "FramePoolTuner.h"
+#include "PipelineWorker.h"
+#include "FrameRedactor.h"
+#include "LatencyMeter.h"
+#include "LatestFrameCache.h"
+
+// The same clock as Direct3D11CaptureFrame::SystemRelativeTime
+winrt::Windows::Foundation::TimeSpan GetSystemRelativeTime();
 
 class SimpleCapture
 {
@@ -34,13 +48,98 @@ public:
 
     bool VisualizeDirtyRegions() { CheckClosed(); return m_visualizeDirtyRegions.load(); }
     void VisualizeDirtyRegions(bool value);
+    // Only has an effect while dirty regions are being visualized
+    bool DetectScrolling() { CheckClosed(); return m_detectScrolling.load(); }
+    void DetectScrolling(bool value) { CheckClosed(); m_detectScrolling.store(value); }
+    // Tracks how often each part of the content gets repainted and draws it
+    // over the preview. Needs dirty regions, turning it off starts over.
+    bool ShowRepaintHeatmap() { CheckClosed(); return m_showRepaintHeatmap.load(); }
+    void ShowRepaintHeatmap(bool value);
+    std::vector<RepaintHotspot> RepaintHotspots(float minRate = 1.0f, size_t maxCount = 16);
+    // Keeps the last few seconds of BGRA8 frames in memory
+    bool KeepReplay() { CheckClosed(); return m_keepReplay.load(); }
+    void KeepReplay(bool value);
+    std::vector<std::shared_ptr<ReplayFrame const>> ReplayFrames() { CheckClosed(); return m_replayBuffer->Frames(); }
+    // Calls the handler with a staging copy of the frame whenever the content
+    // changed enough to be worth a snapshot. Only BGRA8 frames are looked at.
+    // The handler is called from the thread pool, pass nullptr to stop.
+    void SnapshotOnChange(
+        std::function<void(winrt::com_ptr<ID3D11Texture2D> const&)> handler,
+        ChangeTriggerSettings const& settings = {});
+
+    // Hides these parts of every frame before it's shown or handed out, in
+    // pixels of the captured content. Frames that aren't BGRA8 can't be
+    // blurred or pixelated, so the regions are blacked out in the preview and
+    // they aren't kept for snapshots.
+    void RedactionRegions(std::vector<RedactionRegion> const& regions);
+    // Also blurs the password fields of this window, which should be the one
+    // being captured. They're looked for again whenever a frame repaints one
+    // of them or a child of the window is shown, hidden or moved, and every
+    // so often in case we missed something. Call on a thread with a message
+    // loop, and close on that same thread. Pass nullptr to stop.
+    void RedactPasswordFields(HWND window);
+
+    // Looks for the marker of a LatencyMeter inside of these bounds in every
+    // BGRA8 frame, in pixels of the captured content. Pass nullopt to stop.
+    // Starting again starts over.
+    void MeasureLatency(std::optional<RECT> const& markerBounds);
+    // Call as soon as an input event comes in. Returns the phase to flash the
+    // marker to, or nullopt if the input is ignored.
+    std::optional<MarkerPhase> OnLatencyInput(winrt::Windows::Foundation::TimeSpan timestamp);
+    LatencyReport MeasuredLatency();
+
+    // How many buffers the frame pool has. Setting a count turns off tuning.
+    uint32_t FramePoolBufferCount() { CheckClosed(); return m_framePoolBufferCount.load(); }
+    void FramePoolBufferCount(uint32_t value);
+    // Adds buffers when frames get dropped because all of them are held on
+    // to, and takes them away again when they go unused.
+    bool AutoTuneFramePool() { CheckClosed(); return m_autoTuneFramePool.load(); }
+    void AutoTuneFramePool(bool value) { CheckClosed(); m_autoTuneFramePool.store(value); }
 
     winrt::Windows::Foundation::TimeSpan MinUpdateInterval() { CheckClosed(); return m_session.MinUpdateInterval(); }
     void MinUpdateInterval(winrt::Windows::Foundation::TimeSpan value) { CheckClosed(); m_session.MinUpdateInterval(value); }
 
+    // Called when we know the item changed size (e.g. a display mode change) so
+    // that we don't have to wait for a mismatched frame to find out.
+    void ResizeToItemSize()
+    {
+        CheckClosed();
+        auto newSize = std::optional(m_item.Size());
+        m_itemSizeUpdate.exchange(newSize);
+    }
+
+    // Returns a staging copy of the most recent frame if we have one in the
+    // requested format, otherwise nullptr. Safe to call from any thread.
+    winrt::com_ptr<ID3D11Texture2D> TryGetLatestFrame(winrt::Windows::Graphics::DirectX::DirectXPixelFormat pixelFormat);
+
     void Close();
 
 private:
+    struct LatestFrame
+    {
+        winrt::com_ptr<ID3D11Texture2D> Texture;
+        winrt::Windows::Graphics::DirectX::DirectXPixelFormat PixelFormat;
+    };
+
+    struct LatestFrameCopy
+    {
+        winrt::com_ptr<ID3D11Texture2D> Texture;
+        winrt::Windows::Graphics::DirectX::DirectXPixelFormat PixelFormat;
+    };
+
+    // What the frame pool's thread hands to the workers. Workers that got the
+    // same frame share the pixels, but each has its own dirty rects. Already
+    // in the portable types the replay buffer and the change trigger take.
+    struct CpuFrame
+    {
+        Ticks Time = {};
+        std::shared_ptr<std::vector<uint8_t> const> Pixels;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t Stride = 0;
+        std::optional<std::vector<PixelRect>> DirtyRects;
+    };
+
     void OnFrameArrived(
         winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool const& sender,
         winrt::Windows::Foundation::IInspectable const& args);
@@ -54,15 +153,54 @@ private:
     }
 
     void ResizeSwapChain();
+    void UpdateSwapChainSourceSize();
+    void UpdateLatestFrame(winrt::com_ptr<ID3D11Texture2D> const& surfaceTexture, uint32_t width, uint32_t height, bool redact);
     bool TryResizeSwapChain(winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame const& frame);
+    void ScheduleResizeSettle();
+    static void CALLBACK OnResizeTimer(PTP_CALLBACK_INSTANCE, void* context, PTP_TIMER);
+    void ShrinkSettledSwapChain();
     bool TryUpdatePixelFormat();
+    bool TryUpdateItemSize();
+    winrt::com_ptr<ID3D11Texture2D> CopyLatestFrame(winrt::Windows::Graphics::DirectX::DirectXPixelFormat pixelFormat);
+    static void CALLBACK OnPasswordFieldWindowEvent(HWINEVENTHOOK eventHook, DWORD event, HWND hwnd, LONG objectId, LONG childId, DWORD eventThreadId, DWORD eventTimeInMilliseconds);
+    void UpdateRedactionRegions(winrt::Windows::Foundation::TimeSpan frameTime, std::optional<std::vector<RECT>> const& dirtyRects);
+    void PrepareRedaction(uint32_t width, uint32_t height, DXGI_FORMAT format, std::optional<std::vector<RECT>>& dirtyRects);
+    void UpdateRedaction(winrt::com_ptr<ID3D11Texture2D> const& surfaceTexture, uint32_t width, uint32_t height, std::vector<uint8_t> const* framePixels);
+    void RedactTexture(winrt::com_ptr<ID3D11Texture2D> const& texture, uint32_t width, uint32_t height);
+    void BlackOutRedactions(winrt::com_ptr<ID3D11Texture2D> const& texture);
+    void DetectLatencyMarker(
+        winrt::com_ptr<ID3D11Texture2D> const& surfaceTexture,
+        uint32_t width,
+        uint32_t height,
+        DXGI_FORMAT format,
+        std::optional<std::vector<RECT>> const& dirtyRects,
+        winrt::Windows::Foundation::TimeSpan frameTime,
+        winrt::Windows::Foundation::TimeSpan arrivalTime,
+        std::vector<uint8_t> const* framePixels);
+    void CreatePipeline();
+    void OnReplayFrame(CpuFrame const& frame);
+    void OnChangeTriggerFrame(CpuFrame const& frame);
+    std::shared_ptr<std::vector<uint8_t>> GetPipelineBuffer();
+    void OnChangeTriggered();
+    void ScheduleChangeTriggerPoll();
+    static void CALLBACK OnChangeTriggerTimer(PTP_CALLBACK_INSTANCE, void* context, PTP_TIMER);
+    uint64_t GetFramePoolBufferBytes();
+    std::optional<std::vector<RECT>> GetDirtyRects(winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame const& frame);
     DXGI_COLOR_SPACE_TYPE GetColorSpaceFromPixelFormat(DXGI_FORMAT format);
 
 private:
     winrt::Windows::Graphics::Capture::GraphicsCaptureItem m_item{ nullptr };
     winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool m_framePool{ nullptr };
     winrt::Windows::Graphics::Capture::GraphicsCaptureSession m_session{ nullptr };
+    // m_lastSize is the size of the content, m_bufferSize is the size
+    // the swap chain and frame pool buffers were allocated with.
     winrt::Windows::Graphics::SizeInt32 m_lastSize;
+    winrt::Windows::Graphics::SizeInt32 m_bufferSize;
+    CaptureResizePolicy m_resizePolicy;
+    // Shrinks the buffers once a resize settles, there may not be another
+    // frame to do it. Frames and the timer take turns with the lock.
+    std::mutex m_frameLock;
+    wil::unique_threadpool_timer m_resizeTimer;
 
     winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice m_device{ nullptr };
     winrt::com_ptr<IDXGISwapChain3> m_swapChain{ nullptr };
@@ -72,8 +210,80 @@ private:
 
     std::atomic<std::optional<winrt::Windows::Graphics::DirectX::DirectXPixelFormat>> m_pixelFormatUpdate = std::nullopt;
 
+    std::atomic<std::optional<winrt::Windows::Graphics::SizeInt32>> m_itemSizeUpdate = std::nullopt;
+
+    std::atomic<uint32_t> m_framePoolBufferCount = 0;
+    std::atomic<std::optional<uint32_t>> m_framePoolBufferCountUpdate = std::nullopt;
+    std::atomic<bool> m_autoTuneFramePool = false;
+    // Only used on the frame pool's thread
+    std::unique_ptr<FramePoolTuner> m_framePoolTuner;
+
     std::atomic<bool> m_closed = false;
 
+    // Updated on the frame pool's thread, read from whoever wants a snapshot
+    LatestFrameCache<LatestFrame, LatestFrameCopy> m_latestFrame;
+
     std::shared_ptr<DirtyRegionVisualizer> m_dirtyRegionVisualizer;
     std::atomic<bool> m_visualizeDirtyRegions = false;
+    std::unique_ptr<CpuFrameReader> m_frameReader;
+    // Set from the UI thread, picked up on the frame pool's thread
+    std::atomic<std::shared_ptr<std::vector<RedactionRegion> const>> m_redactionRegions;
+    std::atomic<HWND> m_passwordFieldWindow = nullptr;
+    // Set by WinEvents on the UI thread when the window's layout changed
+    wil::unique_hwineventhook m_passwordFieldHook;
+    std::atomic<bool> m_passwordFieldsMoved = false;
+    // Only used on the frame pool's thread. The redacted pixels are kept
+    // in a texture the size of the frame and copied over every frame.
+    FrameRedactor m_redactor;
+    bool m_redactionPending = false;
+    std::vector<uint8_t> m_redactionPixels;
+    winrt::com_ptr<ID3D11Texture2D> m_redactionTexture;
+    HWND m_passwordFieldSearchWindow = nullptr;
+    winrt::Windows::Foundation::TimeSpan m_lastPasswordFieldSearch = {};
+    std::vector<RECT> m_passwordFields;
+    // Where the fields were before they last moved
+    std::vector<RECT> m_movedPasswordFields;
+    winrt::Windows::Foundation::TimeSpan m_passwordFieldsMovedTime = {};
+    // Input comes in on the UI thread, frames on the frame pool's thread
+    std::mutex m_latencyLock;
+    std::optional<MarkerDetector> m_markerDetector;
+    LatencyMeter m_latencyMeter;
+    // Only used on the frame pool's thread. The marker can only change where
+    // something was drawn, so we remember what it looked like last time.
+    std::vector<uint8_t> m_markerPixels;
+    std::optional<MarkerPhase> m_lastMarkerPhase;
+    RECT m_lastMarkerBounds = {};
+    winrt::Windows::Graphics::SizeInt32 m_lastMarkerFrameSize = {};
+    // The replay buffer and the change trigger run on these rather than on
+    // the frame pool's thread. When they fall behind, frames are skipped for
+    // them and their damage piles up until they can take another.
+    std::unique_ptr<PipelineWorker> m_replayWorker;
+    std::unique_ptr<PipelineWorker> m_changeTriggerWorker;
+    // Pixels the workers are done with. Buffers come back here when the
+    // last frame using them goes away, which can be after we're gone.
+    struct PipelineBufferList
+    {
+        std::mutex Lock;
+        std::vector<std::unique_ptr<std::vector<uint8_t>>> Buffers;
+    };
+    std::shared_ptr<PipelineBufferList> m_pipelineBuffers;
+    // Consumers below don't see every frame (e.g. while the pixel format is
+    // something they can't use), so they take what changed from here.
+    DamageTracker m_damageTracker;
+    size_t m_replayDamage = 0;
+    size_t m_changeTriggerDamage = 0;
+    FrameMotionTracker m_motionTracker;
+    std::atomic<bool> m_detectScrolling = false;
+    // Updated and drawn on the frame pool's thread, reported from the UI thread
+    std::mutex m_repaintHeatmapLock;
+    RepaintHeatmap m_repaintHeatmap;
+    std::atomic<bool> m_showRepaintHeatmap = false;
+    std::unique_ptr<ReplayBuffer> m_replayBuffer;
+    std::atomic<bool> m_keepReplay = false;
+    // Guards the trigger and the handler, the timer polls from the thread pool
+    std::mutex m_changeTriggerLock;
+    std::unique_ptr<ChangeTrigger> m_changeTrigger;
+    std::function<void(winrt::com_ptr<ID3D11Texture2D> const&)> m_changeHandler;
+    wil::unique_threadpool_timer m_changeTriggerTimer;
+    std::atomic<bool> m_snapshotOnChange = false;
 };
\ No newline at end of file
@@ -0,0 +1,384 @@
+#include "pch.h"
+#include "SnapshotEncoder.h"
+#include "ScreenTileCodec.h"
+#include "PaletteIndexer.h"
+#include "Hdr10Converter.h"
+#include "ExrWriter.h"
+#include "StridedCopy.h"
+#include "EncodeProgress.h"
+
+namespace winrt
+{
+    using namespace Windows::Foundation;
+    using namespace Windows::Storage;
+    using namespace Windows::Storage::Streams;
+}
+
+namespace util
+{
+    using namespace robmikh::common::uwp;
+}
+
+// Rows written per WritePixels call. Small enough to report progress and
+// notice cancellation often, large enough not to matter for throughput.
+uint32_t const RowsPerChunk = 128;
+
+struct IndexedPixels
+{
+    std::vector<uint32_t> Colors;
+    FrameBuffer Indices;
+};
+
+// Gives up as soon as we see more colors than fit in a palette. Only
+// images that fit pay for the indices.
+std::optional<IndexedPixels> TryIndexPixels(FrameBufferPool& buffers, uint8_t const* bytes, uint32_t width, uint32_t height, uint32_t stride)
+{
+    PaletteIndexer palette;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        auto pixels = reinterpret_cast<uint32_t const*>(bytes + static_cast<size_t>(y) * stride);
+        if (!palette.TryAddRange(pixels, width))
+        {
+            return std::nullopt;
+        }
+    }
+
+    // Every color is in the palette by now, so this can't fail
+    IndexedPixels result;
+    result.Indices = buffers.Acquire(width, height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        auto pixels = reinterpret_cast<uint32_t const*>(bytes + static_cast<size_t>(y) * stride);
+        auto indices = result.Indices.Data() + static_cast<size_t>(y) * result.Indices.Stride();
+        palette.TryIndexRange(pixels, width, indices);
+    }
+    result.Colors = palette.Colors();
+    return result;
+}
+
+// PNG can't hold 10 bits per channel, so HDR10 pixels get widened to 16
+FrameBuffer ConvertToHdr10Rgb48(FrameBufferPool& buffers, uint8_t const* bytes, uint32_t width, uint32_t height, uint32_t stride)
+{
+    // The converter packs them tightly, which always fits
+    auto packedBuffer = buffers.Acquire(width * 4, height);
+    auto packed = reinterpret_cast<uint32_t const*>(packedBuffer.Data());
+    Hdr10Converter::Convert(bytes, width, height, stride, reinterpret_cast<uint32_t*>(packedBuffer.Data()));
+
+    auto result = buffers.Acquire(width * 3 * sizeof(uint16_t), height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        auto pixels = packed + static_cast<size_t>(y) * width;
+        auto channels = reinterpret_cast<uint16_t*>(result.Data() + static_cast<size_t>(y) * result.Stride());
+        for (uint32_t x = 0; x < width; x++)
+        {
+            for (uint32_t channel = 0; channel < 3; channel++)
+            {
+                auto code = static_cast<uint16_t>((pixels[x] >> (channel * 10)) & 0x3ff);
+                channels[x * 3 + channel] = static_cast<uint16_t>((code << 6) | (code >> 4));
+            }
+        }
+    }
+    return result;
+}
+
+uint32_t ComputePngCrc(std::span<uint8_t const> bytes)
+{
+    static auto const table = []()
+    {
+        std::array<uint32_t, 256> table = {};
+        for (uint32_t i = 0; i < table.size(); i++)
+        {
+            auto value = i;
+            for (auto bit = 0; bit < 8; bit++)
+            {
+                value = (value & 1) ? 0xedb88320 ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+
+    uint32_t crc = 0xffffffff;
+    for (auto&& value : bytes)
+    {
+        crc = table[(crc ^ value) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+// WIC doesn't know about the cICP chunk, which is how a PNG says its pixels
+// are BT.2020 primaries with the PQ curve. It has to come before the image
+// data, so we put it right after the header.
+winrt::com_ptr<IStream> AddHdr10PngChunk(winrt::com_ptr<IStream> const& pngStream)
+{
+    HGLOBAL global = nullptr;
+    winrt::check_hresult(GetHGlobalFromStream(pngStream.get(), &global));
+    STATSTG stats = {};
+    winrt::check_hresult(pngStream->Stat(&stats, STATFLAG_NONAME));
+    std::vector<uint8_t> png(static_cast<size_t>(stats.cbSize.QuadPart));
+    {
+        auto data = GlobalLock(global);
+        auto unlock = wil::scope_exit([&]()
+        {
+            GlobalUnlock(global);
+        });
+        memcpy(png.data(), data, png.size());
+    }
+
+    // Signature (8) and the IHDR chunk (4 length, 4 type, 13 data, 4 crc)
+    size_t const headerSize = 33;
+    if (png.size() < headerSize || memcmp(png.data() + 12, "IHDR", 4) != 0)
+    {
+        throw winrt::hresult_error(E_FAIL, L"Unexpected PNG layout!");
+    }
+
+    // Primaries: BT.2020 (9), transfer: PQ (16), matrix: RGB (0), full range (1)
+    std::array<uint8_t, 12> chunk = { 0, 0, 0, 4, 'c', 'I', 'C', 'P', 9, 16, 0, 1 };
+    auto crc = ComputePngCrc(std::span(chunk).subspan(4));
+    std::array<uint8_t, 4> crcBytes = { static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16), static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc) };
+
+    winrt::com_ptr<IStream> result;
+    winrt::check_hresult(CreateStreamOnHGlobal(nullptr, TRUE, result.put()));
+    winrt::check_hresult(result->Write(png.data(), static_cast<ULONG>(headerSize), nullptr));
+    winrt::check_hresult(result->Write(chunk.data(), static_cast<ULONG>(chunk.size()), nullptr));
+    winrt::check_hresult(result->Write(crcBytes.data(), static_cast<ULONG>(crcBytes.size()), nullptr));
+    winrt::check_hresult(result->Write(png.data() + headerSize, static_cast<ULONG>(png.size() - headerSize), nullptr));
+    return result;
+}
+
+SnapshotEncoder::SnapshotEncoder(uint32_t maxConcurrentEncodes) :
+    // An encode can be holding the pixels it read back and a converted copy
+    m_buffers(2 * static_cast<size_t>(std::max(maxConcurrentEncodes, 1u))),
+    m_encodeSlots(maxConcurrentEncodes)
+{
+    m_wicFactory = util::CreateWICFactory();
+}
+
+winrt::IAsyncActionWithProgress<double> SnapshotEncoder::EncodeAsync(
+    winrt::com_ptr<ID3D11Texture2D> texture,
+    winrt::StorageFile file,
+    winrt::guid fileFormatGuid,
+    winrt::guid bitmapPixelFormat)
+{
+    // Canceled encodes still run until their next check, which can be after
+    // whoever started them is gone
+    auto strongThis = shared_from_this();
+    auto cancellation = co_await winrt::get_cancellation_token();
+    cancellation.enable_propagation();
+    auto progressToken = co_await winrt::get_progress_token();
+    EncodeProgress progress([&](double value) { progressToken(value); }, [&]() { return cancellation(); });
+
+    // Get off of the caller's thread before waiting for a free slot
+    co_await winrt::resume_background();
+    wil::shared_event slotAcquired(wil::EventOptions::ManualReset);
+    m_encodeSlots.Acquire([slotAcquired]() { slotAcquired.SetEvent(); });
+    co_await winrt::resume_on_signal(slotAcquired.get());
+    auto releaseSlot = wil::scope_exit([&]()
+    {
+        m_encodeSlots.Release();
+    });
+    if (!progress.Started())
+    {
+        co_return;
+    }
+
+    // Read the pixels back from the GPU
+    D3D11_TEXTURE2D_DESC desc = {};
+    texture->GetDesc(&desc);
+    auto frameBuffer = ReadPixels(texture);
+    // Whichever buffer holds the pixels we're going to encode
+    auto pixels = frameBuffer.Data();
+    FrameBuffer convertedBuffer;
+    auto bytesPerPixel = util::GetBytesPerPixel(desc.Format);
+    auto stride = frameBuffer.Stride();
+    auto bufferSize = stride * desc.Height;
+    if (!progress.ReadBack())
+    {
+        co_return;
+    }
+
+    // Encode into memory first, that way canceling doesn't leave
+    // a half written image behind.
+    winrt::com_ptr<IStream> memoryStream;
+    winrt::check_hresult(CreateStreamOnHGlobal(nullptr, TRUE, memoryStream.put()));
+
+    if (fileFormatGuid == ScreenTileCodec::ContainerFormat)
+    {
+        // Not a WIC format, this one we encode ourselves
+        if (desc.Format != DXGI_FORMAT_B8G8R8A8_UNORM)
+        {
+            throw winrt::hresult_error(E_FAIL, L"Unsupported pixel format!");
+        }
+        auto encoded = ScreenTileCodec::Encode(pixels, desc.Width, desc.Height, stride, true);
+        winrt::check_hresult(memoryStream->Write(encoded.data(), static_cast<ULONG>(encoded.size()), nullptr));
+    }
+    else if (fileFormatGuid == ExrWriter::ContainerFormat)
+    {
+        // Also ours, WIC doesn't have an EXR encoder
+        if (desc.Format != DXGI_FORMAT_R16G16B16A16_FLOAT)
+        {
+            throw winrt::hresult_error(E_FAIL, L"Unsupported pixel format!");
+        }
+        auto encoded = ExrWriter::Encode(pixels, desc.Width, desc.Height, stride);
+        winrt::check_hresult(memoryStream->Write(encoded.data(), static_cast<ULONG>(encoded.size()), nullptr));
+    }
+    else
+    {
+        // HDR10 is written as a 16-bit PNG that's tagged as PQ
+        auto isHdr10 = bitmapPixelFormat == winrt::guid(GUID_WICPixelFormat32bppRGBA1010102);
+        if (isHdr10)
+        {
+            if (desc.Format != DXGI_FORMAT_R16G16B16A16_FLOAT || fileFormatGuid != winrt::guid(GUID_ContainerFormatPng))
+            {
+                throw winrt::hresult_error(E_FAIL, L"Unsupported pixel format!");
+            }
+            convertedBuffer = ConvertToHdr10Rgb48(m_buffers, pixels, desc.Width, desc.Height, stride);
+            pixels = convertedBuffer.Data();
+            bitmapPixelFormat = GUID_WICPixelFormat48bppRGB;
+            bytesPerPixel = 6;
+            stride = convertedBuffer.Stride();
+            bufferSize = stride * desc.Height;
+        }
+
+        // Initialize the encoder
+        winrt::com_ptr<IWICBitmapEncoder> encoder;
+        winrt::check_hresult(m_wicFactory->CreateEncoder(fileFormatGuid, nullptr, encoder.put()));
+        winrt::check_hresult(encoder->Initialize(memoryStream.get(), WICBitmapEncoderNoCache));
+        winrt::com_ptr<IWICBitmapFrameEncode> frame;
+        winrt::com_ptr<IPropertyBag2> props;
+        winrt::check_hresult(encoder->CreateNewFrame(frame.put(), props.put()));
+
+        // Encode the image
+        winrt::check_hresult(frame->Initialize(props.get()));
+        winrt::check_hresult(frame->SetSize(desc.Width, desc.Height));
+
+        // Screenshots of most apps don't use many colors. If this one has 256 or
+        // fewer, an indexed PNG is a lot smaller and faster to write.
+        std::optional<IndexedPixels> indexedPixels;
+        if (fileFormatGuid == winrt::guid(GUID_ContainerFormatPng) && desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM)
+        {
+            indexedPixels = TryIndexPixels(m_buffers, pixels, desc.Width, desc.Height, stride);
+        }
+
+        winrt::guid targetFormat = indexedPixels.has_value() ? winrt::guid(GUID_WICPixelFormat8bppIndexed) : bitmapPixelFormat;
+        winrt::check_hresult(frame->SetPixelFormat(reinterpret_cast<WICPixelFormatGUID*>(&targetFormat)));
+        if (indexedPixels.has_value() && targetFormat == winrt::guid(GUID_WICPixelFormat8bppIndexed))
+        {
+            // WICColor is 0xAARRGGBB, which is what BGRA pixels look like as a uint32_t
+            winrt::com_ptr<IWICPalette> palette;
+            winrt::check_hresult(m_wicFactory->CreatePalette(palette.put()));
+            winrt::check_hresult(palette->InitializeCustom(indexedPixels->Colors.data(), static_cast<uint32_t>(indexedPixels->Colors.size())));
+            winrt::check_hresult(frame->SetPalette(palette.get()));
+
+            pixels = indexedPixels->Indices.Data();
+            bytesPerPixel = 1;
+            stride = indexedPixels->Indices.Stride();
+            bufferSize = stride * desc.Height;
+        }
+        else if (targetFormat != bitmapPixelFormat)
+        {
+            // We must convert the image, but we should only really be converting to a single format.
+            if (targetFormat != winrt::guid(GUID_WICPixelFormat24bppBGR))
+            {
+                throw winrt::hresult_error(E_FAIL, L"Unsupported pixel format!");
+            }
+            uint32_t convertedBytesPerPixel = 3;
+            convertedBuffer = m_buffers.Acquire(convertedBytesPerPixel * desc.Width, desc.Height);
+            uint32_t convertedStride = convertedBuffer.Stride();
+            uint32_t convertedBufferSize = convertedStride * desc.Height;
+
+            winrt::com_ptr<IWICFormatConverter> converter;
+            winrt::check_hresult(m_wicFactory->CreateFormatConverter(converter.put()));
+            winrt::com_ptr<IWICBitmap> bitmap;
+            winrt::check_hresult(m_wicFactory->CreateBitmapFromMemory(desc.Width, desc.Height, bitmapPixelFormat, stride, bufferSize, pixels, bitmap.put()));
+
+            winrt::check_hresult(converter->Initialize(bitmap.get(), targetFormat, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeMedianCut));
+
+            winrt::check_hresult(converter->CopyPixels(nullptr, convertedStride, convertedBufferSize, convertedBuffer.Data()));
+            pixels = convertedBuffer.Data();
+            bytesPerPixel = convertedBytesPerPixel;
+            stride = convertedStride;
+            bufferSize = convertedBufferSize;
+        }
+        if (!progress.Prepared())
+        {
+            co_return;
+        }
+        // TODO: Metadata
+
+        for (uint32_t row = 0; row < desc.Height; row += RowsPerChunk)
+        {
+            auto rows = std::min(RowsPerChunk, desc.Height - row);
+            winrt::check_hresult(frame->WritePixels(rows, stride, rows * stride, pixels + static_cast<size_t>(row) * stride));
+            if (!progress.WroteRows(row + rows, desc.Height))
+            {
+                co_return;
+            }
+        }
+        winrt::check_hresult(frame->Commit());
+        winrt::check_hresult(encoder->Commit());
+
+        if (isHdr10)
+        {
+            memoryStream = AddHdr10PngChunk(memoryStream);
+        }
+    }
+    if (!progress.Encoded())
+    {
+        co_return;
+    }
+
+    // Copy the encoded image to the file
+    STATSTG stats = {};
+    winrt::check_hresult(memoryStream->Stat(&stats, STATFLAG_NONAME));
+    winrt::check_hresult(memoryStream->Seek({}, STREAM_SEEK_SET, nullptr));
+    {
+        auto randomAccessStream = co_await file.OpenAsync(winrt::FileAccessMode::ReadWrite);
+        // The file may already exist and be larger than the new image
+        randomAccessStream.Size(0);
+        auto streamUnknown = randomAccessStream.as<IUnknown>();
+        winrt::com_ptr<IStream> stream;
+        winrt::check_hresult(CreateStreamOverRandomAccessStream(streamUnknown.get(), winrt::guid_of<IStream>(), stream.put_void()));
+        winrt::check_hresult(memoryStream->CopyTo(stream.get(), stats.cbSize, nullptr, nullptr));
+    }
+    progress.Saved();
+}
+
+FrameBuffer SnapshotEncoder::ReadPixels(winrt::com_ptr<ID3D11Texture2D> const& texture)
+{
+    D3D11_TEXTURE2D_DESC desc = {};
+    texture->GetDesc(&desc);
+    winrt::com_ptr<ID3D11Device> d3dDevice;
+    texture->GetDevice(d3dDevice.put());
+    winrt::com_ptr<ID3D11DeviceContext> d3dContext;
+    d3dDevice->GetImmediateContext(d3dContext.put());
+
+    // A new buffer takes a while to fault in, don't hold up other readbacks
+    auto rowBytes = static_cast<uint32_t>(util::GetBytesPerPixel(desc.Format)) * desc.Width;
+    auto bytes = m_buffers.Acquire(rowBytes, desc.Height);
+
+    auto lock = std::scoped_lock(m_readbackLock);
+
+    // Snapshots are usually staging copies already
+    auto stagingTexture = texture;
+    if (desc.Usage != D3D11_USAGE_STAGING || (desc.CPUAccessFlags & D3D11_CPU_ACCESS_READ) == 0)
+    {
+        auto stagingDesc = desc;
+        stagingDesc.Usage = D3D11_USAGE_STAGING;
+        stagingDesc.BindFlags = 0;
+        stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        stagingDesc.MiscFlags = 0;
+        stagingTexture = nullptr;
+        winrt::check_hresult(d3dDevice->CreateTexture2D(&stagingDesc, nullptr, stagingTexture.put()));
+        d3dContext->CopyResource(stagingTexture.get(), texture.get());
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    winrt::check_hresult(d3dContext->Map(stagingTexture.get(), 0, D3D11_MAP_READ, 0, &mapped));
+    auto unmap = wil::scope_exit([&]()
+    {
+        d3dContext->Unmap(stagingTexture.get(), 0);
+    });
+    StridedCopy::Copy(reinterpret_cast<uint8_t const*>(mapped.pData), mapped.RowPitch, bytes.Data(), bytes.Stride(), rowBytes, desc.Height);
+    return bytes;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include "FrameBufferPool.h"
+#include "EncodeSlots.h"
+
+// Encodes snapshots on the thread pool so large captures don't freeze the
+// UI. At most maxConcurrentEncodes run at once, the rest wait their turn.
+// The returned operation reports progress from 0 to 1 and can be canceled,
+// in which case the file is left untouched. Encodes keep the encoder alive
+// until they finish, so it has to be created with std::make_shared.
+class SnapshotEncoder : public std::enable_shared_from_this<SnapshotEncoder>
+{
+public:
+    SnapshotEncoder(uint32_t maxConcurrentEncodes = 2);
+    ~SnapshotEncoder() {}
+
+    winrt::Windows::Foundation::IAsyncActionWithProgress<double> EncodeAsync(
+        winrt::com_ptr<ID3D11Texture2D> texture,
+        winrt::Windows::Storage::StorageFile file,
+        winrt::guid fileFormatGuid,
+        winrt::guid bitmapPixelFormat);
+
+private:
+    FrameBuffer ReadPixels(winrt::com_ptr<ID3D11Texture2D> const& texture);
+
+private:
+    winrt::com_ptr<IWICImagingFactory2> m_wicFactory;
+    EncodeSlots m_encodeSlots;
+    // Readback goes through the immediate context, so only one encode
+    // does it at a time.
+    std::mutex m_readbackLock;
+    // Most snapshots are the same size as the one before. Reusing their
+    // memory saves faulting in and zeroing new buffers, which takes several
+    // times longer than the copy.
+    FrameBufferPool m_buffers;
+};
\ No newline at end of file
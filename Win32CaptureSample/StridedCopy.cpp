@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "StridedCopy.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define STRIDED_COPY_STREAMING
+#endif
+
+size_t const StridedCopy::ParallelThreshold = 4 * 1024 * 1024;
+size_t const StridedCopy::StreamingThreshold = 32 * 1024 * 1024;
+// Big enough that handing a band to the thread pool costs next to nothing
+size_t const BytesPerBand = 1024 * 1024;
+
+void CopyRows(
+    uint8_t const* source,
+    size_t sourceStride,
+    uint8_t* destination,
+    size_t destinationStride,
+    size_t rowBytes,
+    uint32_t rows)
+{
+    if (sourceStride == rowBytes && destinationStride == rowBytes)
+    {
+        memcpy(destination, source, rowBytes * rows);
+        return;
+    }
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        memcpy(destination + y * destinationStride, source + y * sourceStride, rowBytes);
+    }
+}
+
+#ifdef STRIDED_COPY_STREAMING
+void StreamBytes(uint8_t const* source, uint8_t* destination, size_t bytes)
+{
+    // Non-temporal stores have to be aligned
+    auto head = std::min(bytes, (16 - (reinterpret_cast<uintptr_t>(destination) & 15)) & 15);
+    memcpy(destination, source, head);
+    source += head;
+    destination += head;
+    bytes -= head;
+
+    auto body = bytes & ~size_t(63);
+    for (size_t i = 0; i < body; i += 64)
+    {
+        auto first = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+        auto second = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i + 16));
+        auto third = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i + 32));
+        auto fourth = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i), first);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 16), second);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 32), third);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + i + 48), fourth);
+    }
+    memcpy(destination + body, source + body, bytes - body);
+}
+
+void StreamRows(
+    uint8_t const* source,
+    size_t sourceStride,
+    uint8_t* destination,
+    size_t destinationStride,
+    size_t rowBytes,
+    uint32_t rows)
+{
+    if (sourceStride == rowBytes && destinationStride == rowBytes)
+    {
+        StreamBytes(source, destination, rowBytes * rows);
+    }
+    else
+    {
+        for (uint32_t y = 0; y < rows; y++)
+        {
+            StreamBytes(source + y * sourceStride, destination + y * destinationStride, rowBytes);
+        }
+    }
+    // Non-temporal stores aren't ordered with anything else, make sure
+    // they're done before whoever waits on us reads the destination.
+    _mm_sfence();
+}
+#endif
+
+void StridedCopy::Copy(
+    uint8_t const* source,
+    size_t sourceStride,
+    uint8_t* destination,
+    size_t destinationStride,
+    size_t rowBytes,
+    uint32_t rows)
+{
+    auto totalBytes = rowBytes * rows;
+    if (totalBytes == 0)
+    {
+        return;
+    }
+
+    auto copyRows = CopyRows;
+#ifdef STRIDED_COPY_STREAMING
+    if (totalBytes >= StreamingThreshold)
+    {
+        copyRows = StreamRows;
+    }
+#endif
+    if (totalBytes < ParallelThreshold)
+    {
+        copyRows(source, sourceStride, destination, destinationStride, rowBytes, rows);
+        return;
+    }
+
+    auto rowsPerBand = static_cast<uint32_t>(std::max<size_t>(BytesPerBand / rowBytes, 1));
+    std::vector<uint32_t> bands((rows + rowsPerBand - 1) / rowsPerBand);
+    std::iota(bands.begin(), bands.end(), 0);
+    std::for_each(std::execution::par, bands.begin(), bands.end(), [&](uint32_t band)
+    {
+        auto firstRow = band * rowsPerBand;
+        auto bandRows = std::min(rowsPerBand, rows - firstRow);
+        copyRows(
+            source + firstRow * sourceStride,
+            sourceStride,
+            destination + firstRow * destinationStride,
+            destinationStride,
+            rowBytes,
+            bandRows);
+    });
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+// Copies rows between buffers that space them differently, e.g. out of a
+// mapped staging texture into tightly packed pixels. Large copies are split
+// into bands of rows that are copied on the thread pool. Very large ones
+// also use non-temporal stores (on x64), so that a frame bigger than the
+// cache doesn't push everything else out of it on the way through.
+//
+// Reuse the destination between copies where possible. Fresh memory has to
+// be faulted in first, which costs about as much as the copy itself.
+class StridedCopy
+{
+public:
+    // Copies smaller than this stay on the calling thread
+    static size_t const ParallelThreshold;
+    // Copies at least this big bypass the cache
+    static size_t const StreamingThreshold;
+
+    static void Copy(
+        uint8_t const* source,
+        size_t sourceStride,
+        uint8_t* destination,
+        size_t destinationStride,
+        size_t rowBytes,
+        uint32_t rows);
+
+private:
+    StridedCopy() = delete;
+};
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "pch.h"
+#include "SyncedCapture.h"
+#include "SimpleCapture.h"
+
+namespace winrt
+{
+    using namespace Windows::Foundation;
+    using namespace Windows::Graphics;
+    using namespace Windows::Graphics::Capture;
+    using namespace Windows::Graphics::DirectX;
+    using namespace Windows::Graphics::DirectX::Direct3D11;
+}
+
+// Frames wait in the synchronizer for up to MaxLatency and the last one is
+// held for later sets, so a few copies per item are in use at once. Past
+// this, copies are made for one frame and let go.
+size_t const MaxTexturesPerSource = 4;
+
+SyncedCapture::SyncedCapture(
+    winrt::IDirect3DDevice const& device,
+    std::vector<winrt::GraphicsCaptureItem> const& items,
+    FrameSetHandler handler,
+    FrameSynchronizerSettings const& settings) : m_synchronizer(settings)
+{
+    if (items.empty())
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"Nothing to capture.");
+    }
+
+    m_device = device;
+    m_d3dDevice = GetDXGIInterfaceFromObject<ID3D11Device>(m_device);
+    m_d3dDevice->GetImmediateContext(m_d3dContext.put());
+    m_handler = handler;
+    m_pollInterval = std::max(settings.MaxLatency, winrt::TimeSpan{ std::chrono::milliseconds(1) });
+    m_pollTimer.reset(winrt::check_pointer(CreateThreadpoolTimer(&SyncedCapture::OnPollTimer, this, nullptr)));
+
+    for (auto&& item : items)
+    {
+        // All captures share the system relative clock
+        m_synchronizer.AddSource();
+
+        Source source;
+        source.Item = item;
+        source.Size = item.Size();
+        source.FramePool = winrt::Direct3D11CaptureFramePool::CreateFreeThreaded(m_device, winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized, 2, source.Size);
+        source.Session = source.FramePool.CreateCaptureSession(item);
+        m_sources.push_back(source);
+    }
+    for (size_t i = 0; i < m_sources.size(); i++)
+    {
+        m_sources[i].FramePool.FrameArrived([this, i](auto&& sender, auto&&)
+        {
+            OnFrameArrived(i, sender);
+        });
+    }
+}
+
+void SyncedCapture::StartCapture()
+{
+    for (auto&& source : m_sources)
+    {
+        source.Session.StartCapture();
+    }
+
+    // Negative means relative to now
+    ULARGE_INTEGER dueTime = {};
+    dueTime.QuadPart = static_cast<ULONGLONG>(-m_pollInterval.count());
+    FILETIME fileTime = {};
+    fileTime.dwLowDateTime = dueTime.LowPart;
+    fileTime.dwHighDateTime = dueTime.HighPart;
+    auto period = static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(m_pollInterval).count());
+    SetThreadpoolTimer(m_pollTimer.get(), &fileTime, period, 0);
+}
+
+SynchronizerStatistics SyncedCapture::Statistics()
+{
+    auto lock = std::scoped_lock(m_lock);
+    return m_synchronizer.Statistics();
+}
+
+std::vector<size_t> SyncedCapture::SourcesWithoutFrames()
+{
+    auto lock = std::scoped_lock(m_lock);
+    std::vector<size_t> sources;
+    for (size_t i = 0; i < m_sources.size(); i++)
+    {
+        if (!m_sources[i].HasFrame)
+        {
+            sources.push_back(i);
+        }
+    }
+    return sources;
+}
+
+void SyncedCapture::Close()
+{
+    auto expected = false;
+    if (m_closed.compare_exchange_strong(expected, true))
+    {
+        for (auto&& source : m_sources)
+        {
+            source.Session.Close();
+            source.FramePool.Close();
+        }
+        // Waits for any poll that's already running
+        m_pollTimer.reset();
+
+        auto lock = std::scoped_lock(m_lock);
+        m_handler = nullptr;
+        m_synchronizer.Reset();
+        m_sources.clear();
+    }
+}
+
+std::shared_ptr<winrt::com_ptr<ID3D11Texture2D> const> SyncedCapture::AcquireTexture(Source& source, D3D11_TEXTURE2D_DESC const& desc)
+{
+    // Only the ring holds a copy once the synchronizer and the sets let go,
+    // and nothing else can pick it up again while we hold m_lock
+    auto isFree = [](auto&& texture) { return texture.use_count() == 1; };
+    for (auto&& texture : source.Textures)
+    {
+        if (isFree(texture))
+        {
+            D3D11_TEXTURE2D_DESC existingDesc = {};
+            (*texture)->GetDesc(&existingDesc);
+            if (existingDesc.Width == desc.Width && existingDesc.Height == desc.Height && existingDesc.Format == desc.Format)
+            {
+                return texture;
+            }
+        }
+    }
+
+    winrt::com_ptr<ID3D11Texture2D> copy;
+    winrt::check_hresult(m_d3dDevice->CreateTexture2D(&desc, nullptr, copy.put()));
+    auto texture = std::make_shared<winrt::com_ptr<ID3D11Texture2D> const>(copy);
+
+    // Free copies of the wrong size are from before a resize
+    auto stale = std::find_if(source.Textures.begin(), source.Textures.end(), isFree);
+    if (stale != source.Textures.end())
+    {
+        *stale = texture;
+    }
+    else if (source.Textures.size() < MaxTexturesPerSource)
+    {
+        source.Textures.push_back(texture);
+    }
+    return texture;
+}
+
+std::shared_ptr<winrt::com_ptr<ID3D11Texture2D> const> SyncedCapture::CopyFrame(Source& source, winrt::Direct3D11CaptureFrame const& frame)
+{
+    auto surfaceTexture = GetDXGIInterfaceFromObject<ID3D11Texture2D>(frame.Surface());
+    D3D11_TEXTURE2D_DESC desc = {};
+    surfaceTexture->GetDesc(&desc);
+    auto contentSize = frame.ContentSize();
+    auto width = std::min(desc.Width, static_cast<uint32_t>(std::max(contentSize.Width, 1)));
+    auto height = std::min(desc.Height, static_cast<uint32_t>(std::max(contentSize.Height, 1)));
+
+    // Only the content, the rest of the buffer is stale after a resize
+    D3D11_TEXTURE2D_DESC copyDesc = {};
+    copyDesc.Width = width;
+    copyDesc.Height = height;
+    copyDesc.MipLevels = 1;
+    copyDesc.ArraySize = 1;
+    copyDesc.Format = desc.Format;
+    copyDesc.SampleDesc.Count = 1;
+    copyDesc.Usage = D3D11_USAGE_DEFAULT;
+    auto copy = AcquireTexture(source, copyDesc);
+
+    D3D11_BOX region = {};
+    region.right = width;
+    region.bottom = height;
+    region.back = 1;
+    m_d3dContext->CopySubresourceRegion(copy->get(), 0, 0, 0, 0, surfaceTexture.get(), 0, &region);
+    return copy;
+}
+
+void SyncedCapture::OnFrameArrived(size_t source, winrt::Direct3D11CaptureFramePool const& sender)
+{
+    if (m_closed.load())
+    {
+        return;
+    }
+
+    auto frame = sender.TryGetNextFrame();
+    if (frame == nullptr)
+    {
+        return;
+    }
+    auto timestamp = frame.SystemRelativeTime();
+    auto contentSize = frame.ContentSize();
+
+    {
+        auto lock = std::scoped_lock(m_lock);
+        if (m_handler == nullptr)
+        {
+            frame.Close();
+            return;
+        }
+        auto& state = m_sources[source];
+        state.HasFrame = true;
+        auto texture = CopyFrame(state, frame);
+        frame.Close();
+        Deliver(m_synchronizer.AddFrame(source, timestamp, texture));
+
+        // Only this source's thread touches its pool
+        if (contentSize.Width != state.Size.Width || contentSize.Height != state.Size.Height)
+        {
+            state.Size = contentSize;
+            sender.Recreate(m_device, winrt::DirectXPixelFormat::B8G8R8A8UIntNormalized, 2, contentSize);
+        }
+    }
+}
+
+void SyncedCapture::Deliver(std::vector<FrameSet> const& sets)
+{
+    for (auto&& set : sets)
+    {
+        std::vector<winrt::com_ptr<ID3D11Texture2D>> textures;
+        textures.reserve(set.Frames.size());
+        for (auto&& frame : set.Frames)
+        {
+            textures.push_back(*std::static_pointer_cast<winrt::com_ptr<ID3D11Texture2D> const>(frame.Content));
+        }
+        m_handler(textures, set.Time);
+    }
+}
+
+void CALLBACK SyncedCapture::OnPollTimer(PTP_CALLBACK_INSTANCE, void* context, PTP_TIMER)
+{
+    auto capture = reinterpret_cast<SyncedCapture*>(context);
+    auto lock = std::scoped_lock(capture->m_lock);
+    if (capture->m_handler != nullptr)
+    {
+        capture->Deliver(capture->m_synchronizer.Poll(GetSystemRelativeTime()));
+    }
+}
\ No newline at end of file
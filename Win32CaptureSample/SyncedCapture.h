@@ -0,0 +1,64 @@
+#pragma once
+#include "FrameSynchronizer.h"
+
+// Captures several items at once and hands out sets of frames, one from each
+// item, that were captured at about the same time. Every frame is copied on
+// the GPU so that it can wait for the other items' frames, into a few
+// textures per item that are reused once no set holds them.
+class SyncedCapture
+{
+public:
+    // Called in order with a texture for each item, from the capture threads.
+    // The textures are reused after the handler returns, copy them to keep them.
+    using FrameSetHandler = std::function<void(std::vector<winrt::com_ptr<ID3D11Texture2D>> const&, winrt::Windows::Foundation::TimeSpan)>;
+
+    SyncedCapture(
+        winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice const& device,
+        std::vector<winrt::Windows::Graphics::Capture::GraphicsCaptureItem> const& items,
+        FrameSetHandler handler,
+        FrameSynchronizerSettings const& settings = {});
+    ~SyncedCapture() { Close(); }
+
+    void StartCapture();
+    SynchronizerStatistics Statistics();
+    // The items that haven't sent a frame yet, by their index in the list
+    // they were given in
+    std::vector<size_t> SourcesWithoutFrames();
+    void Close();
+
+private:
+    struct Source
+    {
+        winrt::Windows::Graphics::Capture::GraphicsCaptureItem Item{ nullptr };
+        winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool FramePool{ nullptr };
+        winrt::Windows::Graphics::Capture::GraphicsCaptureSession Session{ nullptr };
+        winrt::Windows::Graphics::SizeInt32 Size = {};
+        // Copies of earlier frames, free when nothing else holds them
+        std::vector<std::shared_ptr<winrt::com_ptr<ID3D11Texture2D> const>> Textures;
+        bool HasFrame = false;
+    };
+
+    void OnFrameArrived(size_t source, winrt::Windows::Graphics::Capture::Direct3D11CaptureFramePool const& sender);
+    // Expects m_lock to be held
+    std::shared_ptr<winrt::com_ptr<ID3D11Texture2D> const> CopyFrame(Source& source, winrt::Windows::Graphics::Capture::Direct3D11CaptureFrame const& frame);
+    std::shared_ptr<winrt::com_ptr<ID3D11Texture2D> const> AcquireTexture(Source& source, D3D11_TEXTURE2D_DESC const& desc);
+    // Expects m_lock to be held
+    void Deliver(std::vector<FrameSet> const& sets);
+    static void CALLBACK OnPollTimer(PTP_CALLBACK_INSTANCE, void* context, PTP_TIMER);
+
+private:
+    winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice m_device{ nullptr };
+    winrt::com_ptr<ID3D11Device> m_d3dDevice{ nullptr };
+    winrt::com_ptr<ID3D11DeviceContext> m_d3dContext{ nullptr };
+    std::vector<Source> m_sources;
+    winrt::Windows::Foundation::TimeSpan m_pollInterval = {};
+    // Items that stop changing stop sending frames, this finishes the sets
+    // that were waiting on them
+    wil::unique_threadpool_timer m_pollTimer;
+
+    // Guards the synchronizer and the handler
+    std::mutex m_lock;
+    FrameSynchronizer m_synchronizer;
+    FrameSetHandler m_handler;
+    std::atomic<bool> m_closed = false;
+};
\ No newline at end of file
@@ -0,0 +1,411 @@
+#include "pch.h"
+#include "WindowFilterRules.h"
+
+std::wstring_view const WindowFilterRules::DefaultRules = LR"(
+# Disabled windows
+block style=WS_DISABLED
+# No tooltips
+block exstyle=WS_EX_TOOLWINDOW
+# Task View
+block title="Task View" class="Windows.UI.Core.CoreWindow"
+# XAML Islands
+block title="DesktopWindowXamlSource" class="Windows.UI.Core.CoreWindow"
+# XAML Popups
+block title="PopupHost" class="Xaml_WindowedPopupClass"
+)";
+
+struct StyleFlagName
+{
+    std::wstring_view Name;
+    uint32_t Value;
+};
+
+StyleFlagName const StyleFlagNames[] =
+{
+    { L"WS_POPUP", static_cast<uint32_t>(WS_POPUP) },
+    { L"WS_CHILD", static_cast<uint32_t>(WS_CHILD) },
+    { L"WS_MINIMIZE", static_cast<uint32_t>(WS_MINIMIZE) },
+    { L"WS_VISIBLE", static_cast<uint32_t>(WS_VISIBLE) },
+    { L"WS_DISABLED", static_cast<uint32_t>(WS_DISABLED) },
+    { L"WS_MAXIMIZE", static_cast<uint32_t>(WS_MAXIMIZE) },
+    { L"WS_CAPTION", static_cast<uint32_t>(WS_CAPTION) },
+};
+
+StyleFlagName const ExStyleFlagNames[] =
+{
+    { L"WS_EX_TOPMOST", static_cast<uint32_t>(WS_EX_TOPMOST) },
+    { L"WS_EX_TRANSPARENT", static_cast<uint32_t>(WS_EX_TRANSPARENT) },
+    { L"WS_EX_TOOLWINDOW", static_cast<uint32_t>(WS_EX_TOOLWINDOW) },
+    { L"WS_EX_APPWINDOW", static_cast<uint32_t>(WS_EX_APPWINDOW) },
+    { L"WS_EX_LAYERED", static_cast<uint32_t>(WS_EX_LAYERED) },
+    { L"WS_EX_NOREDIRECTIONBITMAP", static_cast<uint32_t>(WS_EX_NOREDIRECTIONBITMAP) },
+    { L"WS_EX_NOACTIVATE", static_cast<uint32_t>(WS_EX_NOACTIVATE) },
+};
+
+std::wstring_view TrimWhitespace(std::wstring_view value)
+{
+    auto first = value.find_first_not_of(L" \t\r");
+    if (first == std::wstring_view::npos)
+    {
+        return {};
+    }
+    auto last = value.find_last_not_of(L" \t\r");
+    return value.substr(first, last - first + 1);
+}
+
+std::wstring ToLower(std::wstring_view value)
+{
+    std::wstring result(value);
+    for (auto& character : result)
+    {
+        character = static_cast<wchar_t>(towlower(character));
+    }
+    return result;
+}
+
+bool GlobMatch(std::wstring_view pattern, std::wstring_view value)
+{
+    size_t patternIndex = 0;
+    size_t valueIndex = 0;
+    auto starPatternIndex = std::wstring_view::npos;
+    size_t starValueIndex = 0;
+    while (valueIndex < value.size())
+    {
+        if (patternIndex < pattern.size() && (pattern[patternIndex] == L'?' || pattern[patternIndex] == value[valueIndex]))
+        {
+            patternIndex++;
+            valueIndex++;
+        }
+        else if (patternIndex < pattern.size() && pattern[patternIndex] == L'*')
+        {
+            starPatternIndex = patternIndex++;
+            starValueIndex = valueIndex;
+        }
+        else if (starPatternIndex != std::wstring_view::npos)
+        {
+            // Let the last '*' swallow one more character and try again
+            patternIndex = starPatternIndex + 1;
+            valueIndex = ++starValueIndex;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (patternIndex < pattern.size() && pattern[patternIndex] == L'*')
+    {
+        patternIndex++;
+    }
+    return patternIndex == pattern.size();
+}
+
+bool WindowFilterRules::StringPredicate::Matches(std::wstring_view value) const
+{
+    switch (Kind)
+    {
+    case MatchKind::Any:
+        return true;
+    case MatchKind::Exact:
+        return value == Pattern;
+    case MatchKind::Prefix:
+        return value.substr(0, Pattern.size()) == Pattern;
+    case MatchKind::Glob:
+        return GlobMatch(Pattern, value);
+    }
+    return false;
+}
+
+void WindowFilterRules::PrefixTrie::Insert(std::wstring_view prefix, uint32_t ruleIndex)
+{
+    uint32_t node = 0;
+    for (auto&& character : prefix)
+    {
+        auto search = m_nodes[node].Children.find(character);
+        if (search == m_nodes[node].Children.end())
+        {
+            auto child = static_cast<uint32_t>(m_nodes.size());
+            m_nodes[node].Children.insert({ character, child });
+            m_nodes.emplace_back();
+            node = child;
+        }
+        else
+        {
+            node = search->second;
+        }
+    }
+    m_nodes[node].Rules.push_back(ruleIndex);
+}
+
+void WindowFilterRules::AddRules(std::wstring_view text)
+{
+    // Parse everything before indexing anything so that a bad
+    // line doesn't leave us with half of the rules.
+    auto firstNewRule = m_rules.size();
+    auto usesProcessName = m_usesProcessName;
+    size_t lineNumber = 0;
+    try
+    {
+        while (!text.empty())
+        {
+            lineNumber++;
+            auto end = text.find(L'\n');
+            auto line = TrimWhitespace(text.substr(0, end));
+            text = end == std::wstring_view::npos ? std::wstring_view() : text.substr(end + 1);
+            if (line.empty() || line.front() == L'#')
+            {
+                continue;
+            }
+            ParseRule(line, lineNumber);
+        }
+    }
+    catch (...)
+    {
+        m_rules.resize(firstNewRule);
+        m_usesProcessName = usesProcessName;
+        throw;
+    }
+
+    for (auto i = firstNewRule; i < m_rules.size(); i++)
+    {
+        IndexRule(static_cast<uint32_t>(i));
+    }
+}
+
+void WindowFilterRules::ParseRule(std::wstring_view line, size_t lineNumber)
+{
+    auto throwParseError = [lineNumber](std::wstring const& message)
+    {
+        throw winrt::hresult_error(E_INVALIDARG, L"Window filter rules, line " + std::to_wstring(lineNumber) + L": " + message);
+    };
+
+    auto makePredicate = [](std::wstring pattern)
+    {
+        StringPredicate predicate;
+        auto firstWildcard = pattern.find_first_of(L"*?");
+        if (firstWildcard == std::wstring::npos)
+        {
+            predicate.Kind = MatchKind::Exact;
+        }
+        else if (pattern == L"*")
+        {
+            predicate.Kind = MatchKind::Any;
+            pattern.clear();
+        }
+        else if (firstWildcard == pattern.size() - 1 && pattern.back() == L'*')
+        {
+            predicate.Kind = MatchKind::Prefix;
+            pattern.pop_back();
+        }
+        else
+        {
+            predicate.Kind = MatchKind::Glob;
+        }
+        predicate.Pattern = std::move(pattern);
+        return predicate;
+    };
+
+    // Style and extended style bits overlap, so each key only knows its own names
+    auto parseStyle = [&](std::wstring_view value, auto const& flagNames)
+    {
+        uint32_t style = 0;
+        auto end = std::wstring_view::size_type(0);
+        while (end != std::wstring_view::npos)
+        {
+            end = value.find(L'|');
+            auto flag = TrimWhitespace(value.substr(0, end));
+            value = end == std::wstring_view::npos ? std::wstring_view() : value.substr(end + 1);
+
+            auto name = std::find_if(std::begin(flagNames), std::end(flagNames), [flag](auto&& entry) { return entry.Name == flag; });
+            if (flag.empty())
+            {
+                throwParseError(L"missing style flag");
+            }
+            else if (name != std::end(flagNames))
+            {
+                style |= name->Value;
+            }
+            else if (flag.substr(0, 2) == L"0x")
+            {
+                // Anything but 1 to 8 hex digits is a typo, not a flag
+                auto digits = std::wstring(flag.substr(2));
+                wchar_t* digitsEnd = nullptr;
+                auto flagValue = std::wcstoul(digits.c_str(), &digitsEnd, 16);
+                // wcstoul would also take a sign, spaces or a second 0x
+                auto isHex = std::all_of(digits.begin(), digits.end(), [](wchar_t digit) { return iswxdigit(digit) != 0; });
+                if (digits.empty() || digits.size() > 8 || !isHex || digitsEnd != digits.c_str() + digits.size())
+                {
+                    throwParseError(L"invalid style value '" + std::wstring(flag) + L"'");
+                }
+                style |= static_cast<uint32_t>(flagValue);
+            }
+            else
+            {
+                throwParseError(L"unknown style flag '" + std::wstring(flag) + L"'");
+            }
+        }
+        return style;
+    };
+
+    std::wstring_view const keyword = L"block";
+    if (line.substr(0, keyword.size()) != keyword || (line.size() > keyword.size() && line[keyword.size()] != L' ' && line[keyword.size()] != L'\t'))
+    {
+        throwParseError(L"expected 'block'");
+    }
+    line = TrimWhitespace(line.substr(keyword.size()));
+
+    Rule rule;
+    auto hasPredicate = false;
+    while (!line.empty())
+    {
+        auto equals = line.find(L'=');
+        if (equals == std::wstring_view::npos)
+        {
+            throwParseError(L"expected key=value");
+        }
+        auto key = TrimWhitespace(line.substr(0, equals));
+        line = TrimWhitespace(line.substr(equals + 1));
+
+        std::wstring_view value;
+        if (!line.empty() && line.front() == L'"')
+        {
+            auto closingQuote = line.find(L'"', 1);
+            if (closingQuote == std::wstring_view::npos)
+            {
+                throwParseError(L"missing closing quote");
+            }
+            value = line.substr(1, closingQuote - 1);
+            line = TrimWhitespace(line.substr(closingQuote + 1));
+        }
+        else
+        {
+            auto end = line.find_first_of(L" \t");
+            value = line.substr(0, end);
+            line = end == std::wstring_view::npos ? std::wstring_view() : TrimWhitespace(line.substr(end));
+        }
+
+        if (key == L"title")
+        {
+            rule.Title = makePredicate(std::wstring(value));
+        }
+        else if (key == L"class")
+        {
+            rule.ClassName = makePredicate(std::wstring(value));
+        }
+        else if (key == L"process")
+        {
+            rule.ProcessName = makePredicate(ToLower(value));
+            m_usesProcessName = true;
+        }
+        else if (key == L"style")
+        {
+            rule.Style = parseStyle(value, StyleFlagNames);
+        }
+        else if (key == L"exstyle")
+        {
+            rule.ExStyle = parseStyle(value, ExStyleFlagNames);
+        }
+        else
+        {
+            throwParseError(L"unknown key '" + std::wstring(key) + L"'");
+        }
+        hasPredicate = true;
+    }
+
+    if (!hasPredicate)
+    {
+        // A rule without predicates would block every window
+        throwParseError(L"rule has no predicates");
+    }
+    m_rules.push_back(std::move(rule));
+}
+
+// The part of a prefix or glob pattern that every match starts with
+std::wstring_view LiteralPrefix(std::wstring_view pattern)
+{
+    return pattern.substr(0, pattern.find_first_of(L"*?"));
+}
+
+void WindowFilterRules::IndexRule(uint32_t ruleIndex)
+{
+    auto& rule = m_rules[ruleIndex];
+    // Globs that don't start with a wildcard go in the tries by the part
+    // before it, the full pattern is checked once the prefix matches
+    auto hasPrefix = [](StringPredicate const& predicate)
+    {
+        return predicate.Kind == MatchKind::Prefix || (predicate.Kind == MatchKind::Glob && !LiteralPrefix(predicate.Pattern).empty());
+    };
+    if (rule.Title.Kind == MatchKind::Exact)
+    {
+        m_exactTitles[rule.Title.Pattern].push_back(ruleIndex);
+    }
+    else if (rule.ClassName.Kind == MatchKind::Exact)
+    {
+        m_exactClassNames[rule.ClassName.Pattern].push_back(ruleIndex);
+    }
+    else if (rule.ProcessName.Kind == MatchKind::Exact)
+    {
+        m_exactProcessNames[rule.ProcessName.Pattern].push_back(ruleIndex);
+    }
+    else if (hasPrefix(rule.Title))
+    {
+        m_titlePrefixes.Insert(LiteralPrefix(rule.Title.Pattern), ruleIndex);
+    }
+    else if (hasPrefix(rule.ClassName))
+    {
+        m_classNamePrefixes.Insert(LiteralPrefix(rule.ClassName.Pattern), ruleIndex);
+    }
+    else if (hasPrefix(rule.ProcessName))
+    {
+        m_processNamePrefixes.Insert(LiteralPrefix(rule.ProcessName.Pattern), ruleIndex);
+    }
+    else
+    {
+        // Style-only rules and globs that start with a wildcard are checked
+        // for every window
+        m_unindexedRules.push_back(ruleIndex);
+    }
+}
+
+bool WindowFilterRules::Matches(Rule const& rule, WindowFilterInput const& window, std::wstring_view processName) const
+{
+    return (window.Style & rule.Style) == rule.Style &&
+        (window.ExStyle & rule.ExStyle) == rule.ExStyle &&
+        rule.Title.Matches(window.Title) &&
+        rule.ClassName.Matches(window.ClassName) &&
+        rule.ProcessName.Matches(processName);
+}
+
+bool WindowFilterRules::IsBlocked(WindowFilterInput const& window) const
+{
+    std::wstring processName;
+    if (m_usesProcessName)
+    {
+        processName = ToLower(window.ProcessName);
+    }
+
+    auto matches = [&](uint32_t ruleIndex) { return Matches(m_rules[ruleIndex], window, processName); };
+    auto matchesExact = [&](ExactIndex const& index, std::wstring_view key)
+    {
+        auto search = index.find(key);
+        return search != index.end() && std::any_of(search->second.begin(), search->second.end(), matches);
+    };
+
+    if (matchesExact(m_exactTitles, window.Title) ||
+        matchesExact(m_exactClassNames, window.ClassName) ||
+        matchesExact(m_exactProcessNames, processName))
+    {
+        return true;
+    }
+
+    auto blocked = false;
+    auto checkPrefixMatch = [&](uint32_t ruleIndex) { blocked = blocked || matches(ruleIndex); };
+    m_titlePrefixes.ForEachMatch(window.Title, checkPrefixMatch);
+    m_classNamePrefixes.ForEachMatch(window.ClassName, checkPrefixMatch);
+    m_processNamePrefixes.ForEachMatch(processName, checkPrefixMatch);
+    if (blocked)
+    {
+        return true;
+    }
+
+    return std::any_of(m_unindexedRules.begin(), m_unindexedRules.end(), matches);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+struct WindowFilterInput
+{
+    std::wstring_view Title;
+    std::wstring_view ClassName;
+    // Only needs to be filled in if UsesProcessName() is true
+    std::wstring_view ProcessName;
+    uint32_t Style = 0;
+    uint32_t ExStyle = 0;
+};
+
+// A set of "block" rules compiled from a small text format, one rule per line:
+//
+//   # Task View
+//   block title="Task View" class="Windows.UI.Core.CoreWindow"
+//   block exstyle=WS_EX_TOOLWINDOW
+//   block process="notepad*.exe"
+//
+// Every predicate on a line must match for the rule to match. String patterns
+// without wildcards are exact matches, patterns with a single trailing '*' are
+// prefix matches, and anything else is treated as a glob ('*' and '?'). Process
+// names are compared case-insensitively, titles and class names are not. Style
+// predicates match when all of the given flags are set.
+//
+// Each rule is indexed by its most selective predicate (exact strings go into
+// hash maps, prefixes and the start of globs into tries), so evaluating a
+// window only touches the rules that could possibly match it. Rules that
+// only have styles or globs that start with a wildcard are checked for every
+// window.
+class WindowFilterRules
+{
+public:
+    WindowFilterRules() {}
+    ~WindowFilterRules() {}
+
+    static std::wstring_view const DefaultRules;
+
+    void AddRules(std::wstring_view text);
+    bool IsBlocked(WindowFilterInput const& window) const;
+    bool UsesProcessName() const { return m_usesProcessName; }
+    size_t RuleCount() const { return m_rules.size(); }
+
+private:
+    enum class MatchKind
+    {
+        Any,
+        Exact,
+        Prefix,
+        Glob,
+    };
+
+    struct StringPredicate
+    {
+        MatchKind Kind = MatchKind::Any;
+        std::wstring Pattern;
+
+        bool Matches(std::wstring_view value) const;
+    };
+
+    struct Rule
+    {
+        StringPredicate Title;
+        StringPredicate ClassName;
+        StringPredicate ProcessName;
+        uint32_t Style = 0;
+        uint32_t ExStyle = 0;
+    };
+
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::wstring_view value) const { return std::hash<std::wstring_view>{}(value); }
+    };
+    using ExactIndex = std::unordered_map<std::wstring, std::vector<uint32_t>, StringHash, std::equal_to<>>;
+
+    class PrefixTrie
+    {
+    public:
+        void Insert(std::wstring_view prefix, uint32_t ruleIndex);
+
+        template <typename F>
+        void ForEachMatch(std::wstring_view value, F&& func) const
+        {
+            uint32_t node = 0;
+            for (auto&& character : value)
+            {
+                auto search = m_nodes[node].Children.find(character);
+                if (search == m_nodes[node].Children.end())
+                {
+                    return;
+                }
+                node = search->second;
+                for (auto&& ruleIndex : m_nodes[node].Rules)
+                {
+                    func(ruleIndex);
+                }
+            }
+        }
+
+    private:
+        struct Node
+        {
+            std::unordered_map<wchar_t, uint32_t> Children;
+            std::vector<uint32_t> Rules;
+        };
+
+        std::vector<Node> m_nodes{ 1 };
+    };
+
+    void ParseRule(std::wstring_view line, size_t lineNumber);
+    void IndexRule(uint32_t ruleIndex);
+    bool Matches(Rule const& rule, WindowFilterInput const& window, std::wstring_view processName) const;
+
+private:
+    std::vector<Rule> m_rules;
+    ExactIndex m_exactTitles;
+    ExactIndex m_exactClassNames;
+    ExactIndex m_exactProcessNames;
+    PrefixTrie m_titlePrefixes;
+    PrefixTrie m_classNamePrefixes;
+    PrefixTrie m_processNamePrefixes;
+    std::vector<uint32_t> m_unindexedRules;
+    bool m_usesProcessName = false;
+};
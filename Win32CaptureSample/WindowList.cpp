@@ -1,56 +1,110 @@
 #include "pch.h"
 #include "WindowList.h"
 
-bool inline MatchTitleAndClassName(WindowInfo const& window, std::wstring const& title, std::wstring const& className)
+std::optional<std::wstring> ReadUserFilterRules()
 {
-    return wcscmp(window.Title.c_str(), title.c_str()) == 0 &&
-        wcscmp(window.ClassName.c_str(), className.c_str()) == 0;
+    // Extra rules can be dropped next to the executable without rebuilding
+    std::wstring modulePath(MAX_PATH, 0);
+    auto modulePathLength = GetModuleFileNameW(nullptr, modulePath.data(), static_cast<DWORD>(modulePath.size()));
+    modulePath.resize(modulePathLength);
+    auto path = std::filesystem::path(modulePath).replace_filename(L"WindowFilters.txt");
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::wstring rules(winrt::to_hstring(contents));
+    if (!rules.empty() && rules.front() == L'\xFEFF')
+    {
+        rules.erase(0, 1);
+    }
+    return rules;
+}
+
+std::wstring QueryWindowTitle(HWND windowHandle)
+{
+    auto titleLength = GetWindowTextLengthW(windowHandle);
+    if (titleLength <= 0)
+    {
+        return {};
+    }
+    std::wstring title(titleLength + 1, 0);
+    auto copied = GetWindowTextW(windowHandle, title.data(), titleLength + 1);
+    title.resize(copied);
+    return title;
 }
 
-bool IsKnownBlockedWindow(WindowInfo const& window)
+std::wstring QueryWindowClassName(HWND windowHandle)
 {
-    return
-        // Task View
-        MatchTitleAndClassName(window, L"Task View", L"Windows.UI.Core.CoreWindow") ||
-        // XAML Islands
-        MatchTitleAndClassName(window, L"DesktopWindowXamlSource", L"Windows.UI.Core.CoreWindow") ||
-        // XAML Popups
-        MatchTitleAndClassName(window, L"PopupHost", L"Xaml_WindowedPopupClass");
+    // 256 is the maximum length of a window class name
+    std::wstring className(256, 0);
+    auto copied = GetClassNameW(windowHandle, className.data(), static_cast<int>(className.size()));
+    className.resize(copied);
+    return className;
 }
 
-bool IsCapturableWindow(WindowInfo const& window)
+std::wstring QueryWindowProcessName(HWND windowHandle)
 {
-    if (window.Title.empty() || window.WindowHandle == GetShellWindow() ||
-        !IsWindowVisible(window.WindowHandle) || GetAncestor(window.WindowHandle, GA_ROOT) != window.WindowHandle)
+    DWORD processId = 0;
+    GetWindowThreadProcessId(windowHandle, &processId);
+    wil::unique_handle process(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId));
+    if (!process)
     {
-        return false;
+        return {};
     }
+    std::wstring path(MAX_PATH, 0);
+    auto pathLength = static_cast<DWORD>(path.size());
+    if (!QueryFullProcessImageNameW(process.get(), 0, path.data(), &pathLength))
+    {
+        return {};
+    }
+    path.resize(pathLength);
+    return std::filesystem::path(path).filename().wstring();
+}
+
+WindowQueries Win32WindowQueries()
+{
+    return { QueryWindowTitle, QueryWindowClassName, QueryWindowProcessName };
+}
 
-    auto style = GetWindowLongW(window.WindowHandle, GWL_STYLE);
-    if (style & WS_DISABLED)
+bool WindowList::IsCapturableWindow(HWND windowHandle)
+{
+    if (GetAncestor(windowHandle, GA_ROOT) != windowHandle || windowHandle == GetShellWindow())
     {
         return false;
     }
 
-    auto exStyle = GetWindowLongW(window.WindowHandle, GWL_EXSTYLE);
-    if (exStyle & WS_EX_TOOLWINDOW)    // No tooltips
+    auto& window = m_metadataCache.Get(windowHandle);
+    if (window.Title.empty() || !IsWindowVisible(windowHandle))
     {
         return false;
     }
 
     // Check to see if the window is cloaked if it's a UWP
-    if (wcscmp(window.ClassName.c_str(), L"Windows.UI.Core.CoreWindow") == 0 ||
-        wcscmp(window.ClassName.c_str(), L"ApplicationFrameWindow") == 0)
+    if (window.ClassName == m_coreWindowClassName ||
+        window.ClassName == m_applicationFrameWindowClassName)
     {
         DWORD cloaked = FALSE;
-        if (SUCCEEDED(DwmGetWindowAttribute(window.WindowHandle, DWMWA_CLOAKED, &cloaked, sizeof(cloaked))) && (cloaked == DWM_CLOAKED_SHELL))
+        if (SUCCEEDED(DwmGetWindowAttribute(windowHandle, DWMWA_CLOAKED, &cloaked, sizeof(cloaked))) && (cloaked == DWM_CLOAKED_SHELL))
         {
             return false;
         }
     }
 
-    // Unfortunate work-around. Not sure how to avoid this.
-    if (IsKnownBlockedWindow(window))
+    // Style checks and the unfortunate work-arounds for known windows
+    // all live in the filter rules.
+    WindowFilterInput input;
+    input.Title = window.Title;
+    input.ClassName = *window.ClassName;
+    input.Style = static_cast<uint32_t>(GetWindowLongW(windowHandle, GWL_STYLE));
+    input.ExStyle = static_cast<uint32_t>(GetWindowLongW(windowHandle, GWL_EXSTYLE));
+    if (m_filterRules.UsesProcessName())
+    {
+        input.ProcessName = m_metadataCache.GetProcessName(windowHandle);
+    }
+    if (m_filterRules.IsBlocked(input))
     {
         return false;
     }
@@ -60,7 +114,7 @@ bool IsCapturableWindow(WindowInfo const& window)
 
 static thread_local WindowList* WindowListForThread;
 
-WindowList::WindowList()
+WindowList::WindowList() : m_metadataCache(Win32WindowQueries())
 {
     if (WindowListForThread)
     {
@@ -68,19 +122,16 @@ WindowList::WindowList()
     }
     WindowListForThread = this;
 
+    m_coreWindowClassName = m_metadataCache.InternClassName(L"Windows.UI.Core.CoreWindow");
+    m_applicationFrameWindowClassName = m_metadataCache.InternClassName(L"ApplicationFrameWindow");
+    LoadFilterRules();
+
     EnumWindows([](HWND hwnd, LPARAM lParam)
     {
-        if (GetWindowTextLengthW(hwnd) > 0)
+        auto windowList = reinterpret_cast<WindowList*>(lParam);
+        if (windowList->IsCapturableWindow(hwnd))
         {
-            auto window = WindowInfo(hwnd);
-
-            if (!IsCapturableWindow(window))
-            {
-                return TRUE;
-            }
-
-            auto windowList = reinterpret_cast<WindowList*>(lParam);
-            windowList->AddWindow(window);
+            windowList->AddWindow(WindowInfo(hwnd, windowList->m_metadataCache.Get(hwnd)));
         }
         
         return TRUE;
@@ -91,18 +142,26 @@ WindowList::WindowList()
         {
             if (event == EVENT_OBJECT_DESTROY && childId == CHILDID_SELF)
             {
-                WindowListForThread->RemoveWindow(WindowInfo(hwnd));
+                WindowListForThread->m_metadataCache.Remove(hwnd);
+                WindowListForThread->RemoveWindow(hwnd);
                 return;
             }
 
-            if (objectId == OBJID_WINDOW && childId == CHILDID_SELF && hwnd != nullptr && GetAncestor(hwnd, GA_ROOT) == hwnd &&
-                GetWindowTextLengthW(hwnd) > 0 && (event == EVENT_OBJECT_SHOW || event == EVENT_OBJECT_UNCLOAKED))
+            if (objectId != OBJID_WINDOW || childId != CHILDID_SELF || hwnd == nullptr)
             {
-                auto window = WindowInfo(hwnd);
+                return;
+            }
 
-                if (IsCapturableWindow(window))
+            if (event == EVENT_OBJECT_NAMECHANGE)
+            {
+                WindowListForThread->OnWindowTitleChanged(hwnd);
+            }
+            else if (event == EVENT_OBJECT_SHOW || event == EVENT_OBJECT_UNCLOAKED)
+            {
+                if (WindowListForThread->IsCapturableWindow(hwnd))
                 {
-                    WindowListForThread->AddWindow(window);
+                    auto& metadata = WindowListForThread->m_metadataCache.Get(hwnd);
+                    WindowListForThread->AddWindow(WindowInfo(hwnd, metadata));
                 }
             }
         }, 0, 0, WINEVENT_OUTOFCONTEXT));
@@ -114,6 +173,26 @@ WindowList::~WindowList()
     WindowListForThread = nullptr;
 }
 
+void WindowList::LoadFilterRules()
+{
+    m_filterRules.AddRules(WindowFilterRules::DefaultRules);
+    try
+    {
+        if (auto rules = ReadUserFilterRules())
+        {
+            m_filterRules.AddRules(rules.value());
+        }
+    }
+    catch (winrt::hresult_error const& error)
+    {
+        // Keep going with the default rules
+        MessageBoxW(nullptr,
+            error.message().c_str(),
+            L"Win32CaptureSample",
+            MB_OK | MB_ICONERROR);
+    }
+}
+
 void WindowList::AddWindow(WindowInfo const& info)
 {
     auto search = m_seenWindows.find(info.WindowHandle);
@@ -121,43 +200,140 @@ void WindowList::AddWindow(WindowInfo const& info)
     {
         m_windows.push_back(info);
         m_seenWindows.insert(info.WindowHandle);
-        for (auto& comboBox : m_comboBoxes)
+        m_searchIndex.Add(info.WindowHandle, info.Title, info.ClassName);
+        if (m_searchQuery.empty() || m_searchIndex.Matches(info.WindowHandle, m_searchQuery))
         {
-            winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_ADDSTRING, 0, (LPARAM)info.Title.c_str())));
+            m_displayedWindows.push_back(info.WindowHandle);
+            for (auto& comboBox : m_comboBoxes)
+            {
+                winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_ADDSTRING, 0, (LPARAM)info.Title.c_str())));
+            }
         }
     }
 }
 
-bool WindowList::RemoveWindow(WindowInfo const& info)
+bool WindowList::RemoveWindow(HWND windowHandle)
 {
-    auto search = m_seenWindows.find(info.WindowHandle);
+    auto search = m_seenWindows.find(windowHandle);
     if (search != m_seenWindows.end())
     {
         m_seenWindows.erase(search);
-        auto index = 0;
-        for (auto& window : m_windows)
+        m_windows.erase(std::find_if(m_windows.begin(), m_windows.end(), [windowHandle](auto&& info) { return info.WindowHandle == windowHandle; }));
+        m_searchIndex.Remove(windowHandle);
+
+        auto displayed = std::find(m_displayedWindows.begin(), m_displayedWindows.end(), windowHandle);
+        if (displayed != m_displayedWindows.end())
         {
-            if (window.WindowHandle == info.WindowHandle)
+            auto index = std::distance(m_displayedWindows.begin(), displayed);
+            m_displayedWindows.erase(displayed);
+            for (auto& comboBox : m_comboBoxes)
             {
-                break;
+                winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_DELETESTRING, index, 0)));
             }
-            index++;
-        }
-        m_windows.erase(m_windows.begin() + index);
-        for (auto& comboBox : m_comboBoxes)
-        {
-            winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_DELETESTRING, index, 0)));
         }
         return true;
     }
     return false;
 }
 
+void WindowList::OnWindowTitleChanged(HWND windowHandle)
+{
+    // Only windows we've already looked at are queried again here.
+    m_metadataCache.RefreshTitle(windowHandle);
+
+    auto search = m_seenWindows.find(windowHandle);
+    if (search == m_seenWindows.end())
+    {
+        // Some windows are shown before they get a title
+        if (IsCapturableWindow(windowHandle))
+        {
+            AddWindow(WindowInfo(windowHandle, m_metadataCache.Get(windowHandle)));
+        }
+        return;
+    }
+
+    auto& metadata = m_metadataCache.Get(windowHandle);
+    if (!IsCapturableWindow(windowHandle))
+    {
+        RemoveWindow(windowHandle);
+        return;
+    }
+
+    auto window = std::find_if(m_windows.begin(), m_windows.end(), [windowHandle](auto&& info) { return info.WindowHandle == windowHandle; });
+    if (window->Title == metadata.Title)
+    {
+        return;
+    }
+    window->Title = metadata.Title;
+    m_searchIndex.Update(windowHandle, window->Title, window->ClassName);
+
+    // We don't drop windows that stop matching the search query here,
+    // entries disappearing while the user is looking at them is confusing.
+    // Ones that start matching it get added to the end.
+    auto displayed = std::find(m_displayedWindows.begin(), m_displayedWindows.end(), windowHandle);
+    if (displayed == m_displayedWindows.end())
+    {
+        if (m_searchQuery.empty() || m_searchIndex.Matches(windowHandle, m_searchQuery))
+        {
+            m_displayedWindows.push_back(windowHandle);
+            for (auto& comboBox : m_comboBoxes)
+            {
+                winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_ADDSTRING, 0, (LPARAM)window->Title.c_str())));
+            }
+        }
+        return;
+    }
+    auto index = static_cast<WPARAM>(std::distance(m_displayedWindows.begin(), displayed));
+    for (auto& comboBox : m_comboBoxes)
+    {
+        auto selectedIndex = SendMessageW(comboBox, CB_GETCURSEL, 0, 0);
+        winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_DELETESTRING, index, 0)));
+        winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBox, CB_INSERTSTRING, index, (LPARAM)window->Title.c_str())));
+        if (selectedIndex == static_cast<LRESULT>(index))
+        {
+            SendMessageW(comboBox, CB_SETCURSEL, index, 0);
+        }
+    }
+}
+
+HWND WindowList::GetDisplayedWindowHandle(LRESULT comboBoxIndex) const
+{
+    if (comboBoxIndex < 0 || static_cast<size_t>(comboBoxIndex) >= m_displayedWindows.size())
+    {
+        return nullptr;
+    }
+    return m_displayedWindows[static_cast<size_t>(comboBoxIndex)];
+}
+
+void WindowList::SetSearchQuery(std::wstring const& query)
+{
+    m_searchQuery = query;
+    m_displayedWindows = m_searchIndex.Search(m_searchQuery);
+    for (auto& comboBox : m_comboBoxes)
+    {
+        ForceUpdateComboBox(comboBox);
+    }
+}
+
 void WindowList::ForceUpdateComboBox(HWND comboBoxHandle)
 {
-    winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBoxHandle, CB_RESETCONTENT, 0, 0)));
+    std::unordered_map<HWND, WindowInfo const*> windows;
     for (auto& window : m_windows)
     {
+        windows.insert({ window.WindowHandle, &window });
+    }
+
+    SendMessageW(comboBoxHandle, WM_SETREDRAW, FALSE, 0);
+    auto redraw = wil::scope_exit([comboBoxHandle]()
+        {
+            SendMessageW(comboBoxHandle, WM_SETREDRAW, TRUE, 0);
+            InvalidateRect(comboBoxHandle, nullptr, TRUE);
+        });
+
+    winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBoxHandle, CB_RESETCONTENT, 0, 0)));
+    for (auto& windowHandle : m_displayedWindows)
+    {
+        auto& window = *windows.at(windowHandle);
         winrt::check_hresult(static_cast<const int32_t>(SendMessageW(comboBoxHandle, CB_ADDSTRING, 0, (LPARAM)window.Title.c_str())));
     }
-}
\ No newline at end of file
+}
@@ -1,4 +1,7 @@
 #pragma once
+#include "WindowMetadataCache.h"
+#include "WindowFilterRules.h"
+#include "WindowSearchIndex.h"
 
 struct WindowInfo
 {
@@ -18,6 +21,12 @@ struct WindowInfo
         GetClassNameW(WindowHandle, className.data(), classNameLength);
         ClassName = className;
     }
+    WindowInfo(HWND windowHandle, WindowMetadata const& metadata)
+    {
+        WindowHandle = windowHandle;
+        Title = metadata.Title;
+        ClassName = *metadata.ClassName;
+    }
 
     HWND WindowHandle;
     std::wstring Title;
@@ -35,16 +44,31 @@ public:
 
     void RegisterComboBoxForUpdates(HWND comboBoxHandle) { m_comboBoxes.push_back(comboBoxHandle); ForceUpdateComboBox(comboBoxHandle); }
     void UnregisterComboBox(HWND comboBoxHandle) { m_comboBoxes.erase(std::remove(m_comboBoxes.begin(), m_comboBoxes.end(), comboBoxHandle), m_comboBoxes.end()); }
-    const std::vector<WindowInfo> GetCurrentWindows() { return m_windows; }
+    std::vector<WindowInfo> const& GetCurrentWindows() const { return m_windows; }
+
+    // The combo boxes only show the windows that match the search query
+    void SetSearchQuery(std::wstring const& query);
+    // Returns nullptr for CB_ERR or an index that isn't in the list
+    HWND GetDisplayedWindowHandle(LRESULT comboBoxIndex) const;
 
 private:
     void AddWindow(WindowInfo const& info);
-    bool RemoveWindow(WindowInfo const& info);
+    bool RemoveWindow(HWND windowHandle);
+    void OnWindowTitleChanged(HWND windowHandle);
+    bool IsCapturableWindow(HWND windowHandle);
+    void LoadFilterRules();
     void ForceUpdateComboBox(HWND comboBoxHandle);
 
 private:
     std::vector<HWND> m_comboBoxes;
     std::vector<WindowInfo> m_windows;
     std::unordered_set<HWND> m_seenWindows;
+    WindowMetadataCache m_metadataCache;
+    WindowFilterRules m_filterRules;
+    WindowSearchIndex m_searchIndex;
+    std::wstring m_searchQuery;
+    std::vector<HWND> m_displayedWindows;
+    std::wstring const* m_coreWindowClassName = nullptr;
+    std::wstring const* m_applicationFrameWindowClassName = nullptr;
     wil::unique_hwineventhook m_eventHook;
 };
\ No newline at end of file
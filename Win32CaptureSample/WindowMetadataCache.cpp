@@ -0,0 +1,42 @@
+#include "pch.h"
+#include "WindowMetadataCache.h"
+
+WindowMetadata& WindowMetadataCache::Get(HWND windowHandle)
+{
+    auto [it, inserted] = m_windows.try_emplace(windowHandle);
+    auto& metadata = it->second;
+    if (inserted)
+    {
+        metadata.Title = m_queries.Title(windowHandle);
+        metadata.ClassName = InternClassName(m_queries.ClassName(windowHandle));
+    }
+    return metadata;
+}
+
+std::wstring const& WindowMetadataCache::GetProcessName(HWND windowHandle)
+{
+    auto& metadata = Get(windowHandle);
+    if (!metadata.ProcessName.has_value())
+    {
+        metadata.ProcessName = m_queries.ProcessName(windowHandle);
+    }
+    return metadata.ProcessName.value();
+}
+
+void WindowMetadataCache::RefreshTitle(HWND windowHandle)
+{
+    auto search = m_windows.find(windowHandle);
+    if (search != m_windows.end())
+    {
+        auto& metadata = search->second;
+        metadata.Title = m_queries.Title(windowHandle);
+    }
+}
+
+std::wstring const* WindowMetadataCache::InternClassName(std::wstring const& className)
+{
+    // Elements of an unordered_set don't move on rehash, so the
+    // pointer stays valid for the lifetime of the cache.
+    auto [it, inserted] = m_classNames.insert(className);
+    return &(*it);
+}
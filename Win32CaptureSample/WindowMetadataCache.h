@@ -0,0 +1,42 @@
+#pragma once
+
+struct WindowMetadata
+{
+    std::wstring Title;
+    // Interned by the cache, compare by pointer
+    std::wstring const* ClassName = nullptr;
+    // Only queried if someone asks for it
+    std::optional<std::wstring> ProcessName;
+};
+
+// How the cache asks the window system about a window. WindowList passes
+// in the Win32 queries, tests pass in a fake.
+struct WindowQueries
+{
+    std::function<std::wstring(HWND)> Title;
+    std::function<std::wstring(HWND)> ClassName;
+    std::function<std::wstring(HWND)> ProcessName;
+};
+
+// Window titles and class names don't change very often, but we get
+// several hook events for the same window (show, uncloak, name change...).
+// This cache keeps what we queried last time around until the window
+// is renamed or destroyed.
+class WindowMetadataCache
+{
+public:
+    WindowMetadataCache(WindowQueries queries) : m_queries(std::move(queries)) {}
+    ~WindowMetadataCache() {}
+
+    WindowMetadata& Get(HWND windowHandle);
+    std::wstring const& GetProcessName(HWND windowHandle);
+    void RefreshTitle(HWND windowHandle);
+    void Remove(HWND windowHandle) { m_windows.erase(windowHandle); }
+
+    std::wstring const* InternClassName(std::wstring const& className);
+
+private:
+    WindowQueries m_queries;
+    std::unordered_map<HWND, WindowMetadata> m_windows;
+    std::unordered_set<std::wstring> m_classNames;
+};
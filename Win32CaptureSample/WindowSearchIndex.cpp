@@ -0,0 +1,216 @@
+#include "pch.h"
+#include "WindowSearchIndex.h"
+
+bool inline IsWordSeparator(wchar_t character)
+{
+    return character == L' ' || character == L'-' || character == L'_' || character == L'.' ||
+        character == L'\\' || character == L'/' || character == L'|' || character == L':';
+}
+
+int ScoreSubsequence(std::wstring_view text, std::wstring_view query)
+{
+    if (query.empty())
+    {
+        return 0;
+    }
+
+    auto score = 0;
+    size_t queryIndex = 0;
+    auto lastMatch = std::wstring_view::npos;
+    for (size_t i = 0; i < text.size() && queryIndex < query.size(); i++)
+    {
+        if (text[i] != query[queryIndex])
+        {
+            continue;
+        }
+        score += 1;
+        if (lastMatch != std::wstring_view::npos && lastMatch + 1 == i)
+        {
+            score += 4;
+        }
+        if (i == 0 || IsWordSeparator(text[i - 1]))
+        {
+            score += 3;
+        }
+        lastMatch = i;
+        queryIndex++;
+    }
+    if (queryIndex < query.size())
+    {
+        return -1;
+    }
+
+    // The greedy walk above can miss a contiguous match further along
+    auto substring = text.find(query);
+    if (substring != std::wstring_view::npos)
+    {
+        score += 5 * static_cast<int>(query.size());
+        if (substring == 0)
+        {
+            score += 10;
+        }
+    }
+    return score;
+}
+
+std::wstring WindowSearchIndex::ToLower(std::wstring_view value)
+{
+    std::wstring result(value);
+    for (auto& character : result)
+    {
+        character = static_cast<wchar_t>(towlower(character));
+    }
+    return result;
+}
+
+uint64_t WindowSearchIndex::ComputeCharacterMask(std::wstring_view value)
+{
+    uint64_t mask = 0;
+    for (auto&& character : value)
+    {
+        mask |= 1ull << (static_cast<uint32_t>(character) % 64);
+    }
+    return mask;
+}
+
+int WindowSearchIndex::Score(Entry const& entry, std::wstring_view query, uint64_t queryMask)
+{
+    if ((entry.CharacterMask & queryMask) != queryMask)
+    {
+        return -1;
+    }
+    auto titleScore = ScoreSubsequence(entry.Title, query);
+    if (titleScore >= 0)
+    {
+        // Titles are what the user sees, so prefer them
+        titleScore += static_cast<int>(query.size());
+    }
+    auto classNameScore = ScoreSubsequence(entry.ClassName, query);
+    return std::max(titleScore, classNameScore);
+}
+
+void WindowSearchIndex::Add(HWND windowHandle, std::wstring_view title, std::wstring_view className)
+{
+    if (m_entryIndices.find(windowHandle) != m_entryIndices.end())
+    {
+        Update(windowHandle, title, className);
+        return;
+    }
+
+    Entry entry;
+    entry.WindowHandle = windowHandle;
+    entry.Sequence = m_nextSequence++;
+    entry.Title = ToLower(title);
+    entry.ClassName = ToLower(className);
+    entry.CharacterMask = ComputeCharacterMask(entry.Title) | ComputeCharacterMask(entry.ClassName);
+    m_entryIndices.insert({ windowHandle, m_entries.size() });
+    m_entries.push_back(std::move(entry));
+    m_lastMatchesValid = false;
+}
+
+void WindowSearchIndex::Remove(HWND windowHandle)
+{
+    auto search = m_entryIndices.find(windowHandle);
+    if (search == m_entryIndices.end())
+    {
+        return;
+    }
+
+    // Swap with the last entry so removal doesn't shift everything
+    auto index = search->second;
+    m_entryIndices.erase(search);
+    if (index != m_entries.size() - 1)
+    {
+        m_entries[index] = std::move(m_entries.back());
+        m_entryIndices[m_entries[index].WindowHandle] = index;
+    }
+    m_entries.pop_back();
+    m_lastMatchesValid = false;
+}
+
+void WindowSearchIndex::Update(HWND windowHandle, std::wstring_view title, std::wstring_view className)
+{
+    auto search = m_entryIndices.find(windowHandle);
+    if (search == m_entryIndices.end())
+    {
+        return;
+    }
+
+    auto& entry = m_entries[search->second];
+    entry.Title = ToLower(title);
+    entry.ClassName = ToLower(className);
+    entry.CharacterMask = ComputeCharacterMask(entry.Title) | ComputeCharacterMask(entry.ClassName);
+    m_lastMatchesValid = false;
+}
+
+std::vector<HWND> WindowSearchIndex::Search(std::wstring_view query)
+{
+    auto loweredQuery = ToLower(query);
+    auto queryMask = ComputeCharacterMask(loweredQuery);
+
+    struct Match
+    {
+        int Score;
+        uint64_t Sequence;
+        HWND WindowHandle;
+    };
+    std::vector<Match> matches;
+    auto tryMatch = [&](Entry const& entry)
+    {
+        auto score = Score(entry, loweredQuery, queryMask);
+        if (score >= 0)
+        {
+            matches.push_back({ score, entry.Sequence, entry.WindowHandle });
+        }
+    };
+
+    // Anything that matches "abc" also matched "ab"
+    auto isRefinement = m_lastMatchesValid && loweredQuery.size() > m_lastQuery.size() &&
+        loweredQuery.compare(0, m_lastQuery.size(), m_lastQuery) == 0;
+    if (isRefinement)
+    {
+        for (auto&& windowHandle : m_lastMatches)
+        {
+            tryMatch(m_entries[m_entryIndices.at(windowHandle)]);
+        }
+    }
+    else
+    {
+        for (auto&& entry : m_entries)
+        {
+            tryMatch(entry);
+        }
+    }
+
+    std::sort(matches.begin(), matches.end(), [](auto&& left, auto&& right)
+    {
+        if (left.Score != right.Score)
+        {
+            return left.Score > right.Score;
+        }
+        return left.Sequence < right.Sequence;
+    });
+
+    std::vector<HWND> result;
+    result.reserve(matches.size());
+    for (auto&& match : matches)
+    {
+        result.push_back(match.WindowHandle);
+    }
+
+    m_lastQuery = std::move(loweredQuery);
+    m_lastMatches = result;
+    m_lastMatchesValid = true;
+    return result;
+}
+
+bool WindowSearchIndex::Matches(HWND windowHandle, std::wstring_view query) const
+{
+    auto search = m_entryIndices.find(windowHandle);
+    if (search == m_entryIndices.end())
+    {
+        return false;
+    }
+    auto loweredQuery = ToLower(query);
+    return Score(m_entries[search->second], loweredQuery, ComputeCharacterMask(loweredQuery)) >= 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Fuzzy search over window titles and class names. A query matches a window
+// if its characters appear in order in either the title or the class name
+// (e.g. "vsc" matches "Visual Studio Code"). Matches are ranked so that
+// substrings, consecutive characters and word starts win, and titles are
+// preferred over class names.
+//
+// Each entry keeps a 64-bit mask of the characters it contains so most
+// windows are rejected without looking at the text. When a query extends the
+// previous one (the user typing another character), only the previous
+// matches are searched again.
+class WindowSearchIndex
+{
+public:
+    WindowSearchIndex() {}
+    ~WindowSearchIndex() {}
+
+    void Add(HWND windowHandle, std::wstring_view title, std::wstring_view className);
+    void Remove(HWND windowHandle);
+    void Update(HWND windowHandle, std::wstring_view title, std::wstring_view className);
+
+    // Best match first. An empty query returns every window in the order they were added.
+    std::vector<HWND> Search(std::wstring_view query);
+    bool Matches(HWND windowHandle, std::wstring_view query) const;
+
+private:
+    struct Entry
+    {
+        HWND WindowHandle = nullptr;
+        uint64_t Sequence = 0;
+        std::wstring Title;
+        std::wstring ClassName;
+        uint64_t CharacterMask = 0;
+    };
+
+    static std::wstring ToLower(std::wstring_view value);
+    static uint64_t ComputeCharacterMask(std::wstring_view value);
+    static int Score(Entry const& entry, std::wstring_view query, uint64_t queryMask);
+
+private:
+    std::vector<Entry> m_entries;
+    std::unordered_map<HWND, size_t> m_entryIndices;
+    uint64_t m_nextSequence = 0;
+
+    std::wstring m_lastQuery;
+    std::vector<HWND> m_lastMatches;
+    bool m_lastMatchesValid = false;
+};
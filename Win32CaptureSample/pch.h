@@ -32,11 +32,25 @@
 #include <atomic>
 #include <memory>
 #include <algorithm>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <optional>
 #include <future>
 #include <mutex>
+#include <filesystem>
+#include <fstream>
+#include <execution>
+#include <span>
+#include <bit>
+#include <array>
+#include <numeric>
+#include <deque>
+#include <queue>
+#include <map>
+#include <thread>
+#include <condition_variable>
+#include <functional>
 
 // D3D
 #include <d3d11_4.h>
@@ -50,6 +64,9 @@
 // Shell
 #include <shcore.h>
 
+// Common controls
+#include <CommCtrl.h>
+
 // WIL
 #include <wil/resource.h>
 #include <wil/cppwinrt_helpers.h>